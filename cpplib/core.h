@@ -9,6 +9,7 @@
 #include <vector>
 #include <tuple>
 #include <unordered_map>
+#include <map>
 #include <sstream>
 #include <ostream>
 #include <iostream>
@@ -19,14 +20,49 @@
 #include <cmath>
 #include <algorithm>
 #include <random>
-#include <regex>
+#include <bitset>
+#include <list>
 #include <limits>
 #include <algorithm>
 #include <numeric>
 #include <variant>
+#include <charconv>
+#include <string_view>
 #include <chrono>
 #include <thread>
 #include <future>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <atomic>
+#include <cstdlib>
+#include <optional>
+#include <coroutine>
+#include <filesystem>
+#include <fstream>
+#include <cstring>
+#include <cwchar>
+#include <bit>
+#include <fcntl.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#include <sys/uio.h>
+#include <climits>
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <immintrin.h>
+#endif
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#endif
+#ifdef __linux__
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
 
 // https://github.com/aantron/better-enums
 // #include "enum.h"
@@ -45,6 +81,56 @@ namespace js
     return (static_cast<bool>(vx)) ? (y) : vx; \
 })()
 
+    // errors raised by the runtime itself; the message is always a literal so throwing
+    // one does not allocate
+    struct Error : public std::exception
+    {
+        const char *_message;
+
+        Error(const char *message) noexcept : _message(message)
+        {
+        }
+
+        virtual const char *name() const noexcept
+        {
+            return "Error";
+        }
+
+        const char *what() const noexcept override
+        {
+            return _message;
+        }
+    };
+
+    // an operand of the wrong type, e.g. a number accessor on a string any
+    struct TypeError : public Error
+    {
+        using Error::Error;
+
+        const char *name() const noexcept override
+        {
+            return "TypeError";
+        }
+    };
+
+    struct RangeError : public Error
+    {
+        using Error::Error;
+
+        const char *name() const noexcept override
+        {
+            return "RangeError";
+        }
+    };
+
+    // an operation the runtime has no implementation for with these operand types
+    struct NotImplementedError : public TypeError
+    {
+        NotImplementedError() noexcept : TypeError("not implemented")
+        {
+        }
+    };
+
     struct undefined_t;
     struct any;
     struct boolean;
@@ -96,6 +182,12 @@ namespace js
 
 #define $S std::shared_ptr
 
+// regex literal: compiled once per emission site, a fresh RegExp per evaluation
+#define REGEXP(pattern, flags) ([]() {                                           \
+    static const auto program = js::regexp::compile(TXT(pattern), TXT(flags)); \
+    return std::make_shared<js::RegExp>(program);                                \
+})()
+
     typedef tmpl::number<double> number;
     typedef tmpl::object<string, any> object;
     template <typename T>
@@ -156,4453 +248,11758 @@ namespace js
         return lo_value + 0x9e3779b9 + (hi_value << 6) + (hi_value >> 2);
     }
 
-    static std::ostream &operator<<(std::ostream &os, std::nullptr_t ptr)
-    {
-        return os << "null";
-    }
-
-    template <typename I, typename T>
-    inline bool $is(T *t)
-    {
-        return dynamic_cast<I *>(t) != nullptr;
-    }
-
-    template <typename I, typename T>
-    inline bool $is(const std::shared_ptr<T> &t)
-    {
-        return std::dynamic_pointer_cast<I>(t) != nullptr;
-    }
-
-    template <typename I, typename T>
-    inline bool __is(T *t)
-    {
-        return std::type_index(typeid(I *)) == std::type_index(typeid(t)) || is<I>(t);
-    }
-
-    template <typename I, typename T>
-    inline I $as(T t)
-    {
-        return static_cast<I>(t);
-    }
-
-    template <typename I, typename T>
-    inline I *$as(T *t)
-    {
-        return dynamic_cast<I *>(t);
-    }
-
-    template <typename I, typename T, class = std::enable_if_t<!std::is_same_v<I, any>>>
-    inline std::shared_ptr<I> $as(const std::shared_ptr<T> &t)
-    {
-        return std::dynamic_pointer_cast<I>(t);
-    }
-
-    template <typename I, typename T, class = std::enable_if_t<std::is_same_v<I, any>>>
-    inline I $as(const std::shared_ptr<T> &t)
-    {
-        return I(t);
-    }
-
-    template <class T>
-    static string type_of(T value);
-
-    template <typename T>
-    inline auto isNaN(T t)
-    {
-        return std::isnan(static_cast<double>(t));
-    }
-
-    template <typename R, typename T>
-    inline R cast(T t)
-    {
-        return static_cast<R>(t);
-    }
-
-    template <typename T>
-    constexpr const T &const_(T &t)
-    {
-        return static_cast<const T &>(t);
-    }
-
-    template <typename T>
-    constexpr const T *const_(T *t)
-    {
-        return static_cast<const T *>(t);
-    }
-
-    /*
-template <typename T> 
-constexpr const T const_(T t) {
-	return static_cast<const T>(t);
-}
-*/
-
-    template <typename T>
-    constexpr T &mutable_(const T &t)
-    {
-        return const_cast<T &>(t);
-    }
-
-    template <typename T>
-    constexpr T *mutable_(const T *t)
+    // Number formatting ////////////////////////////////////////////////////////////////
+    // ECMAScript Number::toString, toFixed and toPrecision on top of std::to_chars.
+    // Digits are produced into a stack buffer and appended to the destination string
+    // in one go; no streams, no locale.
+    namespace numfmt
     {
-        return const_cast<T *>(t);
-    }
+        // enough for a double written exactly: 767 significant digits plus sign/point/exponent
+        constexpr size_t exact_buffer = 800;
+        constexpr const char *radix_digits = "0123456789abcdefghijklmnopqrstuvwxyz";
 
-    template <typename T>
-    constexpr T &deref_(T *t)
-    {
-        return *t;
-    }
+        // x = 0.digits * 10^point
+        struct decimal_t
+        {
+            char digits[exact_buffer];
+            int count = 0;
+            int point = 0;
+        };
 
-    template <typename T>
-    constexpr T deref_(T t)
-    {
-        return t;
-    }
+        // splits "d.ddde+XX" as written by to_chars(scientific) into digits and point
+        inline void split_scientific(const char *first, const char *last, decimal_t &decimal)
+        {
+            decimal.count = 0;
+            auto it = first;
+            for (; it != last && *it != 'e'; ++it)
+            {
+                if (*it != '.')
+                {
+                    decimal.digits[decimal.count++] = *it;
+                }
+            }
 
-    template <typename T>
-    constexpr auto keys_(const T &t)
-    {
-        return mutable_(t)->keys();
-    }
+            int exponent = 0;
+            std::from_chars(it + 1 + (it[1] == '+'), last, exponent);
+            decimal.point = exponent + 1;
 
-    template <typename T>
-    constexpr auto keys_(T &t)
-    {
-        return t->keys();
-    }
+            while (decimal.count > 1 && decimal.digits[decimal.count - 1] == '0')
+            {
+                decimal.count--;
+            }
+        }
 
-    namespace bitwise
-    {
-        template <typename T1, typename T2>
-        constexpr auto rshift(T1 op1, T2 op2)
+        // shortest digits that round-trip, for non-zero finite positive values
+        inline void shortest(double value, decimal_t &decimal)
         {
-            auto op1ll = static_cast<long long>(op1);
-            auto op1l = static_cast<long>(op1ll);
-            auto op2ll = static_cast<long long>(op2);
-            auto op2ul = static_cast<unsigned long>(op2ll);
-            auto op2ul32 = op2ul & 0x1f;
-            auto r = op1l >> op2ul32;
-            auto rl = static_cast<long>(r);
-            return static_cast<T1>(rl);
+            char buffer[64];
+            auto result = std::to_chars(buffer, buffer + sizeof(buffer), value, std::chars_format::scientific);
+            split_scientific(buffer, result.ptr, decimal);
         }
 
-        template <typename T1, typename T2>
-        constexpr auto rshift_nosign(T1 op1, T2 op2)
+        // every digit of the binary value, for non-zero finite positive values
+        inline void exact(double value, decimal_t &decimal)
         {
-            auto op1ll = static_cast<long long>(op1);
-            auto op1ul = static_cast<unsigned long>(op1ll);
-            auto op2ll = static_cast<long long>(op2);
-            auto op2ul = static_cast<unsigned long>(op2ll);
-            auto op2ul32 = op2ul & 0x1f;
-            auto r = op1ul >> op2ul32;
-            auto rul = static_cast<unsigned long>(r);
-            return static_cast<T1>(rul);
+            char buffer[exact_buffer + 16];
+            auto result = std::to_chars(buffer, buffer + sizeof(buffer), value, std::chars_format::scientific, 770);
+            split_scientific(buffer, result.ptr, decimal);
         }
 
-        template <typename T1, typename T2>
-        constexpr auto lshift(T1 op1, T2 op2)
+        // keeps 'keep' digits, rounding half up as toFixed/toPrecision require
+        inline void round(decimal_t &decimal, int keep)
         {
-            auto op1ll = static_cast<long long>(op1);
-            auto op1l = static_cast<long>(op1ll);
-            auto op2ll = static_cast<long long>(op2);
-            auto op2ul = static_cast<unsigned long>(op2ll);
-            auto op2ul32 = op2ul & 0x1f;
-            auto r = op1l << op2ul32;
-            auto rl = static_cast<long>(r);
-            return static_cast<T1>(rl);
-        }
+            if (keep >= decimal.count)
+            {
+                return;
+            }
 
-    } // namespace bitwise
+            if (keep < 0)
+            {
+                decimal.count = 0;
+                return;
+            }
 
-    static struct undefined_t
-    {
-        constexpr undefined_t()
-        {
+            auto up = decimal.digits[keep] >= '5';
+            decimal.count = keep;
+            if (!up)
+            {
+                return;
+            }
+
+            for (auto i = keep - 1; i >= 0; i--)
+            {
+                if (decimal.digits[i] != '9')
+                {
+                    decimal.digits[i]++;
+                    decimal.count = i + 1;
+                    return;
+                }
+            }
+
+            // carried out of the leading digit: 99.5 -> 100
+            decimal.digits[0] = '1';
+            decimal.count = 1;
+            decimal.point++;
         }
 
-        constexpr undefined_t(const undefined_t &)
+        template <typename S>
+        inline void append(S &out, const char *first, const char *last)
         {
+            out.append(first, last);
         }
 
-        constexpr operator bool()
+        inline bool append_special(tstring &out, double value)
         {
+            if (std::isnan(value))
+            {
+                out.append(TXT("NaN"));
+                return true;
+            }
+
+            if (std::isinf(value))
+            {
+                out.append(value < 0 ? TXT("-Infinity") : TXT("Infinity"));
+                return true;
+            }
+
+            if (value == 0)
+            {
+                out.push_back(TXT('0'));
+                return true;
+            }
+
             return false;
         }
 
-        constexpr operator std::nullptr_t()
+        inline void append_zeros(tstring &out, int count)
         {
-            return nullptr;
+            if (count > 0)
+            {
+                out.append(static_cast<size_t>(count), TXT('0'));
+            }
         }
 
-        constexpr bool operator==(undefined_t)
+        inline void append_digits(tstring &out, const decimal_t &decimal, int from, int to)
         {
-            return true;
+            for (auto i = from; i < to; i++)
+            {
+                out.push_back(i < decimal.count ? static_cast<char_t>(decimal.digits[i]) : TXT('0'));
+            }
         }
 
-        constexpr bool operator!=(undefined_t)
+        inline void append_exponent(tstring &out, int exponent)
         {
-            return false;
+            out.push_back(TXT('e'));
+            out.push_back(exponent < 0 ? TXT('-') : TXT('+'));
+            char buffer[8];
+            auto result = std::to_chars(buffer, buffer + sizeof(buffer), exponent < 0 ? -exponent : exponent);
+            append(out, buffer, result.ptr);
         }
 
-        constexpr bool operator==(const pointer_t &)
+        // Number::toString(10)
+        inline void append_number(tstring &out, double value)
         {
-            return false;
+            if (append_special(out, value))
+            {
+                return;
+            }
+
+            if (value < 0)
+            {
+                out.push_back(TXT('-'));
+                value = -value;
+            }
+
+            decimal_t decimal;
+            shortest(value, decimal);
+            auto k = decimal.count;
+            auto n = decimal.point;
+            if (k <= n && n <= 21)
+            {
+                append_digits(out, decimal, 0, n);
+            }
+            else if (0 < n && n <= 21)
+            {
+                append_digits(out, decimal, 0, n);
+                out.push_back(TXT('.'));
+                append_digits(out, decimal, n, k);
+            }
+            else if (-6 < n && n <= 0)
+            {
+                out.append(TXT("0."));
+                append_zeros(out, -n);
+                append_digits(out, decimal, 0, k);
+            }
+            else
+            {
+                append_digits(out, decimal, 0, 1);
+                if (k > 1)
+                {
+                    out.push_back(TXT('.'));
+                    append_digits(out, decimal, 1, k);
+                }
+
+                append_exponent(out, n - 1);
+            }
         }
 
-        constexpr bool operator!=(const pointer_t &)
+        // Number::toString(radix) for radix != 10, digit generation as in V8's
+        // DoubleToRadixCString: fraction digits stop once they identify the double
+        inline void append_radix(tstring &out, double value, int radix)
         {
-            return true;
-        }
+            if (append_special(out, value))
+            {
+                return;
+            }
 
-        template <typename N = void>
-        requires ArithmeticOrEnum<N>
-        bool operator==(N n) const;
+            char buffer[2200];
+            auto integer_cursor = sizeof(buffer) / 2;
+            auto fraction_cursor = integer_cursor;
+            auto negative = value < 0;
+            if (negative)
+            {
+                value = -value;
+            }
 
-        template <typename N = void>
-        requires ArithmeticOrEnum<N>
-        bool operator!=(N n) const;
+            auto integer = std::floor(value);
+            auto fraction = value - integer;
+            auto delta = std::max(0.5 * (std::nextafter(value, std::numeric_limits<double>::infinity()) - value), std::nextafter(0.0, 1.0));
+            if (fraction >= delta)
+            {
+                buffer[fraction_cursor++] = '.';
+                do
+                {
+                    fraction *= radix;
+                    delta *= radix;
+                    auto digit = static_cast<int>(fraction);
+                    buffer[fraction_cursor++] = radix_digits[digit];
+                    fraction -= digit;
+                    if (fraction > 0.5 || (fraction == 0.5 && (digit & 1)))
+                    {
+                        if (fraction + delta > 1)
+                        {
+                            // round up, propagating into the integer part if needed
+                            for (;;)
+                            {
+                                fraction_cursor--;
+                                if (fraction_cursor == sizeof(buffer) / 2)
+                                {
+                                    integer += 1;
+                                    break;
+                                }
+
+                                auto c = buffer[fraction_cursor];
+                                auto d = c > '9' ? c - 'a' + 10 : c - '0';
+                                if (d + 1 < radix)
+                                {
+                                    buffer[fraction_cursor++] = radix_digits[d + 1];
+                                    break;
+                                }
+                            }
+
+                            break;
+                        }
+                    }
+                } while (fraction >= delta);
+            }
 
-        template <typename N/* = void*/>
-        requires ArithmeticOrEnum<N>
-        friend bool operator==(N n, const undefined_t &u);
+            // beyond 2^53 the low digits are not representable, V8 writes zeros
+            while (integer / radix >= 9007199254740992.0)
+            {
+                integer /= radix;
+                buffer[--integer_cursor] = '0';
+            }
 
-        template <typename N/* = void*/>
-        requires ArithmeticOrEnum<N>
-        friend bool operator!=(N n, const undefined_t &u);
+            do
+            {
+                auto remainder = std::fmod(integer, radix);
+                buffer[--integer_cursor] = radix_digits[static_cast<int>(remainder)];
+                integer = (integer - remainder) / radix;
+            } while (integer > 0);
 
-        friend std::ostream &operator<<(std::ostream &os, undefined_t)
-        {
-            return os << "undefined";
-        }
-    } undefined;
+            if (negative)
+            {
+                buffer[--integer_cursor] = '-';
+            }
 
-    struct void_t
-    {
-        constexpr operator bool()
-        {
-            return false;
+            append(out, buffer + integer_cursor, buffer + fraction_cursor);
         }
 
-        constexpr bool operator==(void_t)
+        inline void append_fixed_digits(tstring &out, const decimal_t &decimal, int digits)
         {
-            return true;
-        }
+            if (decimal.point <= 0)
+            {
+                out.push_back(TXT('0'));
+            }
+            else
+            {
+                append_digits(out, decimal, 0, decimal.point);
+            }
 
-        constexpr bool operator!=(void_t)
-        {
-            return false;
+            if (digits > 0)
+            {
+                out.push_back(TXT('.'));
+                if (decimal.point < 0)
+                {
+                    auto zeros = std::min(-decimal.point, digits);
+                    append_zeros(out, zeros);
+                    append_digits(out, decimal, 0, digits - zeros);
+                }
+                else
+                {
+                    append_digits(out, decimal, decimal.point, decimal.point + digits);
+                }
+            }
         }
 
-        constexpr bool operator==(undefined_t)
+        // Number::toFixed(digits)
+        inline void append_fixed(tstring &out, double value, int digits)
         {
-            return true;
+            if (std::isnan(value))
+            {
+                out.append(TXT("NaN"));
+                return;
+            }
+
+            if (std::abs(value) >= 1e21 || std::isinf(value))
+            {
+                append_number(out, value);
+                return;
+            }
+
+            if (value < 0)
+            {
+                value = -value;
+                decimal_t decimal;
+                exact(value, decimal);
+                round(decimal, decimal.point + digits);
+                // -0.001.toFixed(2) is "-0.00"
+                out.push_back(TXT('-'));
+                append_fixed_digits(out, decimal, digits);
+                return;
+            }
+
+            decimal_t decimal;
+            if (value == 0)
+            {
+                decimal.count = 0;
+                decimal.point = 1;
+            }
+            else
+            {
+                exact(value, decimal);
+                round(decimal, decimal.point + digits);
+            }
+
+            append_fixed_digits(out, decimal, digits);
         }
 
-        constexpr bool operator!=(undefined_t)
+        // Number::toPrecision(precision)
+        inline void append_precision(tstring &out, double value, int precision)
         {
-            return false;
+            if (std::isnan(value) || std::isinf(value))
+            {
+                append_number(out, value);
+                return;
+            }
+
+            if (value < 0)
+            {
+                out.push_back(TXT('-'));
+                value = -value;
+            }
+
+            decimal_t decimal;
+            if (value == 0)
+            {
+                decimal.count = 0;
+                decimal.point = 1;
+            }
+            else
+            {
+                exact(value, decimal);
+                round(decimal, precision);
+            }
+
+            auto e = decimal.point - 1;
+            if (e < -6 || e >= precision)
+            {
+                append_digits(out, decimal, 0, 1);
+                if (precision > 1)
+                {
+                    out.push_back(TXT('.'));
+                    append_digits(out, decimal, 1, precision);
+                }
+
+                append_exponent(out, e);
+            }
+            else if (e >= 0)
+            {
+                append_digits(out, decimal, 0, e + 1);
+                if (precision > e + 1)
+                {
+                    out.push_back(TXT('.'));
+                    append_digits(out, decimal, e + 1, precision);
+                }
+            }
+            else
+            {
+                out.append(TXT("0."));
+                append_zeros(out, -(e + 1));
+                append_digits(out, decimal, 0, precision);
+            }
         }
 
-        template <typename T>
-        constexpr bool operator==(T)
+        inline tstring to_string(double value, int radix = 10)
         {
-            return false;
+            tstring out;
+            if (radix == 10)
+            {
+                append_number(out, value);
+            }
+            else
+            {
+                append_radix(out, value, radix);
+            }
+
+            return out;
         }
+    } // namespace numfmt
 
-        template <typename T>
-        constexpr bool operator!=(T)
+    // Number parsing ///////////////////////////////////////////////////////////////////
+    // parseInt, parseFloat and ToNumber(string) over string views with std::from_chars;
+    // nothing throws and nothing allocates, bad input simply yields NaN.
+    namespace numparse
+    {
+        typedef std::basic_string_view<char_t> view_t;
+
+        constexpr double nan = std::numeric_limits<double>::quiet_NaN();
+        constexpr double infinity = std::numeric_limits<double>::infinity();
+
+        // WhiteSpace and LineTerminator code points
+        constexpr bool is_space(char_t c)
         {
-            return true;
+            switch (c)
+            {
+            case 0x09:
+            case 0x0a:
+            case 0x0b:
+            case 0x0c:
+            case 0x0d:
+            case 0x20:
+                return true;
+            }
+
+#ifdef UNICODE
+            return c == 0xa0 || c == 0x1680 || (c >= 0x2000 && c <= 0x200a) || c == 0x2028 || c == 0x2029 || c == 0x202f || c == 0x205f || c == 0x3000 || c == 0xfeff;
+#else
+            return false;
+#endif
         }
-    };
 
-    namespace tmpl
-    {
-        template <typename T>
-        struct pointer_t
+        constexpr int digit_value(char_t c)
         {
-            bool isUndefined;
-            T _ptr;
+            if (c >= '0' && c <= '9')
+            {
+                return c - '0';
+            }
 
-            pointer_t() : _ptr(nullptr), isUndefined(false){};
+            if (c >= 'a' && c <= 'z')
+            {
+                return c - 'a' + 10;
+            }
 
-            pointer_t(const pointer_t &other) : _ptr(other._ptr), isUndefined(other.isUndefined){};
+            if (c >= 'A' && c <= 'Z')
+            {
+                return c - 'A' + 10;
+            }
 
-            pointer_t(void *ptr) : _ptr(static_cast<T>(ptr)), isUndefined(false){};
+            return 99;
+        }
 
-            pointer_t(std::nullptr_t) : _ptr(nullptr), isUndefined(false){};
+        inline view_t trim_start(view_t text)
+        {
+            size_t i = 0;
+            while (i < text.size() && is_space(text[i]))
+            {
+                i++;
+            }
 
-            pointer_t(js::number);
+            return text.substr(i);
+        }
 
-            pointer_t(const undefined_t &undef) : _ptr(nullptr), isUndefined(true)
+        inline view_t trim(view_t text)
+        {
+            text = trim_start(text);
+            auto n = text.size();
+            while (n > 0 && is_space(text[n - 1]))
             {
+                n--;
             }
 
-            constexpr operator bool()
+            return text.substr(0, n);
+        }
+
+        // from_chars only takes char, wide text is narrowed into a stack buffer first;
+        // consumed is set to the number of characters the literal spans
+        inline double decimal_prefix(view_t text, size_t &consumed)
+        {
+            consumed = 0;
+            if (text.empty() || !(digit_value(text[0]) < 10 || text[0] == '.'))
             {
-                return !isUndefined && _ptr != nullptr;
+                return nan;
             }
 
-            constexpr operator void *()
+            double value = nan;
+#ifdef UNICODE
+            char buffer[512];
+            size_t n = 0;
+            while (n < text.size() && n < sizeof(buffer) && text[n] < 0x80)
             {
-                return static_cast<void *>(_ptr);
+                buffer[n] = static_cast<char>(text[n]);
+                n++;
             }
 
-            template <typename T2>
-            constexpr operator std::shared_ptr<T2>()
+            auto result = std::from_chars(buffer, buffer + n, value, std::chars_format::general);
+            if (result.ec != std::errc() && result.ec != std::errc::result_out_of_range)
             {
-                return std::shared_ptr<T2>(static_cast<T2 *>(_ptr));
+                return nan;
             }
 
-            template <typename T2>
-            constexpr operator const T2 *()
+            consumed = result.ptr - buffer;
+#else
+            auto result = std::from_chars(text.data(), text.data() + text.size(), value, std::chars_format::general);
+            if (result.ec != std::errc() && result.ec != std::errc::result_out_of_range)
             {
-                return isUndefined ? static_cast<const T2 *>(nullptr) : static_cast<const T2 *>(_ptr);
+                return nan;
             }
 
-            template <typename T2 = void>
-            requires ArithmeticOrEnum<T2>
-            constexpr operator T2()
+            consumed = result.ptr - text.data();
+#endif
+            if (result.ec == std::errc::result_out_of_range)
             {
-                return static_cast<T2>(reinterpret_cast<intptr_t>(_ptr));
+                // from_chars leaves value untouched when the literal over/underflows
+                auto exponent = text.find_first_of(TXT("eE"));
+                value = exponent < consumed && text.substr(exponent + 1, 1) == TXT("-") ? 0.0 : infinity;
             }
 
-            operator tstring() const
+            return value;
+        }
+
+        inline bool starts_with_infinity(view_t text)
+        {
+            return text.substr(0, 8) == TXT("Infinity");
+        }
+
+        // digits in radix 2..36; consumed is how many characters were digits
+        inline double integer_prefix(view_t text, int radix, size_t &consumed)
+        {
+            consumed = 0;
+            while (consumed < text.size() && digit_value(text[consumed]) < radix)
             {
-                tostringstream streamObj2;
-                streamObj2 << TXT("null");
-                return streamObj2.str();
+                consumed++;
             }
 
-            operator tstring()
+            if (consumed == 0)
             {
-                tostringstream streamObj2;
-                streamObj2 << TXT("null");
-                return streamObj2.str();
+                return nan;
             }
 
-            bool operator==(undefined_t)
+            if (radix == 10)
             {
-                return isUndefined;
+                // correctly rounded for any number of digits
+                size_t decimal_consumed;
+                return decimal_prefix(text.substr(0, consumed), decimal_consumed);
             }
 
-            bool operator!=(undefined_t)
+            uint64_t exact = 0;
+            size_t i = 0;
+            for (; i < consumed; i++)
             {
-                return !isUndefined;
+                auto digit = static_cast<uint64_t>(digit_value(text[i]));
+                if (exact > (std::numeric_limits<uint64_t>::max() - digit) / radix)
+                {
+                    break;
+                }
+
+                exact = exact * radix + digit;
             }
 
-            bool operator==(pointer_t p)
+            auto value = static_cast<double>(exact);
+            for (; i < consumed; i++)
             {
-                return isUndefined == p.isUndefined && _ptr == p._ptr;
+                value = value * radix + digit_value(text[i]);
             }
 
-            bool operator!=(pointer_t p)
+            return value;
+        }
+
+        // parseFloat: longest StrDecimalLiteral prefix after leading whitespace
+        inline double parse_float(view_t text)
+        {
+            text = trim_start(text);
+            auto negative = false;
+            if (!text.empty() && (text[0] == '-' || text[0] == '+'))
             {
-                return isUndefined != p.isUndefined || _ptr != p._ptr;
+                negative = text[0] == '-';
+                text.remove_prefix(1);
             }
 
-            template <typename N = void>
-            requires ArithmeticOrEnumOrNumber<N>
-            bool operator==(N n);
+            if (starts_with_infinity(text))
+            {
+                return negative ? -infinity : infinity;
+            }
 
-            template <typename N = void>
-            requires ArithmeticOrEnumOrNumber<N>
-            bool operator!=(N n);
+            size_t consumed;
+            auto value = decimal_prefix(text, consumed);
+            return negative ? -value : value;
+        }
 
-            template <typename N = void>
-            requires ArithmeticOrEnum<N>
-            friend bool operator==(N n, const pointer_t p)
+        // parseInt: radix 0 means 10, or 16 with a 0x prefix
+        inline double parse_int(view_t text, int radix = 0)
+        {
+            text = trim_start(text);
+            auto negative = false;
+            if (!text.empty() && (text[0] == '-' || text[0] == '+'))
             {
-                return !p.isUndefined && false;
+                negative = text[0] == '-';
+                text.remove_prefix(1);
             }
 
-            template <typename N = void>
-            requires ArithmeticOrEnum<N>
-            friend bool operator!=(N n, const pointer_t p)
+            auto strip_prefix = true;
+            if (radix != 0)
             {
-                return p.isUndefined || true;
+                if (radix < 2 || radix > 36)
+                {
+                    return nan;
+                }
+
+                strip_prefix = radix == 16;
+            }
+            else
+            {
+                radix = 10;
             }
 
-            /*template <typename _Ty>
-            bool operator==(std::shared_ptr<_Ty> sp)
+            if (strip_prefix && text.size() >= 2 && text[0] == '0' && (text[1] == 'x' || text[1] == 'X'))
             {
-                return false;
+                text.remove_prefix(2);
+                radix = 16;
             }
 
-            template <typename _Ty>
-            bool operator!=(std::shared_ptr<_Ty> sp)
+            size_t consumed;
+            auto value = integer_prefix(text, radix, consumed);
+            return negative ? -value : value;
+        }
+
+        // ToNumber(string): the whole trimmed text has to be a numeric literal
+        inline double to_number(view_t text)
+        {
+            text = trim(text);
+            if (text.empty())
             {
-                return false;
-            }*/
+                return 0;
+            }
 
-            friend std::ostream &operator<<(std::ostream &os, pointer_t val)
+            if (text.size() > 2 && text[0] == '0')
             {
-                if (!val.isUndefined && val._ptr == nullptr)
+                auto radix = text[1] == 'x' || text[1] == 'X' ? 16 : text[1] == 'o' || text[1] == 'O' ? 8 : text[1] == 'b' || text[1] == 'B' ? 2 : 0;
+                if (radix != 0)
                 {
-                    return os << "null";
+                    size_t consumed;
+                    auto value = integer_prefix(text.substr(2), radix, consumed);
+                    return consumed == text.size() - 2 ? value : nan;
                 }
+            }
 
-                return os << val._ptr;
+            auto body = text;
+            auto negative = false;
+            if (body[0] == '-' || body[0] == '+')
+            {
+                negative = body[0] == '-';
+                body.remove_prefix(1);
             }
-        };
 
-    }
+            if (body == TXT("Infinity"))
+            {
+                return negative ? -infinity : infinity;
+            }
 
-    static pointer_t null;
+            size_t consumed;
+            auto value = decimal_prefix(body, consumed);
+            if (consumed != body.size())
+            {
+                return nan;
+            }
 
-    template <typename L, typename R>
-    constexpr bool equals(L l, R r)
-    {
-        auto lIsUndef = l == undefined;
-        auto lIsNull = l == null;
-        auto rIsUndef = r == undefined;
-        auto rIsNull = r == null;
-        return ((lIsUndef || lIsNull) && (rIsUndef || rIsNull)) || l == r;
-    }
+            return negative ? -value : value;
+        }
+    } // namespace numparse
 
-    template <typename L, typename R>
-    constexpr bool not_equals(L l, R r)
+    // String search ////////////////////////////////////////////////////////////////////
+    // Substring search for indexOf, includes, split and replace: single code units go to
+    // memchr/wmemchr, longer needles compare the first and last code unit at 16 bytes of
+    // candidate positions at once (SSE2) and only verify the positions where both match.
+    namespace strsearch
     {
-        return !equals(l, r);
-    }
+        typedef std::basic_string_view<char_t> view_t;
 
-    struct boolean
-    {
-        enum control_t
-        {
-            boolean_false = 0,
-            boolean_true = 1,
-            boolean_undefined = 2
-        } _control;
+        constexpr size_t npos = view_t::npos;
 
-        constexpr boolean() : _control(boolean_undefined)
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define STRSEARCH_SIMD
+        namespace simd
         {
-        }
+            typedef __m128i vector_t;
 
-        inline boolean(const boolean &value) : _control(value._control)
-        {
-        }
+            inline vector_t load(const char_t *data)
+            {
+                return _mm_loadu_si128(reinterpret_cast<const vector_t *>(data));
+            }
 
-        inline boolean(bool value) : _control(static_cast<control_t>(value))
-        {
-        }
+            inline vector_t splat(char_t c)
+            {
+                if constexpr (sizeof(char_t) == 1)
+                {
+                    return _mm_set1_epi8(static_cast<char>(c));
+                }
+                else if constexpr (sizeof(char_t) == 2)
+                {
+                    return _mm_set1_epi16(static_cast<short>(c));
+                }
+                else
+                {
+                    return _mm_set1_epi32(static_cast<int>(c));
+                }
+            }
 
-        constexpr boolean(const undefined_t &) : _control(boolean_undefined)
-        {
-        }
+            inline vector_t equal(vector_t a, vector_t b)
+            {
+                if constexpr (sizeof(char_t) == 1)
+                {
+                    return _mm_cmpeq_epi8(a, b);
+                }
+                else if constexpr (sizeof(char_t) == 2)
+                {
+                    return _mm_cmpeq_epi16(a, b);
+                }
+                else
+                {
+                    return _mm_cmpeq_epi32(a, b);
+                }
+            }
 
-        constexpr operator bool() const
+            // one bit per byte where both a and b are set
+            inline uint32_t mask(vector_t a, vector_t b)
+            {
+                return static_cast<uint32_t>(_mm_movemask_epi8(_mm_and_si128(a, b)));
+            }
+        } // namespace simd
+#endif
+
+        inline size_t find_char(view_t text, char_t c, size_t from = 0)
         {
-            return _control == boolean_true;
+            if (from >= text.size())
+            {
+                return npos;
+            }
+
+#ifdef UNICODE
+            auto found = std::wmemchr(text.data() + from, c, text.size() - from);
+#else
+            auto found = static_cast<const char_t *>(std::memchr(text.data() + from, c, text.size() - from));
+#endif
+            return found ? found - text.data() : npos;
         }
 
-        constexpr operator bool()
+        // first occurrence of pattern at or after from, like basic_string_view::find
+        inline size_t find(view_t text, view_t pattern, size_t from = 0)
         {
-            return _control == boolean_true;
+            auto size = text.size();
+            auto length = pattern.size();
+            if (length == 0)
+            {
+                return from <= size ? from : npos;
+            }
+
+            if (from >= size || length > size - from)
+            {
+                return npos;
+            }
+
+            if (length == 1)
+            {
+                return find_char(text, pattern[0], from);
+            }
+
+#ifdef STRSEARCH_SIMD
+            // memchr skips ahead cheaply when the first code unit is rare
+            auto i = find_char(text, pattern[0], from);
+            if (i == npos)
+            {
+                return npos;
+            }
+
+            constexpr size_t lanes = sizeof(simd::vector_t) / sizeof(char_t);
+            constexpr uint32_t lane_bits = (1u << sizeof(char_t)) - 1;
+
+            auto data = text.data();
+            auto first = simd::splat(pattern[0]);
+            auto last = simd::splat(pattern[length - 1]);
+            for (; i + length - 1 + lanes <= size; i += lanes)
+            {
+                auto candidates = simd::mask(simd::equal(first, simd::load(data + i)), simd::equal(last, simd::load(data + i + length - 1)));
+                while (candidates != 0)
+                {
+                    auto bit = std::countr_zero(candidates);
+                    auto position = i + bit / sizeof(char_t);
+                    if (std::char_traits<char_t>::compare(data + position + 1, pattern.data() + 1, length - 2) == 0)
+                    {
+                        return position;
+                    }
+
+                    candidates &= ~(lane_bits << bit);
+                }
+            }
+
+            return text.find(pattern, i);
+#else
+            return text.find(pattern, from);
+#endif
         }
 
-        constexpr boolean *operator->()
+        // calls f with each piece of text between separators, at most limit pieces; an
+        // empty separator splits into code units
+        template <typename F>
+        inline void split(view_t text, view_t separator, size_t limit, F &&f)
         {
-            return this;
+            if (limit == 0)
+            {
+                return;
+            }
+
+            if (separator.empty())
+            {
+                for (size_t i = 0; i < text.size() && i < limit; i++)
+                {
+                    f(text.substr(i, 1));
+                }
+
+                return;
+            }
+
+            size_t count = 0;
+            size_t start = 0;
+            for (auto found = find(text, separator); found != npos; found = find(text, separator, start))
+            {
+                f(text.substr(start, found - start));
+                if (++count == limit)
+                {
+                    return;
+                }
+
+                start = found + separator.size();
+            }
+
+            f(text.substr(start));
         }
 
-        inline bool operator==(undefined_t) const
+        // GetSubstitution for a string pattern: $$, $&, $` and $'
+        inline void append_substitution(tstring &out, view_t text, size_t position, size_t length, view_t replacement)
         {
-            return _control == boolean_undefined;
+            for (size_t i = 0; i < replacement.size(); i++)
+            {
+                auto c = replacement[i];
+                if (c != '$' || i + 1 == replacement.size())
+                {
+                    out += c;
+                    continue;
+                }
+
+                switch (replacement[i + 1])
+                {
+                case '$':
+                    out += '$';
+                    break;
+                case '&':
+                    out.append(text.substr(position, length));
+                    break;
+                case '`':
+                    out.append(text.substr(0, position));
+                    break;
+                case '\'':
+                    out.append(text.substr(position + length));
+                    break;
+                default:
+                    out += c;
+                    continue;
+                }
+
+                i++;
+            }
         }
 
-        inline bool operator!=(undefined_t) const
+        // String.prototype.replace / replaceAll with a string pattern
+        inline tstring replace(view_t text, view_t pattern, view_t replacement, bool all)
         {
-            return _control != boolean_undefined;
+            auto found = find(text, pattern);
+            if (found == npos)
+            {
+                return tstring(text);
+            }
+
+            tstring out;
+            out.reserve(text.size() + replacement.size());
+            size_t start = 0;
+            while (found != npos)
+            {
+                out.append(text.substr(start, found - start));
+                append_substitution(out, text, found, pattern.size(), replacement);
+                start = found + pattern.size();
+                if (!all)
+                {
+                    break;
+                }
+
+                found = pattern.empty() ? (found < text.size() ? found + 1 : npos) : find(text, pattern, start);
+                if (pattern.empty() && found != npos)
+                {
+                    out += text[start];
+                    start++;
+                }
+            }
+
+            out.append(text.substr(start));
+            return out;
         }
 
-        inline bool operator==(pointer_t) const
+        // ToIntegerOrInfinity clamped to [0, size]
+        inline size_t clamp_position(double position, size_t size)
         {
-            return false;
+            if (std::isnan(position) || position <= 0)
+            {
+                return 0;
+            }
+
+            return position >= static_cast<double>(size) ? size : static_cast<size_t>(position);
         }
+    } // namespace strsearch
 
-        inline bool operator!=(pointer_t) const
+    // UTF-8 / UTF-16 ///////////////////////////////////////////////////////////////////
+    // JS strings are sequences of UTF-16 code units. Narrow builds keep their text as
+    // UTF-8 for I/O (WTF-8 when a lone surrogate has to be kept) and index ASCII text in
+    // place; other text gets its UTF-16 code units decoded once, on first indexed access.
+    namespace utf
+    {
+        constexpr char16_t replacement = 0xfffd;
+
+        inline bool is_ascii(std::string_view text)
         {
+            auto data = text.data();
+            auto size = text.size();
+            size_t i = 0;
+            for (; i + 8 <= size; i += 8)
+            {
+                uint64_t word;
+                std::memcpy(&word, data + i, 8);
+                if (word & 0x8080808080808080ull)
+                {
+                    return false;
+                }
+            }
+
+            for (; i < size; i++)
+            {
+                if (static_cast<unsigned char>(data[i]) >= 0x80)
+                {
+                    return false;
+                }
+            }
+
             return true;
         }
 
-        inline bool operator==(undefined_t)
+        // length of the sequence starting with lead, 0 for a byte that cannot start one
+        constexpr size_t sequence_length(unsigned char lead)
         {
-            return _control == boolean_undefined;
+            return lead < 0x80 ? 1 : lead < 0xc2 ? 0 : lead < 0xe0 ? 2 : lead < 0xf0 ? 3 : lead < 0xf5 ? 4 : 0;
         }
 
-        inline bool operator!=(undefined_t)
+        // decodes one code point at i and advances i; invalid bytes decode to U+FFFD one at a time
+        inline uint32_t decode(std::string_view text, size_t &i)
         {
-            return _control != boolean_undefined;
+            auto lead = static_cast<unsigned char>(text[i]);
+            auto length = sequence_length(lead);
+            if (length == 1)
+            {
+                i++;
+                return lead;
+            }
+
+            if (length == 0 || i + length > text.size())
+            {
+                i++;
+                return replacement;
+            }
+
+            uint32_t code = lead & (0xff >> (length + 1));
+            for (size_t k = 1; k < length; k++)
+            {
+                auto next = static_cast<unsigned char>(text[i + k]);
+                if ((next & 0xc0) != 0x80)
+                {
+                    i++;
+                    return replacement;
+                }
+
+                code = (code << 6) | (next & 0x3f);
+            }
+
+            // overlong forms and values past U+10FFFF
+            if ((length == 3 && code < 0x800) || (length == 4 && (code < 0x10000 || code > 0x10ffff)))
+            {
+                i++;
+                return replacement;
+            }
+
+            i += length;
+            return code;
         }
 
-        inline bool operator==(pointer_t)
+        inline void append_utf16(std::u16string &out, std::string_view text)
         {
-            return false;
+            out.reserve(out.size() + text.size());
+            for (size_t i = 0; i < text.size();)
+            {
+                // ASCII runs 8 bytes at a time
+                if (i + 8 <= text.size())
+                {
+                    uint64_t word;
+                    std::memcpy(&word, text.data() + i, 8);
+                    if ((word & 0x8080808080808080ull) == 0)
+                    {
+                        for (size_t k = 0; k < 8; k++)
+                        {
+                            out.push_back(static_cast<char16_t>(text[i + k]));
+                        }
+
+                        i += 8;
+                        continue;
+                    }
+                }
+
+                auto code = decode(text, i);
+                if (code >= 0x10000)
+                {
+                    code -= 0x10000;
+                    out.push_back(static_cast<char16_t>(0xd800 + (code >> 10)));
+                    out.push_back(static_cast<char16_t>(0xdc00 + (code & 0x3ff)));
+                }
+                else
+                {
+                    out.push_back(static_cast<char16_t>(code));
+                }
+            }
         }
 
-        inline bool operator!=(pointer_t)
+        // UTF-16 code units in text
+        inline size_t utf16_length(std::string_view text)
         {
-            return true;
+            size_t length = 0;
+            for (size_t i = 0; i < text.size();)
+            {
+                length += decode(text, i) >= 0x10000 ? 2 : 1;
+            }
+
+            return length;
         }
 
-        inline bool operator==(boolean other)
+        // byte offset of the code unit at index, the start of its sequence inside a pair
+        inline size_t utf8_offset(std::string_view text, size_t index)
         {
-            return this->operator bool() == static_cast<bool>(other);
+            size_t i = 0;
+            for (size_t length = 0; i < text.size() && length < index;)
+            {
+                auto start = i;
+                length += decode(text, i) >= 0x10000 ? 2 : 1;
+                if (length > index)
+                {
+                    return start;
+                }
+            }
+
+            return i;
         }
 
-        inline bool operator!=(boolean other)
+        inline std::u16string to_utf16(std::string_view text)
         {
-            return this->operator bool() != static_cast<bool>(other);
+            std::u16string out;
+            append_utf16(out, text);
+            return out;
         }
 
-        inline bool operator==(bool other)
+        inline void append_code_point(std::string &out, uint32_t code)
         {
-            return this->operator bool() == other;
+            if (code < 0x80)
+            {
+                out += static_cast<char>(code);
+            }
+            else if (code < 0x800)
+            {
+                out += static_cast<char>(0xc0 | (code >> 6));
+                out += static_cast<char>(0x80 | (code & 0x3f));
+            }
+            else if (code < 0x10000)
+            {
+                out += static_cast<char>(0xe0 | (code >> 12));
+                out += static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+                out += static_cast<char>(0x80 | (code & 0x3f));
+            }
+            else
+            {
+                out += static_cast<char>(0xf0 | (code >> 18));
+                out += static_cast<char>(0x80 | ((code >> 12) & 0x3f));
+                out += static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+                out += static_cast<char>(0x80 | (code & 0x3f));
+            }
         }
 
-        inline bool operator!=(bool other)
+        // surrogate pairs become one 4 byte sequence, lone surrogates stay 3 byte WTF-8
+        inline void append_utf8(std::string &out, std::u16string_view units)
         {
-            return this->operator bool() != other;
+            for (size_t i = 0; i < units.size(); i++)
+            {
+                uint32_t code = units[i];
+                if (code >= 0xd800 && code <= 0xdbff && i + 1 < units.size() && units[i + 1] >= 0xdc00 && units[i + 1] <= 0xdfff)
+                {
+                    code = 0x10000 + ((code - 0xd800) << 10) + (units[++i] - 0xdc00);
+                }
+
+                append_code_point(out, code);
+            }
         }
 
-        boolean operator~()
+        inline std::string to_utf8(std::u16string_view units)
         {
-            return this->operator bool() ? false : true;
+            std::string out;
+            out.reserve(units.size());
+            append_utf8(out, units);
+            return out;
         }
 
-        friend std::ostream &operator<<(std::ostream &os, boolean val)
+        // UTF-8 from outside the runtime (exception messages, file contents) as tstring:
+        // unchanged in narrow builds, UTF-16 or UTF-32 (by the size of wchar_t) in wide ones
+        inline tstring to_text(std::string_view bytes)
         {
-            if (val._control == boolean_undefined)
+#ifdef UNICODE
+            tstring out;
+            out.reserve(bytes.size());
+            for (size_t i = 0; i < bytes.size();)
             {
-                return os << "undefined";
+                auto code = decode(bytes, i);
+                if (sizeof(char_t) == sizeof(char16_t) && code >= 0x10000)
+                {
+                    code -= 0x10000;
+                    out.push_back(static_cast<char_t>(0xd800 + (code >> 10)));
+                    out.push_back(static_cast<char_t>(0xdc00 + (code & 0x3ff)));
+                }
+                else
+                {
+                    out.push_back(static_cast<char_t>(code));
+                }
             }
 
-            return os << (static_cast<bool>(val) ? "true" : "false");
+            return out;
+#else
+            return tstring(bytes);
+#endif
         }
-    };
-
-    static struct boolean true_t(true);
-    static struct boolean false_t(false);
 
-    namespace tmpl
-    {
-        template <typename V>
-        struct number
+        // tstring as UTF-8, the reverse of to_text
+        inline std::string from_text(std::basic_string_view<char_t> text)
         {
-            using number_t = number<V>;
-            V _value;
-
-            number() : _value{-std::numeric_limits<V>::quiet_NaN()}
+#ifdef UNICODE
+            std::string out;
+            out.reserve(text.size());
+            if constexpr (sizeof(char_t) == sizeof(char16_t))
             {
+                append_utf8(out, std::u16string_view(reinterpret_cast<const char16_t *>(text.data()), text.size()));
             }
-
-            number(const number &value) : _value{value._value}
+            else
             {
+                for (auto c : text)
+                {
+                    append_code_point(out, static_cast<uint32_t>(c));
+                }
             }
 
-            template <typename T = void>
-            requires ArithmeticOrEnum<T>
-            number(T initValue) : _value{static_cast<V>(initValue)}
-            {
-            }
+            return out;
+#else
+            return std::string(text);
+#endif
+        }
 
-            template <typename T = void>
-            requires ArithmeticOrEnum<T>
-            number(const shared<T> &initValue) : _value{static_cast<V>(initValue.get())}
+        // WTF-8 concatenation: a high surrogate at the end of left and a low surrogate at
+        // the start of right join into the 4 byte sequence of their code point
+        inline void append(std::string &left, std::string_view right)
+        {
+            auto size = left.size();
+            if (size >= 3 && right.size() >= 3 && static_cast<unsigned char>(left[size - 3]) == 0xed && (static_cast<unsigned char>(left[size - 2]) & 0xf0) == 0xa0 && static_cast<unsigned char>(right[0]) == 0xed && (static_cast<unsigned char>(right[1]) & 0xf0) == 0xb0)
             {
+                size_t i = size - 3;
+                size_t k = 0;
+                auto high = decode(left, i);
+                auto low = decode(right, k);
+                left.resize(size - 3);
+                append_code_point(left, 0x10000 + ((high - 0xd800) << 10) + (low - 0xdc00));
+                left.append(right.substr(3));
+                return;
             }
 
-            number(js::pointer_t p) : _value{p._ptr != nullptr ? static_cast<V>(intptr_t(p._ptr)) : -std::numeric_limits<V>::quiet_NaN()}
-            {
-            }
+            left.append(right);
+        }
 
-            number(const undefined_t &undef) : _value{-std::numeric_limits<V>::quiet_NaN()}
+        // simple case mapping: Latin-1, Latin Extended-A, Greek and Cyrillic
+        constexpr uint32_t to_lower(uint32_t c)
+        {
+            if ((c >= 'A' && c <= 'Z') || (c >= 0xc0 && c <= 0xde && c != 0xd7) || (c >= 0x391 && c <= 0x3a9 && c != 0x3a2) || (c >= 0x410 && c <= 0x42f))
             {
+                return c + 0x20;
             }
 
-            inline bool is_undefined()
+            if (c >= 0x400 && c <= 0x40f)
             {
-                return std::signbit(_value) && std::isnan(_value);
+                return c + 0x50;
             }
 
-            constexpr operator size_t()
+            if (c == 0x178)
             {
-                return static_cast<size_t>(_value);
+                return 0xff;
             }
 
-            constexpr operator bool()
+            if ((((c >= 0x100 && c <= 0x137) || (c >= 0x14a && c <= 0x177)) && c % 2 == 0) || (c >= 0x139 && c <= 0x148 && c % 2 == 1))
             {
-                return std::isnormal(_value);
+                return c + 1;
             }
 
-            template <typename T = void>
-            requires ArithmeticOrEnum<T>
-            constexpr operator T()
+            return c;
+        }
+
+        constexpr uint32_t to_upper(uint32_t c)
+        {
+            if ((c >= 'a' && c <= 'z') || (c >= 0xe0 && c <= 0xfe && c != 0xf7) || (c >= 0x3b1 && c <= 0x3c9 && c != 0x3c2) || (c >= 0x430 && c <= 0x44f))
             {
-                return static_cast<T>(_value);
+                return c - 0x20;
             }
 
-            constexpr number_t *operator->()
+            if (c == 0xff)
             {
-                return this;
+                return 0x178;
             }
 
-            operator tstring() const
+            if (c >= 0x450 && c <= 0x45f)
             {
-                tostringstream streamObj2;
-                streamObj2 << _value;
-                return streamObj2.str();
+                return c - 0x50;
             }
 
-            operator tstring()
+            if ((((c >= 0x101 && c <= 0x137) || (c >= 0x14b && c <= 0x177)) && c % 2 == 1) || (c >= 0x13a && c <= 0x148 && c % 2 == 0))
             {
-                tostringstream streamObj2;
-                streamObj2 << _value;
-                return streamObj2.str();
+                return c - 1;
+            }
+
+            return c;
+        }
+    } // namespace utf
+
+    static std::ostream &operator<<(std::ostream &os, std::nullptr_t ptr)
+    {
+        return os << "null";
+    }
+
+    template <typename I, typename T>
+    inline bool $is(T *t)
+    {
+        return dynamic_cast<I *>(t) != nullptr;
+    }
+
+    template <typename I, typename T>
+    inline bool $is(const std::shared_ptr<T> &t)
+    {
+        return std::dynamic_pointer_cast<I>(t) != nullptr;
+    }
+
+    template <typename I, typename T>
+    inline bool __is(T *t)
+    {
+        return std::type_index(typeid(I *)) == std::type_index(typeid(t)) || is<I>(t);
+    }
+
+    template <typename I, typename T>
+    inline I $as(T t)
+    {
+        return static_cast<I>(t);
+    }
+
+    template <typename I, typename T>
+    inline I *$as(T *t)
+    {
+        return dynamic_cast<I *>(t);
+    }
+
+    template <typename I, typename T, class = std::enable_if_t<!std::is_same_v<I, any>>>
+    inline std::shared_ptr<I> $as(const std::shared_ptr<T> &t)
+    {
+        return std::dynamic_pointer_cast<I>(t);
+    }
+
+    template <typename I, typename T, class = std::enable_if_t<std::is_same_v<I, any>>>
+    inline I $as(const std::shared_ptr<T> &t)
+    {
+        return I(t);
+    }
+
+    template <class T>
+    static string type_of(T value);
+
+    template <typename T>
+    inline auto isNaN(T t)
+    {
+        return std::isnan(static_cast<double>(t));
+    }
+
+    template <typename R, typename T>
+    inline R cast(T t)
+    {
+        return static_cast<R>(t);
+    }
+
+    template <typename T>
+    constexpr const T &const_(T &t)
+    {
+        return static_cast<const T &>(t);
+    }
+
+    template <typename T>
+    constexpr const T *const_(T *t)
+    {
+        return static_cast<const T *>(t);
+    }
+
+    /*
+template <typename T> 
+constexpr const T const_(T t) {
+	return static_cast<const T>(t);
+}
+*/
+
+    template <typename T>
+    constexpr T &mutable_(const T &t)
+    {
+        return const_cast<T &>(t);
+    }
+
+    template <typename T>
+    constexpr T *mutable_(const T *t)
+    {
+        return const_cast<T *>(t);
+    }
+
+    template <typename T>
+    constexpr T &deref_(T *t)
+    {
+        return *t;
+    }
+
+    template <typename T>
+    constexpr T deref_(T t)
+    {
+        return t;
+    }
+
+    template <typename T>
+    constexpr auto keys_(const T &t)
+    {
+        return mutable_(t)->keys();
+    }
+
+    template <typename T>
+    constexpr auto keys_(T &t)
+    {
+        return t->keys();
+    }
+
+    namespace bitwise
+    {
+        template <typename T1, typename T2>
+        constexpr auto rshift(T1 op1, T2 op2)
+        {
+            auto op1ll = static_cast<long long>(op1);
+            auto op1l = static_cast<long>(op1ll);
+            auto op2ll = static_cast<long long>(op2);
+            auto op2ul = static_cast<unsigned long>(op2ll);
+            auto op2ul32 = op2ul & 0x1f;
+            auto r = op1l >> op2ul32;
+            auto rl = static_cast<long>(r);
+            return static_cast<T1>(rl);
+        }
+
+        template <typename T1, typename T2>
+        constexpr auto rshift_nosign(T1 op1, T2 op2)
+        {
+            auto op1ll = static_cast<long long>(op1);
+            auto op1ul = static_cast<unsigned long>(op1ll);
+            auto op2ll = static_cast<long long>(op2);
+            auto op2ul = static_cast<unsigned long>(op2ll);
+            auto op2ul32 = op2ul & 0x1f;
+            auto r = op1ul >> op2ul32;
+            auto rul = static_cast<unsigned long>(r);
+            return static_cast<T1>(rul);
+        }
+
+        template <typename T1, typename T2>
+        constexpr auto lshift(T1 op1, T2 op2)
+        {
+            auto op1ll = static_cast<long long>(op1);
+            auto op1l = static_cast<long>(op1ll);
+            auto op2ll = static_cast<long long>(op2);
+            auto op2ul = static_cast<unsigned long>(op2ll);
+            auto op2ul32 = op2ul & 0x1f;
+            auto r = op1l << op2ul32;
+            auto rl = static_cast<long>(r);
+            return static_cast<T1>(rl);
+        }
+
+    } // namespace bitwise
+
+    static struct undefined_t
+    {
+        constexpr undefined_t()
+        {
+        }
+
+        constexpr undefined_t(const undefined_t &)
+        {
+        }
+
+        constexpr operator bool()
+        {
+            return false;
+        }
+
+        constexpr operator std::nullptr_t()
+        {
+            return nullptr;
+        }
+
+        constexpr bool operator==(undefined_t)
+        {
+            return true;
+        }
+
+        constexpr bool operator!=(undefined_t)
+        {
+            return false;
+        }
+
+        constexpr bool operator==(const pointer_t &)
+        {
+            return false;
+        }
+
+        constexpr bool operator!=(const pointer_t &)
+        {
+            return true;
+        }
+
+        template <typename N = void>
+        requires ArithmeticOrEnum<N>
+        bool operator==(N n) const;
+
+        template <typename N = void>
+        requires ArithmeticOrEnum<N>
+        bool operator!=(N n) const;
+
+        template <typename N/* = void*/>
+        requires ArithmeticOrEnum<N>
+        friend bool operator==(N n, const undefined_t &u);
+
+        template <typename N/* = void*/>
+        requires ArithmeticOrEnum<N>
+        friend bool operator!=(N n, const undefined_t &u);
+
+        friend std::ostream &operator<<(std::ostream &os, undefined_t)
+        {
+            return os << "undefined";
+        }
+    } undefined;
+
+    struct void_t
+    {
+        constexpr operator bool()
+        {
+            return false;
+        }
+
+        constexpr bool operator==(void_t)
+        {
+            return true;
+        }
+
+        constexpr bool operator!=(void_t)
+        {
+            return false;
+        }
+
+        constexpr bool operator==(undefined_t)
+        {
+            return true;
+        }
+
+        constexpr bool operator!=(undefined_t)
+        {
+            return false;
+        }
+
+        template <typename T>
+        constexpr bool operator==(T)
+        {
+            return false;
+        }
+
+        template <typename T>
+        constexpr bool operator!=(T)
+        {
+            return true;
+        }
+    };
+
+    namespace tmpl
+    {
+        template <typename T>
+        struct pointer_t
+        {
+            bool isUndefined;
+            T _ptr;
+
+            pointer_t() : _ptr(nullptr), isUndefined(false){};
+
+            pointer_t(const pointer_t &other) : _ptr(other._ptr), isUndefined(other.isUndefined){};
+
+            pointer_t(void *ptr) : _ptr(static_cast<T>(ptr)), isUndefined(false){};
+
+            pointer_t(std::nullptr_t) : _ptr(nullptr), isUndefined(false){};
+
+            pointer_t(js::number);
+
+            pointer_t(const undefined_t &undef) : _ptr(nullptr), isUndefined(true)
+            {
+            }
+
+            constexpr operator bool()
+            {
+                return !isUndefined && _ptr != nullptr;
+            }
+
+            constexpr operator void *()
+            {
+                return static_cast<void *>(_ptr);
+            }
+
+            template <typename T2>
+            constexpr operator std::shared_ptr<T2>()
+            {
+                return std::shared_ptr<T2>(static_cast<T2 *>(_ptr));
+            }
+
+            template <typename T2>
+            constexpr operator const T2 *()
+            {
+                return isUndefined ? static_cast<const T2 *>(nullptr) : static_cast<const T2 *>(_ptr);
+            }
+
+            template <typename T2 = void>
+            requires ArithmeticOrEnum<T2>
+            constexpr operator T2()
+            {
+                return static_cast<T2>(reinterpret_cast<intptr_t>(_ptr));
+            }
+
+            operator tstring() const
+            {
+                tostringstream streamObj2;
+                streamObj2 << TXT("null");
+                return streamObj2.str();
+            }
+
+            operator tstring()
+            {
+                tostringstream streamObj2;
+                streamObj2 << TXT("null");
+                return streamObj2.str();
+            }
+
+            bool operator==(undefined_t)
+            {
+                return isUndefined;
+            }
+
+            bool operator!=(undefined_t)
+            {
+                return !isUndefined;
+            }
+
+            bool operator==(pointer_t p)
+            {
+                return isUndefined == p.isUndefined && _ptr == p._ptr;
+            }
+
+            bool operator!=(pointer_t p)
+            {
+                return isUndefined != p.isUndefined || _ptr != p._ptr;
+            }
+
+            template <typename N = void>
+            requires ArithmeticOrEnumOrNumber<N>
+            bool operator==(N n);
+
+            template <typename N = void>
+            requires ArithmeticOrEnumOrNumber<N>
+            bool operator!=(N n);
+
+            template <typename N = void>
+            requires ArithmeticOrEnum<N>
+            friend bool operator==(N n, const pointer_t p)
+            {
+                return !p.isUndefined && false;
+            }
+
+            template <typename N = void>
+            requires ArithmeticOrEnum<N>
+            friend bool operator!=(N n, const pointer_t p)
+            {
+                return p.isUndefined || true;
+            }
+
+            /*template <typename _Ty>
+            bool operator==(std::shared_ptr<_Ty> sp)
+            {
+                return false;
+            }
+
+            template <typename _Ty>
+            bool operator!=(std::shared_ptr<_Ty> sp)
+            {
+                return false;
+            }*/
+
+            friend std::ostream &operator<<(std::ostream &os, pointer_t val)
+            {
+                if (!val.isUndefined && val._ptr == nullptr)
+                {
+                    return os << "null";
+                }
+
+                return os << val._ptr;
+            }
+        };
+
+    }
+
+    static pointer_t null;
+
+    template <typename L, typename R>
+    constexpr bool equals(L l, R r)
+    {
+        auto lIsUndef = l == undefined;
+        auto lIsNull = l == null;
+        auto rIsUndef = r == undefined;
+        auto rIsNull = r == null;
+        return ((lIsUndef || lIsNull) && (rIsUndef || rIsNull)) || l == r;
+    }
+
+    template <typename L, typename R>
+    constexpr bool not_equals(L l, R r)
+    {
+        return !equals(l, r);
+    }
+
+    struct boolean
+    {
+        enum control_t
+        {
+            boolean_false = 0,
+            boolean_true = 1,
+            boolean_undefined = 2
+        } _control;
+
+        constexpr boolean() : _control(boolean_undefined)
+        {
+        }
+
+        inline boolean(const boolean &value) : _control(value._control)
+        {
+        }
+
+        inline boolean(bool value) : _control(static_cast<control_t>(value))
+        {
+        }
+
+        constexpr boolean(const undefined_t &) : _control(boolean_undefined)
+        {
+        }
+
+        constexpr operator bool() const
+        {
+            return _control == boolean_true;
+        }
+
+        constexpr operator bool()
+        {
+            return _control == boolean_true;
+        }
+
+        constexpr boolean *operator->()
+        {
+            return this;
+        }
+
+        inline bool operator==(undefined_t) const
+        {
+            return _control == boolean_undefined;
+        }
+
+        inline bool operator!=(undefined_t) const
+        {
+            return _control != boolean_undefined;
+        }
+
+        inline bool operator==(pointer_t) const
+        {
+            return false;
+        }
+
+        inline bool operator!=(pointer_t) const
+        {
+            return true;
+        }
+
+        inline bool operator==(undefined_t)
+        {
+            return _control == boolean_undefined;
+        }
+
+        inline bool operator!=(undefined_t)
+        {
+            return _control != boolean_undefined;
+        }
+
+        inline bool operator==(pointer_t)
+        {
+            return false;
+        }
+
+        inline bool operator!=(pointer_t)
+        {
+            return true;
+        }
+
+        inline bool operator==(boolean other)
+        {
+            return this->operator bool() == static_cast<bool>(other);
+        }
+
+        inline bool operator!=(boolean other)
+        {
+            return this->operator bool() != static_cast<bool>(other);
+        }
+
+        inline bool operator==(bool other)
+        {
+            return this->operator bool() == other;
+        }
+
+        inline bool operator!=(bool other)
+        {
+            return this->operator bool() != other;
+        }
+
+        boolean operator~()
+        {
+            return this->operator bool() ? false : true;
+        }
+
+        friend std::ostream &operator<<(std::ostream &os, boolean val)
+        {
+            if (val._control == boolean_undefined)
+            {
+                return os << "undefined";
+            }
+
+            return os << (static_cast<bool>(val) ? "true" : "false");
+        }
+    };
+
+    static struct boolean true_t(true);
+    static struct boolean false_t(false);
+
+    namespace tmpl
+    {
+        template <typename V>
+        struct number
+        {
+            using number_t = number<V>;
+            V _value;
+
+            number() : _value{-std::numeric_limits<V>::quiet_NaN()}
+            {
+            }
+
+            number(const number &value) : _value{value._value}
+            {
+            }
+
+            template <typename T = void>
+            requires ArithmeticOrEnum<T>
+            number(T initValue) : _value{static_cast<V>(initValue)}
+            {
+            }
+
+            template <typename T = void>
+            requires ArithmeticOrEnum<T>
+            number(const shared<T> &initValue) : _value{static_cast<V>(initValue.get())}
+            {
+            }
+
+            number(js::pointer_t p) : _value{p._ptr != nullptr ? static_cast<V>(intptr_t(p._ptr)) : -std::numeric_limits<V>::quiet_NaN()}
+            {
+            }
+
+            number(const undefined_t &undef) : _value{-std::numeric_limits<V>::quiet_NaN()}
+            {
+            }
+
+            inline bool is_undefined()
+            {
+                return std::signbit(_value) && std::isnan(_value);
+            }
+
+            constexpr operator size_t()
+            {
+                return static_cast<size_t>(_value);
+            }
+
+            constexpr operator bool()
+            {
+                return std::isnormal(_value);
+            }
+
+            template <typename T = void>
+            requires ArithmeticOrEnum<T>
+            constexpr operator T()
+            {
+                return static_cast<T>(_value);
+            }
+
+            constexpr number_t *operator->()
+            {
+                return this;
+            }
+
+            operator tstring() const
+            {
+                tstring out;
+                append_to(out);
+                return out;
+            }
+
+            operator tstring()
+            {
+                tstring out;
+                append_to(out);
+                return out;
             }
 
             operator js::string();
 
-            inline bool operator==(undefined_t)
+            // JS ToString(Number) appended to out
+            void append_to(tstring &out) const
+            {
+                if (std::signbit(_value) && std::isnan(_value))
+                {
+                    out.append(TXT("undefined"));
+                    return;
+                }
+
+                numfmt::append_number(out, static_cast<double>(_value));
+            }
+
+            inline bool operator==(undefined_t)
+            {
+                return is_undefined();
+            }
+
+            inline bool operator!=(undefined_t)
+            {
+                return !is_undefined();
+            }
+
+            inline friend bool operator==(const undefined_t, number_t other)
+            {
+                return other.is_undefined();
+            }
+
+            inline friend bool operator!=(const undefined_t, number_t other)
+            {
+                return !other.is_undefined();
+            }
+
+            inline friend bool operator==(const number_t n, js::pointer_t p)
+            {
+                return mutable_(n).is_undefined() == p.isUndefined && false;
+            }
+
+            inline friend bool operator!=(const number_t n, js::pointer_t p)
+            {
+                return mutable_(n).is_undefined() != p.isUndefined || true;
+            }
+
+            number_t operator+()
+            {
+                return +_value;
+            }
+
+            number_t &operator++()
+            {
+                _value += 1;
+                return *this;
+            }
+
+            number_t operator++(int)
+            {
+                number_t tmp(*this);
+                operator++();
+                return tmp;
+            }
+
+            template <typename T = void>
+            requires ArithmeticOrEnumOrNumber<T>
+            friend number_t operator+(const number_t n, T value)
+            {
+                return n._value + static_cast<V>(value);
+            }
+
+            template <typename T = void>
+            requires ArithmeticOrEnum<T>
+            friend T operator+(T value, const number_t n)
+            {
+                return value + static_cast<T>(n._value);
+            }
+
+            template <typename T = void>
+            requires ArithmeticOrEnumOrNumber<T>
+                number_t &operator+=(T value)
+            {
+                _value += static_cast<V>(value);
+                return *this;
+            }
+
+            template <typename N = void>
+            requires ArithmeticOrEnum<N>
+            friend N operator+=(N &n, const number &other)
+            {
+                return n += static_cast<N>(mutable_(other));
+            }
+
+            template <typename T = void>
+            requires ArithmeticOrEnumOrNumber<T>
+            friend number_t operator-(const number_t n, T value)
+            {
+                return n._value - static_cast<V>(value);
+            }
+
+            template <typename T = void>
+            requires ArithmeticOrEnum<T>
+            friend T operator-(T value, const number_t n)
+            {
+                return value - static_cast<T>(n._value);
+            }
+
+            number_t operator-()
+            {
+                return -_value;
+            }
+
+            number_t &operator--()
+            {
+                _value -= 1;
+                return *this;
+            }
+
+            number_t operator--(int)
+            {
+                number_t tmp(*this);
+                operator--();
+                return tmp;
+            }
+
+            template <typename T = void>
+            requires ArithmeticOrEnumOrNumber<T>
+                number_t &operator-=(T value)
+            {
+                _value -= static_cast<V>(value);
+                return *this;
+            }
+
+            template <typename N = void>
+            requires ArithmeticOrEnum<N>
+            friend N operator-=(N &n, const number &other)
+            {
+                return n -= static_cast<N>(mutable_(other));
+            }
+
+            template <typename T = void>
+            requires ArithmeticOrEnumOrNumber<T>
+            friend number_t operator*(const number_t n, T value)
+            {
+                return n._value * static_cast<V>(value);
+            }
+
+            template <typename T = void>
+            requires ArithmeticOrEnum<T>
+            friend T operator*(T value, const number_t n)
+            {
+                return value * static_cast<T>(n._value);
+            }
+
+            template <typename T = void>
+            requires ArithmeticOrEnumOrNumber<T>
+                number_t &operator*=(T value)
+            {
+                _value *= static_cast<V>(value);
+                return *this;
+            }
+
+            template <typename N = void>
+            requires ArithmeticOrEnum<N>
+            friend N operator*=(N &n, const number &other)
+            {
+                return n *= static_cast<N>(mutable_(other));
+            }
+
+            template <typename T = void>
+            requires ArithmeticOrEnumOrNumber<T>
+            friend number_t operator/(const number_t n, T value)
+            {
+                return n._value / static_cast<V>(value);
+            }
+
+            template <typename T = void>
+            requires ArithmeticOrEnum<T>
+            friend T operator/(T value, const number_t n)
+            {
+                return value / static_cast<T>(n._value);
+            }
+
+            template <typename T = void>
+            requires ArithmeticOrEnumOrNumber<T>
+                number_t &operator/=(T value)
+            {
+                _value /= static_cast<V>(value);
+                return *this;
+            }
+
+            template <typename N = void>
+            requires ArithmeticOrEnum<N>
+            friend N operator/=(N &n, const number &other)
+            {
+                return n /= static_cast<N>(mutable_(other));
+            }
+
+            template <typename T = void>
+            requires ArithmeticOrEnumOrNumber<T>
+            friend number_t operator^(const number_t n, T value)
+            {
+                return static_cast<long>(n._value) ^ static_cast<long>(static_cast<V>(value));
+            }
+
+            template <typename T = void>
+            requires ArithmeticOrEnum<T>
+            friend number_t operator^(T value, const number_t n)
+            {
+                return static_cast<long>(static_cast<V>(value)) ^ static_cast<long>(n._value);
+            }
+
+            template <typename T = void>
+            requires ArithmeticOrEnumOrNumber<T>
+                number_t &operator^=(T value)
+            {
+                _value = static_cast<long>(_value) ^ static_cast<long>(static_cast<V>(value));
+                return *this;
+            }
+
+            template <typename T = void>
+            requires ArithmeticOrEnumOrNumber<T>
+            friend number_t operator|(const number_t n, T value)
+            {
+                return static_cast<long>(n._value) | static_cast<long>(static_cast<V>(value));
+            }
+
+            template <typename T = void>
+            requires ArithmeticOrEnum<T>
+            friend T operator|(T value, const number_t n)
+            {
+                return static_cast<long>(static_cast<V>(value)) | static_cast<long>(n._value);
+            }
+
+            template <typename T = void>
+            requires ArithmeticOrEnumOrNumber<T>
+                number_t &operator|=(T value)
+            {
+                _value = static_cast<long>(_value) | static_cast<long>(static_cast<V>(value));
+                return *this;
+            }
+
+            template <typename T = void>
+            requires ArithmeticOrEnumOrNumber<T>
+            friend number_t operator&(const number_t n, T value)
+            {
+                return static_cast<long>(n._value) & static_cast<long>(static_cast<V>(value));
+            }
+
+            template <typename T = void>
+            requires ArithmeticOrEnum<T>
+            friend T operator&(T value, const number_t n)
+            {
+                return static_cast<long>(static_cast<V>(value)) & static_cast<long>(n._value);
+            }
+
+            template <typename T = void>
+            requires ArithmeticOrEnumOrNumber<T>
+                number_t &operator&=(T value)
+            {
+                _value = static_cast<long>(_value) & static_cast<long>(static_cast<V>(value));
+                return *this;
+            }
+
+            template <typename T = void>
+            requires ArithmeticOrEnumOrNumber<T>
+            friend number_t operator%(const number_t n, T value)
+            {
+                return number_t(static_cast<long>(n._value) % static_cast<long>(static_cast<V>(value)));
+            }
+
+            template <typename T = void>
+            requires ArithmeticOrEnum<T>
+            friend T operator%(T value, const number_t n)
+            {
+                return static_cast<long>(static_cast<V>(value)) % static_cast<long>(n._value);
+            }
+
+            template <typename T = void>
+            requires ArithmeticOrEnumOrNumber<T>
+                number_t &operator%=(T value)
+            {
+                _value = static_cast<long>(_value) % static_cast<long>(static_cast<V>(value));
+                return *this;
+            }
+
+            template <typename T = void>
+            requires ArithmeticOrEnumOrNumber<T>
+                number_t operator<<(T value)
+            {
+                return number_t(static_cast<long>(_value) << static_cast<long>(static_cast<V>(value)));
+            }
+
+            template <typename T = void>
+            requires ArithmeticOrEnumOrNumber<T>
+                number_t &operator<<=(T value)
+            {
+                _value = static_cast<long>(_value) << static_cast<long>(static_cast<V>(value));
+                return *this;
+            }
+
+            template <typename T = void>
+            requires ArithmeticOrEnumOrNumber<T>
+                number_t operator>>(T value)
+            {
+                return number_t(static_cast<long>(_value) >> static_cast<long>(static_cast<V>(value)));
+            }
+
+            template <typename T = void>
+            requires ArithmeticOrEnumOrNumber<T>
+                number_t &operator>>=(T value)
+            {
+                _value = static_cast<long>(_value) >> static_cast<long>(static_cast<V>(value));
+                return *this;
+            }
+
+            number_t operator~()
+            {
+                return ~static_cast<long>(_value);
+            }
+
+            template <typename N = void>
+            requires ArithmeticOrEnumOrNumber<N>
+            friend bool operator==(const number_t value, N n)
+            {
+                return value._value == static_cast<V>(n);
+            }
+
+            template <typename N = void>
+            requires ArithmeticOrEnum<N>
+            friend bool operator==(N n, const number_t value)
+            {
+                return static_cast<V>(n) == value._value;
+            }
+
+            template <typename N = void>
+            requires ArithmeticOrEnumOrNumber<N>
+            friend bool operator!=(const number_t value, N n)
+            {
+                return value._value != static_cast<V>(n);
+            }
+
+            template <typename N = void>
+            requires ArithmeticOrEnum<N>
+            friend bool operator!=(N n, const number_t value)
+            {
+                return static_cast<V>(n) != value._value;
+            }
+
+            template <typename N = void>
+            requires ArithmeticOrEnumOrNumber<N>
+            friend bool operator<(const number_t value, N n)
+            {
+                return value._value < static_cast<V>(n);
+            }
+
+            template <typename N = void>
+            requires ArithmeticOrEnum<N>
+            friend bool operator<(N n, const number_t value)
+            {
+                return static_cast<V>(n) < value._value;
+            }
+
+            template <typename N = void>
+            requires ArithmeticOrEnumOrNumber<N>
+            friend bool operator<=(const number_t value, N n)
+            {
+                return value._value <= static_cast<V>(n);
+            }
+
+            template <typename N = void>
+            requires ArithmeticOrEnum<N>
+            friend bool operator<=(N n, const number_t value)
+            {
+                return static_cast<V>(n) <= value._value;
+            }
+
+            template <typename N = void>
+            requires ArithmeticOrEnumOrNumber<N>
+            friend bool operator>(const number_t value, N n)
+            {
+                return value._value > static_cast<V>(n);
+            }
+
+            template <typename N = void>
+            requires ArithmeticOrEnum<N>
+            friend bool operator>(N n, const number_t value)
+            {
+                return static_cast<V>(n) > value._value;
+            }
+
+            template <typename N = void>
+            requires ArithmeticOrEnumOrNumber<N>
+            friend bool operator>=(const number_t value, N n)
+            {
+                return value._value >= static_cast<V>(n);
+            }
+
+            template <typename N = void>
+            requires ArithmeticOrEnum<N>
+            friend bool operator>=(N n, const number_t value)
+            {
+                return static_cast<V>(n) >= value._value;
+            }
+
+            js::string toString();
+            js::string toString(number_t radix);
+            js::string toFixed(number_t digits = 0);
+            js::string toPrecision(number_t precision = undefined);
+
+            friend tostream &operator<<(tostream &os, number_t val)
+            {
+                tstring out;
+                val.append_to(out);
+                return os << out;
+            }
+        };
+
+        template <typename T>
+        pointer_t<T>::pointer_t(js::number n) : _ptr((void *)(long long)n._value), isUndefined(false)
+        {
+        }
+
+        template <typename T>
+        template <typename N>
+        requires ArithmeticOrEnumOrNumber<N>
+        bool pointer_t<T>::operator==(N n)
+        {
+            //return isUndefined == n.isUndefined && intptr_t(_ptr) == intptr_t(static_cast<size_t>(n));
+            return false;
+        }
+
+        template <typename T>
+        template <typename N>
+        requires ArithmeticOrEnumOrNumber<N>
+        bool pointer_t<T>::operator!=(N n)
+        {
+            //return isUndefined != n.isUndefined || intptr_t(_ptr) != intptr_t(static_cast<size_t>(n));
+            return true;
+        }
+
+    } // impl
+
+    template <typename N>
+    requires ArithmeticOrEnum<N>
+    bool undefined_t::operator==(N n) const
+    {
+        return false;
+    }
+
+    template <typename N>
+    requires ArithmeticOrEnum<N>
+    bool undefined_t::operator!=(N n) const
+    {
+        return true;
+    }
+
+    template <typename N/*=void*/>
+    requires ArithmeticOrEnum<N>
+    bool operator==(N n, const undefined_t &u)
+    {
+        return false;
+    }
+
+    template <typename N/*=void*/>
+    requires ArithmeticOrEnum<N>
+    bool operator!=(N n, const undefined_t &u)
+    {
+        return true;
+    }
+
+    namespace tmpl
+    {
+        template <typename T>
+        struct string
+        {
+            using string_t = string<T>;
+
+            enum
+            {
+                string_defined = 0,
+                string_null = 1,
+                string_undefined = 2
+            } _control;
+            T _value;
+
+#ifndef UNICODE
+            struct units_t
+            {
+                std::atomic<size_t> references;
+                std::u16string text;
+            };
+
+            // stands for the units of every ASCII text, which indexes _value directly; never
+            // counted or freed
+            static inline units_t ascii_units{{0}, {}};
+
+            // UTF-16 code units of _value (see utf), decoded on first indexed access, shared
+            // between copies and dropped by every member that can change _value. Published
+            // with a compare-exchange, so const readers on several threads agree on one copy;
+            // copies and moves only touch the count when the units are already there
+            mutable std::atomic<units_t *> _units{nullptr};
+
+            static units_t *retain(units_t *units)
+            {
+                if (units && units != &ascii_units)
+                {
+                    units->references.fetch_add(1, std::memory_order_relaxed);
+                }
+
+                return units;
+            }
+
+            static void release(units_t *units)
+            {
+                if (units && units != &ascii_units && units->references.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                {
+                    delete units;
+                }
+            }
+#endif
+
+            string() : _value(), _control(string_undefined)
+            {
+            }
+
+#ifdef UNICODE
+            string(const string &value) : _value(value._value), _control(value._control)
+            {
+            }
+
+            string(string &&value) noexcept = default;
+            string &operator=(const string &value) = default;
+            string &operator=(string &&value) noexcept = default;
+#else
+            string(const string &value) : _value(value._value), _control(value._control), _units(retain(value._units.load(std::memory_order_acquire)))
+            {
+            }
+
+            string(string &&value) noexcept : _value(std::move(value._value)), _control(value._control), _units(value._units.load(std::memory_order_relaxed))
+            {
+                value._units.store(nullptr, std::memory_order_relaxed);
+            }
+
+            ~string()
+            {
+                release(_units.load(std::memory_order_relaxed));
+            }
+
+            string &operator=(const string &value)
+            {
+                if (this != &value)
+                {
+                    _value = value._value;
+                    _control = value._control;
+                    auto previous = _units.load(std::memory_order_relaxed);
+                    _units.store(retain(value._units.load(std::memory_order_acquire)), std::memory_order_relaxed);
+                    release(previous);
+                }
+
+                return *this;
+            }
+
+            string &operator=(string &&value) noexcept
+            {
+                if (this != &value)
+                {
+                    _value = std::move(value._value);
+                    _control = value._control;
+                    auto previous = _units.load(std::memory_order_relaxed);
+                    _units.store(value._units.load(std::memory_order_relaxed), std::memory_order_relaxed);
+                    value._units.store(nullptr, std::memory_order_relaxed);
+                    release(previous);
+                }
+
+                return *this;
+            }
+#endif
+
+            string(js::pointer_t v) : _value(v ? static_cast<const char_t *>(v) : TXT("")), _control(v ? string_defined : string_null)
+            {
+            }
+
+            string(tstring value) : _value(std::move(value)), _control(string_defined)
+            {
+            }
+
+            string(const char_t *value) : _value(value == nullptr ? TXT("") : value), _control(value == nullptr ? string_null : string_defined)
+            {
+            }
+
+            string(const char_t value) : _value(1, value), _control(string_defined)
+            {
+            }
+
+            string(const undefined_t &) : _control(string_undefined)
+            {
+            }
+
+            inline operator const char_t *()
+            {
+                return _value.c_str();
+            }
+
+            inline operator bool()
+            {
+                return _control == 0 && !_value.empty();
+            }
+
+            inline operator int()
+            {
+                auto value = numparse::to_number(_value);
+                return std::isfinite(value) ? static_cast<int>(value) : 0;
+            }
+
+            inline operator double()
+            {
+                return numparse::to_number(_value);
+            }
+
+            // the caller may change the text through the reference
+            inline operator T &()
+            {
+                invalidate_units();
+                return _value;
+            }
+
+            void invalidate_units()
+            {
+#ifndef UNICODE
+                release(_units.load(std::memory_order_relaxed));
+                _units.store(nullptr, std::memory_order_relaxed);
+#endif
+            }
+
+            /*inline operator size_t()
+            {
+                return _value.size();
+            }*/
+
+            inline bool is_null() const
+            {
+                return _control == string_null;
+            }
+
+            inline bool is_undefined() const
+            {
+                return _control == string_undefined;
+            }
+
+            // code units for JS indexing, nullptr when _value indexes directly
+            const std::u16string *units() const
+            {
+#ifdef UNICODE
+                return nullptr;
+#else
+                auto cached = _units.load(std::memory_order_acquire);
+                if (!cached)
+                {
+                    auto computed = utf::is_ascii(_value) ? &ascii_units : new units_t{{1}, utf::to_utf16(_value)};
+                    // when another thread got there first its units are kept, pointers to
+                    // them may already have been handed out
+                    if (_units.compare_exchange_strong(cached, computed, std::memory_order_acq_rel, std::memory_order_acquire))
+                    {
+                        cached = computed;
+                    }
+                    else
+                    {
+                        release(computed);
+                    }
+                }
+
+                return cached == &ascii_units ? nullptr : &cached->text;
+#endif
+            }
+
+            size_t length() const
+            {
+                auto text = units();
+                return text ? text->size() : _value.size();
+            }
+
+            uint32_t unit_at(size_t index) const
+            {
+                auto text = units();
+                return text ? (*text)[index] : static_cast<std::make_unsigned_t<char_t>>(_value[index]);
+            }
+
+            static T from_unit(uint32_t unit)
+            {
+#ifdef UNICODE
+                return T(1, static_cast<char_t>(unit));
+#else
+                T result;
+                utf::append_code_point(result, unit);
+                return result;
+#endif
+            }
+
+            // code units [from, to)
+            T slice_units(size_t from, size_t to) const
+            {
+                auto text = units();
+#ifndef UNICODE
+                if (text)
+                {
+                    return utf::to_utf8(std::u16string_view(*text).substr(from, to - from));
+                }
+#endif
+                return _value.substr(from, to - from);
+            }
+
+            // code unit index <-> offset into _value
+            size_t index_to_offset(size_t index) const
+            {
+#ifndef UNICODE
+                if (units())
+                {
+                    return utf::utf8_offset(_value, index);
+                }
+#endif
+                return index;
+            }
+
+            size_t offset_to_index(size_t offset) const
+            {
+#ifndef UNICODE
+                if (offset != T::npos && units())
+                {
+                    return utf::utf16_length(std::string_view(_value).substr(0, offset));
+                }
+#endif
+                return offset;
+            }
+
+            static void append_text(T &out, const T &text)
+            {
+#ifdef UNICODE
+                out.append(text);
+#else
+                utf::append(out, text);
+#endif
+            }
+
+            // relative start/end of slice: negative counts from the end
+            static size_t relative_position(double position, size_t size)
+            {
+                if (std::isnan(position))
+                {
+                    return 0;
+                }
+
+                position = std::trunc(position);
+                if (position < 0)
+                {
+                    return position + size <= 0 ? 0 : static_cast<size_t>(position + size);
+                }
+
+                return position >= size ? size : static_cast<size_t>(position);
+            }
+
+            js::number get_length() const
+            {
+                return js::number(length());
+            }
+
+            constexpr string *operator->()
+            {
+                return this;
+            }
+
+            template <typename N = void>
+            requires ArithmeticOrEnumOrNumber<N>
+                string_t operator[](N n) const
+            {
+                auto index = static_cast<size_t>(n);
+                return index < length() ? string_t(from_unit(unit_at(index))) : string_t();
+            }
+
+            template <typename B = void>
+            requires BoolOrBoolean<B>
+                string_t operator+(B b)
+            {
+                return string(_value + (b ? "true" : "false"));
+            }
+
+            template <typename N = void>
+            requires ArithmeticOrEnum<N>
+                string_t operator+(N value)
+            {
+                if constexpr (std::is_floating_point_v<N>)
+                {
+                    auto result = _value;
+                    numfmt::append_number(result, static_cast<double>(value));
+                    return string(std::move(result));
+                }
+                else
+                {
+                    return string(_value + to_tstring(value));
+                }
+            }
+
+            template <typename N = void>
+            requires ArithmeticOrEnum<N>
+            friend string_t operator+(N value, const string_t &val)
+            {
+                if constexpr (std::is_floating_point_v<N>)
+                {
+                    T result;
+                    numfmt::append_number(result, static_cast<double>(value));
+                    return string(std::move(result += val._value));
+                }
+                else
+                {
+                    return string(to_tstring(value) + val._value);
+                }
+            }
+
+            string_t operator+(js::number value)
+            {
+                auto result = _value;
+                value.append_to(result);
+                return string(std::move(result));
+            }
+
+            friend string_t operator+(js::number value, const string_t &val)
+            {
+                T result;
+                value.append_to(result);
+                return string(std::move(result += val._value));
+            }
+
+            string_t operator+(string value)
+            {
+                auto result = _value;
+                append_text(result, value._value);
+                return string(std::move(result));
+            }
+
+            friend string_t operator+(const string &value, string other)
+            {
+                return mutable_(value) + other;
+            }
+
+            string_t operator+(js::pointer_t ptr)
+            {
+                return string(_value + ((!ptr) ? TXT("null") : to_tstring(static_cast<size_t>(ptr))));
+            }
+
+            string_t operator+(any value);
+
+            string_t &operator+=(char_t c)
+            {
+                _control = string_defined;
+                invalidate_units();
+                _value.append(string(c)._value);
+                return *this;
+            }
+
+            template <typename N = void>
+            requires ArithmeticOrEnumOrNumber<N>
+                string_t &operator+=(N n)
+            {
+                auto value = t_tostring(n);
+                _control = string_defined;
+                invalidate_units();
+                _value.append(value);
+                return *this;
+            }
+
+            string_t &operator+=(string value)
+            {
+                _control = string_defined;
+                invalidate_units();
+                append_text(_value, value._value);
+                return *this;
+            }
+
+            string_t &operator+=(any value);
+
+            bool operator==(const string_t &other) const
+            {
+                return _control == string_defined && _value.compare(other._value) == 0;
+            }
+
+            bool operator==(const string_t &other)
+            {
+                return _control == string_defined && _value.compare(other._value) == 0;
+            }
+
+            bool operator!=(const string_t &other) const
+            {
+                return _control == string_defined && _value.compare(other._value) != 0;
+            }
+
+            bool operator!=(const string_t &other)
+            {
+                return _control == string_defined && _value.compare(other._value) != 0;
+            }
+
+            bool operator==(undefined_t)
+            {
+                return is_undefined();
+            }
+
+            friend bool operator==(undefined_t, const string_t &other)
+            {
+                return other.is_undefined();
+            }
+
+            bool operator!=(undefined_t)
+            {
+                return !is_undefined();
+            }
+
+            friend bool operator!=(undefined_t, const string_t &other)
+            {
+                return !other.is_undefined();
+            }
+
+            bool operator==(js::pointer_t ptr)
+            {
+                return is_null() && (!ptr);
+            }
+
+            friend bool operator==(js::pointer_t ptr, const string_t &other)
+            {
+                return other.is_null() && (!ptr);
+            }
+
+            bool operator!=(js::pointer_t ptr)
+            {
+                return _control == string_defined && (!ptr);
+            }
+
+            friend bool operator!=(js::pointer_t ptr, const string_t &other)
+            {
+                return other._control == string_defined && (!ptr);
+            }
+
+            string_t concat(string value)
+            {
+                return *this + value;
+            }
+
+            template <typename N = void>
+            requires ArithmeticOrEnumOrNumber<N>
+                string_t charAt(N n)
+            const
+            {
+                auto index = static_cast<size_t>(n);
+                return index < length() ? from_unit(unit_at(index)) : T();
+            }
+
+            template <typename N = void>
+            requires ArithmeticOrEnumOrNumber<N>
+                js::number charCodeAt(N n)
+            const
+            {
+                auto index = static_cast<size_t>(n);
+                return index < length() ? js::number(unit_at(index)) : js::number(numparse::nan);
+            }
+
+            template <typename N = void>
+            requires can_cast_to_size_t<N>
+                string_t fromCharCode(N n)
+            const
+            {
+                return from_unit(static_cast<uint16_t>(static_cast<size_t>(n)));
+            }
+
+            template <typename F>
+            string_t map_case(F map) const
+            {
+                T result(_value);
+#ifndef UNICODE
+                if (auto text = units())
+                {
+                    std::u16string mapped(*text);
+                    for (auto &unit : mapped)
+                    {
+                        unit = static_cast<char16_t>(map(unit));
+                    }
+
+                    return utf::to_utf8(mapped);
+                }
+#endif
+                for (auto &c : result)
+                {
+                    c = static_cast<char_t>(map(static_cast<std::make_unsigned_t<char_t>>(c)));
+                }
+
+                return result;
+            }
+
+            string_t toUpperCase() const
+            {
+                return map_case(utf::to_upper);
+            }
+
+            string_t toLowerCase() const
+            {
+                return map_case(utf::to_lower);
+            }
+
+            template <typename N = void>
+            requires ArithmeticOrEnumOrNumber<N>
+                string_t substring(N begin, N end)
+            {
+                auto size = length();
+                auto from = strsearch::clamp_position(static_cast<double>(begin), size);
+                auto to = strsearch::clamp_position(static_cast<double>(end), size);
+                return from <= to ? slice_units(from, to) : slice_units(to, from);
+            }
+
+            template <typename N = void>
+            requires ArithmeticOrEnumOrNumber<N>
+                string_t slice(N begin)
+            {
+                auto size = length();
+                return slice_units(relative_position(static_cast<double>(begin), size), size);
+            }
+
+            template <typename N = void>
+            requires ArithmeticOrEnumOrNumber<N>
+                string_t slice(N begin, N end)
+            {
+                auto size = length();
+                auto from = relative_position(static_cast<double>(begin), size);
+                auto to = relative_position(static_cast<double>(end), size);
+                return from < to ? slice_units(from, to) : T();
+            }
+
+            js::number indexOf(const string_t &searchString, js::number position = 0) const
+            {
+                auto from = index_to_offset(strsearch::clamp_position(position._value, length()));
+                auto found = strsearch::find(_value, searchString._value, from);
+                return found == strsearch::npos ? js::number(-1) : js::number(offset_to_index(found));
+            }
+
+            js::number lastIndexOf(const string_t &searchString, js::number position = undefined) const
+            {
+                auto from = std::isnan(position._value) ? _value.size() : index_to_offset(strsearch::clamp_position(position._value, length()));
+                auto found = std::basic_string_view<char_t>(_value).rfind(searchString._value, from);
+                return found == strsearch::npos ? js::number(-1) : js::number(offset_to_index(found));
+            }
+
+            js::boolean includes(const string_t &searchString, js::number position = 0) const
+            {
+                auto from = index_to_offset(strsearch::clamp_position(position._value, length()));
+                return strsearch::find(_value, searchString._value, from) != strsearch::npos;
+            }
+
+            js::boolean startsWith(const string_t &searchString, js::number position = 0) const
+            {
+                auto start = index_to_offset(strsearch::clamp_position(position._value, length()));
+                return std::basic_string_view<char_t>(_value).substr(start, searchString._value.size()) == searchString._value;
+            }
+
+            js::boolean endsWith(const string_t &searchString, js::number endPosition = undefined) const
+            {
+                auto end = std::isnan(endPosition._value) ? _value.size() : index_to_offset(strsearch::clamp_position(endPosition._value, length()));
+                auto size = searchString._value.size();
+                return size <= end && std::basic_string_view<char_t>(_value).substr(end - size, size) == searchString._value;
+            }
+
+            array<string_t> split(const string_t &separator, js::number limit = undefined) const
+            {
+                array<string_t> result;
+                if (separator.is_undefined())
+                {
+                    result._values.push_back(*this);
+                    return result;
+                }
+
+                auto count = std::isnan(limit._value) ? std::numeric_limits<uint32_t>::max() : static_cast<uint32_t>(static_cast<int64_t>(limit._value));
+                if (separator._value.empty() && units())
+                {
+                    for (size_t i = 0; i < length() && i < count; i++)
+                    {
+                        result._values.emplace_back(from_unit(unit_at(i)));
+                    }
+
+                    return result;
+                }
+
+                strsearch::split(_value, separator._value, count, [&](std::basic_string_view<char_t> piece) {
+                    result._values.emplace_back(T(piece));
+                });
+
+                return result;
+            }
+
+            string_t replace(const string_t &pattern, const string_t &replacement) const
+            {
+                return strsearch::replace(_value, pattern._value, replacement._value, false);
+            }
+
+            string_t replaceAll(const string_t &pattern, const string_t &replacement) const
+            {
+                return strsearch::replace(_value, pattern._value, replacement._value, true);
+            }
+
+            auto begin()
+            {
+                return _value.begin();
+            }
+
+            auto end()
+            {
+                return _value.end();
+            }
+
+            friend tostream &operator<<(tostream &os, string val)
+            {
+                if (val._control == 2)
+                {
+                    return os << "undefined";
+                }
+
+                return os << val._value;
+            }
+
+            size_t hash(void) const noexcept
+            {
+                return std::hash<T>{}(_value);
+            }
+        };
+
+    } // namespace tmpl
+
+    template <typename T>
+    string toString(const T &val)
+    {
+        tostringstream os;
+        os << val;
+        return string(os.str());
+    }
+
+    static string string_empty(TXT(""));
+
+    static js::string operator""_S(const char_t *s, std::size_t size)
+    {
+        return js::string(s);
+    }
+
+    static js::number operator""_N(long double value)
+    {
+        return js::number(value);
+    }
+
+    static js::number operator""_N(unsigned long long value)
+    {
+        return js::number(value);
+    }
+
+    static js::number operator+(const string &v)
+    {
+        return number(static_cast<double>(mutable_(v)));
+    }
+
+    static js::number operator+(pointer_t ptr)
+    {
+        return number(reinterpret_cast<size_t>(ptr._ptr));
+    }
+
+    template <typename T, class = std::enable_if_t<std::is_enum_v<T>>>
+    T operator&(T t1, T t2)
+    {
+        return static_cast<T>(static_cast<size_t>(t1) & static_cast<size_t>(t2));
+    }
+
+    template <typename T, class = std::enable_if_t<std::is_enum_v<T>>>
+    T operator&=(T &t1, T t2)
+    {
+        return t1 = static_cast<T>(static_cast<size_t>(t1) & static_cast<size_t>(t2));
+    }
+
+    template <typename T, class = std::enable_if_t<std::is_enum_v<T>>>
+    T operator|(T t1, T t2)
+    {
+        return static_cast<T>(static_cast<size_t>(t1) & static_cast<size_t>(t2));
+    }
+
+    template <typename T, class = std::enable_if_t<std::is_enum_v<T>>>
+    T operator|=(T &t1, T t2)
+    {
+        return t1 = static_cast<T>(static_cast<size_t>(t1) | static_cast<size_t>(t2));
+    }
+
+    template <typename T, class = std::enable_if_t<std::is_enum_v<T>>>
+    T operator~(T t1)
+    {
+        return static_cast<T>(~static_cast<size_t>(t1));
+    }
+
+    // function ///////////////////////////////////////////////////////////////////////
+    // template <typename Rx, typename _Cls, typename... Args>
+    // struct _Deduction_MethodPtr<Rx (/*__thiscall*/ _Cls::*)(Args...) const>
+    // {
+    //     using _ReturnType = Rx;
+    //     const static size_t _CountArgs = sizeof...(Args);
+    // };
+
+    // template <typename Rx, typename _Cls, typename... Args>
+    // struct _Deduction_MethodPtr<Rx (/*__thiscall*/ _Cls::*)(Args...)>
+    // {
+    //     using _ReturnType = Rx;
+    //     const static size_t _CountArgs = sizeof...(Args);
+    // };
+
+    // template <typename Rx, typename... Args>
+    // struct _Deduction_MethodPtr<Rx(/*__cdecl*/ *)(Args...)>
+    // {
+    //     using _ReturnType = Rx;
+    //     const static size_t _CountArgs = sizeof...(Args);
+    // };
+
+    // template <typename F, typename _type = decltype(&F::operator())>
+    // struct _Deduction
+    // {
+    //     using type = _type;
+    // };
+
+    template <typename F, typename Array, std::size_t... I>
+    auto invoke_seq_impl(const F &f, Array &a, std::index_sequence<I...>)
+    {
+        return std::invoke(f, a[I]...);
+    }
+
+    template <std::size_t N, typename F, typename Array, typename Indices = std::make_index_sequence<N>>
+    auto invoke_seq(const F &f, Array &a)
+    {
+        return invoke_seq_impl(f, a, Indices{});
+    }
+
+    template <typename F, typename Array, std::size_t... I>
+    auto invoke_seq_impl(F &f, Array &a, std::index_sequence<I...>)
+    {
+        return std::invoke(f, a[I]...);
+    }
+
+    template <std::size_t N, typename F, typename Array, typename Indices = std::make_index_sequence<N>>
+    auto invoke_seq(F &f, Array &a)
+    {
+        return invoke_seq_impl(f, a, Indices{});
+    }
+
+    template<typename F> 
+    struct function_traits {
+        typedef F functor_type;
+    }
+
+    template<typename R, typename ...Args> 
+    struct function_traits_impl {
+        static constexpr const bool IS_SUPPORTED = true;
+
+        static constexpr const size_t nargs = sizeof...(Args);
+
+        typedef R result_type;
+
+        template <size_t i>
+        struct arg
+        {
+            typedef typename std::tuple_element<i, std::tuple<Args...>>::type type;
+        };
+    }
+
+    template<typename R, typename ...Args> 
+    struct functype_helper {
+
+        typedef (R* builtin_functype)(Args...);
+
+        typedef std::function<R(Args...)> std_function;
+    };
+
+    template<typename R, typename ...Args> 
+    struct function_traits<typename functype_helper<R,Args...>::builtin_functype> :
+        function_traits_impl<R, Args...>
+    {
+    };
+
+    template<typename R, typename ...Args> 
+    struct function_traits<typename functype_helper<R,Args...>::std_function> :
+        function_traits_impl<R, Args...>
+    {
+    };
+
+    template<typename P> 
+    struct deref_shared_ptr {
+        typedef P shared_p;
+    };
+
+    template<typename T> 
+    struct deref_shared_ptr<std::shared_ptr<T>> {
+        typedef T item_t;
+    };
+
+
+    struct function
+    {
+        virtual any invoke(std::initializer_list<any> args_) = 0;
+
+        inline bool operator==(const function& other) {
+            void *mem = this;
+            void *omem = &other;
+            return mem==omem;
+        }
+
+    };
+
+    template <typename F>
+    struct function_t : function
+    {
+        typedef F functor_type;
+        typedef function_traits<F> traits;
+
+        static_assert(is_supported<function_traits<F>>, "unsupported functor type, should be std::function or c++ function type");
+
+        F _f;
+
+        function_t(const F &f) : _f{f}
+        {
+        }
+
+        template <typename... Args>
+        auto operator()(Args... args);
+
+        virtual any invoke(std::initializer_list<any> args_) override;
+    };
+
+    template <typename P, typename T=typename deref_shared_ptr<P>::item_t>
+    struct class_ref : function {
+
+        static_assert(std::is_base_of<object, T>::value, "return type should be derived from shared_ptr to object");
+
+        template<typename... Args>
+        inline static P create(Args... &args) {
+            P result = std::make_shared<T>(args...);
+            return result;
+        }
+
+        template <typename... Args>
+        auto operator()(Args... args) {
+            return create(args...);
+        }
+
+        // still pure virtual :
+        virtual invoke(std::initializer_list<any> args_) = 0;
+    };
+
+    template <typename F, typename T = typename std::result_of<F>::type>
+    struct constructor_ref : function_t<F>, class_ref<T>
+    {
+
+        using function_t::function_t;
+    };
+
+    template <typename T, typename... Args>
+    struct constructor_by_args : constructor_ref<std::function<T(Args...)>> {
+
+
+        using function_t::function_t;
+
+    };
+
+
+    template <typename T>
+    struct ArrayKeys
+    {
+        typedef ArrayKeys<T> iterator;
+
+        T _index;
+        T _end;
+
+        ArrayKeys(T end_) : _index(0), _end(end_)
+        {
+        }
+
+        iterator &begin()
+        {
+            return *this;
+        }
+
+        iterator &end()
+        {
+            return *this;
+        }
+
+        const T &operator*()
+        {
+            return _index;
+        }
+
+        bool operator!=(const iterator &rhs)
+        {
+            return _index != rhs._end;
+        }
+
+        iterator &operator++()
+        {
+            _index++;
+            return *this;
+        }
+    };
+
+    namespace tmpl
+    {
+
+
+        template <typename E>
+        struct array : public std::enable_shared_from_this<array<E>>
+        {
+
+            using Cnt = std::vector<E>;
+            using std::enable_shared_from_this<array<E>>::shared_from_this;
+
+
+            bool isUndefined;
+            Cnt _values;
+
+            array() : isUndefined(false)
+            {
+            }
+
+            array(const array &value) : _values(value._values), isUndefined(value.isUndefined)
+            {
+            }
+
+            array(std::initializer_list<E> values) : _values(values), isUndefined(false)
+            {
+            }
+
+            array(Cnt values) : _values(values), isUndefined(false)
+            {
+            }
+
+            array(const undefined_t &undef) : isUndefined(true)
+            {
+            }
+
+            constexpr operator bool()
+            {
+                return !isUndefined;
+            }
+
+            constexpr array *operator->()
+            {
+                return this;
+            }
+
+            size_t get_length() const
+            {
+                return _values.size();
+            }
+
+            size_t size() const
+            {
+                return _values.size();
+            }
+
+            template <typename N = void>
+            requires can_cast_to_size_t<N>
+                E &operator[](N i) const
+            {
+                if (static_cast<size_t>(i) >= _values.size())
+                {
+                    if constexpr (std::is_same_v<decltype(E{undefined}), E>)
+                    {
+                        static E empty{undefined};
+                        return empty;
+                    }
+                    else
+                    {
+                        static E empty;
+                        return empty;
+                    }
+                }
+
+                return mutable_(_values)[static_cast<size_t>(i)];
+            }
+
+            template <typename N = void>
+            requires can_cast_to_size_t<N>
+                E &operator[](N i)
+            {
+                while (static_cast<size_t>(i) >= _values.size())
+                {
+                    if constexpr (std::is_same_v<decltype(E{undefined}), E>)
+                    {
+                        _values.push_back(E{undefined});
+                    }
+                    else
+                    {
+                        _values.push_back(E{});
+                    }
+                }
+
+                return _values[static_cast<size_t>(i)];
+            }
+
+            ArrayKeys<size_t> keys()
+            {
+                return ArrayKeys<size_t>(_values.size());
+            }
+
+            void push(E t)
+            {
+                _values.push_back(t);
+            }
+
+            template <typename... Args>
+            void push(Args... args)
+            {
+                for (const auto &item : {args...})
+                {
+                    _values.push_back(item);
+                }
+            }
+
+            E pop()
+            {
+                return _values.pop_back();
+            }
+
+            template <typename... Args>
+            void splice(size_t position, size_t size, Args... args)
+            {
+                _values.erase(_values.cbegin() + position, _values.cbegin() + position + size);
+                _values.insert(_values.cbegin() + position, {args...});
+            }
+
+            array slice(size_t first, size_t last)
+            {
+                return array(Cnt(_values.cbegin() + first, _values.cbegin() + last + 1));
+            }
+
+            js::number indexOf(const E &e)
+            {
+                return _values.cend() - std::find(_values.cbegin(), _values.cend(), e) - 1;
+            }
+
+            js::boolean removeElement(const E &e)
+            {
+                return _values.erase(std::find(_values.cbegin(), _values.cend(), e)) != _values.cend();
+            }
+
+            auto begin()
+            {
+                return _values.begin();
+            }
+
+            auto end()
+            {
+                return _values.end();
+            }
+
+            friend std::ostream &operator<<(std::ostream &os, array val)
+            {
+                if (val.isUndefined)
+                {
+                    return os << "undefined";
+                }
+
+                return os << "[array]";
+            }
+
+            template <typename N = void>
+            requires can_cast_to_size_t<N>
+            bool exists(N n) const
+            {
+                return static_cast<size_t>(n) < _values.size();
+            }
+
+            template <class T>
+            bool exists(T) const
+            {
+                return false;
+            }
+
+            array filter(std::function<bool(E)> p)
+            {
+                Cnt result;
+                std::copy_if(_values.begin(), _values.end(), std::back_inserter(result), p);
+                return result;
+            }
+
+            array filter(std::function<bool(E, size_t)> p)
+            {
+                Cnt result;
+                auto first = &(_values)[0];
+                std::copy_if(_values.begin(), _values.end(), std::back_inserter(result), [=](auto &v)
+                             {
+                                 auto index = &v - first;
+                                 return p(v, index);
+                             });
+                return result;
+            }
+
+            template <typename F, class = decltype(F()())>
+            auto map(F p) -> array<undefined_t>
+            {
+                std::vector<undefined_t> result;
+                std::transform(_values.begin(), _values.end(), std::back_inserter(result), [=](auto &v)
+                               {
+                                   mutable_(p)(v);
+                                   return undefined;
+                               });
+
+                return array<undefined_t>(result);
+            }
+
+            /*
+            template <typename F, class = decltype(F()(E()))>
+            auto map(F p) -> array<decltype(p(E()))>
+            {
+                std::vector<decltype(p(E()))> result;
+                std::transform(_values.begin(), _values.end(), std::back_inserter(result), [=](auto &v)
+                               { return mutable_(p)(v); });
+
+                return array<decltype(p(E()))>(result);
+            }
+
+            template <typename F, class = decltype(F()(E(), 0))>
+            auto map(F p) -> array<decltype(p(E(), 0))>
+            {
+                std::vector<decltype(p(E(), 0))> result;
+                auto first = &(_values)[0];
+                std::transform(_values.begin(), _values.end(), std::back_inserter(result), [=](auto &v)
+                               {
+                                   auto index = &v - first;
+                                   return mutable_(p)(v, index);
+                               });
+
+                return array<decltype(p(E(), 0))>(result);
+            }
+*/
+
+            template <typename P>
+            auto reduce(P p)
+            {
+                return std::reduce(_values.begin(), _values.end(), 0, p);
+            }
+
+            template <typename P, typename I>
+            auto reduce(P p, I initial)
+            {
+                return std::reduce(_values.begin(), _values.end(), initial, p);
+            }
+
+            template <typename P>
+            boolean every(P p)
+            {
+                return std::all_of(_values.begin(), _values.end(), p);
+            }
+
+            template <typename P>
+            boolean some(P p)
+            {
+                return std::any_of(_values.begin(), _values.end(), p);
+            }
+
+            js::string join(js::string s)
+            {
+                return std::accumulate(_values.begin(), _values.end(), js::string{}, [&](auto &res, auto &piece)
+                                       { return res += (res) ? s + piece : piece; });
+            }
+
+            void forEach(std::function<void(E)> p)
+            {
+                std::for_each(_values.begin(), _values.end(), p);
+            }
+
+            void forEach(std::function<void(E, size_t)> p)
+            {
+                auto first = &(*_values._values)[0];
+                std::for_each(_values.begin(), _values.end(), [=](auto &v)
+                              {
+                                  auto index = &v - first;
+                                  return p(v, index);
+                              });
+            }
+        };
+
+    } // namespace tmpl
+
+    template <typename TKey, typename TMap>
+    struct ObjectKeys
+    {
+        typedef ObjectKeys<TKey, TMap> iterator;
+        typedef decltype(((TMap *)nullptr)->begin()) TIterator_map;
+
+        TIterator_map _index;
+        const TIterator_map _end;
+
+        ObjectKeys(TMap &values_) : _index(values_.begin()), _end(values_.end())
+        {
+        }
+
+        iterator &begin()
+        {
+            return *this;
+        }
+
+        iterator &end()
+        {
+            return *this;
+        }
+
+        const TKey &operator*()
+        {
+            return _index->first;
+        }
+
+        bool operator!=(const iterator &rhs)
+        {
+            return _index != rhs._end;
+        }
+
+        iterator &operator++()
+        {
+            ++_index;
+            return *this;
+        }
+    };
+
+    namespace tmpl
+    {
+
+
+        template <typename K, typename V>
+        struct object : public std::enable_shared_from_this<object<K, V>>
+        {
+            friend struct ObjectKeys<K, V>;
+            friend struct any;
+
+            struct K_hash
+            {
+                typedef K argument_type;
+                typedef std::size_t result_type;
+                result_type operator()(argument_type const &value) const
+                {
+                    return value.hash();
+                }
+            };
+
+            struct K_equal_to
+            {
+                typedef K argument_type;
+                bool operator()(argument_type const &value, argument_type const &other) const
+                {
+                    return value == other;
+                }
+            };
+
+            using Cnt = std::unordered_map<K, V, K_hash, K_equal_to>;
+            using std::enable_shared_from_this<object<K, V>>::shared_from_this;
+
+            using pair = std::pair<const K, V>;
+
+            bool isUndefined;
+            Cnt _values;
+
+            object();
+
+            object(const object &value);
+
+            object(std::initializer_list<pair> values);
+
+            object(const undefined_t &);
+
+            /*!*/virtual/*!*/ ~object()
+            {
+            }
+
+            typedef constructor_by_args<$S<object>> constructor_type;
+            constexpr static constructor_type constructor_type_obj = constructor_type();
+            virtual function& constructor() {
+                return constructor_type_obj;
+            }
+
+            constexpr operator bool()
+            {
+                return !isUndefined;
+            }
+
+            static ObjectKeys<js::string, Cnt> keys(const object &);
+
+            ObjectKeys<js::string, Cnt> keys();
+
+            constexpr object *operator->()
+            {
+                return this;
+            }
+
+            any &operator[](js::number n) const;
+
+            any &operator[](const char_t *s) const;
+
+            any &operator[](std::string s) const;
+
+            any &operator[](js::string s) const;
+
+            any &operator[](js::number n);
+
+            any &operator[](const char_t *s);
+
+            any &operator[](std::string s);
+
+            any &operator[](js::string s);
+
+            any &operator[](undefined_t undef);
+
+            inline bool operator==(const object &other) const
+            {
+                // TODO - finish it
+                return isUndefined == other.isUndefined && isUndefined == true;
+            }
+
+            size_t size() const
+            {
+                return _values.size();
+            }
+
+            void Delete(js::number field)
+            {
+                _values.erase(field.operator std::string /*&*/());
+            }
+
+            void Delete(js::string field)
+            {
+                _values.erase(field.operator std::string &());
+            }
+
+            void Delete(js::any field);
+
+            void Delete(js::undefined_t)
+            {
+                _values.erase("undefined");
+            }
+
+            void Delete(const char_t *field)
+            {
+                _values.erase(field);
+            }
+        
+            void Delete(const std::string & field) {
+                _values.erase(field);
+            }
+
+            template <typename N = void>
+            requires ArithmeticOrEnum<N>
+            bool exists(N n) const
+            {
+                return _values.find(js::string(to_tstring(n))) != _values.end();
+            }
+
+            template <class T>
+            bool exists(T i) const
+            {
+                if constexpr (is_stringish_v<T>)
+                {
+                    return _values.find(i) != _values.end();
+                }
+
+                return false;
+            }
+
+            virtual js::string toString()
+            {
+                tostringstream streamObj2;
+                streamObj2 << *this;
+                return streamObj2.str();
+            }
+
+            friend tostream &operator<<(tostream &os, object val)
+            {
+                if (val.isUndefined)
+                {
+                    return os << TXT("undefined");
+                }
+
+                return os << TXT("[object]");
+            }
+        };
+
+    } // namespace tmpl
+
+    typedef tmpl::object<string, any> object;
+
+
+
+    struct any
+    {
+        struct any_hash
+        {
+            typedef js::any argument_type;
+            typedef std::size_t result_type;
+            result_type operator()(argument_type const &value) const
+            {
+                return value.hash();
+            }
+        };
+
+        struct any_equal_to
+        {
+            typedef js::any argument_type;
+            bool operator()(argument_type const &value, argument_type const &other) const
+            {
+                return value == other;
+            }
+        };
+
+        enum anyTypeId
+        {
+            undefined_type = 0,
+            boolean_type,
+            pointer_type,
+            number_type,
+            string_type,
+            array_type,
+            object_type,
+            function_type,
+        };
+
+        using any_value_type = std::variant<
+            js::undefined_t,
+            js::boolean,
+            js::pointer_t,
+            js::number,
+            js::string,
+            std::shared_ptr<js::array_any>,
+            std::shared_ptr<js::object>,
+            std::shared_ptr<js::function>
+            >;
+
+        any_value_type _value;
+
+        any() : _value(undefined)
+        {
+        }
+
+        any(const any &other) : _value(other._value)
+        {
+        }
+
+        any(void_t) : _value(undefined)
+        {
+        }
+
+        any(undefined_t) : _value(undefined)
+        {
+        }
+
+        any(pointer_t v) : _value(v)
+        {
+        }
+
+        any(bool value) : _value(js::boolean(value))
+        {
+        }
+
+        template <typename N = void>
+        requires ArithmeticOrEnum<N>
+        any(N value) : _value(js::number(value))
+        {
+        }
+
+        any(char_t value) : _value(js::string(value))
+        {
+        }
+
+        any(js::boolean value) : _value(value)
+        {
+        }
+
+        any(js::number value) : _value(value)
+        {
+        }
+
+        any(const tstring &value) : _value(js::string(value))
+        {
+        }
+
+        any(const js::string &value) : _value(value)
+        {
+        }
+
+        any(const js::array_any &value) : _value(&value)
+        {
+        }
+
+        any(const js::object &value) : _value(&value)
+        {
+        }
+
+        any(const std::shared_ptr<js::array_any> &value) : _value(value)
+        {
+        }
+
+        any(const std::shared_ptr<js::object> &value) : _value(value)
+        {
+        }
+
+        template <typename F, class = std::enable_if_t<std::is_member_function_pointer_v<typename _Deduction<F>::type>>>
+        any(const F &value) : _value(std::shared_ptr<js::function>(((js::function *)new js::function_t<F>(value))))
+        {
+        }
+
+        template <typename Rx, typename... Args>
+        any(Rx(/*__cdecl*/ *value)(Args...)) : _value(std::shared_ptr<js::function>((js::function *)new js::function_t<Rx(/*__cdecl*/ *)(Args...), Rx(/*__cdecl*/ *)(Args...)>(value)))
+        {
+        }
+
+        template <typename C>
+        any(std::shared_ptr<C> value) : _value(std::shared_ptr<js::object>(value))
+        {
+        }
+
+        constexpr any *operator->()
+        {
+            return this;
+        }
+
+        inline anyTypeId get_type() const
+        {
+            return static_cast<anyTypeId>(_value.index());
+        }
+
+        template <typename T>
+        inline const T &get() const
+        {
+            return std::get<T>(_value);
+        }
+
+        template <typename T>
+        inline std::shared_ptr<T> get_ptr() const
+        {
+            return std::dynamic_pointer_cast<T>(mutable_(std::get<std::shared_ptr<js::object>>(_value)));
+        }
+
+        template <typename T>
+        inline T &get()
+        {
+            return std::get<T>(_value);
+        }
+
+        template <typename T>
+        inline std::shared_ptr<T> get_ptr()
+        {
+            return std::dynamic_pointer_cast<T>(std::get<std::shared_ptr<js::object>>(_value));
+        }
+
+        inline const js::boolean &boolean_ref() const
+        {
+            return get<js::boolean>();
+        }
+
+        inline js::boolean &boolean_ref()
+        {
+            return get<js::boolean>();
+        }
+
+        inline const js::number &number_ref() const
+        {
+            return get<js::number>();
+        }
+
+        inline js::number &number_ref()
+        {
+            return get<js::number>();
+        }
+
+        inline const js::string &string_ref() const
+        {
+            return get<js::string>();
+        }
+
+        inline js::string &string_ref()
+        {
+            return get<js::string>();
+        }
+
+        inline std::shared_ptr<function> function_ptr()
+        {
+            return get<std::shared_ptr<function>>();
+        }
+
+        inline std::shared_ptr<function> function_ptr() const
+        {
+            return get<std::shared_ptr<function>>();
+        }
+
+        inline const array_any &array_ref() const
+        {
+            return get<array_any>();
+        }
+
+        inline array_any &array_ref()
+        {
+            return get<array_any>();
+        }
+
+        inline const object &object_ref() const
+        {
+            return get<object>();
+        }
+
+        inline object &object_ref()
+        {
+            return get<object>();
+        }
+
+        /*
+        inline const std::shared_ptr<js::object> &class_ref() const
+        {
+            return get<std::shared_ptr<js::object>>();
+        }
+
+        inline std::shared_ptr<js::object> &class_ref()
+        {
+            return get<std::shared_ptr<js::object>>();
+        }*/
+
+        any &operator=(const any &other)
+        {
+            _value = other._value;
+            return *this;
+        }
+
+        template <typename N = void>
+        requires ArithmeticOrEnumOrNumber<N>
+            any &operator=(N other)
+        {
+            _value = js::number(other);
+            return *this;
+        }
+
+        template <class T>
+        any &operator[](T t) const
+        {
+            if constexpr (std::is_same_v<T, js::number>)
+            {
+                if (get_type() == anyTypeId::array_type)
+                {
+                    return mutable_(array_ref())[t];
+                }
+            }
+
+            if constexpr (is_stringish_v<T>)
+            {
+                if (get_type() == anyTypeId::object_type)
+                {
+                    return (object_ref())[t];
+                }
+            }
+
+            throw TypeError("wrong type");
+        }
+
+        template <class T>
+        any &operator[](T t)
+        {
+            if constexpr (std::is_same_v<T, js::number>)
+            {
+                if (get_type() == anyTypeId::array_type)
+                {
+                    return (array_ref())[t];
+                }
+            }
+
+            if constexpr (is_stringish_v<T>)
+            {
+                if (get_type() == anyTypeId::object_type)
+                {
+                    return (object_ref())[t];
+                }
+            }
+
+            throw TypeError("wrong type");
+        }
+
+        operator js::pointer_t()
+        {
+            if (get_type() == anyTypeId::string_type && string_ref().is_null())
+            {
+                return null;
+            }
+
+            if (get_type() == anyTypeId::number_type)
+            {
+                return pointer_t(number_ref());
+            }
+
+
+            return pointer_t(0xffffffff);
+        }
+
+        operator js::boolean()
+        {
+            if (get_type() == anyTypeId::boolean_type)
+            {
+                return boolean_ref();
+            }
+
+            throw TypeError("wrong type");
+        }
+
+        operator js::number()
+        {
+            if (get_type() == anyTypeId::number_type)
+            {
+                return number_ref();
+            }
+
+            if (get_type() == anyTypeId::string_type)
+            {
+                return js::number(numparse::to_number(string_ref()._value));
+            }
+
+            throw TypeError("wrong type");
+        }
+
+        operator js::string()
+        {
+            /*
+            // String
+            template <typename T>
+            string<T>::string(any val) : _value(val != null ? val.operator std::string() : string_empty._value), _control(val != null ? string_defined : string_null)
+            {
+            }    
+        */
+
+            if (get_type() == anyTypeId::undefined_type)
+            {
+                return js::string();
+            }
+
+            if (get_type() == anyTypeId::string_type)
+            {
+                return string_ref();
+            }
+
+            if (get_type() == anyTypeId::number_type)
+            {
+                return js::string(number_ref().operator tstring());
+            }
+
+            if (get_type() == anyTypeId::pointer_type)
+            {
+                return js::string(get<js::pointer_t>());
+            }
+
+            throw TypeError("wrong type");
+        }
+
+        operator js::object()
+        {
+            if (get_type() == anyTypeId::object_type)
+            {
+                return object_ref();
+            }
+
+            throw TypeError("wrong type");
+        }
+
+        operator js::array_any()
+        {
+            if (get_type() == anyTypeId::array_type)
+            {
+                return array_ref();
+            }
+
+            throw TypeError("wrong type");
+        }
+
+        operator bool()
+        {
+            switch (get_type())
+            {
+            case anyTypeId::undefined_type:
+                return false;
+            case anyTypeId::boolean_type:
+                return boolean_ref();
+            case anyTypeId::number_type:
+                return number_ref();
+            case anyTypeId::string_type:
+                return string_ref()._value.length() > 0;
+            case anyTypeId::object_type:
+                return object_ref()->size() > 0;
+            case anyTypeId::array_type:
+                return array_ref()->size() > 0;
+            case anyTypeId::pointer_type:
+                return get<pointer_t>();
+            default:
+                break;
+            }
+
+            return false;
+        }
+
+        template <typename N = void>
+        requires ArithmeticOrEnum<N>
+        operator N()
+        {
+            switch (get_type())
+            {
+            case anyTypeId::undefined_type:
+                return 0;
+            case anyTypeId::boolean_type:
+                return boolean_ref() ? 1 : 0;
+            case anyTypeId::number_type:
+                return number_ref();
+            case anyTypeId::string_type:
+                return static_cast<N>(numparse::to_number(string_ref()._value));
+            }
+
+            throw TypeError("wrong type");
+        }
+
+        /*template <typename T>
+        operator std::shared_ptr<T>()
+        {
+            if (get_type() == anyTypeId::class_type)
+            {
+                return std::dynamic_pointer_cast<T>(std::get<std::shared_ptr<js::object>>(_value));
+            }
+
+            throw TypeError("wrong type");
+        }*/
+
+        template <typename Rx, typename... Args>
+        operator std::function<Rx(Args...)>()
+        {
+            if (get_type() == anyTypeId::function_type)
+            {
+                auto func = function_ptr();
+                return std::function<Rx(Args...)>([=](Args... args) -> Rx
+                                                  { return func->invoke({args...}); });
+            }
+
+            throw TypeError("wrong type");
+        }
+
+        operator tstring()
+        {
+            tostringstream streamObj2;
+            streamObj2 << *this;
+            return streamObj2.str();
+        }
+
+        bool operator==(const js::any &other) const
+        {
+            if (get_type() != other.get_type())
+            {
+                return false;
+            }
+
+            switch (get_type())
+            {
+            case anyTypeId::undefined_type:
+                return true;
+            case anyTypeId::boolean_type:
+                return boolean_ref() == mutable_(other).boolean_ref();
+            case anyTypeId::number_type:
+                return number_ref() == mutable_(other).number_ref();
+            case anyTypeId::string_type:
+                return string_ref() == mutable_(other).string_ref();
+            case anyTypeId::object_type:
+                return object_ref() == mutable_(other).object_ref();
+            }
+
+            throw NotImplementedError();
+        }
+
+        bool operator!=(const js::any &other) const
+        {
+            return !(*this == other);
+        }
+
+        bool operator==(const js::undefined_t &) const
+        {
+            return get_type() == anyTypeId::undefined_type;
+        }
+
+        bool operator!=(const js::undefined_t &) const
+        {
+            return get_type() != anyTypeId::undefined_type;
+        }
+
+        bool operator==(const pointer_t &other) const
+        {
+            switch (get_type())
+            {
+            case anyTypeId::undefined_type:
+            case anyTypeId::boolean_type:
+            case anyTypeId::number_type:
+                return false;
+            case anyTypeId::string_type:
+                return string_ref().is_null() && other._ptr == nullptr;
+            case anyTypeId::object_type:
+            //case anyTypeId::class_type:
+            case anyTypeId::pointer_type:
+                return get<pointer_t>()._ptr == other._ptr;
+            }
+
+            throw NotImplementedError();
+        }
+
+        bool operator!=(const pointer_t &other) const
+        {
+            return !operator==(other);
+        }
+
+        bool operator==(const js::boolean &other) const
+        {
+            return static_cast<js::boolean>(*mutable_(this)) == other;
+        }
+
+        bool operator!=(const js::boolean &other) const
+        {
+            return static_cast<js::boolean>(*mutable_(this)) != other;
+        }
+
+        template <typename N = void>
+        requires ArithmeticOrEnumOrNumber<N>
+        bool operator==(const N &n) const
+        {
+            return static_cast<js::number>(*mutable_(this)) == n;
+        }
+
+        template <typename N = void>
+        requires ArithmeticOrEnumOrNumber<N>
+        friend bool operator==(const N &n, const any &val)
+        {
+            return n == static_cast<js::number>(mutable_(val));
+        }
+
+        template <typename N = void>
+        requires ArithmeticOrEnumOrNumber<N>
+        bool operator!=(const N &n) const
+        {
+            return static_cast<js::number>(*mutable_(this)) != n;
+        }
+
+        template <typename N = void>
+        requires ArithmeticOrEnumOrNumber<N>
+        friend bool operator!=(const N &n, const any &val)
+        {
+            return n != static_cast<js::number>(mutable_(val));
+        }
+
+        bool operator==(const js::string &other) const
+        {
+            return static_cast<js::string>(*mutable_(this)) == other;
+        }
+
+        bool operator!=(const js::string &other) const
+        {
+            return static_cast<js::string>(*mutable_(this)) != other;
+        }
+
+        template <typename N = void>
+        requires ArithmeticOrEnumOrNumber<N>
+            any operator+(N n)
+        {
+            switch (get_type())
+            {
+            case anyTypeId::number_type:
+                return number_ref() + n;
+            }
+
+            throw NotImplementedError();
+        }
+
+        template <typename N = void>
+        requires ArithmeticOrEnumOrNumber<N>
+        friend N operator+(N n, const any &val)
+        {
+            switch (val.get_type())
+            {
+            case anyTypeId::number_type:
+                return n + mutable_(val).number_ref();
+            }
+
+            throw NotImplementedError();
+        }
+
+        any operator+(string s)
+        {
+            switch (get_type())
+            {
+            case anyTypeId::number_type:
+                return number_ref().operator js::string() + s;
+            case anyTypeId::string_type:
+                return any(string_ref() + s);
+            }
+
+            throw NotImplementedError();
+        }
+
+        inline any operator+(any t) const
+        {
+            return mutable_(this)->operator+(t);
+        }
+
+        any operator+(any t)
+        {
+            switch (get_type())
+            {
+            case anyTypeId::number_type:
+                switch (t.get_type())
+                {
+                case anyTypeId::number_type:
+                    return number_ref() + t.number_ref();
+                case anyTypeId::string_type:
+                    return number_ref().operator js::string() + t.string_ref();
+                }
+                break;
+            case anyTypeId::string_type:
+                switch (t.get_type())
+                {
+                case anyTypeId::string_type:
+                    return string_ref() + t.string_ref();
+                }
+                break;
+            }
+
+            throw NotImplementedError();
+        }
+
+        any &operator++()
+        {
+            switch (get_type())
+            {
+            case anyTypeId::number_type:
+                number_ref()++;
+                return *this;
+            }
+
+            throw NotImplementedError();
+        }
+
+        any operator++(int)
+        {
+            switch (get_type())
+            {
+            case anyTypeId::number_type:
+                any tmp(number_ref());
+                operator++();
+                return tmp;
+            }
+
+            throw NotImplementedError();
+        }
+
+        template <typename N = void>
+        requires ArithmeticOrEnumOrNumber<N>
+            any &operator+=(N n)
+        {
+            switch (get_type())
+            {
+            case anyTypeId::number_type:
+                number_ref() += n;
+                return *this;
+            }
+
+            throw NotImplementedError();
+        }
+
+        template <typename N = void>
+        requires ArithmeticOrEnumOrNumber<N>
+        friend N operator+=(N &n, any value)
+        {
+            switch (value.get_type())
+            {
+            case anyTypeId::number_type:
+                return n += value.number_ref();
+            }
+
+            throw NotImplementedError();
+        }
+
+        template <typename N = void>
+        requires ArithmeticOrEnumOrNumber<N>
+            any operator-(N n)
+        {
+            switch (get_type())
+            {
+            case anyTypeId::number_type:
+                return number_ref() - n;
+            }
+
+            throw NotImplementedError();
+        }
+
+        template <typename N = void>
+        requires ArithmeticOrEnumOrNumber<N>
+        friend N operator-(N n, const any &val)
+        {
+            switch (val.get_type())
+            {
+            case anyTypeId::number_type:
+                return n - mutable_(val).number_ref();
+            }
+
+            throw NotImplementedError();
+        }
+
+        any operator-(any t)
+        {
+            switch (get_type())
+            {
+            case anyTypeId::number_type:
+                switch (t.get_type())
+                {
+                case anyTypeId::number_type:
+                    return number_ref() - t.number_ref();
+                }
+                break;
+            }
+
+            throw NotImplementedError();
+        }
+
+        any &operator--()
+        {
+            switch (get_type())
+            {
+            case anyTypeId::number_type:
+                number_ref() -= 1;
+                return *this;
+            }
+
+            throw NotImplementedError();
+        }
+
+        any operator--(int)
+        {
+            switch (get_type())
             {
-                return is_undefined();
+            case anyTypeId::number_type:
+                any tmp(number_ref());
+                operator--();
+                return tmp;
             }
 
-            inline bool operator!=(undefined_t)
+            throw NotImplementedError();
+        }
+
+        template <typename N = void>
+        requires ArithmeticOrEnumOrNumber<N>
+            any &operator-=(N n)
+        {
+            switch (get_type())
             {
-                return !is_undefined();
+            case anyTypeId::number_type:
+                number_ref() -= n;
+                return *this;
             }
 
-            inline friend bool operator==(const undefined_t, number_t other)
+            throw NotImplementedError();
+        }
+
+        template <typename N = void>
+        requires ArithmeticOrEnumOrNumber<N>
+        friend N operator-=(N &n, any value)
+        {
+            switch (value.get_type())
             {
-                return other.is_undefined();
+            case anyTypeId::number_type:
+                return n -= value.number_ref();
             }
 
-            inline friend bool operator!=(const undefined_t, number_t other)
+            throw NotImplementedError();
+        }
+
+        template <typename N = void>
+        requires ArithmeticOrEnumOrNumber<N>
+            any operator*(N n)
+        {
+            switch (get_type())
             {
-                return !other.is_undefined();
+            case anyTypeId::number_type:
+                return any(number_ref() * n);
             }
 
-            inline friend bool operator==(const number_t n, js::pointer_t p)
+            throw NotImplementedError();
+        }
+
+        template <typename N = void>
+        requires ArithmeticOrEnumOrNumber<N>
+        friend N operator*(N n, const any &val)
+        {
+            switch (val.get_type())
             {
-                return mutable_(n).is_undefined() == p.isUndefined && false;
+            case anyTypeId::number_type:
+                return n * mutable_(val).number_ref();
             }
 
-            inline friend bool operator!=(const number_t n, js::pointer_t p)
+            throw NotImplementedError();
+        }
+
+        any operator*(any t)
+        {
+            switch (get_type())
             {
-                return mutable_(n).is_undefined() != p.isUndefined || true;
+            case anyTypeId::number_type:
+                switch (t.get_type())
+                {
+                case anyTypeId::number_type:
+                    return any(number_ref() * t.number_ref());
+                }
+                break;
             }
 
-            number_t operator+()
+            throw NotImplementedError();
+        }
+
+        template <typename N = void>
+        requires ArithmeticOrEnumOrNumber<N>
+            any &operator*=(N n)
+        {
+            switch (get_type())
             {
-                return +_value;
+            case anyTypeId::number_type:
+                number_ref() *= n;
+                return *this;
             }
 
-            number_t &operator++()
+            throw NotImplementedError();
+        }
+
+        template <typename N = void>
+        requires ArithmeticOrEnumOrNumber<N>
+            any operator/(N n)
+        {
+            switch (get_type())
             {
-                _value += 1;
+            case anyTypeId::number_type:
+                return any(number_ref() / n);
+            }
+
+            throw NotImplementedError();
+        }
+
+        template <typename N = void>
+        requires ArithmeticOrEnumOrNumber<N>
+        friend N operator/(N n, const any &val)
+        {
+            switch (val.get_type())
+            {
+            case anyTypeId::number_type:
+                return n / mutable_(val).number_ref();
+            }
+
+            throw NotImplementedError();
+        }
+
+        any operator/(any t)
+        {
+            switch (get_type())
+            {
+            case anyTypeId::number_type:
+                switch (t.get_type())
+                {
+                case anyTypeId::number_type:
+                    return any(number_ref() / t.number_ref());
+                }
+                break;
+            }
+
+            throw NotImplementedError();
+        }
+
+        template <typename N = void>
+        requires ArithmeticOrEnumOrNumber<N>
+            any &operator/=(N n)
+        {
+            switch (get_type())
+            {
+            case anyTypeId::number_type:
+                number_ref() /= n;
                 return *this;
             }
 
-            number_t operator++(int)
+            throw NotImplementedError();
+        }
+
+        template <typename N = void>
+        requires ArithmeticOrEnumOrNumber<N>
+            any operator%(N n)
+        {
+            switch (get_type())
             {
-                number_t tmp(*this);
-                operator++();
-                return tmp;
+            case anyTypeId::number_type:
+                return any(number_ref() % n);
             }
 
-            template <typename T = void>
-            requires ArithmeticOrEnumOrNumber<T>
-            friend number_t operator+(const number_t n, T value)
+            throw NotImplementedError();
+        }
+
+        any operator%(any t)
+        {
+            switch (get_type())
             {
-                return n._value + static_cast<V>(value);
+            case anyTypeId::number_type:
+                switch (t.get_type())
+                {
+                case anyTypeId::number_type:
+                    return any(number_ref() % t.number_ref());
+                }
+                break;
             }
 
-            template <typename T = void>
-            requires ArithmeticOrEnum<T>
-            friend T operator+(T value, const number_t n)
+            throw NotImplementedError();
+        }
+
+        template <typename N = void>
+        requires ArithmeticOrEnumOrNumber<N>
+        friend any operator%(N n, any value)
+        {
+            switch (value.get_type())
             {
-                return value + static_cast<T>(n._value);
+            case anyTypeId::number_type:
+                return any(n % value.number_ref());
             }
 
-            template <typename T = void>
-            requires ArithmeticOrEnumOrNumber<T>
-                number_t &operator+=(T value)
+            throw NotImplementedError();
+        }
+
+        template <typename N = void>
+        requires ArithmeticOrEnumOrNumber<N>
+            any &operator%=(N other)
+        {
+            switch (get_type())
             {
-                _value += static_cast<V>(value);
+            case anyTypeId::number_type:
+                number_ref() %= other;
                 return *this;
             }
 
-            template <typename N = void>
-            requires ArithmeticOrEnum<N>
-            friend N operator+=(N &n, const number &other)
+            throw NotImplementedError();
+        }
+
+        template <typename N = void>
+        requires ArithmeticOrEnumOrNumber<N>
+        bool operator>(N n)
+        {
+            switch (get_type())
+            {
+            case anyTypeId::number_type:
+                return number_ref() > n;
+            }
+
+            throw NotImplementedError();
+        }
+
+        any operator>(any t)
+        {
+            switch (get_type())
+            {
+            case anyTypeId::number_type:
+                switch (t.get_type())
+                {
+                case anyTypeId::number_type:
+                    return any(number_ref() > t.number_ref());
+                }
+                break;
+            }
+
+            throw NotImplementedError();
+        }
+
+        template <typename N = void>
+        requires ArithmeticOrEnumOrNumber<N>
+        bool operator>=(N n)
+        {
+            switch (get_type())
+            {
+            case anyTypeId::number_type:
+                return number_ref() >= n;
+            }
+
+            throw NotImplementedError();
+        }
+
+        any operator>=(any t)
+        {
+            switch (get_type())
+            {
+            case anyTypeId::number_type:
+                switch (t.get_type())
+                {
+                case anyTypeId::number_type:
+                    return any(number_ref() >= t.number_ref());
+                }
+                break;
+            }
+
+            throw NotImplementedError();
+        }
+
+        template <typename N = void>
+        requires ArithmeticOrEnumOrNumber<N>
+        bool operator<(N n)
+        {
+            switch (get_type())
             {
-                return n += static_cast<N>(mutable_(other));
+            case anyTypeId::number_type:
+                return number_ref() < n;
             }
 
-            template <typename T = void>
-            requires ArithmeticOrEnumOrNumber<T>
-            friend number_t operator-(const number_t n, T value)
+            throw NotImplementedError();
+        }
+
+        any operator<(any t)
+        {
+            switch (get_type())
             {
-                return n._value - static_cast<V>(value);
+            case anyTypeId::number_type:
+                switch (t.get_type())
+                {
+                case anyTypeId::number_type:
+                    return any(number_ref() < t.number_ref());
+                }
+                break;
             }
 
-            template <typename T = void>
-            requires ArithmeticOrEnum<T>
-            friend T operator-(T value, const number_t n)
+            throw NotImplementedError();
+        }
+
+        bool operator<=(js::number n)
+        {
+            switch (get_type())
             {
-                return value - static_cast<T>(n._value);
+            case anyTypeId::number_type:
+                return number_ref() <= n;
             }
 
-            number_t operator-()
+            throw NotImplementedError();
+        }
+
+        any operator<=(any t)
+        {
+            switch (get_type())
             {
-                return -_value;
+            case anyTypeId::number_type:
+                switch (t.get_type())
+                {
+                case anyTypeId::number_type:
+                    return any(number_ref() <= t.number_ref());
+                }
+                break;
             }
 
-            number_t &operator--()
+            throw NotImplementedError();
+        }
+
+        template <typename... Args>
+        any operator()(Args... args) const
+        {
+            switch (get_type())
             {
-                _value -= 1;
-                return *this;
+            case anyTypeId::function_type:
+                return function_ptr()->invoke({args...});
             }
 
-            number_t operator--(int)
+            throw NotImplementedError();
+        }
+
+        template <typename... Args>
+        any operator()(Args... args)
+        {
+            switch (get_type())
             {
-                number_t tmp(*this);
-                operator--();
-                return tmp;
+            case anyTypeId::function_type:
+                return function_ptr()->invoke({args...});
             }
 
-            template <typename T = void>
-            requires ArithmeticOrEnumOrNumber<T>
-                number_t &operator-=(T value)
+            throw NotImplementedError();
+        }
+
+        js::string type_of()
+        {
+            switch (get_type())
             {
-                _value -= static_cast<V>(value);
-                return *this;
+            case anyTypeId::undefined_type:
+                return TXT("undefined");
+
+            case anyTypeId::boolean_type:
+                return TXT("boolean");
+
+            case anyTypeId::number_type:
+                return TXT("number");
+
+            case anyTypeId::string_type:
+                return TXT("string");
+
+            case anyTypeId::array_type:
+                return TXT("array");
+
+            case anyTypeId::object_type:
+                return TXT("object");
+
+            default:
+                return TXT("error");
             }
+        }
 
-            template <typename N = void>
-            requires ArithmeticOrEnum<N>
-            friend N operator-=(N &n, const number &other)
+        void Delete(const char_t *field)
+        {
+            switch (get_type())
             {
-                return n -= static_cast<N>(mutable_(other));
+            case anyTypeId::object_type:
+                object_ref().Delete(field);
+                break;
+
+            default:
+                throw TypeError("wrong type");
             }
+        }
 
-            template <typename T = void>
-            requires ArithmeticOrEnumOrNumber<T>
-            friend number_t operator*(const number_t n, T value)
+        js::number get_length() const
+        {
+            switch (get_type())
             {
-                return n._value * static_cast<V>(value);
+            case anyTypeId::string_type:
+                return string_ref().get_length();
+            case anyTypeId::array_type:
+                return array_ref().get_length();
+            default:
+                throw TypeError("wrong type");
             }
+        }
 
-            template <typename T = void>
-            requires ArithmeticOrEnum<T>
-            friend T operator*(T value, const number_t n)
+        auto begin() -> decltype(array_ref().begin())
+        {
+            switch (get_type())
             {
-                return value * static_cast<T>(n._value);
+            case anyTypeId::array_type:
+                return array_ref().begin();
+            default:
+                throw TypeError("wrong type");
             }
+        }
 
-            template <typename T = void>
-            requires ArithmeticOrEnumOrNumber<T>
-                number_t &operator*=(T value)
+        auto end() -> decltype(array_ref().end())
+        {
+            switch (get_type())
             {
-                _value *= static_cast<V>(value);
-                return *this;
+            case anyTypeId::array_type:
+                return array_ref().end();
+            default:
+                throw TypeError("wrong type");
             }
+        }
 
-            template <typename N = void>
-            requires ArithmeticOrEnum<N>
-            friend N operator*=(N &n, const number &other)
+        size_t hash(void) const noexcept
+        {
+            size_t const h1(std::hash<int>{}(static_cast<int>(get_type())));
+            size_t h2;
+
+            switch (get_type())
             {
-                return n *= static_cast<N>(mutable_(other));
+            case anyTypeId::undefined_type:
+                h2 = 0;
+                break;
+
+            case anyTypeId::boolean_type:
+                h2 = std::hash<bool>{}(static_cast<bool>(mutable_(boolean_ref())));
+                break;
+
+            case anyTypeId::number_type:
+                h2 = std::hash<double>{}(static_cast<double>(mutable_(number_ref())));
+                break;
+
+            case anyTypeId::string_type:
+                h2 = std::hash<tstring>{}(static_cast<tstring &>(mutable_(string_ref())));
+                break;
+
+            default:
+                h2 = 0;
             }
 
-            template <typename T = void>
-            requires ArithmeticOrEnumOrNumber<T>
-            friend number_t operator/(const number_t n, T value)
+            return hash_combine(h1, h2);
+        }
+
+        friend tostream &operator<<(tostream &os, any val)
+        {
+            switch (val.get_type())
             {
-                return n._value / static_cast<V>(value);
+            case anyTypeId::undefined_type:
+                return os << TXT("undefined");
+
+            case anyTypeId::boolean_type:
+                return os << val.boolean_ref();
+
+            case anyTypeId::number_type:
+                return os << val.number_ref();
+
+            case anyTypeId::pointer_type:
+                return os << TXT("null");
+
+            case anyTypeId::string_type:
+                return os << val.string_ref();
+
+            case anyTypeId::function_type:
+                return os << TXT("[function]");
+
+            case anyTypeId::array_type:
+                return os << TXT("[array]");
+
+            case anyTypeId::object_type:
+                return os << TXT("[object]");
+
+            //case anyTypeId::class_type:
+            //    return os << val.class_ref().get()->toString();
+
+            default:
+                return os << TXT("[any]");
             }
+        }
+    };
+
+
+    template <typename F>
+    any invokeWithInitList(F &_f, std::initializer_list<any> args_)
+    {
+        typedef function_traits<F> traits;
+
+        auto args_vector = std::vector<any>(args_);
+        if constexpr (std::is_void_v<traits::return_type>)
+        {
+            invoke_seq<traits::nargs>(_f, args_vector);
+            return any();
+        }
+        else
+        {
+            return invoke_seq<traits::nargs>(_f, args_vector);
+        }
+    }
+
+    template <typename F>
+    template <typename... Args>
+    auto function_t<F>::operator()(Args... args)
+    {
+
+        if constexpr (std::is_void_v<traits::return_type>)
+        {
+            _f(args...);
+        }
+        else 
+        {
+            return _f(args...);
+        }
+    }
+
+    template <typename F>
+    any function_t<F>::invoke(std::initializer_list<any> args_)
+    {
+        auto result = invokeWithInitList(*_f, args_);
+        return result;
+    }
 
-            template <typename T = void>
-            requires ArithmeticOrEnum<T>
-            friend T operator/(T value, const number_t n)
-            {
-                return value / static_cast<T>(n._value);
-            }
+    template <typename T>
+    struct shared;
 
-            template <typename T = void>
-            requires ArithmeticOrEnumOrNumber<T>
-                number_t &operator/=(T value)
-            {
-                _value /= static_cast<V>(value);
-                return *this;
-            }
+    template <class T1, class T2>
+    concept NotShared = !std::is_same_v<T1, shared<T2>>;
 
-            template <typename N = void>
-            requires ArithmeticOrEnum<N>
-            friend N operator/=(N &n, const number &other)
-            {
-                return n /= static_cast<N>(mutable_(other));
-            }
+    template <typename T>
+    struct shared
+    {
+        using shared_type = shared<T>;
 
-            template <typename T = void>
-            requires ArithmeticOrEnumOrNumber<T>
-            friend number_t operator^(const number_t n, T value)
-            {
-                return static_cast<long>(n._value) ^ static_cast<long>(static_cast<V>(value));
-            }
+        std::shared_ptr<T> _value;
 
-            template <typename T = void>
-            requires ArithmeticOrEnum<T>
-            friend number_t operator^(T value, const number_t n)
-            {
-                return static_cast<long>(static_cast<V>(value)) ^ static_cast<long>(n._value);
-            }
+        shared(T t) : _value(std::make_shared<T>(t)) {}
+        shared(std::shared_ptr<T> t) : _value(t) {}
 
-            template <typename T = void>
-            requires ArithmeticOrEnumOrNumber<T>
-                number_t &operator^=(T value)
-            {
-                _value = static_cast<long>(_value) ^ static_cast<long>(static_cast<V>(value));
-                return *this;
-            }
+        template <typename V>
+        shared_type &operator=(const V &v)
+        {
+            *_value = mutable_(v);
+            return *this;
+        }
 
-            template <typename T = void>
-            requires ArithmeticOrEnumOrNumber<T>
-            friend number_t operator|(const number_t n, T value)
-            {
-                return static_cast<long>(n._value) | static_cast<long>(static_cast<V>(value));
-            }
+        T &operator*() const
+        {
+            return *_value.get();
+        }
 
-            template <typename T = void>
-            requires ArithmeticOrEnum<T>
-            friend T operator|(T value, const number_t n)
-            {
-                return static_cast<long>(static_cast<V>(value)) | static_cast<long>(n._value);
-            }
+        operator T() { return *_value.get(); }
 
-            template <typename T = void>
-            requires ArithmeticOrEnumOrNumber<T>
-                number_t &operator|=(T value)
-            {
-                _value = static_cast<long>(_value) | static_cast<long>(static_cast<V>(value));
-                return *this;
-            }
+        // todo: memory leak here, improve it using any(shared_t<value> s)
+        operator any() { return *_value.get(); }
 
-            template <typename T = void>
-            requires ArithmeticOrEnumOrNumber<T>
-            friend number_t operator&(const number_t n, T value)
-            {
-                return static_cast<long>(n._value) & static_cast<long>(static_cast<V>(value));
-            }
+        T &get() const { return *_value.get(); }
 
-            template <typename T = void>
-            requires ArithmeticOrEnum<T>
-            friend T operator&(T value, const number_t n)
-            {
-                return static_cast<long>(static_cast<V>(value)) & static_cast<long>(n._value);
-            }
+        T *operator->() const
+        {
+            return _value.get();
+        }
 
-            template <typename T = void>
-            requires ArithmeticOrEnumOrNumber<T>
-                number_t &operator&=(T value)
-            {
-                _value = static_cast<long>(_value) & static_cast<long>(static_cast<V>(value));
-                return *this;
-            }
+        template <class Tv>
+        auto &operator[](Tv t) const
+        {
+            return const_(get())[t];
+        }
 
-            template <typename T = void>
-            requires ArithmeticOrEnumOrNumber<T>
-            friend number_t operator%(const number_t n, T value)
-            {
-                return number_t(static_cast<long>(n._value) % static_cast<long>(static_cast<V>(value)));
-            }
+        template <class Tv>
+        auto &operator[](Tv t)
+        {
+            return get()[t];
+        }
 
-            template <typename T = void>
-            requires ArithmeticOrEnum<T>
-            friend T operator%(T value, const number_t n)
-            {
-                return static_cast<long>(static_cast<V>(value)) % static_cast<long>(n._value);
-            }
+        auto &operator++()
+        {
+            return ++get();
+        }
 
-            template <typename T = void>
-            requires ArithmeticOrEnumOrNumber<T>
-                number_t &operator%=(T value)
-            {
-                _value = static_cast<long>(_value) % static_cast<long>(static_cast<V>(value));
-                return *this;
-            }
+        auto operator++(int)
+        {
+            return get()++;
+        }
 
-            template <typename T = void>
-            requires ArithmeticOrEnumOrNumber<T>
-                number_t operator<<(T value)
-            {
-                return number_t(static_cast<long>(_value) << static_cast<long>(static_cast<V>(value)));
-            }
+        template <class Tv>
+        auto operator+(Tv other) const
+        {
+            return get() + other;
+        }
 
-            template <typename T = void>
-            requires ArithmeticOrEnumOrNumber<T>
-                number_t &operator<<=(T value)
-            {
-                _value = static_cast<long>(_value) << static_cast<long>(static_cast<V>(value));
-                return *this;
-            }
+        template <class Tv = void>
+        requires NotShared<Tv, T>
+        friend auto operator+(Tv other, const shared_type &val)
+        {
+            return other + val.get();
+        }
 
-            template <typename T = void>
-            requires ArithmeticOrEnumOrNumber<T>
-                number_t operator>>(T value)
-            {
-                return number_t(static_cast<long>(_value) >> static_cast<long>(static_cast<V>(value)));
-            }
+        template <class Tv>
+        auto operator+=(Tv other) const
+        {
+            return get() += other;
+        }
 
-            template <typename T = void>
-            requires ArithmeticOrEnumOrNumber<T>
-                number_t &operator>>=(T value)
-            {
-                _value = static_cast<long>(_value) >> static_cast<long>(static_cast<V>(value));
-                return *this;
-            }
+        template <class Tv>
+        requires NotShared<Tv, T>
+        friend auto operator+=(Tv &other, const shared_type &val)
+        {
+            return other += mutable_(val).get();
+        }
 
-            number_t operator~()
-            {
-                return ~static_cast<long>(_value);
-            }
+        template <class Tv>
+        auto operator-(Tv other) const
+        {
+            return get() - other;
+        }
 
-            template <typename N = void>
-            requires ArithmeticOrEnumOrNumber<N>
-            friend bool operator==(const number_t value, N n)
-            {
-                return value._value == static_cast<V>(n);
-            }
+        template <class Tv = void>
+        requires NotShared<Tv, T>
+        friend auto operator-(Tv other, const shared_type &val)
+        {
+            return other - val.get();
+        }
 
-            template <typename N = void>
-            requires ArithmeticOrEnum<N>
-            friend bool operator==(N n, const number_t value)
-            {
-                return static_cast<V>(n) == value._value;
-            }
+        template <class Tv>
+        auto operator-=(Tv other) const
+        {
+            return get() -= other;
+        }
 
-            template <typename N = void>
-            requires ArithmeticOrEnumOrNumber<N>
-            friend bool operator!=(const number_t value, N n)
-            {
-                return value._value != static_cast<V>(n);
-            }
+        template <class Tv>
+        requires NotShared<Tv, T>
+        friend auto operator-=(Tv &other, const shared_type &val)
+        {
+            return other -= mutable_(val).get();
+        }
 
-            template <typename N = void>
-            requires ArithmeticOrEnum<N>
-            friend bool operator!=(N n, const number_t value)
-            {
-                return static_cast<V>(n) != value._value;
-            }
+        template <class Tv>
+        auto operator*(Tv other) const
+        {
+            return get() * other;
+        }
+
+        template <class Tv = void>
+        requires NotShared<Tv, T>
+        friend auto operator*(Tv other, const shared_type &val)
+        {
+            return other * val.get();
+        }
+
+        template <class Tv>
+        auto operator*=(Tv other) const
+        {
+            return get() *= other;
+        }
 
-            template <typename N = void>
-            requires ArithmeticOrEnumOrNumber<N>
-            friend bool operator<(const number_t value, N n)
-            {
-                return value._value < static_cast<V>(n);
-            }
+        template <class Tv>
+        requires NotShared<Tv, T>
+        friend auto operator*=(Tv &other, const shared_type &val)
+        {
+            return other *= mutable_(val).get();
+        }
 
-            template <typename N = void>
-            requires ArithmeticOrEnum<N>
-            friend bool operator<(N n, const number_t value)
-            {
-                return static_cast<V>(n) < value._value;
-            }
+        template <class Tv>
+        auto operator/(Tv other) const
+        {
+            return get() / other;
+        }
 
-            template <typename N = void>
-            requires ArithmeticOrEnumOrNumber<N>
-            friend bool operator<=(const number_t value, N n)
-            {
-                return value._value <= static_cast<V>(n);
-            }
+        template <class Tv = void>
+        requires NotShared<Tv, T>
+        friend auto operator/(Tv other, const shared_type &val)
+        {
+            return other / val.get();
+        }
 
-            template <typename N = void>
-            requires ArithmeticOrEnum<N>
-            friend bool operator<=(N n, const number_t value)
-            {
-                return static_cast<V>(n) <= value._value;
-            }
+        template <class Tv>
+        auto operator/=(Tv other) const
+        {
+            return get() /= other;
+        }
 
-            template <typename N = void>
-            requires ArithmeticOrEnumOrNumber<N>
-            friend bool operator>(const number_t value, N n)
-            {
-                return value._value > static_cast<V>(n);
-            }
+        template <class Tv>
+        requires NotShared<Tv, T>
+        friend auto operator/=(Tv &other, const shared_type &val)
+        {
+            return other /= mutable_(val).get();
+        }
 
-            template <typename N = void>
-            requires ArithmeticOrEnum<N>
-            friend bool operator>(N n, const number_t value)
-            {
-                return static_cast<V>(n) > value._value;
-            }
+        template <class Tv>
+        friend bool operator==(const Tv &other, const shared_type &val)
+        {
+            return val.get() == other;
+        }
 
-            template <typename N = void>
-            requires ArithmeticOrEnumOrNumber<N>
-            friend bool operator>=(const number_t value, N n)
-            {
-                return value._value >= static_cast<V>(n);
-            }
+        template <class Tv>
+        friend bool operator!=(const Tv &other, const shared_type &val)
+        {
+            return val.get() != other;
+        }
 
-            template <typename N = void>
-            requires ArithmeticOrEnum<N>
-            friend bool operator>=(N n, const number_t value)
-            {
-                return static_cast<V>(n) >= value._value;
-            }
+        template <class Tv>
+        bool operator==(const Tv &other) const
+        {
+            return get() == other;
+        }
 
-            js::string toString();
-            js::string toString(number_t radix);
+        template <class Tv>
+        bool operator!=(const Tv &other) const
+        {
+            return get() != other;
+        }
 
-            friend tostream &operator<<(tostream &os, number_t val)
-            {
-                if (val.is_undefined())
-                {
-                    return os << TXT("undefined");
-                }
+        template <class Tv>
+        friend bool operator==(const shared<Tv> &other, const shared_type &val)
+        {
+            return val.get() == other.get();
+        }
 
-                if (std::isnan(static_cast<double>(val)))
-                {
-                    return os << TXT("NaN");
-                }
+        template <class Tv>
+        friend bool operator!=(const shared<Tv> &other, const shared_type &val)
+        {
+            return val.get() != other.get();
+        }
 
-                return os << val._value;
-            }
-        };
+        template <class Tv>
+        bool operator==(const shared<Tv> &other) const
+        {
+            return get() == other.get();
+        }
 
-        template <typename T>
-        pointer_t<T>::pointer_t(js::number n) : _ptr((void *)(long long)n._value), isUndefined(false)
+        template <class Tv>
+        bool operator!=(const shared<Tv> &other) const
         {
+            return get() != other.get();
         }
 
-        template <typename T>
-        template <typename N>
-        requires ArithmeticOrEnumOrNumber<N>
-        bool pointer_t<T>::operator==(N n)
+        number get_length() const
         {
-            //return isUndefined == n.isUndefined && intptr_t(_ptr) == intptr_t(static_cast<size_t>(n));
-            return false;
+            return get()->get_length();
         }
 
-        template <typename T>
-        template <typename N>
-        requires ArithmeticOrEnumOrNumber<N>
-        bool pointer_t<T>::operator!=(N n)
+        auto begin()
         {
-            //return isUndefined != n.isUndefined || intptr_t(_ptr) != intptr_t(static_cast<size_t>(n));
-            return true;
+            return get()->begin();
         }
 
-    } // impl
+        auto end()
+        {
+            return get()->end();
+        }
+    };
 
-    template <typename N>
-    requires ArithmeticOrEnum<N>
-    bool undefined_t::operator==(N n) const
-    {
-        return false;
-    }
+    template <typename T>
+    shared(T t) -> shared<T>;
 
-    template <typename N>
-    requires ArithmeticOrEnum<N>
-    bool undefined_t::operator!=(N n) const
+    // TODO: put into class undefined
+    static js::number operator+(const undefined_t &v)
     {
-        return true;
+        return number(NAN);
     }
 
-    template <typename N/*=void*/>
-    requires ArithmeticOrEnum<N>
-    bool operator==(N n, const undefined_t &u)
+    // TODO: put into class boolean
+    static js::number operator+(const boolean &v)
     {
-        return false;
+        return number((mutable_(v)) ? 1 : 0);
     }
 
-    template <typename N/*=void*/>
-    requires ArithmeticOrEnum<N>
-    bool operator!=(N n, const undefined_t &u)
+    // typedefs
+    typedef std::unordered_map<any, int, any::any_hash, any::any_equal_to> switch_type;
+
+    // label of value in a switch_type table, 0 (default) when it is not a case; lookups
+    // never insert, so static tables stay shared and untouched
+    inline int switch_case(const switch_type &cases, const any &value)
     {
-        return true;
+        auto found = cases.find(value);
+        return found != cases.end() ? found->second : 0;
     }
 
-    namespace tmpl
+    // switch over string literals, a CHD perfect hash (Helpers.findPerfectHash): the seeded
+    // hash picks one of B buckets, the bucket's displacement places the key in one of N
+    // slots (both powers of two, N a little over the key count), one compare confirms the
+    // candidate
+    template <size_t N, size_t B>
+    struct string_switch
     {
-        template <typename T>
-        struct string
+        struct slot_t
         {
-            using string_t = string<T>;
-
-            enum
-            {
-                string_defined = 0,
-                string_null = 1,
-                string_undefined = 2
-            } _control;
-            T _value;
-
-            string() : _value(), _control(string_undefined)
-            {
-            }
-
-            string(const string &value) : _value(value._value), _control(value._control)
-            {
-            }
-
-            string(js::pointer_t v) : _value(v ? static_cast<const char_t *>(v) : TXT("")), _control(v ? string_defined : string_null)
-            {
-            }
-
-            string(tstring value) : _value(value), _control(string_defined)
-            {
-            }
-
-            string(const char_t *value) : _value(value == nullptr ? TXT("") : value), _control(value == nullptr ? string_null : string_defined)
-            {
-            }
-
-            string(const char_t value) : _value(1, value), _control(string_defined)
-            {
-            }
-
-            string(const undefined_t &) : _control(string_undefined)
-            {
-            }
+            const char_t *text;
+            size_t size;
+            int label;
+        };
 
-            inline operator const char_t *()
-            {
-                return _value.c_str();
-            }
+        uint32_t seed;
+        uint32_t displacements[B];
+        slot_t slots[N];
 
-            inline operator bool()
+        // seeded FNV-1a over code units, Helpers.switchHash on the emitter side
+        static constexpr uint32_t hash(uint32_t seed, std::basic_string_view<char_t> text)
+        {
+            uint32_t value = 0x811c9dc5u ^ seed;
+            for (auto c : text)
             {
-                return _control == 0 && !_value.empty();
+                value ^= static_cast<uint32_t>(static_cast<std::make_unsigned_t<char_t>>(c));
+                value *= 0x01000193u;
             }
 
-            inline operator int()
-            {
-                return !(*this) ? 0 : std::stoi(_value);
-            }
+            return value ^ (value >> 16);
+        }
 
-            inline operator double()
-            {
-                return !(*this) ? 0 : std::stod(_value);
-            }
+        // murmur3 finalizer of the displaced hash, Helpers.switchPlace
+        static constexpr uint32_t place(uint32_t hash, uint32_t displacement)
+        {
+            uint32_t value = hash ^ displacement;
+            value = (value ^ (value >> 16)) * 0x85ebca6bu;
+            value = (value ^ (value >> 13)) * 0xc2b2ae35u;
+            return value ^ (value >> 16);
+        }
 
-            inline operator T &()
-            {
-                return _value;
-            }
+        int operator()(std::basic_string_view<char_t> text) const
+        {
+            auto value = hash(seed, text);
+            auto &slot = slots[place(value, displacements[value & (B - 1)]) & (N - 1)];
+            return slot.size == text.size() && slot.text && text.compare(0, slot.size, slot.text, slot.size) == 0 ? slot.label : 0;
+        }
 
-            /*inline operator size_t()
-            {
-                return _value.size();
-            }*/
+        int operator()(const string &value) const
+        {
+            return value.is_undefined() || value.is_null() ? 0 : (*this)(std::basic_string_view<char_t>(value._value));
+        }
 
-            inline bool is_null() const
-            {
-                return _control == string_null;
-            }
+        int operator()(const any &value) const
+        {
+            return value.get_type() == any::string_type ? (*this)(value.get<string>()) : 0;
+        }
+    };
 
-            inline bool is_undefined() const
-            {
-                return _control == string_undefined;
-            }
+    // integer switch discriminant, unboxed once; fractions, NaN, huge values and anything
+    // that is not a number map to switch_no_case, which no case label can equal
+    constexpr int64_t switch_no_case = std::numeric_limits<int64_t>::min();
 
-            js::number get_length() const
-            {
-                return js::number(_value.size());
-            }
+    inline int64_t switch_int(double value)
+    {
+        return value == std::trunc(value) && std::abs(value) <= 9007199254740992.0 ? static_cast<int64_t>(value) : switch_no_case;
+    }
 
-            constexpr string *operator->()
-            {
-                return this;
-            }
+    template <typename V>
+    requires std::is_integral_v<V>
+    constexpr int64_t switch_int(V value)
+    {
+        return static_cast<int64_t>(value);
+    }
 
-            template <typename N = void>
-            requires ArithmeticOrEnumOrNumber<N>
-                string_t operator[](N n) const
-            {
-                return string(_value[n]);
-            }
+    inline int64_t switch_int(const number &value)
+    {
+        return switch_int(value._value);
+    }
 
-            template <typename B = void>
-            requires BoolOrBoolean<B>
-                string_t operator+(B b)
-            {
-                return string(_value + (b ? "true" : "false"));
-            }
+    inline int64_t switch_int(const any &value)
+    {
+        return value.get_type() == any::number_type ? switch_int(value.get<number>()._value) : switch_no_case;
+    }
 
-            template <typename N = void>
-            requires ArithmeticOrEnum<N>
-                string_t operator+(N value)
-            {
-                return string(_value + to_tstring(value));
-            }
+    // switch over numeric cases that are not all integers: cases sorted by value, binary
+    // searched; NaN matches nothing and -0 matches 0, as with ===
+    template <size_t N>
+    struct number_switch
+    {
+        struct case_t
+        {
+            double value;
+            int label;
+        };
 
-            template <typename N = void>
-            requires ArithmeticOrEnum<N>
-            friend string_t operator+(N value, const string_t &val)
-            {
-                return string(to_tstring(value) + val._value);
-            }
+        case_t cases[N];
 
-            string_t operator+(js::number value)
-            {
-                return string(_value + value.operator tstring());
-            }
+        int operator()(double value) const
+        {
+            auto found = std::lower_bound(std::begin(cases), std::end(cases), value, [](const case_t &left, double right) {
+                return left.value < right;
+            });
 
-            friend string_t operator+(js::number value, const string_t &val)
-            {
-                return string(value.operator tstring() + val._value);
-            }
+            return found != std::end(cases) && found->value == value ? found->label : 0;
+        }
 
-            string_t operator+(string value)
-            {
-                return string(_value + value._value);
-            }
+        int operator()(const number &value) const
+        {
+            return (*this)(value._value);
+        }
 
-            friend string_t operator+(const string &value, string other)
-            {
-                return mutable_(value) + other;
-            }
+        int operator()(const any &value) const
+        {
+            return value.get_type() == any::number_type ? (*this)(value.get<number>()._value) : 0;
+        }
+    };
 
-            string_t operator+(js::pointer_t ptr)
-            {
-                return string(_value + ((!ptr) ? TXT("null") : to_tstring(static_cast<size_t>(ptr))));
-            }
+    // Number
+    static js::number Infinity(std::numeric_limits<double>::infinity());
+    static js::number NaN(std::numeric_limits<double>::quiet_NaN());
 
-            string_t operator+(any value);
+    namespace tmpl
+    {
 
-            string_t &operator+=(char_t c)
-            {
-                _control = string_defined;
-                _value.append(string(c)._value);
-                return *this;
-            }
+        // Number
+        template <typename V>
+        number<V>::operator js::string()
+        {
+            return js::string(static_cast<tstring>(*this));
+        }
 
-            template <typename N = void>
-            requires ArithmeticOrEnumOrNumber<N>
-                string_t &operator+=(N n)
+        template <typename V>
+        js::string number<V>::toString()
+        {
+            tstring out;
+            append_to(out);
+            return js::string(std::move(out));
+        }
+
+        template <typename V>
+        js::string number<V>::toString(number_t radix)
+        {
+            if (radix.is_undefined() || radix._value == 10)
             {
-                auto value = t_tostring(n);
-                _control = string_defined;
-                _value.append(value);
-                return *this;
+                return toString();
             }
 
-            string_t &operator+=(string value)
+            if (!(radix._value >= 2 && radix._value <= 36))
             {
-                _control = string_defined;
-                _value.append(value._value);
-                return *this;
+                throw js::string(TXT("toString() radix must be between 2 and 36"));
             }
 
-            string_t &operator+=(any value);
+            tstring out;
+            numfmt::append_radix(out, static_cast<double>(_value), static_cast<int>(radix._value));
+            return js::string(std::move(out));
+        }
 
-            bool operator==(const string_t &other) const
+        template <typename V>
+        js::string number<V>::toFixed(number_t digits)
+        {
+            auto count = digits.is_undefined() ? 0.0 : std::trunc(static_cast<double>(digits._value));
+            if (!(count >= 0 && count <= 100))
             {
-                return _control == string_defined && _value.compare(other._value) == 0;
+                throw js::string(TXT("toFixed() digits argument must be between 0 and 100"));
             }
 
-            bool operator==(const string_t &other)
-            {
-                return _control == string_defined && _value.compare(other._value) == 0;
-            }
+            tstring out;
+            numfmt::append_fixed(out, static_cast<double>(_value), static_cast<int>(count));
+            return js::string(std::move(out));
+        }
 
-            bool operator!=(const string_t &other) const
+        template <typename V>
+        js::string number<V>::toPrecision(number_t precision)
+        {
+            if (precision.is_undefined())
             {
-                return _control == string_defined && _value.compare(other._value) != 0;
+                return toString();
             }
 
-            bool operator!=(const string_t &other)
+            auto count = std::trunc(static_cast<double>(precision._value));
+            if (std::isfinite(_value) && !(count >= 1 && count <= 100))
             {
-                return _control == string_defined && _value.compare(other._value) != 0;
+                throw js::string(TXT("toPrecision() argument must be between 1 and 100"));
             }
 
-            bool operator==(undefined_t)
-            {
-                return is_undefined();
-            }
+            tstring out;
+            numfmt::append_precision(out, static_cast<double>(_value), static_cast<int>(count));
+            return js::string(std::move(out));
+        }
 
-            friend bool operator==(undefined_t, const string_t &other)
-            {
-                return other.is_undefined();
-            }
+        template <typename T>
+        string<T> string<T>::operator+(any value)
+        {
+            string tmp(_value);
+            tmp._value.append(value.operator std::string());
+            return tmp;
+        }
 
-            bool operator!=(undefined_t)
-            {
-                return !is_undefined();
-            }
+        template <typename T>
+        string<T> &string<T>::operator+=(any value)
+        {
+            auto value_string = value.operator std::string();
+            _control = string_defined;
+            invalidate_units();
+            _value.append(value_string);
+            return *this;
+        }
 
-            friend bool operator!=(undefined_t, const string_t &other)
-            {
-                return !other.is_undefined();
-            }
+        // Object
+        template <typename K, typename V>
+        object<K, V>::object() : isUndefined(false)
+        {
+        }
 
-            bool operator==(js::pointer_t ptr)
-            {
-                return is_null() && (!ptr);
-            }
+        template <typename K, typename V>
+        object<K, V>::object(const object &value) : _values(value._values), isUndefined(value.isUndefined)
+        {
+        }
 
-            friend bool operator==(js::pointer_t ptr, const string_t &other)
+        template <typename K, typename V>
+        object<K, V>::object(std::initializer_list<pair> values) : _values(values), isUndefined(false)
+        {
+            for (auto &item : values)
             {
-                return other.is_null() && (!ptr);
+                _values[item.first] = item.second;
             }
+        }
 
-            bool operator!=(js::pointer_t ptr)
-            {
-                return _control == string_defined && (!ptr);
-            }
+        template <typename K, typename V>
+        object<K, V>::object(const undefined_t &) : isUndefined(true)
+        {
+        }
 
-            friend bool operator!=(js::pointer_t ptr, const string_t &other)
-            {
-                return other._control == string_defined && (!ptr);
-            }
+        template <typename K, typename V>
+        void object<K, V>::Delete(js::any field)
+        {
+            _values.erase(field.operator std::string /*&*/());
+        }
 
-            string_t concat(string value)
-            {
-                return _value + value._value;
-            }
 
-            template <typename N = void>
-            requires ArithmeticOrEnumOrNumber<N>
-                string_t charAt(N n)
-            const
-            {
-                return _value[n];
-            }
+        template <typename K, typename V>
+        ObjectKeys<js::string, typename object<K, V>::Cnt> object<K, V>::keys(const object<K, V> &obj)
+        {
+            return ObjectKeys<js::string, object<K, V>::Cnt>(obj->_values);
+        }
 
-            template <typename N = void>
-            requires ArithmeticOrEnumOrNumber<N>
-                js::number charCodeAt(N n)
-            const
-            {
-                return static_cast<size_t>(_value[n]);
-            }
+        template <typename K, typename V>
+        ObjectKeys<js::string, typename object<K, V>::Cnt> object<K, V>::keys()
+        {
+            return ObjectKeys<js::string, object<K, V>::Cnt>(_values);
+        }
 
-            template <typename N = void>
-            requires can_cast_to_size_t<N>
-                string_t fromCharCode(N n)
-            const
-            {
-                return static_cast<char_t>(static_cast<size_t>(n));
-            }
+        template <typename K, typename V>
+        any &object<K, V>::operator[](js::number n) const
+        {
+            return mutable_(_values)[static_cast<std::string>(n)];
+        }
 
-            string_t toUpperCase()
-            {
-                std::string result(this->operator std::string &());
-                for (auto &c : result)
-                {
-                    c = toupper(c);
-                }
+        template <typename K, typename V>
+        any &object<K, V>::operator[](js::number n)
+        {
+            return _values[static_cast<std::string>(n)];
+        }
 
-                return string(result);
-            }
+        template <typename K, typename V>
+        any &object<K, V>::operator[](const char_t *s) const
+        {
+            return mutable_(_values)[std::string(s)];
+        }
 
-            string_t toLowerCase()
-            {
-                std::string result(this->operator std::string &());
-                for (auto &c : result)
-                {
-                    c = tolower(c);
-                }
+        template <typename K, typename V>
+        any &object<K, V>::operator[](std::string s) const
+        {
+            return mutable_(_values)[s];
+        }
+
+        template <typename K, typename V>
+        any &object<K, V>::operator[](js::string s) const
+        {
+            return mutable_(_values)[(std::string)s];
+        }
 
-                return string(result);
-            }
+        template <typename K, typename V>
+        any &object<K, V>::operator[](const char_t *s)
+        {
+            return _values[std::string(s)];
+        }
 
-            template <typename N = void>
-            requires ArithmeticOrEnumOrNumber<N>
-                string_t substring(N begin, N end)
-            {
-                return _value.substr(begin, end - begin);
-            }
+        template <typename K, typename V>
+        any &object<K, V>::operator[](std::string s)
+        {
+            return _values[s];
+        }
 
-            template <typename N = void>
-            requires ArithmeticOrEnumOrNumber<N>
-                string_t slice(N begin)
-            {
-                return _value.substr(begin < js::number(0) ? get_length() + begin : begin, get_length() - begin);
-            }
+        template <typename K, typename V>
+        any &object<K, V>::operator[](js::string s)
+        {
+            return _values[(std::string)s];
+        }
 
-            template <typename N = void>
-            requires ArithmeticOrEnumOrNumber<N>
-                string_t slice(N begin, N end)
-            {
-                auto endStart = end < js::number(0) ? get_length() + end : end;
-                auto endPosition = begin < js::number(0) ? get_length() + begin : begin;
-                return _value.substr(begin < js::number(0) ? get_length() + begin : begin, (endStart >= endPosition) ? endStart - endPosition : js::number(0));
-            }
+        template <typename K, typename V>
+        any &object<K, V>::operator[](undefined_t)
+        {
+            return _values["undefined"];
+        }
 
-            auto begin()
-            {
-                return _value.begin();
-            }
+    } // namespace tmpl
 
-            auto end()
-            {
-                return _value.end();
-            }
+    // typeof
+    template <>
+    string type_of(boolean value)
+    {
+        return STR("boolean");
+    }
 
-            friend tostream &operator<<(tostream &os, string val)
-            {
-                if (val._control == 2)
-                {
-                    return os << "undefined";
-                }
+    template <>
+    string type_of(number value)
+    {
+        return STR("number");
+    }
 
-                return os << val._value;
-            }
+    template <>
+    string type_of(string value)
+    {
+        return STR("string");
+    }
 
-            size_t hash(void) const noexcept
-            {
-                return std::hash<T>{}(_value);
-            }
-        };
+    template <>
+    string type_of(object value)
+    {
+        return STR("object");
+    }
 
-    } // namespace tmpl
+    template <>
+    string type_of(any value)
+    {
+        return value.type_of();
+    }
 
-    template <typename T>
-    string toString(const T &val)
+    template <class T>
+    static any Void(T value)
     {
-        tostringstream os;
-        os << val;
-        return string(os.str());
+        return any();
     }
 
-    static string string_empty(TXT(""));
+    template <typename I>
+    inline bool is(js::any t)
+    {
+        return false;
+    }
 
-    static js::string operator""_S(const char_t *s, std::size_t size)
+    template <>
+    inline bool is<js::boolean>(js::any t)
     {
-        return js::string(s);
+        return t && t.get_type() == any::anyTypeId::boolean_type;
     }
 
-    static js::number operator""_N(long double value)
+    template <>
+    inline bool is<js::number>(js::any t)
     {
-        return js::number(value);
+        return t && t.get_type() == any::anyTypeId::number_type;
     }
 
-    static js::number operator""_N(unsigned long long value)
+    template <>
+    inline bool is<js::string>(js::any t)
     {
-        return js::number(value);
+        return t && t.get_type() == any::anyTypeId::string_type;
     }
 
-    static js::number operator+(const string &v)
+    template <>
+    inline bool is<js::array_any>(js::any t)
     {
-        return number(static_cast<double>(mutable_(v)));
+        return t && t.get_type() == any::anyTypeId::array_type;
     }
 
-    static js::number operator+(pointer_t ptr)
+    template <>
+    inline bool is<js::object>(js::any t)
     {
-        return number(reinterpret_cast<size_t>(ptr._ptr));
+        return t && t.get_type() == any::anyTypeId::object_type;
     }
 
-    template <typename T, class = std::enable_if_t<std::is_enum_v<T>>>
-    T operator&(T t1, T t2)
+    template <>
+    inline bool is<js::function>(js::any t)
     {
-        return static_cast<T>(static_cast<size_t>(t1) & static_cast<size_t>(t2));
+        return t && t.get_type() == any::anyTypeId::function_type;
     }
 
-    template <typename T, class = std::enable_if_t<std::is_enum_v<T>>>
-    T operator&=(T &t1, T t2)
+    namespace utils
     {
-        return t1 = static_cast<T>(static_cast<size_t>(t1) & static_cast<size_t>(t2));
+
+        // scope guard for try...finally, holds the lambda by value so entering the block
+        // costs neither an allocation nor an indirect call
+        template <typename F>
+        struct finally
+        {
+        private:
+            F _dtor;
+
+        public:
+            finally(F dtor) : _dtor(std::move(dtor)){};
+            finally(const finally &) = delete;
+            finally &operator=(const finally &) = delete;
+            ~finally() { _dtor(); }
+        };
+
+        template <typename F>
+        finally(F) -> finally<F>;
+
+        template <typename... Args>
+        object *assign(object *dst, const Args &...args)
+        {
+            for (auto src : {args...})
+            {
+                for (auto &k : keys_(src))
+                {
+                    (*dst)[k] = (*const_(src))[k];
+                }
+            }
+
+            return dst;
+        }
+
+    }; // namespace Utils
+
+    template <typename V, class Ax = void>
+    requires has_exists_member<Ax>
+    constexpr bool in(V v, const Ax &a)
+    {
+        return a.exists(v);
     }
 
-    template <typename T, class = std::enable_if_t<std::is_enum_v<T>>>
-    T operator|(T t1, T t2)
+    template <typename V, class Ax = void>
+    requires has_exists_member<Ax>
+    constexpr bool in(V v, Ax *a)
     {
-        return static_cast<T>(static_cast<size_t>(t1) & static_cast<size_t>(t2));
+        return a->exists(v);
+    }
+
+    template <typename V, class O>
+    constexpr bool in(V v, O o)
+    {
+        return false;
+    }
+
+} // namespace js
+
+#ifdef UNICODE
+#define MAIN                                                             \
+    int wmain(int argc, char_t **argv)                                   \
+    {                                                                    \
+        try                                                              \
+        {                                                                \
+            Main();                                                      \
+            js::event_loop().run();                                      \
+        }                                                                \
+        catch (const js::string &s)                                      \
+        {                                                                \
+            js::console_sink().flush();                                  \
+            std::wcout << TXT("Exception: ") << s << std::endl;          \
+        }                                                                \
+        catch (const js::any &a)                                         \
+        {                                                                \
+            js::console_sink().flush();                                  \
+            std::wcout << TXT("Exception: ") << a << std::endl;          \
+        }                                                                \
+        catch (const js::Error &error)                                   \
+        {                                                                \
+            js::console_sink().flush();                                  \
+            std::wcout << TXT("Exception: ")                             \
+                       << js::utf::to_text(error.name()) << TXT(": ")    \
+                       << js::utf::to_text(error.what()) << std::endl;   \
+        }                                                                \
+        catch (const std::exception &exception)                          \
+        {                                                                \
+            js::console_sink().flush();                                  \
+            std::wcout << TXT("Exception: ")                             \
+                       << js::utf::to_text(exception.what())             \
+                       << std::endl;                                     \
+        }                                                                \
+        catch (const tstring &s)                                         \
+        {                                                                \
+            js::console_sink().flush();                                  \
+            std::wcout << TXT("Exception: ") << s << std::endl;          \
+        }                                                                \
+        catch (const char_t *s)                                          \
+        {                                                                \
+            js::console_sink().flush();                                  \
+            std::wcout << TXT("Exception: ") << s << std::endl;          \
+        }                                                                \
+        catch (...)                                                      \
+        {                                                                \
+            js::console_sink().flush();                                  \
+            std::wcout << TXT("General failure.") << std::endl;          \
+        }                                                                \
+        js::executor().shutdown();                                       \
+        js::profile::dump();                                             \
+        js::console_sink().shutdown();                                   \
+        return 0;                                                        \
+    }
+#else
+#define MAIN                                                             \
+    int main(int argc, char_t **argv)                                    \
+    {                                                                    \
+        try                                                              \
+        {                                                                \
+            Main();                                                      \
+            js::event_loop().run();                                      \
+        }                                                                \
+        catch (const js::string &s)                                      \
+        {                                                                \
+            js::console_sink().flush();                                  \
+            std::cout << TXT("Exception: ") << s << std::endl;           \
+        }                                                                \
+        catch (const js::any &a)                                         \
+        {                                                                \
+            js::console_sink().flush();                                  \
+            std::cout << TXT("Exception: ") << a << std::endl;           \
+        }                                                                \
+        catch (const js::Error &error)                                   \
+        {                                                                \
+            js::console_sink().flush();                                  \
+            std::cout << "Exception: " << error.name() << ": "           \
+                      << error.what() << std::endl;                      \
+        }                                                                \
+        catch (const std::exception &exception)                          \
+        {                                                                \
+            js::console_sink().flush();                                  \
+            std::cout << "Exception: " << exception.what() << std::endl; \
+        }                                                                \
+        catch (const tstring &s)                                         \
+        {                                                                \
+            js::console_sink().flush();                                  \
+            std::cout << TXT("Exception: ") << s << std::endl;           \
+        }                                                                \
+        catch (const char_t *s)                                          \
+        {                                                                \
+            js::console_sink().flush();                                  \
+            std::cout << TXT("Exception: ") << s << std::endl;           \
+        }                                                                \
+        catch (...)                                                      \
+        {                                                                \
+            js::console_sink().flush();                                  \
+            std::cout << TXT("General failure.") << std::endl;           \
+        }                                                                \
+        js::executor().shutdown();                                       \
+        js::profile::dump();                                             \
+        js::console_sink().shutdown();                                   \
+        return 0;                                                        \
     }
+#endif
+
+// JS Core classes
+namespace js
+{
 
-    template <typename T, class = std::enable_if_t<std::is_enum_v<T>>>
-    T operator|=(T &t1, T t2)
+    // Executor ///////////////////////////////////////////////////////////////////////
+    // work-stealing pool shared by thread(), await and Promise jobs; every worker owns
+    // a deque (LIFO for the owner, FIFO for thieves), external submissions go to the
+    // injection queue. Worker count: set_workers() before first use or TSCXX_WORKERS.
+    struct executor_stats
     {
-        return t1 = static_cast<T>(static_cast<size_t>(t1) | static_cast<size_t>(t2));
-    }
+        size_t workers;
+        size_t queued;
+        size_t submitted;
+        size_t executed;
+        size_t steals;
+    };
 
-    template <typename T, class = std::enable_if_t<std::is_enum_v<T>>>
-    T operator~(T t1)
+    struct executor_t
     {
-        return static_cast<T>(~static_cast<size_t>(t1));
-    }
+        typedef std::function<void()> task_t;
 
-    // function ///////////////////////////////////////////////////////////////////////
-    // template <typename Rx, typename _Cls, typename... Args>
-    // struct _Deduction_MethodPtr<Rx (/*__thiscall*/ _Cls::*)(Args...) const>
-    // {
-    //     using _ReturnType = Rx;
-    //     const static size_t _CountArgs = sizeof...(Args);
-    // };
+        struct work_queue
+        {
+            std::mutex lock;
+            std::deque<task_t> tasks;
+        };
 
-    // template <typename Rx, typename _Cls, typename... Args>
-    // struct _Deduction_MethodPtr<Rx (/*__thiscall*/ _Cls::*)(Args...)>
-    // {
-    //     using _ReturnType = Rx;
-    //     const static size_t _CountArgs = sizeof...(Args);
-    // };
+        inline static thread_local int current_worker = -1;
 
-    // template <typename Rx, typename... Args>
-    // struct _Deduction_MethodPtr<Rx(/*__cdecl*/ *)(Args...)>
-    // {
-    //     using _ReturnType = Rx;
-    //     const static size_t _CountArgs = sizeof...(Args);
-    // };
+        std::vector<std::unique_ptr<work_queue>> _queues;
+        std::vector<std::thread> _workers;
+        work_queue _injection;
+        std::mutex _start_lock;
+        std::mutex _wake_lock;
+        std::condition_variable _wake;
+        std::atomic<size_t> _queued{0};
+        std::atomic<size_t> _submitted{0};
+        std::atomic<size_t> _executed{0};
+        std::atomic<size_t> _steals{0};
+        std::atomic<bool> _started{false};
+        std::atomic<bool> _stopping{false};
+        size_t _worker_count;
 
-    // template <typename F, typename _type = decltype(&F::operator())>
-    // struct _Deduction
-    // {
-    //     using type = _type;
-    // };
+        executor_t() : _worker_count(std::max(1u, std::thread::hardware_concurrency()))
+        {
+            if (auto env = std::getenv("TSCXX_WORKERS"))
+            {
+                auto count = std::strtoul(env, nullptr, 10);
+                if (count > 0)
+                {
+                    _worker_count = count;
+                }
+            }
+        }
 
-    template <typename F, typename Array, std::size_t... I>
-    auto invoke_seq_impl(const F &f, Array &a, std::index_sequence<I...>)
-    {
-        return std::invoke(f, a[I]...);
-    }
+        ~executor_t()
+        {
+            shutdown();
+        }
 
-    template <std::size_t N, typename F, typename Array, typename Indices = std::make_index_sequence<N>>
-    auto invoke_seq(const F &f, Array &a)
-    {
-        return invoke_seq_impl(f, a, Indices{});
-    }
+        // has effect only before the first task is submitted
+        void set_workers(size_t count)
+        {
+            std::lock_guard<std::mutex> guard(_start_lock);
+            if (!_started && count > 0)
+            {
+                _worker_count = count;
+            }
+        }
 
-    template <typename F, typename Array, std::size_t... I>
-    auto invoke_seq_impl(F &f, Array &a, std::index_sequence<I...>)
-    {
-        return std::invoke(f, a[I]...);
-    }
+        void submit(task_t task)
+        {
+            if (_stopping)
+            {
+                // pool is gone, late submissions run inline
+                execute(task);
+                return;
+            }
 
-    template <std::size_t N, typename F, typename Array, typename Indices = std::make_index_sequence<N>>
-    auto invoke_seq(F &f, Array &a)
-    {
-        return invoke_seq_impl(f, a, Indices{});
-    }
+            start();
 
-    template<typename F> 
-    struct function_traits {
-        typedef F functor_type;
-    }
+            auto &queue = current_worker >= 0 ? *_queues[current_worker] : _injection;
+            {
+                std::lock_guard<std::mutex> guard(queue.lock);
+                queue.tasks.push_back(std::move(task));
+            }
 
-    template<typename R, typename ...Args> 
-    struct function_traits_impl {
-        static constexpr const bool IS_SUPPORTED = true;
+            _submitted++;
+            _queued++;
 
-        static constexpr const size_t nargs = sizeof...(Args);
+            {
+                std::lock_guard<std::mutex> guard(_wake_lock);
+            }
 
-        typedef R result_type;
+            _wake.notify_one();
+        }
 
-        template <size_t i>
-        struct arg
+        // runs one pending task on the calling thread, used to help while waiting
+        bool run_one()
         {
-            typedef typename std::tuple_element<i, std::tuple<Args...>>::type type;
-        };
-    }
-
-    template<typename R, typename ...Args> 
-    struct functype_helper {
+            task_t task;
+            if (!take(current_worker, task))
+            {
+                return false;
+            }
 
-        typedef (R* builtin_functype)(Args...);
+            execute(task);
+            return true;
+        }
 
-        typedef std::function<R(Args...)> std_function;
-    };
+        template <typename R>
+        void wait(const std::shared_future<R> &result)
+        {
+            using namespace std::chrono_literals;
+            while (result.wait_for(0s) != std::future_status::ready)
+            {
+                if (!run_one())
+                {
+                    result.wait_for(1ms);
+                }
+            }
+        }
 
-    template<typename R, typename ...Args> 
-    struct function_traits<typename functype_helper<R,Args...>::builtin_functype> :
-        function_traits_impl<R, Args...>
-    {
-    };
+        // drains remaining tasks and joins workers, called from MAIN
+        void shutdown()
+        {
+            {
+                std::lock_guard<std::mutex> guard(_start_lock);
+                if (!_started || _stopping)
+                {
+                    return;
+                }
 
-    template<typename R, typename ...Args> 
-    struct function_traits<typename functype_helper<R,Args...>::std_function> :
-        function_traits_impl<R, Args...>
-    {
-    };
+                {
+                    std::lock_guard<std::mutex> wake_guard(_wake_lock);
+                    _stopping = true;
+                }
+            }
 
-    template<typename P> 
-    struct deref_shared_ptr {
-        typedef P shared_p;
-    };
+            _wake.notify_all();
+            for (auto &worker : _workers)
+            {
+                if (worker.joinable())
+                {
+                    worker.join();
+                }
+            }
+        }
 
-    template<typename T> 
-    struct deref_shared_ptr<std::shared_ptr<T>> {
-        typedef T item_t;
-    };
+        executor_stats stats() const
+        {
+            return {_worker_count, _queued.load(), _submitted.load(), _executed.load(), _steals.load()};
+        }
 
+    private:
+        void start()
+        {
+            if (_started)
+            {
+                return;
+            }
 
-    struct function
-    {
-        virtual any invoke(std::initializer_list<any> args_) = 0;
+            std::lock_guard<std::mutex> guard(_start_lock);
+            if (_started)
+            {
+                return;
+            }
 
-        inline bool operator==(const function& other) {
-            void *mem = this;
-            void *omem = &other;
-            return mem==omem;
-        }
+            for (size_t i = 0; i < _worker_count; i++)
+            {
+                _queues.push_back(std::make_unique<work_queue>());
+            }
 
-    };
+            for (size_t i = 0; i < _worker_count; i++)
+            {
+                _workers.emplace_back([this, i]()
+                                      { worker_loop(static_cast<int>(i)); });
+            }
 
-    template <typename F>
-    struct function_t : function
-    {
-        typedef F functor_type;
-        typedef function_traits<F> traits;
+            _started = true;
+        }
 
-        static_assert(is_supported<function_traits<F>>, "unsupported functor type, should be std::function or c++ function type");
+        static bool pop_back(work_queue &queue, task_t &task)
+        {
+            std::lock_guard<std::mutex> guard(queue.lock);
+            if (queue.tasks.empty())
+            {
+                return false;
+            }
 
-        F _f;
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+            return true;
+        }
 
-        function_t(const F &f) : _f{f}
+        static bool pop_front(work_queue &queue, task_t &task)
         {
-        }
+            std::lock_guard<std::mutex> guard(queue.lock);
+            if (queue.tasks.empty())
+            {
+                return false;
+            }
 
-        template <typename... Args>
-        auto operator()(Args... args);
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+            return true;
+        }
 
-        virtual any invoke(std::initializer_list<any> args_) override;
-    };
+        bool take(int index, task_t &task)
+        {
+            if (_queued == 0)
+            {
+                return false;
+            }
 
-    template <typename P, typename T=typename deref_shared_ptr<P>::item_t>
-    struct class_ref : function {
+            if (index >= 0 && pop_back(*_queues[index], task))
+            {
+                _queued--;
+                return true;
+            }
 
-        static_assert(std::is_base_of<object, T>::value, "return type should be derived from shared_ptr to object");
+            if (pop_front(_injection, task))
+            {
+                _queued--;
+                return true;
+            }
 
-        template<typename... Args>
-        inline static P create(Args... &args) {
-            P result = std::make_shared<T>(args...);
-            return result;
-        }
+            auto count = _queues.size();
+            for (size_t i = 1; i <= count; i++)
+            {
+                auto victim = (static_cast<size_t>(index + count) + i) % count;
+                if (static_cast<int>(victim) != index && pop_front(*_queues[victim], task))
+                {
+                    _queued--;
+                    _steals++;
+                    return true;
+                }
+            }
 
-        template <typename... Args>
-        auto operator()(Args... args) {
-            return create(args...);
+            return false;
         }
 
-        // still pure virtual :
-        virtual invoke(std::initializer_list<any> args_) = 0;
-    };
-
-    template <typename F, typename T = typename std::result_of<F>::type>
-    struct constructor_ref : function_t<F>, class_ref<T>
-    {
+        void execute(task_t &task)
+        {
+            try
+            {
+                task();
+            }
+            catch (...)
+            {
+                // results and errors are delivered through the task's own future or promise
+            }
 
-        using function_t::function_t;
-    };
+            _executed++;
+        }
 
-    template <typename T, typename... Args>
-    struct constructor_by_args : constructor_ref<std::function<T(Args...)>> {
+        void worker_loop(int index)
+        {
+            current_worker = index;
+            task_t task;
+            while (true)
+            {
+                if (take(index, task))
+                {
+                    execute(task);
+                    task = nullptr;
+                    continue;
+                }
 
+                std::unique_lock<std::mutex> guard(_wake_lock);
+                if (_stopping && _queued == 0)
+                {
+                    break;
+                }
 
-        using function_t::function_t;
+                _wake.wait(guard, [this]()
+                           { return _stopping || _queued > 0; });
+            }
 
+            current_worker = -1;
+        }
     };
 
-
-    template <typename T>
-    struct ArrayKeys
+    inline executor_t &executor()
     {
-        typedef ArrayKeys<T> iterator;
-
-        T _index;
-        T _end;
+        static executor_t instance;
+        return instance;
+    }
 
-        ArrayKeys(T end_) : _index(0), _end(end_)
-        {
-        }
+    template <typename F>
+    auto async(F f) -> std::shared_future<decltype(f())>
+    {
+        typedef decltype(f()) result_t;
+        auto task = std::make_shared<std::packaged_task<result_t()>>(std::move(f));
+        std::shared_future<result_t> result = task->get_future().share();
+        executor().submit([task]()
+                          { (*task)(); });
+        return result;
+    }
 
-        iterator &begin()
-        {
-            return *this;
-        }
+    template <typename R>
+    R await(const std::shared_future<R> &result)
+    {
+        executor().wait(result);
+        return result.get();
+    }
 
-        iterator &end()
-        {
-            return *this;
-        }
+    // Timers /////////////////////////////////////////////////////////////////////////
+    // hierarchical timer wheel with millisecond ticks: 4 levels of 256 slots cover
+    // 2^32 ms, timers further out park in the top level and cascade again. Nodes live
+    // in a slab linked by index, so insert and cancel are O(1); ids carry a generation
+    // so a stale id can't cancel a reused node. Loop thread only.
+    struct timer_wheel_t
+    {
+        typedef std::function<void()> callback_t;
+
+        static constexpr unsigned slot_bits = 8;
+        static constexpr unsigned slots = 1u << slot_bits;
+        static constexpr unsigned levels = 4;
+        static constexpr uint64_t span = uint64_t(1) << (slot_bits * levels);
+        static constexpr uint32_t none = 0xffffffff;
+
+        struct timer_node
+        {
+            callback_t callback;
+            uint64_t expires = 0;
+            uint64_t interval = 0;
+            uint32_t generation = 0;
+            uint32_t prev = none;
+            uint32_t next = none;
+            uint32_t slot = none;
+            bool active = false;
+        };
 
-        const T &operator*()
+        std::vector<timer_node> _nodes;
+        std::vector<uint32_t> _free;
+        uint32_t _heads[levels * slots];
+        uint64_t _now = 0;
+        size_t _count = 0;
+
+        timer_wheel_t()
         {
-            return _index;
+            std::fill(std::begin(_heads), std::end(_heads), none);
         }
 
-        bool operator!=(const iterator &rhs)
+        size_t pending() const
         {
-            return _index != rhs._end;
+            return _count;
         }
 
-        iterator &operator++()
+        uint64_t now() const
         {
-            _index++;
-            return *this;
+            return _now;
         }
-    };
-
-    namespace tmpl
-    {
 
-
-        template <typename E>
-        struct array : public std::enable_shared_from_this<array<E>>
+        // interval is 0 for one-shot timers; returns an id > 0
+        uint64_t add(callback_t callback, uint64_t at, uint64_t interval = 0)
         {
-
-            using Cnt = std::vector<E>;
-            using std::enable_shared_from_this<array<E>>::shared_from_this;
-
-
-            bool isUndefined;
-            Cnt _values;
-
-            array() : isUndefined(false)
+            uint32_t index;
+            if (!_free.empty())
             {
+                index = _free.back();
+                _free.pop_back();
             }
-
-            array(const array &value) : _values(value._values), isUndefined(value.isUndefined)
+            else
             {
+                index = static_cast<uint32_t>(_nodes.size());
+                _nodes.emplace_back();
             }
 
-            array(std::initializer_list<E> values) : _values(values), isUndefined(false)
-            {
-            }
+            auto &node = _nodes[index];
+            node.callback = std::move(callback);
+            node.expires = std::max(at, _now + 1);
+            node.interval = interval;
+            node.active = true;
+            link(index);
+            _count++;
+            return ((uint64_t(node.generation) << 32) | index) + 1;
+        }
 
-            array(Cnt values) : _values(values), isUndefined(false)
+        bool cancel(uint64_t id)
+        {
+            if (id == 0)
             {
+                return false;
             }
 
-            array(const undefined_t &undef) : isUndefined(true)
+            id--;
+            auto index = static_cast<uint32_t>(id & 0xffffffff);
+            if (index >= _nodes.size() || _nodes[index].generation != (id >> 32) || !_nodes[index].active)
             {
+                return false;
             }
 
-            constexpr operator bool()
+            if (_nodes[index].slot != none)
             {
-                return !isUndefined;
+                unlink(index);
             }
 
-            constexpr array *operator->()
-            {
-                return this;
-            }
+            release(index);
+            return true;
+        }
 
-            size_t get_length() const
+        // ms from now() until the wheel has to be advanced again
+        uint64_t next_timeout() const
+        {
+            auto boundary = slots - (_now & (slots - 1));
+            for (uint64_t distance = 1; distance < boundary; distance++)
             {
-                return _values.size();
+                if (_heads[(_now + distance) & (slots - 1)] != none)
+                {
+                    return distance;
+                }
             }
 
-            size_t size() const
-            {
-                return _values.size();
-            }
+            return boundary;
+        }
 
-            template <typename N = void>
-            requires can_cast_to_size_t<N>
-                E &operator[](N i) const
+        // fires everything due up to 'to', calling checkpoint after each callback
+        template <typename F>
+        size_t advance(uint64_t to, F checkpoint)
+        {
+            size_t fired = 0;
+            while (_now < to)
             {
-                if (static_cast<size_t>(i) >= _values.size())
+                if (_count == 0)
                 {
-                    if constexpr (std::is_same_v<decltype(E{undefined}), E>)
-                    {
-                        static E empty{undefined};
-                        return empty;
-                    }
-                    else
-                    {
-                        static E empty;
-                        return empty;
-                    }
+                    _now = to;
+                    break;
                 }
 
-                return mutable_(_values)[static_cast<size_t>(i)];
-            }
-
-            template <typename N = void>
-            requires can_cast_to_size_t<N>
-                E &operator[](N i)
-            {
-                while (static_cast<size_t>(i) >= _values.size())
+                _now++;
+                for (unsigned level = 1; level < levels; level++)
                 {
-                    if constexpr (std::is_same_v<decltype(E{undefined}), E>)
-                    {
-                        _values.push_back(E{undefined});
-                    }
-                    else
+                    if (((_now >> (slot_bits * (level - 1))) & (slots - 1)) != 0)
                     {
-                        _values.push_back(E{});
+                        break;
                     }
+
+                    cascade(level * slots + ((_now >> (slot_bits * level)) & (slots - 1)));
                 }
 
-                return _values[static_cast<size_t>(i)];
+                auto &head = _heads[_now & (slots - 1)];
+                while (head != none)
+                {
+                    auto index = head;
+                    unlink(index);
+                    fire(index);
+                    checkpoint();
+                    fired++;
+                }
             }
 
-            ArrayKeys<size_t> keys()
+            return fired;
+        }
+
+    private:
+        void fire(uint32_t index)
+        {
+            auto generation = _nodes[index].generation;
+            // the callback may add timers and reallocate the slab, so it is moved out
+            auto callback = std::move(_nodes[index].callback);
+            if (_nodes[index].interval == 0)
             {
-                return ArrayKeys<size_t>(_values.size());
+                release(index);
+                callback();
+                return;
             }
 
-            void push(E t)
+            callback();
+
+            // rearm unless the interval was cleared from inside its callback
+            auto &node = _nodes[index];
+            if (node.active && node.generation == generation)
             {
-                _values.push_back(t);
+                node.callback = std::move(callback);
+                node.expires = _now + node.interval;
+                link(index);
             }
+        }
 
-            template <typename... Args>
-            void push(Args... args)
+        void link(uint32_t index)
+        {
+            auto &node = _nodes[index];
+            auto expires = std::max(node.expires, _now);
+            auto delta = expires - _now;
+            if (delta >= span)
             {
-                for (const auto &item : {args...})
-                {
-                    _values.push_back(item);
-                }
+                expires = _now + span - 1;
+                delta = span - 1;
             }
 
-            E pop()
+            unsigned level = 0;
+            while (level < levels - 1 && delta >= (uint64_t(1) << (slot_bits * (level + 1))))
             {
-                return _values.pop_back();
+                level++;
             }
 
-            template <typename... Args>
-            void splice(size_t position, size_t size, Args... args)
+            auto slot = static_cast<uint32_t>(level * slots + ((expires >> (slot_bits * level)) & (slots - 1)));
+            node.slot = slot;
+            node.prev = none;
+            node.next = _heads[slot];
+            if (node.next != none)
             {
-                _values.erase(_values.cbegin() + position, _values.cbegin() + position + size);
-                _values.insert(_values.cbegin() + position, {args...});
+                _nodes[node.next].prev = index;
             }
 
-            array slice(size_t first, size_t last)
+            _heads[slot] = index;
+        }
+
+        void unlink(uint32_t index)
+        {
+            auto &node = _nodes[index];
+            if (node.prev != none)
             {
-                return array(Cnt(_values.cbegin() + first, _values.cbegin() + last + 1));
+                _nodes[node.prev].next = node.next;
             }
-
-            js::number indexOf(const E &e)
+            else
             {
-                return _values.cend() - std::find(_values.cbegin(), _values.cend(), e) - 1;
+                _heads[node.slot] = node.next;
             }
 
-            js::boolean removeElement(const E &e)
+            if (node.next != none)
             {
-                return _values.erase(std::find(_values.cbegin(), _values.cend(), e)) != _values.cend();
+                _nodes[node.next].prev = node.prev;
             }
 
-            auto begin()
+            node.prev = node.next = node.slot = none;
+        }
+
+        void cascade(uint32_t slot)
+        {
+            auto index = _heads[slot];
+            _heads[slot] = none;
+            while (index != none)
             {
-                return _values.begin();
+                auto next = _nodes[index].next;
+                link(index);
+                index = next;
             }
+        }
 
-            auto end()
+        void release(uint32_t index)
+        {
+            auto &node = _nodes[index];
+            node.callback = nullptr;
+            node.active = false;
+            node.generation = (node.generation + 1) & 0xfffff;
+            _free.push_back(index);
+            _count--;
+        }
+    };
+
+    // Event loop /////////////////////////////////////////////////////////////////////
+    // single-threaded loop run by MAIN after Main() returns; promise reactions are
+    // microtasks, work finished elsewhere (executor jobs) comes back as macrotasks.
+    // The loop keeps running while macrotasks are queued, timers are pending or
+    // operations are held.
+    struct event_loop_t
+    {
+        typedef std::function<void()> task_t;
+
+        std::deque<task_t> _microtasks;
+        std::deque<task_t> _macrotasks;
+        std::mutex _lock;
+        std::condition_variable _wake;
+        std::atomic<size_t> _held{0};
+        timer_wheel_t _timers;
+        std::chrono::steady_clock::time_point _origin = std::chrono::steady_clock::now();
+
+        // a timer set from another thread gets its id at once and reaches the wheel through
+        // a macrotask; _remote maps that id to the wheel id, 0 while still on the way.
+        // Wheel ids stay below 2^52, so both kinds are exact as JS numbers
+        static constexpr uint64_t remote_bit = uint64_t(1) << 52;
+        std::atomic<uint64_t> _next_remote{0};
+        std::unordered_map<uint64_t, uint64_t> _remote;
+
+        // the thread that runs static initialisation and so MAIN, a host running the loop
+        // elsewhere calls bind() from that thread first
+        static inline std::atomic<std::thread::id> loop_thread{std::this_thread::get_id()};
+
+        static bool on_loop_thread()
+        {
+            return loop_thread.load(std::memory_order_relaxed) == std::this_thread::get_id();
+        }
+
+        static void bind()
+        {
+            loop_thread = std::this_thread::get_id();
+        }
+
+        void queue_microtask(task_t task)
+        {
+            if (!on_loop_thread())
             {
-                return _values.end();
+                post(std::move(task));
+                return;
             }
 
-            friend std::ostream &operator<<(std::ostream &os, array val)
-            {
-                if (val.isUndefined)
-                {
-                    return os << "undefined";
-                }
+            _microtasks.push_back(std::move(task));
+        }
 
-                return os << "[array]";
+        // thread-safe
+        void post(task_t task)
+        {
+            {
+                std::lock_guard<std::mutex> guard(_lock);
+                _macrotasks.push_back(std::move(task));
             }
 
-            template <typename N = void>
-            requires can_cast_to_size_t<N>
-            bool exists(N n) const
+            _wake.notify_one();
+        }
+
+        // keeps the loop alive until the matching release()
+        void hold()
+        {
+            _held++;
+        }
+
+        void release()
+        {
             {
-                return static_cast<size_t>(n) < _values.size();
+                std::lock_guard<std::mutex> guard(_lock);
+                _held--;
             }
 
-            template <class T>
-            bool exists(T) const
+            _wake.notify_one();
+        }
+
+        void run_microtasks()
+        {
+            while (!_microtasks.empty())
             {
-                return false;
+                auto task = std::move(_microtasks.front());
+                _microtasks.pop_front();
+                task();
             }
+        }
 
-            array filter(std::function<bool(E)> p)
+        uint64_t now_ms() const
+        {
+            return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - _origin).count();
+        }
+
+        // thread-safe
+        uint64_t set_timer(task_t callback, uint64_t delay, bool repeat)
+        {
+            if (on_loop_thread())
             {
-                Cnt result;
-                std::copy_if(_values.begin(), _values.end(), std::back_inserter(result), p);
-                return result;
+                return add_timer(std::move(callback), delay, repeat);
             }
 
-            array filter(std::function<bool(E, size_t)> p)
+            auto id = remote_bit | ++_next_remote;
             {
-                Cnt result;
-                auto first = &(_values)[0];
-                std::copy_if(_values.begin(), _values.end(), std::back_inserter(result), [=](auto &v)
-                             {
-                                 auto index = &v - first;
-                                 return p(v, index);
-                             });
-                return result;
+                std::lock_guard<std::mutex> guard(_lock);
+                _remote.emplace(id, 0);
             }
 
-            template <typename F, class = decltype(F()())>
-            auto map(F p) -> array<undefined_t>
-            {
-                std::vector<undefined_t> result;
-                std::transform(_values.begin(), _values.end(), std::back_inserter(result), [=](auto &v)
-                               {
-                                   mutable_(p)(v);
-                                   return undefined;
-                               });
+            post([this, id, callback = std::move(callback), delay, repeat]() mutable
+                 {
+                     task_t fire = [this, id, callback = std::move(callback), repeat]() mutable
+                     {
+                         if (!repeat)
+                         {
+                             std::lock_guard<std::mutex> guard(_lock);
+                             _remote.erase(id);
+                         }
 
-                return array<undefined_t>(result);
-            }
+                         callback();
+                     };
 
-            /*
-            template <typename F, class = decltype(F()(E()))>
-            auto map(F p) -> array<decltype(p(E()))>
-            {
-                std::vector<decltype(p(E()))> result;
-                std::transform(_values.begin(), _values.end(), std::back_inserter(result), [=](auto &v)
-                               { return mutable_(p)(v); });
+                     std::lock_guard<std::mutex> guard(_lock);
+                     auto found = _remote.find(id);
+                     // cleared before it got here
+                     if (found != _remote.end())
+                     {
+                         found->second = add_timer(std::move(fire), delay, repeat);
+                     }
+                 });
+            return id;
+        }
 
-                return array<decltype(p(E()))>(result);
+        // thread-safe, from another thread the timer is cleared when the loop gets to it
+        bool clear_timer(uint64_t id)
+        {
+            if (!on_loop_thread())
+            {
+                post([this, id]()
+                     { clear_timer(id); });
+                return true;
             }
 
-            template <typename F, class = decltype(F()(E(), 0))>
-            auto map(F p) -> array<decltype(p(E(), 0))>
+            if (!(id & remote_bit))
             {
-                std::vector<decltype(p(E(), 0))> result;
-                auto first = &(_values)[0];
-                std::transform(_values.begin(), _values.end(), std::back_inserter(result), [=](auto &v)
-                               {
-                                   auto index = &v - first;
-                                   return mutable_(p)(v, index);
-                               });
-
-                return array<decltype(p(E(), 0))>(result);
+                return _timers.cancel(id);
             }
-*/
 
-            template <typename P>
-            auto reduce(P p)
+            std::lock_guard<std::mutex> guard(_lock);
+            auto found = _remote.find(id);
+            if (found == _remote.end())
             {
-                return std::reduce(_values.begin(), _values.end(), 0, p);
+                return false;
             }
 
-            template <typename P, typename I>
-            auto reduce(P p, I initial)
+            auto wheel = found->second;
+            _remote.erase(found);
+            return wheel == 0 || _timers.cancel(wheel);
+        }
+
+        uint64_t add_timer(task_t callback, uint64_t delay, bool repeat)
+        {
+            auto at = std::max(now_ms(), _timers.now()) + delay;
+            return _timers.add(std::move(callback), at, repeat ? std::max<uint64_t>(delay, 1) : 0);
+        }
+
+        size_t run_timers()
+        {
+            return _timers.advance(now_ms(), [this]()
+                                   { run_microtasks(); });
+        }
+
+        // runs due timers or one macrotask (waiting for either if wait is set) plus
+        // the microtask checkpoint
+        bool run_once(bool wait = true)
+        {
+            run_microtasks();
+            if (run_timers() > 0)
             {
-                return std::reduce(_values.begin(), _values.end(), initial, p);
+                return true;
             }
 
-            template <typename P>
-            boolean every(P p)
+            task_t task;
             {
-                return std::all_of(_values.begin(), _values.end(), p);
-            }
+                std::unique_lock<std::mutex> guard(_lock);
+                if (wait)
+                {
+                    auto ready = [this]()
+                    { return !_macrotasks.empty() || (_held == 0 && _timers.pending() == 0); };
+                    if (_timers.pending() > 0)
+                    {
+                        auto deadline = _origin + std::chrono::milliseconds(_timers.now() + _timers.next_timeout());
+                        _wake.wait_until(guard, deadline, ready);
+                    }
+                    else
+                    {
+                        _wake.wait(guard, ready);
+                    }
+                }
 
-            template <typename P>
-            boolean some(P p)
-            {
-                return std::any_of(_values.begin(), _values.end(), p);
+                if (!_macrotasks.empty())
+                {
+                    task = std::move(_macrotasks.front());
+                    _macrotasks.pop_front();
+                }
             }
 
-            js::string join(js::string s)
+            if (!task)
             {
-                return std::accumulate(_values.begin(), _values.end(), js::string{}, [&](auto &res, auto &piece)
-                                       { return res += (res) ? s + piece : piece; });
+                return run_timers() > 0;
             }
 
-            void forEach(std::function<void(E)> p)
-            {
-                std::for_each(_values.begin(), _values.end(), p);
-            }
+            task();
+            run_microtasks();
+            return true;
+        }
 
-            void forEach(std::function<void(E, size_t)> p)
+        bool alive()
+        {
+            std::lock_guard<std::mutex> guard(_lock);
+            return !_microtasks.empty() || !_macrotasks.empty() || _held > 0 || _timers.pending() > 0;
+        }
+
+        void run()
+        {
+            while (alive())
             {
-                auto first = &(*_values._values)[0];
-                std::for_each(_values.begin(), _values.end(), [=](auto &v)
-                              {
-                                  auto index = &v - first;
-                                  return p(v, index);
-                              });
+                run_once();
             }
-        };
+        }
+    };
 
-    } // namespace tmpl
+    inline event_loop_t &event_loop()
+    {
+        static event_loop_t instance;
+        return instance;
+    }
 
-    template <typename TKey, typename TMap>
-    struct ObjectKeys
+    template <class _Fn, class... _Args>
+    static void thread(_Fn f, _Args... args)
     {
-        typedef ObjectKeys<TKey, TMap> iterator;
-        typedef decltype(((TMap *)nullptr)->begin()) TIterator_map;
+        executor().submit([=]() mutable
+                          { f(args...); });
+    }
 
-        TIterator_map _index;
-        const TIterator_map _end;
+    // delays clamped as browsers do: NaN and negative run at once, past 2^31-1 ms is 1
+    inline uint64_t timer_delay(js::number delay)
+    {
+        auto ms = static_cast<double>(delay);
+        return !(ms > 0) ? 0 : ms > 2147483647.0 ? 1 : static_cast<uint64_t>(ms);
+    }
 
-        ObjectKeys(TMap &values_) : _index(values_.begin()), _end(values_.end())
+    // timers run on the event loop thread; from a worker the call is forwarded to the
+    // loop, the returned id can be cleared from any thread
+    template <typename F, typename... Args>
+    js::number setTimeout(F f, js::number delay = 0, Args... args)
+    {
+        auto ms = timer_delay(delay);
+        auto callback = [=]() mutable
+        { f(args...); };
+        return js::number(static_cast<double>(event_loop().set_timer(callback, ms, false)));
+    }
+
+    template <typename F, typename... Args>
+    js::number setInterval(F f, js::number delay = 0, Args... args)
+    {
+        auto ms = timer_delay(delay);
+        auto callback = [=]() mutable
+        { f(args...); };
+        return js::number(static_cast<double>(event_loop().set_timer(callback, ms, true)));
+    }
+
+    static void clearTimeout(js::number id)
+    {
+        event_loop().clear_timer(static_cast<uint64_t>(static_cast<double>(id)));
+    }
+
+    static void clearInterval(js::number id)
+    {
+        clearTimeout(id);
+    }
+
+    // sleep(ms) as a statement blocks the calling thread when the temporary is destroyed;
+    // co_await sleep(ms) suspends on a loop timer instead and never blocks
+    struct sleep_t
+    {
+        size_t _ms;
+        bool _awaited = false;
+
+        explicit sleep_t(size_t ms) : _ms(ms)
         {
         }
 
-        iterator &begin()
+        // move-only, the moved-from object must not block a second time
+        sleep_t(sleep_t &&other) noexcept : _ms(other._ms), _awaited(other._awaited)
         {
-            return *this;
+            other._awaited = true;
         }
 
-        iterator &end()
+        sleep_t(const sleep_t &) = delete;
+        sleep_t &operator=(const sleep_t &) = delete;
+        sleep_t &operator=(sleep_t &&) = delete;
+
+        ~sleep_t()
         {
-            return *this;
+            if (!_awaited)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(_ms));
+            }
         }
 
-        const TKey &operator*()
+        bool await_ready()
         {
-            return _index->first;
+            _awaited = true;
+            return false;
         }
 
-        bool operator!=(const iterator &rhs)
+        void await_suspend(std::coroutine_handle<> handle)
         {
-            return _index != rhs._end;
+            event_loop().set_timer([handle]()
+                                   { handle.resume(); },
+                                   _ms, false);
         }
 
-        iterator &operator++()
+        void await_resume()
         {
-            ++_index;
-            return *this;
         }
     };
 
-    namespace tmpl
+    static sleep_t sleep(js::number n)
     {
+        return sleep_t(static_cast<size_t>(n));
+    }
 
+    // await sleep() outside an async function goes through js::async; the caller blocks
+    // once here, the value left in the shared state is disarmed because its destructor may
+    // run on a worker
+    inline void await(const std::shared_future<sleep_t> &result)
+    {
+        executor().wait(result);
+        auto &pending = const_cast<sleep_t &>(result.get());
+        pending._awaited = true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(pending._ms));
+    }
 
-        template <typename K, typename V>
-        struct object : public std::enable_shared_from_this<object<K, V>>
-        {
-            friend struct ObjectKeys<K, V>;
-            friend struct any;
+    static number parseInt(const js::string &value, number radix = undefined)
+    {
+        auto base = radix.is_undefined() || std::isnan(radix._value) ? 0.0 : std::trunc(static_cast<double>(radix._value));
+        return number(numparse::parse_int(value._value, std::abs(base) <= 36 ? static_cast<int>(base) : -1));
+    }
 
-            struct K_hash
-            {
-                typedef K argument_type;
-                typedef std::size_t result_type;
-                result_type operator()(argument_type const &value) const
-                {
-                    return value.hash();
-                }
-            };
+    static number parseFloat(const js::string &value)
+    {
+        return number(numparse::parse_float(value._value));
+    }
 
-            struct K_equal_to
-            {
-                typedef K argument_type;
-                bool operator()(argument_type const &value, argument_type const &other) const
-                {
-                    return value == other;
-                }
-            };
+    static number Number(const js::string &value)
+    {
+        return number(numparse::to_number(value._value));
+    }
 
-            using Cnt = std::unordered_map<K, V, K_hash, K_equal_to>;
-            using std::enable_shared_from_this<object<K, V>>::shared_from_this;
+    static number Number(number value)
+    {
+        return value;
+    }
 
-            using pair = std::pair<const K, V>;
+    static object Object;
 
-            bool isUndefined;
-            Cnt _values;
+    static string String;
 
-            object();
+    template <typename T>
+    using ReadonlyArray = tmpl::array<T>;
 
-            object(const object &value);
+    template <typename T>
+    using Array = tmpl::array<T>;
 
-            object(std::initializer_list<pair> values);
+    struct Date
+    {
+        number getHours()
+        {
+            return number(0);
+        }
 
-            object(const undefined_t &);
+        number getMinutes()
+        {
+            return number(0);
+        }
 
-            /*!*/virtual/*!*/ ~object()
-            {
-            }
+        number getSeconds()
+        {
+            return number(0);
+        }
+    };
 
-            typedef constructor_by_args<$S<object>> constructor_type;
-            constexpr static constructor_type constructor_type_obj = constructor_type();
-            virtual function& constructor() {
-                return constructor_type_obj;
-            }
+    typedef any Action;
 
-            constexpr operator bool()
-            {
-                return !isUndefined;
-            }
+    typedef any Function;
 
-            static ObjectKeys<js::string, Cnt> keys(const object &);
+    // Regular expressions //////////////////////////////////////////////////////////////
+    // ECMAScript patterns are parsed once into a small instruction set and run on a
+    // backtracking VM. Unbounded loops over a variable width body, as in /(a+)+b/ or
+    // /(a|aa)*b/, can take exponential time there, so unless the pattern needs
+    // backreferences or lookaround those run on a Pike VM in linear time instead; plain
+    // literals use string_view::find.
+    namespace regexp
+    {
+        typedef std::basic_string_view<char_t> view_t;
 
-            ObjectKeys<js::string, Cnt> keys();
+        constexpr size_t npos = static_cast<size_t>(-1);
+        constexpr uint32_t unbounded = std::numeric_limits<uint32_t>::max();
+        constexpr uint32_t branch = std::numeric_limits<uint32_t>::max();
 
-            constexpr object *operator->()
-            {
-                return this;
-            }
+        // more instructions than this is a pattern like /(a{1000}){1000}/
+        constexpr size_t max_program = 1 << 20;
 
-            any &operator[](js::number n) const;
+        enum flag_t : uint8_t
+        {
+            flag_global = 1,
+            flag_ignore_case = 2,
+            flag_multiline = 4,
+            flag_dot_all = 8,
+            flag_unicode = 16,
+            flag_sticky = 32,
+            flag_has_indices = 64
+        };
 
-            any &operator[](const char_t *s) const;
+        enum class op_t : uint8_t
+        {
+            character,         // x: code unit, case folded under the i flag
+            any,               // '.'
+            set,               // x: index into program_t::sets
+            split,             // try x first, then y
+            jump,              // x
+            save,              // register x := position
+            reset,             // registers [x, y) := npos
+            progress,          // fail if register x still equals the position
+            line_start,
+            line_end,
+            word_boundary,
+            not_word_boundary,
+            backref,           // x: group
+            look,              // x: index into program_t::looks
+            end_at,            // fail unless the position equals register x
+            match
+        };
 
-            any &operator[](std::string s) const;
+        struct inst_t
+        {
+            op_t op;
+            uint32_t x;
+            uint32_t y;
+        };
 
-            any &operator[](js::string s) const;
+        constexpr uint32_t code_unit(char_t c)
+        {
+            return static_cast<std::make_unsigned_t<char_t>>(c);
+        }
 
-            any &operator[](js::number n);
+        // largest code point that is one code unit: ASCII in UTF-8, the BMP in UTF-16
+        constexpr uint32_t single_unit_max = sizeof(char_t) == 1 ? 0x7f : sizeof(char_t) == 2 ? 0xffff : 0x10ffff;
 
-            any &operator[](const char_t *s);
+        // code units of a code point in the encoding of the build, returns their count
+        inline size_t encode(uint32_t code, uint32_t (&units)[4])
+        {
+            if (code <= single_unit_max)
+            {
+                units[0] = code;
+                return 1;
+            }
 
-            any &operator[](std::string s);
+            if (sizeof(char_t) == 2)
+            {
+                code -= 0x10000;
+                units[0] = 0xd800 + (code >> 10);
+                units[1] = 0xdc00 + (code & 0x3ff);
+                return 2;
+            }
 
-            any &operator[](js::string s);
+            size_t length = code < 0x800 ? 2 : code < 0x10000 ? 3 : 4;
+            units[0] = ((0xff00u >> length) & 0xff) | (code >> (6 * (length - 1)));
+            for (size_t i = 1; i < length; i++)
+            {
+                units[i] = 0x80 | ((code >> (6 * (length - 1 - i))) & 0x3f);
+            }
 
-            any &operator[](undefined_t undef);
+            return length;
+        }
 
-            inline bool operator==(const object &other) const
+        typedef std::vector<std::pair<uint32_t, uint32_t>> unit_ranges_t;
+
+        // code points in [from, to], all above single_unit_max, as sequences of code unit
+        // ranges: the range is split until every sequence shares its encoded length and
+        // each trailing unit covers either one value or its whole span (RE2's UTF-8 ranges)
+        inline void encode_range(uint32_t from, uint32_t to, std::vector<unit_ranges_t> &sequences)
+        {
+            constexpr uint32_t bits = sizeof(char_t) == 2 ? 10 : 6;
+            for (uint32_t limit : {0x7ffu, 0xffffu})
             {
-                // TODO - finish it
-                return isUndefined == other.isUndefined && isUndefined == true;
+                if (sizeof(char_t) == 1 && from <= limit && to > limit)
+                {
+                    encode_range(from, limit, sequences);
+                    encode_range(limit + 1, to, sequences);
+                    return;
+                }
             }
 
-            size_t size() const
+            uint32_t first[4];
+            uint32_t last[4];
+            auto length = encode(from, first);
+            encode(to, last);
+            for (size_t i = 1; i < length; i++)
             {
-                return _values.size();
+                auto mask = (1u << (bits * i)) - 1;
+                if ((from & ~mask) == (to & ~mask))
+                {
+                    continue;
+                }
+
+                if ((from & mask) != 0)
+                {
+                    encode_range(from, from | mask, sequences);
+                    encode_range((from | mask) + 1, to, sequences);
+                    return;
+                }
+
+                if ((to & mask) != mask)
+                {
+                    encode_range(from, (to & ~mask) - 1, sequences);
+                    encode_range(to & ~mask, to, sequences);
+                    return;
+                }
             }
 
-            void Delete(js::number field)
+            unit_ranges_t sequence;
+            for (size_t i = 0; i < length; i++)
             {
-                _values.erase(field.operator std::string /*&*/());
+                sequence.emplace_back(first[i], last[i]);
             }
 
-            void Delete(js::string field)
+            sequences.push_back(std::move(sequence));
+        }
+
+        // UTF-8 text is matched byte by byte, so only ASCII is case folded there
+        constexpr uint32_t to_lower(uint32_t c)
+        {
+            if constexpr (sizeof(char_t) == 1)
             {
-                _values.erase(field.operator std::string &());
+                return c >= 'A' && c <= 'Z' ? c + 0x20 : c;
             }
 
-            void Delete(js::any field);
+            return utf::to_lower(c);
+        }
 
-            void Delete(js::undefined_t)
+        constexpr uint32_t to_upper(uint32_t c)
+        {
+            if constexpr (sizeof(char_t) == 1)
             {
-                _values.erase("undefined");
+                return c >= 'a' && c <= 'z' ? c - 0x20 : c;
             }
 
-            void Delete(const char_t *field)
+            return utf::to_upper(c);
+        }
+
+        constexpr bool is_line_terminator(uint32_t c)
+        {
+            return c == '\n' || c == '\r' || c == 0x2028 || c == 0x2029;
+        }
+
+        constexpr bool is_word(uint32_t c)
+        {
+            return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+        }
+
+        // code units of a class; units below 256 live in the bitmap, the rest in ranges
+        struct set_t
+        {
+            std::bitset<256> low;
+            std::vector<std::pair<uint32_t, uint32_t>> ranges;
+            bool negate = false;
+
+            void add(uint32_t from, uint32_t to)
             {
-                _values.erase(field);
-            }
-        
-            void Delete(const std::string & field) {
-                _values.erase(field);
+                for (; from <= to && from < 256; from++)
+                {
+                    low.set(from);
+                }
+
+                if (from <= to)
+                {
+                    ranges.emplace_back(from, to);
+                }
             }
 
-            template <typename N = void>
-            requires ArithmeticOrEnum<N>
-            bool exists(N n) const
+            void add(const set_t &other)
             {
-                return _values.find(js::string(to_tstring(n))) != _values.end();
+                if (!other.negate)
+                {
+                    low |= other.low;
+                    ranges.insert(ranges.end(), other.ranges.begin(), other.ranges.end());
+                    return;
+                }
+
+                for (uint32_t c = 0; c < 256; c++)
+                {
+                    if (!other.low[c])
+                    {
+                        low.set(c);
+                    }
+                }
+
+                // complement of the sorted, disjoint ranges above 255
+                uint32_t next = 256;
+                for (auto &range : other.ranges)
+                {
+                    if (range.first > next)
+                    {
+                        ranges.emplace_back(next, range.first - 1);
+                    }
+
+                    next = range.second + 1;
+                }
+
+                ranges.emplace_back(next, std::numeric_limits<char_t>::max());
             }
 
-            template <class T>
-            bool exists(T i) const
+            bool raw(uint32_t c) const
             {
-                if constexpr (is_stringish_v<T>)
+                if (c < 256)
+                {
+                    return low[c];
+                }
+
+                for (auto &range : ranges)
                 {
-                    return _values.find(i) != _values.end();
+                    if (c >= range.first && c <= range.second)
+                    {
+                        return true;
+                    }
                 }
 
                 return false;
             }
 
-            virtual js::string toString()
+            bool contains(uint32_t c, bool ignore_case) const
             {
-                tostringstream streamObj2;
-                streamObj2 << *this;
-                return streamObj2.str();
+                auto found = raw(c) || (ignore_case && (raw(to_lower(c)) || raw(to_upper(c))));
+                return found != negate;
             }
+        };
 
-            friend tostream &operator<<(tostream &os, object val)
+        // \d \w \s and their complements
+        inline set_t class_set(char_t name)
+        {
+            set_t set;
+            switch (name)
             {
-                if (val.isUndefined)
+            case 'd':
+            case 'D':
+                set.add('0', '9');
+                break;
+            case 'w':
+            case 'W':
+                set.add('a', 'z');
+                set.add('A', 'Z');
+                set.add('0', '9');
+                set.add('_', '_');
+                break;
+            case 's':
+            case 'S':
+                set.add('\t', '\r');
+                set.add(' ', ' ');
+                if constexpr (sizeof(char_t) > 1)
                 {
-                    return os << TXT("undefined");
+                    set.add(0xa0, 0xa0);
+                    set.add(0x1680, 0x1680);
+                    set.add(0x2000, 0x200a);
+                    set.add(0x2028, 0x2029);
+                    set.add(0x202f, 0x202f);
+                    set.add(0x205f, 0x205f);
+                    set.add(0x3000, 0x3000);
+                    set.add(0xfeff, 0xfeff);
                 }
 
-                return os << TXT("[object]");
+                break;
             }
-        };
-
-    } // namespace tmpl
-
-    typedef tmpl::object<string, any> object;
-
 
+            set.negate = name >= 'A' && name <= 'Z';
+            return set;
+        }
 
-    struct any
-    {
-        struct any_hash
+        struct look_t
         {
-            typedef js::any argument_type;
-            typedef std::size_t result_type;
-            result_type operator()(argument_type const &value) const
-            {
-                return value.hash();
-            }
+            uint32_t start;
+            uint32_t reg;
+            uint32_t min_width;
+            uint32_t max_width;
+            bool negate;
+            bool behind;
         };
 
-        struct any_equal_to
+        struct program_t
         {
-            typedef js::any argument_type;
-            bool operator()(argument_type const &value, argument_type const &other) const
-            {
-                return value == other;
-            }
-        };
+            tstring source;
+            tstring flags_text;
+            uint8_t flags = 0;
+            uint32_t groups = 1;
+            uint32_t registers = 2;
+            std::vector<inst_t> code;
+            std::vector<set_t> sets;
+            std::vector<look_t> looks;
+            std::vector<std::pair<tstring, uint32_t>> names;
 
-        enum anyTypeId
-        {
-            undefined_type = 0,
-            boolean_type,
-            pointer_type,
-            number_type,
-            string_type,
-            array_type,
-            object_type,
-            function_type,
-        };
+            // backreferences or lookaround need the backtracking VM
+            bool backtrack = false;
 
-        using any_value_type = std::variant<
-            js::undefined_t,
-            js::boolean,
-            js::pointer_t,
-            js::number,
-            js::string,
-            std::shared_ptr<js::array_any>,
-            std::shared_ptr<js::object>,
-            std::shared_ptr<js::function>
-            >;
+            // an unbounded loop whose body can match in more than one way
+            bool ambiguous_loops = false;
 
-        any_value_type _value;
+            // the whole pattern is a case sensitive literal
+            bool is_literal = false;
+            tstring literal;
 
-        any() : _value(undefined)
-        {
-        }
+            // code units a match can start with, when the pattern cannot match empty
+            bool has_first = false;
+            bool first_high = false;
+            std::bitset<256> first;
 
-        any(const any &other) : _value(other._value)
-        {
-        }
+            bool ignore_case() const
+            {
+                return flags & flag_ignore_case;
+            }
+        };
 
-        any(void_t) : _value(undefined)
+        [[noreturn]] inline void syntax_error(const program_t &program, const char_t *message)
         {
+            throw js::string(tstring(TXT("Invalid regular expression: /")) + program.source + TXT("/: ") + message);
         }
 
-        any(undefined_t) : _value(undefined)
+        struct node_t
         {
-        }
+            enum kind_t : uint8_t
+            {
+                empty,
+                character,
+                any,
+                set,
+                group,
+                alternation,
+                concat,
+                repeat,
+                assertion,
+                backref,
+                look
+            } kind = empty;
 
-        any(pointer_t v) : _value(v)
-        {
-        }
+            uint32_t value = 0;
+            uint32_t min = 0;
+            uint32_t max = 0;
+            bool greedy = true;
+            bool negate = false;
+            bool behind = false;
 
-        any(bool value) : _value(js::boolean(value))
-        {
-        }
+            // capture groups inside the node: [first_group, last_group)
+            uint32_t first_group = 0;
+            uint32_t last_group = 0;
+            std::vector<node_t> children;
+        };
 
-        template <typename N = void>
-        requires ArithmeticOrEnum<N>
-        any(N value) : _value(js::number(value))
+        inline uint32_t min_width(const node_t &node)
         {
-        }
+            switch (node.kind)
+            {
+            case node_t::character:
+            case node_t::any:
+            case node_t::set:
+                return 1;
+            case node_t::group:
+                return min_width(node.children[0]);
+            case node_t::alternation:
+            {
+                auto width = unbounded;
+                for (auto &child : node.children)
+                {
+                    width = std::min(width, min_width(child));
+                }
 
-        any(char_t value) : _value(js::string(value))
-        {
-        }
+                return width;
+            }
+            case node_t::concat:
+            {
+                uint64_t width = 0;
+                for (auto &child : node.children)
+                {
+                    width += min_width(child);
+                }
 
-        any(js::boolean value) : _value(value)
-        {
+                return static_cast<uint32_t>(std::min<uint64_t>(width, unbounded - 1));
+            }
+            case node_t::repeat:
+                return static_cast<uint32_t>(std::min<uint64_t>(static_cast<uint64_t>(node.min) * min_width(node.children[0]), unbounded - 1));
+            default:
+                return 0;
+            }
         }
 
-        any(js::number value) : _value(value)
+        inline uint32_t max_width(const node_t &node)
         {
-        }
+            switch (node.kind)
+            {
+            case node_t::character:
+            case node_t::any:
+            case node_t::set:
+                return 1;
+            case node_t::group:
+                return max_width(node.children[0]);
+            case node_t::alternation:
+            case node_t::concat:
+            {
+                uint64_t width = 0;
+                for (auto &child : node.children)
+                {
+                    auto child_width = max_width(child);
+                    if (child_width == unbounded)
+                    {
+                        return unbounded;
+                    }
 
-        any(const tstring &value) : _value(js::string(value))
-        {
-        }
+                    width = node.kind == node_t::concat ? width + child_width : std::max<uint64_t>(width, child_width);
+                }
 
-        any(const js::string &value) : _value(value)
-        {
-        }
+                return width >= unbounded ? unbounded : static_cast<uint32_t>(width);
+            }
+            case node_t::repeat:
+            {
+                auto child_width = max_width(node.children[0]);
+                if (child_width == 0)
+                {
+                    return 0;
+                }
 
-        any(const js::array_any &value) : _value(&value)
-        {
-        }
+                if (node.max == unbounded || child_width == unbounded)
+                {
+                    return unbounded;
+                }
 
-        any(const js::object &value) : _value(&value)
-        {
+                auto width = static_cast<uint64_t>(node.max) * child_width;
+                return width >= unbounded ? unbounded : static_cast<uint32_t>(width);
+            }
+            case node_t::backref:
+                return unbounded;
+            default:
+                return 0;
+            }
         }
 
-        any(const std::shared_ptr<js::array_any> &value) : _value(value)
+        struct parser_t
         {
-        }
+            program_t &program;
+            view_t text;
+            size_t pos = 0;
+            uint32_t next_group = 1;
 
-        any(const std::shared_ptr<js::object> &value) : _value(value)
-        {
-        }
+            parser_t(program_t &program_) : program(program_), text(program_.source)
+            {
+            }
 
-        template <typename F, class = std::enable_if_t<std::is_member_function_pointer_v<typename _Deduction<F>::type>>>
-        any(const F &value) : _value(std::shared_ptr<js::function>(((js::function *)new js::function_t<F>(value))))
-        {
-        }
+            bool ignore_case() const
+            {
+                return program.ignore_case();
+            }
 
-        template <typename Rx, typename... Args>
-        any(Rx(/*__cdecl*/ *value)(Args...)) : _value(std::shared_ptr<js::function>((js::function *)new js::function_t<Rx(/*__cdecl*/ *)(Args...), Rx(/*__cdecl*/ *)(Args...)>(value)))
-        {
-        }
+            bool unicode() const
+            {
+                return program.flags & flag_unicode;
+            }
 
-        template <typename C>
-        any(std::shared_ptr<C> value) : _value(std::shared_ptr<js::object>(value))
-        {
-        }
+            bool at_end() const
+            {
+                return pos >= text.size();
+            }
 
-        constexpr any *operator->()
-        {
-            return this;
-        }
+            char_t peek(size_t offset = 0) const
+            {
+                return pos + offset < text.size() ? text[pos + offset] : 0;
+            }
 
-        inline anyTypeId get_type() const
-        {
-            return static_cast<anyTypeId>(_value.index());
-        }
+            bool eat(char_t c)
+            {
+                if (!at_end() && text[pos] == c)
+                {
+                    pos++;
+                    return true;
+                }
 
-        template <typename T>
-        inline const T &get() const
-        {
-            return std::get<T>(_value);
-        }
+                return false;
+            }
 
-        template <typename T>
-        inline std::shared_ptr<T> get_ptr() const
-        {
-            return std::dynamic_pointer_cast<T>(mutable_(std::get<std::shared_ptr<js::object>>(_value)));
-        }
+            // group count and names up front, \k<name> and \10 may refer forward
+            void scan_groups()
+            {
+                auto in_class = false;
+                for (size_t i = 0; i < text.size(); i++)
+                {
+                    auto c = text[i];
+                    if (c == '\\')
+                    {
+                        i++;
+                    }
+                    else if (c == '[')
+                    {
+                        in_class = true;
+                    }
+                    else if (c == ']')
+                    {
+                        in_class = false;
+                    }
+                    else if (c == '(' && !in_class)
+                    {
+                        if (i + 1 < text.size() && text[i + 1] == '?')
+                        {
+                            if (i + 3 < text.size() && text[i + 2] == '<' && text[i + 3] != '=' && text[i + 3] != '!')
+                            {
+                                auto end = text.find('>', i + 3);
+                                if (end == view_t::npos)
+                                {
+                                    syntax_error(program, TXT("Invalid capture group name"));
+                                }
+
+                                program.names.emplace_back(tstring(text.substr(i + 3, end - i - 3)), program.groups++);
+                            }
+                        }
+                        else
+                        {
+                            program.groups++;
+                        }
+                    }
+                }
+            }
 
-        template <typename T>
-        inline T &get()
-        {
-            return std::get<T>(_value);
-        }
+            node_t parse()
+            {
+                scan_groups();
+                auto node = parse_disjunction();
+                if (!at_end())
+                {
+                    syntax_error(program, text[pos] == ')' ? TXT("Unmatched ')'") : TXT("Unexpected character"));
+                }
 
-        template <typename T>
-        inline std::shared_ptr<T> get_ptr()
-        {
-            return std::dynamic_pointer_cast<T>(std::get<std::shared_ptr<js::object>>(_value));
-        }
+                return node;
+            }
 
-        inline const js::boolean &boolean_ref() const
-        {
-            return get<js::boolean>();
-        }
+            node_t parse_disjunction()
+            {
+                auto first_group = next_group;
+                auto node = parse_alternative();
+                if (peek() != '|')
+                {
+                    return node;
+                }
 
-        inline js::boolean &boolean_ref()
-        {
-            return get<js::boolean>();
-        }
+                node_t alternation;
+                alternation.kind = node_t::alternation;
+                alternation.children.push_back(std::move(node));
+                while (eat('|'))
+                {
+                    alternation.children.push_back(parse_alternative());
+                }
 
-        inline const js::number &number_ref() const
-        {
-            return get<js::number>();
-        }
+                alternation.first_group = first_group;
+                alternation.last_group = next_group;
+                return alternation;
+            }
 
-        inline js::number &number_ref()
-        {
-            return get<js::number>();
-        }
+            node_t parse_alternative()
+            {
+                auto first_group = next_group;
+                node_t concat;
+                concat.kind = node_t::concat;
+                while (!at_end() && peek() != '|' && peek() != ')')
+                {
+                    auto term = parse_term();
+                    // e.g. the code units of one code point, they join the sequence around them
+                    if (term.kind == node_t::concat)
+                    {
+                        std::move(term.children.begin(), term.children.end(), std::back_inserter(concat.children));
+                        continue;
+                    }
 
-        inline const js::string &string_ref() const
-        {
-            return get<js::string>();
-        }
+                    concat.children.push_back(std::move(term));
+                }
 
-        inline js::string &string_ref()
-        {
-            return get<js::string>();
-        }
+                concat.first_group = first_group;
+                concat.last_group = next_group;
+                if (concat.children.size() == 1)
+                {
+                    return std::move(concat.children[0]);
+                }
 
-        inline std::shared_ptr<function> function_ptr()
-        {
-            return get<std::shared_ptr<function>>();
-        }
+                return concat;
+            }
+
+            node_t parse_term()
+            {
+                auto first_group = next_group;
+                node_t atom;
+                auto c = text[pos];
+                if (c == '^' || c == '$')
+                {
+                    pos++;
+                    atom.kind = node_t::assertion;
+                    atom.value = static_cast<uint32_t>(c == '^' ? op_t::line_start : op_t::line_end);
+                    return atom;
+                }
 
-        inline std::shared_ptr<function> function_ptr() const
-        {
-            return get<std::shared_ptr<function>>();
-        }
+                if (c == '\\' && (peek(1) == 'b' || peek(1) == 'B'))
+                {
+                    atom.kind = node_t::assertion;
+                    atom.value = static_cast<uint32_t>(peek(1) == 'b' ? op_t::word_boundary : op_t::not_word_boundary);
+                    pos += 2;
+                    return atom;
+                }
 
-        inline const array_any &array_ref() const
-        {
-            return get<array_any>();
-        }
+                if (c == '*' || c == '+' || c == '?' || (c == '{' && is_quantifier()))
+                {
+                    syntax_error(program, TXT("Nothing to repeat"));
+                }
 
-        inline array_any &array_ref()
-        {
-            return get<array_any>();
-        }
+                atom = parse_atom();
+                atom.first_group = first_group;
+                atom.last_group = next_group;
 
-        inline const object &object_ref() const
-        {
-            return get<object>();
-        }
+                uint32_t min, max;
+                if (!parse_quantifier(min, max))
+                {
+                    return atom;
+                }
 
-        inline object &object_ref()
-        {
-            return get<object>();
-        }
+                if (atom.kind == node_t::look && atom.behind)
+                {
+                    syntax_error(program, TXT("Invalid quantifier"));
+                }
 
-        /*
-        inline const std::shared_ptr<js::object> &class_ref() const
-        {
-            return get<std::shared_ptr<js::object>>();
-        }
+                node_t repeat;
+                repeat.kind = node_t::repeat;
+                repeat.min = min;
+                repeat.max = max;
+                repeat.greedy = !eat('?');
+                repeat.first_group = first_group;
+                repeat.last_group = next_group;
+                repeat.children.push_back(std::move(atom));
+                return repeat;
+            }
 
-        inline std::shared_ptr<js::object> &class_ref()
-        {
-            return get<std::shared_ptr<js::object>>();
-        }*/
+            bool is_quantifier()
+            {
+                auto saved = pos;
+                uint32_t min, max;
+                auto result = parse_braces(min, max);
+                pos = saved;
+                return result;
+            }
 
-        any &operator=(const any &other)
-        {
-            _value = other._value;
-            return *this;
-        }
+            bool parse_number(uint32_t &value)
+            {
+                auto start = pos;
+                uint64_t number = 0;
+                while (!at_end() && text[pos] >= '0' && text[pos] <= '9')
+                {
+                    number = std::min<uint64_t>(number * 10 + (text[pos] - '0'), unbounded - 1);
+                    pos++;
+                }
 
-        template <typename N = void>
-        requires ArithmeticOrEnumOrNumber<N>
-            any &operator=(N other)
-        {
-            _value = js::number(other);
-            return *this;
-        }
+                // {n,} leaves max unbounded
+                if (pos == start)
+                {
+                    return false;
+                }
 
-        template <class T>
-        any &operator[](T t) const
-        {
-            if constexpr (std::is_same_v<T, js::number>)
+                value = static_cast<uint32_t>(number);
+                return true;
+            }
+
+            // {n} {n,} {n,m}
+            bool parse_braces(uint32_t &min, uint32_t &max)
             {
-                if (get_type() == anyTypeId::array_type)
+                if (!eat('{') || !parse_number(min))
                 {
-                    return mutable_(array_ref())[t];
+                    return false;
+                }
+
+                max = min;
+                if (eat(','))
+                {
+                    max = unbounded;
+                    parse_number(max);
                 }
+
+                return eat('}');
             }
 
-            if constexpr (is_stringish_v<T>)
+            bool parse_quantifier(uint32_t &min, uint32_t &max)
             {
-                if (get_type() == anyTypeId::object_type)
+                switch (peek())
                 {
-                    return (object_ref())[t];
+                case '*':
+                    pos++;
+                    min = 0;
+                    max = unbounded;
+                    return true;
+                case '+':
+                    pos++;
+                    min = 1;
+                    max = unbounded;
+                    return true;
+                case '?':
+                    pos++;
+                    min = 0;
+                    max = 1;
+                    return true;
+                case '{':
+                {
+                    auto saved = pos;
+                    if (parse_braces(min, max))
+                    {
+                        if (min > max)
+                        {
+                            syntax_error(program, TXT("numbers out of order in {} quantifier"));
+                        }
+
+                        return true;
+                    }
+
+                    pos = saved;
+                    return false;
                 }
+                }
+
+                return false;
             }
 
-            throw "wrong type";
-        }
+            node_t character(uint32_t c)
+            {
+                node_t node;
+                node.kind = node_t::character;
+                node.value = ignore_case() ? to_lower(c) : c;
+                return node;
+            }
 
-        template <class T>
-        any &operator[](T t)
-        {
-            if constexpr (std::is_same_v<T, js::number>)
+            // one code point: a character, or the sequence of its code units
+            node_t code_point(uint32_t c)
             {
-                if (get_type() == anyTypeId::array_type)
+                uint32_t units[4];
+                auto length = encode(c, units);
+                if (length == 1)
                 {
-                    return (array_ref())[t];
+                    return character(c);
+                }
+
+                node_t concat;
+                concat.kind = node_t::concat;
+                for (size_t i = 0; i < length; i++)
+                {
+                    concat.children.push_back(character(units[i]));
                 }
+
+                return concat;
             }
 
-            if constexpr (is_stringish_v<T>)
+            // the code point at pos in the pattern: a whole UTF-8 sequence in narrow builds,
+            // a surrogate pair under the u flag where wchar_t is UTF-16
+            uint32_t next_code_point()
             {
-                if (get_type() == anyTypeId::object_type)
+#ifdef UNICODE
+                auto c = code_unit(text[pos++]);
+                if (sizeof(char_t) == 2 && unicode() && c >= 0xd800 && c <= 0xdbff && code_unit(peek()) >= 0xdc00 && code_unit(peek()) <= 0xdfff)
                 {
-                    return (object_ref())[t];
+                    return 0x10000 + ((c - 0xd800) << 10) + (code_unit(text[pos++]) - 0xdc00);
                 }
-            }
 
-            throw "wrong type";
-        }
+                return c;
+#else
+                return utf::decode(text, pos);
+#endif
+            }
 
-        operator js::pointer_t()
-        {
-            if (get_type() == anyTypeId::string_type && string_ref().is_null())
+            node_t set(set_t &&set)
             {
-                return null;
+                node_t node;
+                node.kind = node_t::set;
+                node.value = static_cast<uint32_t>(program.sets.size());
+                program.sets.push_back(std::move(set));
+                return node;
             }
 
-            if (get_type() == anyTypeId::number_type)
+            node_t parse_atom()
             {
-                return pointer_t(number_ref());
+                auto c = text[pos++];
+                switch (c)
+                {
+                case '.':
+                {
+                    node_t node;
+                    node.kind = node_t::any;
+                    return node;
+                }
+                case '(':
+                    return parse_group();
+                case '[':
+                    return parse_class();
+                case '\\':
+                    return parse_atom_escape();
+                case ')':
+                    syntax_error(program, TXT("Unmatched ')'"));
+                }
+
+                pos--;
+                return code_point(next_code_point());
             }
 
+            node_t parse_group()
+            {
+                node_t node;
+                if (!eat('?'))
+                {
+                    node.kind = node_t::group;
+                    node.value = next_group++;
+                }
+                else if (eat(':'))
+                {
+                    node.kind = node_t::empty;
+                }
+                else if (eat('=') || eat('!'))
+                {
+                    node.kind = node_t::look;
+                    node.negate = text[pos - 1] == '!';
+                }
+                else if (eat('<'))
+                {
+                    if (eat('=') || eat('!'))
+                    {
+                        node.kind = node_t::look;
+                        node.negate = text[pos - 1] == '!';
+                        node.behind = true;
+                    }
+                    else
+                    {
+                        // the name was collected by scan_groups
+                        pos = text.find('>', pos) + 1;
+                        node.kind = node_t::group;
+                        node.value = next_group++;
+                    }
+                }
+                else
+                {
+                    syntax_error(program, TXT("Invalid group"));
+                }
+
+                auto body = parse_disjunction();
+                if (!eat(')'))
+                {
+                    syntax_error(program, TXT("Unterminated group"));
+                }
 
-            return pointer_t(0xffffffff);
-        }
+                if (node.kind == node_t::empty)
+                {
+                    return body;
+                }
 
-        operator js::boolean()
-        {
-            if (get_type() == anyTypeId::boolean_type)
-            {
-                return boolean_ref();
+                node.children.push_back(std::move(body));
+                return node;
             }
 
-            throw "wrong type";
-        }
-
-        operator js::number()
-        {
-            if (get_type() == anyTypeId::number_type)
+            uint32_t parse_hex(size_t digits)
             {
-                return number_ref();
+                uint32_t value = 0;
+                for (size_t i = 0; i < digits; i++)
+                {
+                    auto c = peek(i);
+                    auto digit = c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : c >= 'A' && c <= 'F' ? c - 'A' + 10 : -1;
+                    if (digit < 0)
+                    {
+                        return unbounded;
+                    }
+
+                    value = value * 16 + digit;
+                }
+
+                pos += digits;
+                return value;
             }
 
-            if (get_type() == anyTypeId::string_type)
+            // character escapes shared by atoms and classes, pos is past the backslash
+            uint32_t parse_character_escape(bool in_class)
             {
-                char_t *end;
-#ifdef UNICODE
-                return js::number(std::wcstof(string_ref().operator const char_t *(), &end));
-#else
-                return js::number(std::strtof(string_ref().operator const char_t *(), &end));
-#endif
-            }
+                auto c = text[pos++];
+                switch (c)
+                {
+                case 'n':
+                    return '\n';
+                case 't':
+                    return '\t';
+                case 'r':
+                    return '\r';
+                case 'v':
+                    return '\v';
+                case 'f':
+                    return '\f';
+                case 'b':
+                    return '\b';
+                case 'c':
+                {
+                    auto letter = peek();
+                    if ((letter >= 'a' && letter <= 'z') || (letter >= 'A' && letter <= 'Z'))
+                    {
+                        pos++;
+                        return letter % 32;
+                    }
 
-            throw "wrong type";
-        }
+                    pos--;
+                    return '\\';
+                }
+                case 'x':
+                {
+                    auto value = parse_hex(2);
+                    return value == unbounded ? 'x' : value;
+                }
+                case 'u':
+                {
+                    if (unicode() && eat('{'))
+                    {
+                        auto end = text.find('}', pos);
+                        if (end == view_t::npos)
+                        {
+                            syntax_error(program, TXT("Invalid Unicode escape"));
+                        }
+
+                        auto value = parse_hex(end - pos);
+                        if (value == unbounded || value > 0x10ffff)
+                        {
+                            syntax_error(program, TXT("Invalid Unicode escape"));
+                        }
+
+                        pos = end + 1;
+                        return value;
+                    }
 
-        operator js::string()
-        {
-            /*
-            // String
-            template <typename T>
-            string<T>::string(any val) : _value(val != null ? val.operator std::string() : string_empty._value), _control(val != null ? string_defined : string_null)
+                    auto value = parse_hex(4);
+                    if (value == unbounded)
+                    {
+                        return 'u';
+                    }
+
+                    // \uD83D\uDE00 is one code point, except without u where wchar_t is UTF-16
+                    if (value >= 0xd800 && value <= 0xdbff && (sizeof(char_t) != 2 || unicode()) && peek() == '\\' && peek(1) == 'u')
+                    {
+                        auto saved = pos;
+                        pos += 2;
+                        auto low = parse_hex(4);
+                        if (low >= 0xdc00 && low <= 0xdfff)
+                        {
+                            return 0x10000 + ((value - 0xd800) << 10) + (low - 0xdc00);
+                        }
+
+                        pos = saved;
+                    }
+
+                    return value;
+                }
+                case '0':
+                    if (!(peek() >= '0' && peek() <= '9'))
+                    {
+                        return 0;
+                    }
+
+                    [[fallthrough]];
+                case '1':
+                case '2':
+                case '3':
+                case '4':
+                case '5':
+                case '6':
+                case '7':
+                {
+                    // legacy octal escape
+                    uint32_t value = c - '0';
+                    while (value < 32 && peek() >= '0' && peek() <= '7')
+                    {
+                        value = value * 8 + (text[pos++] - '0');
+                    }
+
+                    return value;
+                }
+                }
+
+                if (unicode() && !in_class && is_word(c))
+                {
+                    syntax_error(program, TXT("Invalid escape"));
+                }
+
+                return code_unit(c);
+            }
+
+            node_t parse_atom_escape()
             {
-            }    
-        */
+                if (at_end())
+                {
+                    syntax_error(program, TXT("\\ at end of pattern"));
+                }
 
-            if (get_type() == anyTypeId::undefined_type)
+                auto c = text[pos];
+                switch (c)
+                {
+                case 'd':
+                case 'D':
+                case 'w':
+                case 'W':
+                case 's':
+                case 'S':
+                    pos++;
+                    return set(class_set(c));
+                case 'k':
+                    if (!program.names.empty() && peek(1) == '<')
+                    {
+                        auto end = text.find('>', pos);
+                        if (end == view_t::npos)
+                        {
+                            syntax_error(program, TXT("Invalid named reference"));
+                        }
+
+                        auto name = text.substr(pos + 2, end - pos - 2);
+                        for (auto &entry : program.names)
+                        {
+                            if (entry.first == name)
+                            {
+                                pos = end + 1;
+                                node_t node;
+                                node.kind = node_t::backref;
+                                node.value = entry.second;
+                                return node;
+                            }
+                        }
+
+                        syntax_error(program, TXT("Invalid named capture referenced"));
+                    }
+
+                    break;
+                }
+
+                if (c >= '1' && c <= '9')
+                {
+                    auto saved = pos;
+                    uint32_t group;
+                    parse_number(group);
+                    if (group < program.groups)
+                    {
+                        node_t node;
+                        node.kind = node_t::backref;
+                        node.value = group;
+                        return node;
+                    }
+
+                    pos = saved;
+                }
+
+                return code_point(parse_character_escape(false));
+            }
+
+            // one class atom as a code point; a class escape such as \d is returned through escape
+            uint32_t parse_class_atom(set_t *&escape, set_t &storage)
             {
-                return js::string();
+                escape = nullptr;
+                if (text[pos] != '\\')
+                {
+                    return next_code_point();
+                }
+
+                pos++;
+
+                if (at_end())
+                {
+                    syntax_error(program, TXT("\\ at end of pattern"));
+                }
+
+                switch (text[pos])
+                {
+                case 'd':
+                case 'D':
+                case 'w':
+                case 'W':
+                case 's':
+                case 'S':
+                    storage = class_set(text[pos++]);
+                    escape = &storage;
+                    return 0;
+                case '-':
+                    pos++;
+                    return '-';
+                }
+
+                return parse_character_escape(true);
             }
 
-            if (get_type() == anyTypeId::string_type)
-            {
-                return string_ref();
+            node_t parse_class()
+            {
+                set_t set;
+                // members above single_unit_max
+                unit_ranges_t wide;
+                auto add = [&](uint32_t from, uint32_t to)
+                {
+                    if (from <= single_unit_max)
+                    {
+                        set.add(from, std::min(to, single_unit_max));
+                    }
+
+                    if (to > single_unit_max)
+                    {
+                        wide.emplace_back(std::max(from, single_unit_max + 1), to);
+                    }
+                };
+
+                // a negated escape (\D \W \S) also holds every code point past single_unit_max
+                auto every_wide = false;
+                auto add_escape = [&](const set_t &escape)
+                {
+                    set.add(escape);
+                    every_wide = every_wide || escape.negate;
+                };
+
+                auto negate = eat('^');
+                for (;;)
+                {
+                    if (at_end())
+                    {
+                        syntax_error(program, TXT("Unterminated character class"));
+                    }
+
+                    if (eat(']'))
+                    {
+                        break;
+                    }
+
+                    set_t storage;
+                    set_t *escape;
+                    auto from = parse_class_atom(escape, storage);
+                    if (peek() == '-' && peek(1) != ']' && peek(1) != 0)
+                    {
+                        pos++;
+                        set_t storage_to;
+                        set_t *escape_to;
+                        auto to = parse_class_atom(escape_to, storage_to);
+                        if (escape || escape_to)
+                        {
+                            if (unicode())
+                            {
+                                syntax_error(program, TXT("Invalid character class"));
+                            }
+
+                            // Annex B: the dash is literal next to a class escape
+                            escape ? add_escape(*escape) : add(from, from);
+                            set.add('-', '-');
+                            escape_to ? add_escape(*escape_to) : add(to, to);
+                            continue;
+                        }
+
+                        if (from > to)
+                        {
+                            syntax_error(program, TXT("Range out of order in character class"));
+                        }
+
+                        add(from, to);
+                        continue;
+                    }
+
+                    escape ? add_escape(*escape) : add(from, from);
+                }
+
+                std::sort(set.ranges.begin(), set.ranges.end());
+                if (wide.empty())
+                {
+                    set.negate = negate;
+                    return this->set(std::move(set));
+                }
+
+                return wide_class(std::move(set), std::move(wide), every_wide, negate);
             }
 
-            if (get_type() == anyTypeId::number_type)
+            // a class with members of more than one code unit matches one whole code point:
+            // the single unit members stay a set, the others become the unit sequences that
+            // encode them, alternatives of one node
+            node_t wide_class(set_t &&set, unit_ranges_t &&wide, bool every_wide, bool negate)
             {
-                return js::string(number_ref().operator tstring());
-            }
+                if (every_wide)
+                {
+                    wide.emplace_back(single_unit_max + 1, 0x10ffff);
+                }
 
-            if (get_type() == anyTypeId::pointer_type)
-            {
-                return js::string(get<js::pointer_t>());
-            }
+                // in narrow builds the units past ASCII are parts of UTF-8 sequences
+                for (auto c = single_unit_max + 1; c < 256; c++)
+                {
+                    set.low.reset(c);
+                }
 
-            throw "wrong type";
-        }
+                std::sort(wide.begin(), wide.end());
+                unit_ranges_t merged;
+                for (auto &range : wide)
+                {
+                    if (!merged.empty() && range.first <= merged.back().second + 1)
+                    {
+                        merged.back().second = std::max(merged.back().second, range.second);
+                    }
+                    else
+                    {
+                        merged.push_back(range);
+                    }
+                }
 
-        operator js::object()
-        {
-            if (get_type() == anyTypeId::object_type)
-            {
-                return object_ref();
-            }
+                if (negate)
+                {
+                    // everything else, leaving out the surrogate units that pair up into
+                    // the wide code points
+                    set_t single;
+                    for (uint32_t c = 0; c <= std::min(single_unit_max, 255u); c++)
+                    {
+                        if (!set.contains(c, ignore_case()))
+                        {
+                            single.add(c, c);
+                        }
+                    }
 
-            throw "wrong type";
-        }
+                    if (sizeof(char_t) == 2)
+                    {
+                        auto gap = [&](uint32_t from, uint32_t to)
+                        {
+                            if (from < 0xd800)
+                            {
+                                single.add(from, std::min(to, 0xd7ffu));
+                            }
+
+                            if (to > 0xdfff)
+                            {
+                                single.add(std::max(from, 0xe000u), to);
+                            }
+                        };
+
+                        uint32_t next = 256;
+                        for (auto &range : set.ranges)
+                        {
+                            if (range.first > next)
+                            {
+                                gap(next, range.first - 1);
+                            }
+
+                            next = std::max(next, range.second + 1);
+                        }
+
+                        if (next <= single_unit_max)
+                        {
+                            gap(next, single_unit_max);
+                        }
+                    }
 
-        operator js::array_any()
-        {
-            if (get_type() == anyTypeId::array_type)
-            {
-                return array_ref();
-            }
+                    unit_ranges_t others;
+                    auto next = single_unit_max + 1;
+                    for (auto &range : merged)
+                    {
+                        if (range.first > next)
+                        {
+                            others.emplace_back(next, range.first - 1);
+                        }
 
-            throw "wrong type";
-        }
+                        next = range.second + 1;
+                    }
 
-        operator bool()
-        {
-            switch (get_type())
-            {
-            case anyTypeId::undefined_type:
-                return false;
-            case anyTypeId::boolean_type:
-                return boolean_ref();
-            case anyTypeId::number_type:
-                return number_ref();
-            case anyTypeId::string_type:
-                return string_ref()._value.length() > 0;
-            case anyTypeId::object_type:
-                return object_ref()->size() > 0;
-            case anyTypeId::array_type:
-                return array_ref()->size() > 0;
-            case anyTypeId::pointer_type:
-                return get<pointer_t>();
-            default:
-                break;
-            }
+                    if (next <= 0x10ffff)
+                    {
+                        others.emplace_back(next, 0x10ffff);
+                    }
 
-            return false;
-        }
+                    set = std::move(single);
+                    merged = std::move(others);
+                }
 
-        template <typename N = void>
-        requires ArithmeticOrEnum<N>
-        operator N()
-        {
-            switch (get_type())
-            {
-            case anyTypeId::undefined_type:
-                return 0;
-            case anyTypeId::boolean_type:
-                return boolean_ref() ? 1 : 0;
-            case anyTypeId::number_type:
-                return number_ref();
-            case anyTypeId::string_type:
-                char_t *end;
-#ifdef UNICODE
-                return static_cast<N>(std::wcstof(string_ref().operator const char_t *(), &end));
-#else
-                return static_cast<N>(std::strtof(string_ref().operator const char_t *(), &end));
-#endif
-            }
+                node_t alternation;
+                alternation.kind = node_t::alternation;
+                if (set.low.any() || !set.ranges.empty())
+                {
+                    alternation.children.push_back(this->set(std::move(set)));
+                }
 
-            throw "wrong type";
-        }
+                std::vector<unit_ranges_t> sequences;
+                for (auto &range : merged)
+                {
+                    encode_range(range.first, range.second, sequences);
+                }
 
-        /*template <typename T>
-        operator std::shared_ptr<T>()
-        {
-            if (get_type() == anyTypeId::class_type)
-            {
-                return std::dynamic_pointer_cast<T>(std::get<std::shared_ptr<js::object>>(_value));
-            }
+                for (auto &sequence : sequences)
+                {
+                    node_t concat;
+                    concat.kind = node_t::concat;
+                    for (auto &units : sequence)
+                    {
+                        if (units.first == units.second)
+                        {
+                            concat.children.push_back(character(units.first));
+                        }
+                        else
+                        {
+                            set_t unit_set;
+                            unit_set.add(units.first, units.second);
+                            concat.children.push_back(this->set(std::move(unit_set)));
+                        }
+                    }
 
-            throw "wrong type";
-        }*/
+                    alternation.children.push_back(std::move(concat));
+                }
 
-        template <typename Rx, typename... Args>
-        operator std::function<Rx(Args...)>()
+                if (alternation.children.size() == 1)
+                {
+                    return std::move(alternation.children[0]);
+                }
+
+                if (alternation.children.empty())
+                {
+                    // matches nothing, as [^\s\S] would
+                    set_t none;
+                    return this->set(std::move(none));
+                }
+
+                return alternation;
+            }
+        };
+
+        struct compiler_t
         {
-            if (get_type() == anyTypeId::function_type)
+            program_t &program;
+
+            size_t size() const
             {
-                auto func = function_ptr();
-                return std::function<Rx(Args...)>([=](Args... args) -> Rx
-                                                  { return func->invoke({args...}); });
+                return program.code.size();
             }
 
-            throw "wrong type";
-        }
+            void emit(op_t op, uint32_t x = 0, uint32_t y = 0)
+            {
+                if (program.code.size() >= max_program)
+                {
+                    syntax_error(program, TXT("Regular expression too large"));
+                }
 
-        operator tstring()
-        {
-            tostringstream streamObj2;
-            streamObj2 << *this;
-            return streamObj2.str();
-        }
+                program.code.push_back({op, x, y});
+            }
 
-        bool operator==(const js::any &other) const
-        {
-            if (get_type() != other.get_type())
+            void reset_groups(const node_t &node)
             {
-                return false;
+                if (node.first_group < node.last_group)
+                {
+                    emit(op_t::reset, node.first_group * 2, node.last_group * 2);
+                }
             }
 
-            switch (get_type())
+            // body of one iteration, with the empty check when it can match empty
+            void iteration(const node_t &node)
             {
-            case anyTypeId::undefined_type:
-                return true;
-            case anyTypeId::boolean_type:
-                return boolean_ref() == mutable_(other).boolean_ref();
-            case anyTypeId::number_type:
-                return number_ref() == mutable_(other).number_ref();
-            case anyTypeId::string_type:
-                return string_ref() == mutable_(other).string_ref();
-            case anyTypeId::object_type:
-                return object_ref() == mutable_(other).object_ref();
+                auto &child = node.children[0];
+                auto check = min_width(child) == 0;
+                auto reg = check ? program.registers++ : 0;
+                if (check)
+                {
+                    emit(op_t::save, reg);
+                }
+
+                reset_groups(node);
+                compile(child);
+                if (check)
+                {
+                    emit(op_t::progress, reg);
+                }
             }
 
-            throw "not implemented";
-        }
+            void compile(const node_t &node)
+            {
+                switch (node.kind)
+                {
+                case node_t::empty:
+                    break;
+                case node_t::character:
+                    emit(op_t::character, node.value);
+                    break;
+                case node_t::any:
+                    emit(op_t::any);
+                    break;
+                case node_t::set:
+                    emit(op_t::set, node.value);
+                    break;
+                case node_t::group:
+                    emit(op_t::save, node.value * 2);
+                    compile(node.children[0]);
+                    emit(op_t::save, node.value * 2 + 1);
+                    break;
+                case node_t::concat:
+                    for (auto &child : node.children)
+                    {
+                        compile(child);
+                    }
 
-        bool operator!=(const js::any &other) const
-        {
-            return !(*this == other);
-        }
+                    break;
+                case node_t::alternation:
+                {
+                    std::vector<size_t> exits;
+                    for (size_t i = 0; i < node.children.size(); i++)
+                    {
+                        if (i + 1 == node.children.size())
+                        {
+                            compile(node.children[i]);
+                            break;
+                        }
+
+                        auto split = size();
+                        emit(op_t::split, static_cast<uint32_t>(split + 1));
+                        compile(node.children[i]);
+                        exits.push_back(size());
+                        emit(op_t::jump);
+                        program.code[split].y = static_cast<uint32_t>(size());
+                    }
 
-        bool operator==(const js::undefined_t &) const
-        {
-            return get_type() == anyTypeId::undefined_type;
-        }
+                    for (auto exit : exits)
+                    {
+                        program.code[exit].x = static_cast<uint32_t>(size());
+                    }
 
-        bool operator!=(const js::undefined_t &) const
-        {
-            return get_type() != anyTypeId::undefined_type;
-        }
+                    break;
+                }
+                case node_t::repeat:
+                {
+                    for (uint32_t i = 0; i < node.min; i++)
+                    {
+                        reset_groups(node);
+                        compile(node.children[0]);
+                    }
 
-        bool operator==(const pointer_t &other) const
-        {
-            switch (get_type())
-            {
-            case anyTypeId::undefined_type:
-            case anyTypeId::boolean_type:
-            case anyTypeId::number_type:
-                return false;
-            case anyTypeId::string_type:
-                return string_ref().is_null() && other._ptr == nullptr;
-            case anyTypeId::object_type:
-            //case anyTypeId::class_type:
-            case anyTypeId::pointer_type:
-                return get<pointer_t>()._ptr == other._ptr;
-            }
+                    if (node.max == unbounded)
+                    {
+                        auto loop = size();
+                        emit(op_t::split);
+                        auto body = size();
+                        iteration(node);
+                        emit(op_t::jump, static_cast<uint32_t>(loop));
+                        auto exit = size();
+                        program.code[loop].x = static_cast<uint32_t>(node.greedy ? body : exit);
+                        program.code[loop].y = static_cast<uint32_t>(node.greedy ? exit : body);
+                        break;
+                    }
 
-            throw "not implemented";
-        }
+                    std::vector<size_t> splits;
+                    for (auto i = node.min; i < node.max; i++)
+                    {
+                        splits.push_back(size());
+                        emit(op_t::split);
+                        iteration(node);
+                    }
 
-        bool operator!=(const pointer_t &other) const
-        {
-            return !operator==(other);
-        }
+                    for (auto split : splits)
+                    {
+                        auto body = static_cast<uint32_t>(split + 1);
+                        auto exit = static_cast<uint32_t>(size());
+                        program.code[split].x = node.greedy ? body : exit;
+                        program.code[split].y = node.greedy ? exit : body;
+                    }
 
-        bool operator==(const js::boolean &other) const
-        {
-            return static_cast<js::boolean>(*mutable_(this)) == other;
-        }
+                    break;
+                }
+                case node_t::assertion:
+                    emit(static_cast<op_t>(node.value));
+                    break;
+                case node_t::backref:
+                    program.backtrack = true;
+                    emit(op_t::backref, node.value);
+                    break;
+                case node_t::look:
+                {
+                    program.backtrack = true;
+                    auto &child = node.children[0];
+                    auto index = static_cast<uint32_t>(program.looks.size());
+                    program.looks.push_back({static_cast<uint32_t>(size() + 2), node.behind ? program.registers++ : 0, min_width(child), max_width(child), node.negate, node.behind});
+                    emit(op_t::look, index);
+                    auto jump = size();
+                    emit(op_t::jump);
+                    compile(child);
+                    if (node.behind)
+                    {
+                        emit(op_t::end_at, program.looks[index].reg);
+                    }
 
-        bool operator!=(const js::boolean &other) const
-        {
-            return static_cast<js::boolean>(*mutable_(this)) != other;
-        }
+                    emit(op_t::match);
+                    program.code[jump].x = static_cast<uint32_t>(size());
+                    break;
+                }
+                }
+            }
+        };
 
-        template <typename N = void>
-        requires ArithmeticOrEnumOrNumber<N>
-        bool operator==(const N &n) const
+        // code units that can start a match; returns whether the node can match empty
+        inline bool first_units(const program_t &program, const node_t &node, std::bitset<256> &units, bool &high)
         {
-            return static_cast<js::number>(*mutable_(this)) == n;
-        }
+            switch (node.kind)
+            {
+            case node_t::character:
+                if (node.value < 256)
+                {
+                    units.set(node.value);
+                }
+                else
+                {
+                    high = true;
+                }
 
-        template <typename N = void>
-        requires ArithmeticOrEnumOrNumber<N>
-        friend bool operator==(const N &n, const any &val)
-        {
-            return n == static_cast<js::number>(mutable_(val));
-        }
+                if (program.ignore_case())
+                {
+                    auto upper = to_upper(node.value);
+                    upper < 256 ? (void)units.set(upper) : (void)(high = true);
+                }
 
-        template <typename N = void>
-        requires ArithmeticOrEnumOrNumber<N>
-        bool operator!=(const N &n) const
-        {
-            return static_cast<js::number>(*mutable_(this)) != n;
-        }
+                return false;
+            case node_t::any:
+                units.set();
+                high = true;
+                return false;
+            case node_t::set:
+            {
+                auto &set = program.sets[node.value];
+                for (uint32_t c = 0; c < 256; c++)
+                {
+                    if (set.contains(c, program.ignore_case()))
+                    {
+                        units.set(c);
+                    }
+                }
+
+                high = high || set.negate || !set.ranges.empty() || program.ignore_case();
+                return false;
+            }
+            case node_t::group:
+                return first_units(program, node.children[0], units, high);
+            case node_t::concat:
+                for (auto &child : node.children)
+                {
+                    if (!first_units(program, child, units, high))
+                    {
+                        return false;
+                    }
+                }
 
-        template <typename N = void>
-        requires ArithmeticOrEnumOrNumber<N>
-        friend bool operator!=(const N &n, const any &val)
-        {
-            return n != static_cast<js::number>(mutable_(val));
-        }
+                return true;
+            case node_t::alternation:
+            {
+                auto nullable = false;
+                for (auto &child : node.children)
+                {
+                    nullable = first_units(program, child, units, high) || nullable;
+                }
 
-        bool operator==(const js::string &other) const
-        {
-            return static_cast<js::string>(*mutable_(this)) == other;
+                return nullable;
+            }
+            case node_t::repeat:
+                return first_units(program, node.children[0], units, high) || node.min == 0;
+            case node_t::backref:
+                units.set();
+                high = true;
+                return true;
+            default:
+                return true;
+            }
         }
 
-        bool operator!=(const js::string &other) const
+        inline bool has_alternation(const node_t &node)
         {
-            return static_cast<js::string>(*mutable_(this)) != other;
+            return node.kind == node_t::alternation || std::any_of(node.children.begin(), node.children.end(), has_alternation);
         }
 
-        template <typename N = void>
-        requires ArithmeticOrEnumOrNumber<N>
-            any operator+(N n)
+        inline bool has_ambiguous_loops(const node_t &node)
         {
-            switch (get_type())
+            if (node.kind == node_t::repeat && node.max == unbounded)
             {
-            case anyTypeId::number_type:
-                return number_ref() + n;
+                auto &body = node.children[0];
+                if (min_width(body) != max_width(body) || has_alternation(body))
+                {
+                    return true;
+                }
             }
 
-            throw "not implemented";
+            return std::any_of(node.children.begin(), node.children.end(), has_ambiguous_loops);
         }
 
-        template <typename N = void>
-        requires ArithmeticOrEnumOrNumber<N>
-        friend N operator+(N n, const any &val)
+        inline std::shared_ptr<const program_t> compile(view_t pattern, view_t flags)
         {
-            switch (val.get_type())
+            auto program = std::make_shared<program_t>();
+            program->source = tstring(pattern);
+            program->flags_text = tstring(flags);
+            for (auto c : flags)
             {
-            case anyTypeId::number_type:
-                return n + mutable_(val).number_ref();
+                auto flag = c == 'g' ? flag_global : c == 'i' ? flag_ignore_case : c == 'm' ? flag_multiline : c == 's' ? flag_dot_all : c == 'u' ? flag_unicode : c == 'y' ? flag_sticky : c == 'd' ? flag_has_indices : 0;
+                if (flag == 0 || (program->flags & flag))
+                {
+                    throw js::string(tstring(TXT("Invalid flags supplied to RegExp constructor '")) + program->flags_text + TXT("'"));
+                }
+
+                program->flags |= flag;
             }
 
-            throw "not implemented";
-        }
+            parser_t parser(*program);
+            auto root = parser.parse();
+            program->groups = parser.next_group;
+            program->registers = program->groups * 2;
 
-        any operator+(string s)
-        {
-            switch (get_type())
+            compiler_t compiler{*program};
+            compiler.emit(op_t::save, 0);
+            compiler.compile(root);
+            compiler.emit(op_t::save, 1);
+            compiler.emit(op_t::match);
+
+            auto literal = [&](const node_t &node) {
+                return node.kind == node_t::character && (!program->ignore_case() || to_upper(node.value) == node.value);
+            };
+
+            if (literal(root) || (root.kind == node_t::concat && std::all_of(root.children.begin(), root.children.end(), literal)))
             {
-            case anyTypeId::number_type:
-                return number_ref().operator js::string() + s;
-            case anyTypeId::string_type:
-                return any(string_ref() + s);
+                program->is_literal = true;
+                for (auto &child : root.kind == node_t::concat ? root.children : std::vector<node_t>{root})
+                {
+                    program->literal += static_cast<char_t>(child.value);
+                }
             }
 
-            throw "not implemented";
+            program->ambiguous_loops = has_ambiguous_loops(root);
+            program->has_first = !first_units(*program, root, program->first, program->first_high);
+            return program;
         }
 
-        inline any operator+(any t) const
+        struct vm_t
         {
-            return mutable_(this)->operator+(t);
-        }
+            const program_t &program;
+            view_t input;
+            bool ignore_case;
+            bool multiline;
+            bool dot_all;
+            std::vector<size_t> regs;
 
-        any operator+(any t)
-        {
-            switch (get_type())
+            struct frame_t
             {
-            case anyTypeId::number_type:
-                switch (t.get_type())
+                uint32_t pc;
+                uint32_t reg;
+                size_t value;
+            };
+
+            std::vector<frame_t> stack;
+
+            vm_t(const program_t &program_, view_t input_)
+                : program(program_), input(input_), ignore_case(program_.ignore_case()), multiline(program_.flags & flag_multiline), dot_all(program_.flags & flag_dot_all)
+            {
+            }
+
+            inline uint32_t unit(size_t pos) const
+            {
+                auto c = code_unit(input[pos]);
+                return ignore_case ? to_lower(c) : c;
+            }
+
+            // single code unit instructions
+            inline bool consume(const inst_t &inst, size_t pos) const
+            {
+                if (pos >= input.size())
                 {
-                case anyTypeId::number_type:
-                    return number_ref() + t.number_ref();
-                case anyTypeId::string_type:
-                    return number_ref().operator js::string() + t.string_ref();
+                    return false;
                 }
-                break;
-            case anyTypeId::string_type:
-                switch (t.get_type())
+
+                switch (inst.op)
                 {
-                case anyTypeId::string_type:
-                    return string_ref() + t.string_ref();
+                case op_t::character:
+                    return unit(pos) == inst.x;
+                case op_t::any:
+                    return dot_all || !is_line_terminator(unit(pos));
+                case op_t::set:
+                    return program.sets[inst.x].contains(code_unit(input[pos]), ignore_case);
+                default:
+                    return false;
                 }
-                break;
             }
 
-            throw "not implemented";
-        }
+            // zero width assertions
+            inline bool holds(const inst_t &inst, size_t pos) const
+            {
+                switch (inst.op)
+                {
+                case op_t::line_start:
+                    return pos == 0 || (multiline && is_line_terminator(unit(pos - 1)));
+                case op_t::line_end:
+                    return pos == input.size() || (multiline && is_line_terminator(unit(pos)));
+                case op_t::word_boundary:
+                case op_t::not_word_boundary:
+                {
+                    auto before = pos > 0 && is_word(unit(pos - 1));
+                    auto after = pos < input.size() && is_word(unit(pos));
+                    return (before != after) == (inst.op == op_t::word_boundary);
+                }
+                default:
+                    return false;
+                }
+            }
 
-        any &operator++()
-        {
-            switch (get_type())
+            // next position at or after pos where a match can start
+            size_t candidate(size_t pos) const
             {
-            case anyTypeId::number_type:
-                number_ref()++;
-                return *this;
+                if (!program.has_first)
+                {
+                    return pos;
+                }
+
+                for (; pos < input.size(); pos++)
+                {
+                    auto c = code_unit(input[pos]);
+                    if (c < 256 ? program.first[c] : program.first_high)
+                    {
+                        return pos;
+                    }
+                }
+
+                return npos;
             }
 
-            throw "not implemented";
-        }
+            void set(uint32_t reg, size_t value)
+            {
+                stack.push_back({0, reg, regs[reg]});
+                regs[reg] = value;
+            }
 
-        any operator++(int)
-        {
-            switch (get_type())
+            // backtracking from pc at pos; registers keep the values of the match
+            bool run(uint32_t pc, size_t pos, size_t &end)
             {
-            case anyTypeId::number_type:
-                any tmp(number_ref());
-                operator++();
-                return tmp;
+                auto base = stack.size();
+                auto &code = program.code;
+                for (;;)
+                {
+                    auto &inst = code[pc];
+                    switch (inst.op)
+                    {
+                    case op_t::character:
+                    case op_t::any:
+                    case op_t::set:
+                        if (consume(inst, pos))
+                        {
+                            pos++;
+                            pc++;
+                            continue;
+                        }
+
+                        break;
+                    case op_t::split:
+                        stack.push_back({inst.y, branch, pos});
+                        pc = inst.x;
+                        continue;
+                    case op_t::jump:
+                        pc = inst.x;
+                        continue;
+                    case op_t::save:
+                        set(inst.x, pos);
+                        pc++;
+                        continue;
+                    case op_t::reset:
+                        for (auto reg = inst.x; reg < inst.y; reg++)
+                        {
+                            if (regs[reg] != npos)
+                            {
+                                set(reg, npos);
+                            }
+                        }
+
+                        pc++;
+                        continue;
+                    case op_t::progress:
+                        if (regs[inst.x] != pos)
+                        {
+                            pc++;
+                            continue;
+                        }
+
+                        break;
+                    case op_t::line_start:
+                    case op_t::line_end:
+                    case op_t::word_boundary:
+                    case op_t::not_word_boundary:
+                        if (holds(inst, pos))
+                        {
+                            pc++;
+                            continue;
+                        }
+
+                        break;
+                    case op_t::backref:
+                    {
+                        auto from = regs[inst.x * 2];
+                        auto to = regs[inst.x * 2 + 1];
+                        if (from == npos || to == npos)
+                        {
+                            pc++;
+                            continue;
+                        }
+
+                        auto length = to - from;
+                        if (pos + length <= input.size())
+                        {
+                            size_t i = 0;
+                            while (i < length && unit(from + i) == unit(pos + i))
+                            {
+                                i++;
+                            }
+
+                            if (i == length)
+                            {
+                                pos += length;
+                                pc++;
+                                continue;
+                            }
+                        }
+
+                        break;
+                    }
+                    case op_t::look:
+                        if (look(program.looks[inst.x], pos))
+                        {
+                            pc++;
+                            continue;
+                        }
+
+                        break;
+                    case op_t::end_at:
+                        if (regs[inst.x] == pos)
+                        {
+                            pc++;
+                            continue;
+                        }
+
+                        break;
+                    case op_t::match:
+                        stack.resize(base);
+                        end = pos;
+                        return true;
+                    }
+
+                    // failure: undo register writes up to the latest branch
+                    for (;;)
+                    {
+                        if (stack.size() == base)
+                        {
+                            return false;
+                        }
+
+                        auto frame = stack.back();
+                        stack.pop_back();
+                        if (frame.reg == branch)
+                        {
+                            pc = frame.pc;
+                            pos = frame.value;
+                            break;
+                        }
+
+                        regs[frame.reg] = frame.value;
+                    }
+                }
             }
 
-            throw "not implemented";
-        }
+            // lookaround is atomic: once the body matched it is not backtracked into
+            bool look(const look_t &look, size_t pos)
+            {
+                auto saved = regs;
+                auto matched = false;
+                size_t end;
+                if (!look.behind)
+                {
+                    matched = run(look.start, pos, end);
+                }
+                else
+                {
+                    regs[look.reg] = pos;
+                    auto from = look.max_width == unbounded || look.max_width > pos ? 0 : pos - look.max_width;
+                    auto to = look.min_width > pos ? npos : pos - look.min_width;
+                    for (auto start = from; to != npos && start <= to && !matched; start++)
+                    {
+                        matched = run(look.start, start, end);
+                    }
+                }
 
-        template <typename N = void>
-        requires ArithmeticOrEnumOrNumber<N>
-            any &operator+=(N n)
-        {
-            switch (get_type())
+                if (matched == look.negate)
+                {
+                    regs = std::move(saved);
+                    return false;
+                }
+
+                if (look.negate)
+                {
+                    regs = std::move(saved);
+                    return true;
+                }
+
+                // keep the captures of a positive lookaround, undoable by the outer match
+                for (uint32_t reg = 0; reg < regs.size(); reg++)
+                {
+                    if (regs[reg] != saved[reg])
+                    {
+                        stack.push_back({0, reg, saved[reg]});
+                    }
+                }
+
+                return true;
+            }
+
+            bool backtrack_search(size_t start, bool sticky)
             {
-            case anyTypeId::number_type:
-                number_ref() += n;
-                return *this;
+                for (auto pos = start; pos <= input.size(); pos++)
+                {
+                    if (!sticky)
+                    {
+                        pos = candidate(pos);
+                        if (pos == npos)
+                        {
+                            return false;
+                        }
+                    }
+
+                    std::fill(regs.begin(), regs.end(), npos);
+                    size_t end;
+                    if (run(0, pos, end))
+                    {
+                        return true;
+                    }
+
+                    if (sticky)
+                    {
+                        return false;
+                    }
+                }
+
+                return false;
             }
 
-            throw "not implemented";
-        }
+            // Pike VM: threads advance in lock step, one per instruction, in priority order
+            struct threads_t
+            {
+                std::vector<uint32_t> pcs;
+                std::vector<size_t> regs;
+                std::vector<uint32_t> marks;
+                uint32_t generation = 0;
 
-        template <typename N = void>
-        requires ArithmeticOrEnumOrNumber<N>
-        friend N operator+=(N &n, any value)
-        {
-            switch (value.get_type())
+                void clear()
+                {
+                    pcs.clear();
+                    regs.clear();
+                    generation++;
+                }
+            };
+
+            void add(threads_t &threads, uint32_t pc, size_t pos)
             {
-            case anyTypeId::number_type:
-                return n += value.number_ref();
+                auto &code = program.code;
+                stack.clear();
+                stack.push_back({pc, branch, 0});
+                while (!stack.empty())
+                {
+                    auto frame = stack.back();
+                    stack.pop_back();
+                    if (frame.reg != branch)
+                    {
+                        regs[frame.reg] = frame.value;
+                        continue;
+                    }
+
+                    pc = frame.pc;
+                    if (threads.marks[pc] == threads.generation)
+                    {
+                        continue;
+                    }
+
+                    threads.marks[pc] = threads.generation;
+                    auto &inst = code[pc];
+                    switch (inst.op)
+                    {
+                    case op_t::jump:
+                        stack.push_back({inst.x, branch, 0});
+                        break;
+                    case op_t::split:
+                        stack.push_back({inst.y, branch, 0});
+                        stack.push_back({inst.x, branch, 0});
+                        break;
+                    case op_t::save:
+                        set(inst.x, pos);
+                        stack.push_back({pc + 1, branch, 0});
+                        break;
+                    case op_t::reset:
+                        for (auto reg = inst.x; reg < inst.y; reg++)
+                        {
+                            set(reg, npos);
+                        }
+
+                        stack.push_back({pc + 1, branch, 0});
+                        break;
+                    case op_t::progress:
+                        if (regs[inst.x] != pos)
+                        {
+                            stack.push_back({pc + 1, branch, 0});
+                        }
+
+                        break;
+                    case op_t::line_start:
+                    case op_t::line_end:
+                    case op_t::word_boundary:
+                    case op_t::not_word_boundary:
+                        if (holds(inst, pos))
+                        {
+                            stack.push_back({pc + 1, branch, 0});
+                        }
+
+                        break;
+                    default:
+                        threads.pcs.push_back(pc);
+                        threads.regs.insert(threads.regs.end(), regs.begin(), regs.end());
+                        break;
+                    }
+                }
             }
 
-            throw "not implemented";
-        }
+            bool pike_search(size_t start, bool sticky)
+            {
+                threads_t current, next;
+                current.marks.assign(program.code.size(), 0);
+                next.marks.assign(program.code.size(), 0);
+                current.clear();
+                auto count = regs.size();
+                std::vector<size_t> best;
+                for (auto pos = start;; pos++)
+                {
+                    if (best.empty() && (pos == start || !sticky))
+                    {
+                        if (current.pcs.empty())
+                        {
+                            current.clear();
+                        }
+
+                        if (current.pcs.empty() && !sticky)
+                        {
+                            pos = candidate(pos);
+                            if (pos == npos)
+                            {
+                                break;
+                            }
+                        }
+
+                        std::fill(regs.begin(), regs.end(), npos);
+                        add(current, 0, pos);
+                    }
 
-        template <typename N = void>
-        requires ArithmeticOrEnumOrNumber<N>
-            any operator-(N n)
+                    if (current.pcs.empty())
+                    {
+                        if (!best.empty() || sticky || pos >= input.size())
+                        {
+                            break;
+                        }
+
+                        continue;
+                    }
+
+                    next.clear();
+                    for (size_t i = 0; i < current.pcs.size(); i++)
+                    {
+                        auto pc = current.pcs[i];
+                        auto thread = current.regs.begin() + i * count;
+                        auto &inst = program.code[pc];
+                        if (inst.op == op_t::match)
+                        {
+                            // lower priority threads lose to this match
+                            best.assign(thread, thread + count);
+                            break;
+                        }
+
+                        if (consume(inst, pos))
+                        {
+                            std::copy(thread, thread + count, regs.begin());
+                            add(next, pc + 1, pos + 1);
+                        }
+                    }
+
+                    std::swap(current, next);
+                    if (pos >= input.size())
+                    {
+                        break;
+                    }
+                }
+
+                if (best.empty())
+                {
+                    return false;
+                }
+
+                regs = std::move(best);
+                return true;
+            }
+        };
+
+        // leftmost match at or after start, only at start under the y flag; captures
+        // receives two positions per group, npos for groups that did not participate
+        inline bool search(const program_t &program, view_t input, size_t start, std::vector<size_t> &captures)
         {
-            switch (get_type())
+            auto sticky = (program.flags & flag_sticky) != 0;
+            if (start > input.size())
             {
-            case anyTypeId::number_type:
-                return number_ref() - n;
+                return false;
             }
 
-            throw "not implemented";
-        }
+            if (program.is_literal)
+            {
+                view_t literal(program.literal);
+                auto found = sticky ? (input.substr(start, literal.size()) == literal ? start : npos) : strsearch::find(input, literal, start);
+                if (found == npos)
+                {
+                    return false;
+                }
 
-        template <typename N = void>
-        requires ArithmeticOrEnumOrNumber<N>
-        friend N operator-(N n, const any &val)
-        {
-            switch (val.get_type())
+                captures.assign({found, found + literal.size()});
+                return true;
+            }
+
+            vm_t vm(program, input);
+            vm.regs.assign(program.registers, npos);
+            if (!(program.ambiguous_loops && !program.backtrack ? vm.pike_search(start, sticky) : vm.backtrack_search(start, sticky)))
             {
-            case anyTypeId::number_type:
-                return n - mutable_(val).number_ref();
+                return false;
             }
 
-            throw "not implemented";
+            captures.assign(vm.regs.begin(), vm.regs.begin() + program.groups * 2);
+            return true;
         }
 
-        any operator-(any t)
+        // programs compiled for new RegExp(...) at run time, by flags and source
+        struct cache_t
         {
-            switch (get_type())
-            {
-            case anyTypeId::number_type:
-                switch (t.get_type())
-                {
-                case anyTypeId::number_type:
-                    return number_ref() - t.number_ref();
-                }
-                break;
-            }
+            static constexpr size_t capacity = 256;
+
+            std::mutex mutex;
+            std::list<std::pair<tstring, std::shared_ptr<const program_t>>> entries;
+            std::unordered_map<tstring, decltype(entries)::iterator> index;
+        };
 
-            throw "not implemented";
+        inline cache_t &cache()
+        {
+            static cache_t instance;
+            return instance;
         }
 
-        any &operator--()
+        inline std::shared_ptr<const program_t> compile_cached(view_t pattern, view_t flags)
         {
-            switch (get_type())
+            auto key = tstring(flags);
+            key += '/';
+            key += pattern;
+
+            auto &cache = regexp::cache();
             {
-            case anyTypeId::number_type:
-                number_ref() -= 1;
-                return *this;
+                std::lock_guard<std::mutex> lock(cache.mutex);
+                auto found = cache.index.find(key);
+                if (found != cache.index.end())
+                {
+                    cache.entries.splice(cache.entries.begin(), cache.entries, found->second);
+                    return found->second->second;
+                }
             }
 
-            throw "not implemented";
-        }
+            auto program = compile(pattern, flags);
 
-        any operator--(int)
-        {
-            switch (get_type())
+            std::lock_guard<std::mutex> lock(cache.mutex);
+            if (cache.index.find(key) == cache.index.end())
             {
-            case anyTypeId::number_type:
-                any tmp(number_ref());
-                operator--();
-                return tmp;
+                cache.entries.emplace_front(key, program);
+                cache.index[key] = cache.entries.begin();
+                if (cache.entries.size() > cache_t::capacity)
+                {
+                    cache.index.erase(cache.entries.back().first);
+                    cache.entries.pop_back();
+                }
             }
 
-            throw "not implemented";
+            return program;
         }
+    } // namespace regexp
 
-        template <typename N = void>
-        requires ArithmeticOrEnumOrNumber<N>
-            any &operator-=(N n)
-        {
-            switch (get_type())
-            {
-            case anyTypeId::number_type:
-                number_ref() -= n;
-                return *this;
-            }
+    struct RegExpExecArray : public Array<string>
+    {
+        number index;
+        string input;
+
+        RegExpExecArray() = default;
 
-            throw "not implemented";
+        RegExpExecArray(const undefined_t &undef) : Array<string>(undef)
+        {
         }
+    };
 
-        template <typename N = void>
-        requires ArithmeticOrEnumOrNumber<N>
-        friend N operator-=(N &n, any value)
+    struct RegExp
+    {
+        std::shared_ptr<const regexp::program_t> _program;
+        js::string source;
+        js::string flags;
+        js::boolean global;
+        js::boolean ignoreCase;
+        js::boolean multiline;
+        js::boolean dotAll;
+        js::boolean unicode;
+        js::boolean sticky;
+        number lastIndex;
+
+        RegExp(js::string pattern, js::string flags_ = string_empty) : RegExp(regexp::compile_cached(pattern._value, flags_._value))
         {
-            switch (value.get_type())
-            {
-            case anyTypeId::number_type:
-                return n -= value.number_ref();
-            }
+        }
 
-            throw "not implemented";
+        // regex literals share the program compiled once at their emission site
+        RegExp(std::shared_ptr<const regexp::program_t> program)
+            : _program(std::move(program)),
+              source(_program->source.empty() ? tstring(TXT("(?:)")) : _program->source),
+              flags(_program->flags_text),
+              global((_program->flags & regexp::flag_global) != 0),
+              ignoreCase((_program->flags & regexp::flag_ignore_case) != 0),
+              multiline((_program->flags & regexp::flag_multiline) != 0),
+              dotAll((_program->flags & regexp::flag_dot_all) != 0),
+              unicode((_program->flags & regexp::flag_unicode) != 0),
+              sticky((_program->flags & regexp::flag_sticky) != 0),
+              lastIndex(0)
+        {
         }
 
-        template <typename N = void>
-        requires ArithmeticOrEnumOrNumber<N>
-            any operator*(N n)
+        RegExpExecArray exec(js::string val)
         {
-            switch (get_type())
+            auto update = (_program->flags & (regexp::flag_global | regexp::flag_sticky)) != 0;
+            auto start = update ? static_cast<double>(lastIndex._value) : 0.0;
+
+            // lastIndex and index count UTF-16 code units, captures are offsets into _value
+            std::vector<size_t> captures;
+            if (!(start >= 0 && start <= val.length()) || !regexp::search(*_program, val._value, val.index_to_offset(static_cast<size_t>(start)), captures))
             {
-            case anyTypeId::number_type:
-                return any(number_ref() * n);
+                if (update)
+                {
+                    lastIndex = 0;
+                }
+
+                return RegExpExecArray(undefined);
             }
 
-            throw "not implemented";
-        }
+            if (update)
+            {
+                lastIndex = val.offset_to_index(captures[1]);
+            }
 
-        template <typename N = void>
-        requires ArithmeticOrEnumOrNumber<N>
-        friend N operator*(N n, const any &val)
-        {
-            switch (val.get_type())
+            RegExpExecArray result;
+            result.index = val.offset_to_index(captures[0]);
+            result.input = val;
+            for (size_t i = 0; i < captures.size(); i += 2)
             {
-            case anyTypeId::number_type:
-                return n * mutable_(val).number_ref();
+                result._values.push_back(captures[i] == regexp::npos ? js::string() : js::string(val._value.substr(captures[i], captures[i + 1] - captures[i])));
             }
 
-            throw "not implemented";
+            return result;
         }
 
-        any operator*(any t)
+        js::boolean test(js::string val)
         {
-            switch (get_type())
+            if ((_program->flags & (regexp::flag_global | regexp::flag_sticky)) != 0)
             {
-            case anyTypeId::number_type:
-                switch (t.get_type())
-                {
-                case anyTypeId::number_type:
-                    return any(number_ref() * t.number_ref());
-                }
-                break;
+                return !exec(val).isUndefined;
             }
 
-            throw "not implemented";
+            std::vector<size_t> captures;
+            return regexp::search(*_program, val._value, 0, captures);
         }
 
-        template <typename N = void>
-        requires ArithmeticOrEnumOrNumber<N>
-            any &operator*=(N n)
+        js::string toString()
         {
-            switch (get_type())
-            {
-            case anyTypeId::number_type:
-                number_ref() *= n;
-                return *this;
-            }
+            return js::string(TXT("/")) + source + js::string(TXT("/")) + flags;
+        }
+    };
+
+    template <typename T>
+    struct TypedArray : public Array<T>
+    {
+        typedef Array<T> super__;
+        js::number _length;
 
-            throw "not implemented";
+        TypedArray(js::number length_) : super__()
+        {
+            _length = length_;
         }
+    };
 
-        template <typename N = void>
-        requires ArithmeticOrEnumOrNumber<N>
-            any operator/(N n)
+    struct Int16Array : TypedArray<short>
+    {
+        Int16Array(js::number length_) : TypedArray(length_)
         {
-            switch (get_type())
-            {
-            case anyTypeId::number_type:
-                return any(number_ref() / n);
-            }
+        }
+    };
 
-            throw "not implemented";
+    struct Uint16Array : TypedArray<unsigned short>
+    {
+        Uint16Array(js::number length_) : TypedArray(length_)
+        {
         }
+    };
 
-        template <typename N = void>
-        requires ArithmeticOrEnumOrNumber<N>
-        friend N operator/(N n, const any &val)
+    struct Float32Array : TypedArray<float>
+    {
+        Float32Array(js::number length_) : TypedArray(length_)
         {
-            switch (val.get_type())
-            {
-            case anyTypeId::number_type:
-                return n / mutable_(val).number_ref();
-            }
+        }
+    };
 
-            throw "not implemented";
+    struct Float64Array : TypedArray<double>
+    {
+        Float64Array(js::number length_) : TypedArray(length_)
+        {
         }
+    };
 
-        any operator/(any t)
+    struct Int32Array : TypedArray<int>
+    {
+        Int32Array(js::number length_) : TypedArray(length_)
         {
-            switch (get_type())
-            {
-            case anyTypeId::number_type:
-                switch (t.get_type())
-                {
-                case anyTypeId::number_type:
-                    return any(number_ref() / t.number_ref());
-                }
-                break;
-            }
+        }
+    };
 
-            throw "not implemented";
+    struct Uint32Array : TypedArray<unsigned int>
+    {
+        Uint32Array(js::number length_) : TypedArray(length_)
+        {
         }
+    };
 
-        template <typename N = void>
-        requires ArithmeticOrEnumOrNumber<N>
-            any &operator/=(N n)
+    struct Int64Array : TypedArray<long long>
+    {
+        Int64Array(js::number length_) : TypedArray(length_)
         {
-            switch (get_type())
-            {
-            case anyTypeId::number_type:
-                number_ref() /= n;
-                return *this;
-            }
+        }
+    };
 
-            throw "not implemented";
+    struct Uint64Array : TypedArray<unsigned long long>
+    {
+        Uint64Array(js::number length_) : TypedArray(length_)
+        {
         }
+    };
 
-        template <typename N = void>
-        requires ArithmeticOrEnumOrNumber<N>
-            any operator%(N n)
+    struct ArrayBuffer
+    {
+        std::unique_ptr<uint8_t[]> _data;
+        size_t _size = 0;
+        size_t _capacity = 0;
+        js::number byteLength;
+
+        ArrayBuffer() : byteLength(0)
         {
-            switch (get_type())
-            {
-            case anyTypeId::number_type:
-                return any(number_ref() % n);
-            }
+        }
 
-            throw "not implemented";
+        ArrayBuffer(js::number length) : _data(new uint8_t[static_cast<size_t>(length)]()), _size(static_cast<size_t>(length)), _capacity(_size), byteLength(length)
+        {
         }
 
-        any operator%(any t)
+        // storage for readers filling the buffer in place, contents past _size are uninitialized
+        uint8_t *_reserve(size_t capacity)
         {
-            switch (get_type())
+            if (capacity > _capacity)
             {
-            case anyTypeId::number_type:
-                switch (t.get_type())
+                auto data = std::unique_ptr<uint8_t[]>(new uint8_t[capacity]);
+                if (_capacity > 0)
                 {
-                case anyTypeId::number_type:
-                    return any(number_ref() % t.number_ref());
+                    std::memcpy(data.get(), _data.get(), _capacity);
                 }
-                break;
+
+                _data = std::move(data);
+                _capacity = capacity;
             }
 
-            throw "not implemented";
+            return _data.get();
         }
 
-        template <typename N = void>
-        requires ArithmeticOrEnumOrNumber<N>
-        friend any operator%(N n, any value)
+        void _resize(size_t size)
         {
-            switch (value.get_type())
-            {
-            case anyTypeId::number_type:
-                return any(n % value.number_ref());
-            }
-
-            throw "not implemented";
+            _reserve(size);
+            _size = size;
+            byteLength = js::number(static_cast<double>(size));
         }
+    };
 
-        template <typename N = void>
-        requires ArithmeticOrEnumOrNumber<N>
-            any &operator%=(N other)
-        {
-            switch (get_type())
-            {
-            case anyTypeId::number_type:
-                number_ref() %= other;
-                return *this;
-            }
+    struct ArrayBufferView
+    {
+    };
+
+    // Promise //////////////////////////////////////////////////////////////////////
+    template <typename T = any>
+    struct Promise;
+
+    template <typename T>
+    struct is_promise : std::false_type
+    {
+    };
+
+    template <typename T>
+    struct is_promise<std::shared_ptr<Promise<T>>> : std::true_type
+    {
+        typedef T value_type;
+    };
+
+    template <typename T>
+    struct is_shared_ptr : std::false_type
+    {
+    };
 
-            throw "not implemented";
+    template <typename T>
+    struct is_shared_ptr<std::shared_ptr<T>> : std::true_type
+    {
+    };
+
+    // rejection reasons are kept as exception_ptr so thrown C++ exceptions and
+    // JS values travel the same way
+    static any reason_to_any(const std::exception_ptr &reason)
+    {
+        try
+        {
+            std::rethrow_exception(reason);
+        }
+        catch (const any &a)
+        {
+            return a;
+        }
+        catch (const js::string &s)
+        {
+            return any(s);
+        }
+        catch (const Error &error)
+        {
+            return any(js::string(utf::to_text(error.name()) + TXT(": ") + utf::to_text(error.what())));
+        }
+        catch (const std::exception &exception)
+        {
+            return any(js::string(utf::to_text(exception.what())));
+        }
+        catch (const char_t *s)
+        {
+            return any(js::string(s));
+        }
+        catch (...)
+        {
+            return any();
         }
+    }
 
-        template <typename N = void>
-        requires ArithmeticOrEnumOrNumber<N>
-        bool operator>(N n)
+    template <typename V>
+    struct promise_state
+    {
+        enum status_t
         {
-            switch (get_type())
-            {
-            case anyTypeId::number_type:
-                return number_ref() > n;
-            }
+            pending,
+            fulfilled,
+            rejected
+        };
+
+        // status may be polled without the lock; value and reason are written under it
+        // before status changes and never afterwards
+        std::atomic<status_t> status{pending};
 
-            throw "not implemented";
-        }
+        std::optional<V> value;
+        std::exception_ptr reason;
+        std::vector<std::function<void()>> reactions;
+        // then() and co_await can register from a worker while the loop settles
+        std::mutex lock;
+        // wakes workers blocked in await
+        std::condition_variable settled;
 
-        any operator>(any t)
+        void fulfill(V v)
         {
-            switch (get_type())
+            std::unique_lock<std::mutex> guard(lock);
+            if (status != pending)
             {
-            case anyTypeId::number_type:
-                switch (t.get_type())
-                {
-                case anyTypeId::number_type:
-                    return any(number_ref() > t.number_ref());
-                }
-                break;
+                return;
             }
 
-            throw "not implemented";
+            value.emplace(std::move(v));
+            settle(fulfilled, guard);
         }
 
-        template <typename N = void>
-        requires ArithmeticOrEnumOrNumber<N>
-        bool operator>=(N n)
+        void reject(std::exception_ptr r)
         {
-            switch (get_type())
+            std::unique_lock<std::mutex> guard(lock);
+            if (status != pending)
             {
-            case anyTypeId::number_type:
-                return number_ref() >= n;
+                return;
             }
 
-            throw "not implemented";
+            reason = r;
+            settle(rejected, guard);
         }
 
-        any operator>=(any t)
+        void on_settled(std::function<void()> reaction)
         {
-            switch (get_type())
             {
-            case anyTypeId::number_type:
-                switch (t.get_type())
+                std::lock_guard<std::mutex> guard(lock);
+                if (status == pending)
                 {
-                case anyTypeId::number_type:
-                    return any(number_ref() >= t.number_ref());
+                    reactions.push_back(std::move(reaction));
+                    return;
                 }
-                break;
             }
 
-            throw "not implemented";
+            event_loop().queue_microtask(std::move(reaction));
         }
 
-        template <typename N = void>
-        requires ArithmeticOrEnumOrNumber<N>
-        bool operator<(N n)
+        // blocks until settled or the timeout passes, true when settled
+        template <typename Duration>
+        bool wait_for(Duration timeout)
         {
-            switch (get_type())
-            {
-            case anyTypeId::number_type:
-                return number_ref() < n;
-            }
-
-            throw "not implemented";
+            std::unique_lock<std::mutex> guard(lock);
+            return settled.wait_for(guard, timeout, [this]()
+                                    { return status != pending; });
         }
 
-        any operator<(any t)
+    private:
+        void settle(status_t to, std::unique_lock<std::mutex> &guard)
         {
-            switch (get_type())
+            status = to;
+            auto reactions_to_run = std::move(reactions);
+            reactions.clear();
+            guard.unlock();
+            settled.notify_all();
+
+            for (auto &reaction : reactions_to_run)
             {
-            case anyTypeId::number_type:
-                switch (t.get_type())
-                {
-                case anyTypeId::number_type:
-                    return any(number_ref() < t.number_ref());
-                }
-                break;
+                event_loop().queue_microtask(std::move(reaction));
             }
-
-            throw "not implemented";
         }
+    };
 
-        bool operator<=(js::number n)
-        {
-            switch (get_type())
-            {
-            case anyTypeId::number_type:
-                return number_ref() <= n;
-            }
+    template <typename T>
+    struct Promise : public std::enable_shared_from_this<Promise<T>>
+    {
+        typedef std::conditional_t<std::is_void_v<T>, undefined_t, T> value_t;
+        typedef promise_state<value_t> state_t;
+
+        std::shared_ptr<state_t> _state;
 
-            throw "not implemented";
+        Promise() : _state(std::make_shared<state_t>())
+        {
         }
 
-        any operator<=(any t)
+        // new Promise((resolve, reject) => {...})
+        template <typename F>
+        Promise(F executor) : _state(std::make_shared<state_t>())
         {
-            switch (get_type())
+            auto resolver = resolve_function();
+            auto rejecter = reject_function();
+            try
             {
-            case anyTypeId::number_type:
-                switch (t.get_type())
-                {
-                case anyTypeId::number_type:
-                    return any(number_ref() <= t.number_ref());
-                }
-                break;
+                executor(resolver, rejecter);
+            }
+            catch (...)
+            {
+                settle_rejected(_state, std::current_exception());
             }
+        }
 
-            throw "not implemented";
+        constexpr Promise *operator->()
+        {
+            return this;
         }
 
-        template <typename... Args>
-        any operator()(Args... args) const
+        bool is_pending() const
         {
-            switch (get_type())
-            {
-            case anyTypeId::function_type:
-                return function_ptr()->invoke({args...});
-            }
+            return _state->status == state_t::pending;
+        }
 
-            throw "not implemented";
+        bool is_rejected() const
+        {
+            return _state->status == state_t::rejected;
         }
 
-        template <typename... Args>
-        any operator()(Args... args)
+        // valid after the promise is settled, rethrows the rejection reason
+        value_t get() const
         {
-            switch (get_type())
+            if (_state->status == state_t::rejected)
             {
-            case anyTypeId::function_type:
-                return function_ptr()->invoke({args...});
+                std::rethrow_exception(_state->reason);
             }
 
-            throw "not implemented";
+            return *_state->value;
         }
 
-        js::string type_of()
+        template <typename F>
+        auto then(F on_fulfilled)
         {
-            switch (get_type())
-            {
-            case anyTypeId::undefined_type:
-                return TXT("undefined");
-
-            case anyTypeId::boolean_type:
-                return TXT("boolean");
-
-            case anyTypeId::number_type:
-                return TXT("number");
-
-            case anyTypeId::string_type:
-                return TXT("string");
-
-            case anyTypeId::array_type:
-                return TXT("array");
-
-            case anyTypeId::object_type:
-                return TXT("object");
-
-            default:
-                return TXT("error");
-            }
+            return then_internal(std::move(on_fulfilled), nullptr);
         }
 
-        void Delete(const char_t *field)
+        template <typename F, typename R>
+        auto then(F on_fulfilled, R on_rejected)
         {
-            switch (get_type())
-            {
-            case anyTypeId::object_type:
-                object_ref().Delete(field);
-                break;
+            return then_internal(std::move(on_fulfilled), std::move(on_rejected));
+        }
 
-            default:
-                throw "wrong type";
-            }
+        template <typename R>
+        std::shared_ptr<Promise<T>> _catch(R on_rejected)
+        {
+            auto result = std::make_shared<Promise<T>>();
+            auto state = _state;
+            auto target = result->_state;
+            state->on_settled([=]() mutable
+                              {
+                                  if (state->status == state_t::fulfilled)
+                                  {
+                                      target->fulfill(*state->value);
+                                      return;
+                                  }
+
+                                  try
+                                  {
+                                      auto reason = reason_to_any(state->reason);
+                                      if constexpr (std::is_void_v<decltype(invoke_handler(on_rejected, reason))>)
+                                      {
+                                          invoke_handler(on_rejected, reason);
+                                          target->fulfill(value_t{});
+                                      }
+                                      else
+                                      {
+                                          adopt(target, static_cast<value_t>(invoke_handler(on_rejected, reason)));
+                                      }
+                                  }
+                                  catch (...)
+                                  {
+                                      target->reject(std::current_exception());
+                                  }
+                              });
+            return result;
         }
 
-        js::number get_length() const
+        template <typename F>
+        std::shared_ptr<Promise<T>> finally(F on_finally)
         {
-            switch (get_type())
-            {
-            case anyTypeId::string_type:
-                return string_ref().get_length();
-            case anyTypeId::array_type:
-                return array_ref().get_length();
-            default:
-                throw "wrong type";
-            }
+            auto result = std::make_shared<Promise<T>>();
+            auto state = _state;
+            auto target = result->_state;
+            state->on_settled([=]() mutable
+                              {
+                                  try
+                                  {
+                                      on_finally();
+                                  }
+                                  catch (...)
+                                  {
+                                      target->reject(std::current_exception());
+                                      return;
+                                  }
+
+                                  if (state->status == state_t::fulfilled)
+                                  {
+                                      target->fulfill(*state->value);
+                                  }
+                                  else
+                                  {
+                                      target->reject(state->reason);
+                                  }
+                              });
+            return result;
         }
 
-        auto begin() -> decltype(array_ref().begin())
+        template <typename V>
+        static auto resolve(V value)
         {
-            switch (get_type())
+            if constexpr (is_promise<V>::value)
             {
-            case anyTypeId::array_type:
-                return array_ref().begin();
-            default:
-                throw "wrong type";
+                return value;
+            }
+            else
+            {
+                auto result = std::make_shared<Promise<V>>();
+                settle_fulfilled(result->_state, std::move(value));
+                return result;
             }
         }
 
-        auto end() -> decltype(array_ref().end())
+        static std::shared_ptr<Promise<void>> resolve()
         {
-            switch (get_type())
-            {
-            case anyTypeId::array_type:
-                return array_ref().end();
-            default:
-                throw "wrong type";
-            }
+            auto result = std::make_shared<Promise<void>>();
+            settle_fulfilled(result->_state, undefined);
+            return result;
         }
 
-        size_t hash(void) const noexcept
+        template <typename V>
+        static std::shared_ptr<Promise<T>> reject(V reason)
         {
-            size_t const h1(std::hash<int>{}(static_cast<int>(get_type())));
-            size_t h2;
+            auto result = std::make_shared<Promise<T>>();
+            settle_rejected(result->_state, std::make_exception_ptr(any(reason)));
+            return result;
+        }
 
-            switch (get_type())
-            {
-            case anyTypeId::undefined_type:
-                h2 = 0;
-                break;
+        // settles once every input is fulfilled, or with the first rejection
+        template <typename C>
+        static auto all(C promises)
+        {
+            auto &items = container_of(promises);
+            typedef typename is_promise<std::decay_t<decltype(*std::begin(items))>>::value_type item_t;
+            typedef typename Promise<item_t>::value_t item_value_t;
 
-            case anyTypeId::boolean_type:
-                h2 = std::hash<bool>{}(static_cast<bool>(mutable_(boolean_ref())));
-                break;
+            auto result = std::make_shared<Promise<std::shared_ptr<array<item_value_t>>>>();
+            auto target = result->_state;
+            auto values = std::make_shared<array<item_value_t>>();
+            auto remaining = std::make_shared<size_t>(0);
 
-            case anyTypeId::number_type:
-                h2 = std::hash<double>{}(static_cast<double>(mutable_(number_ref())));
-                break;
+            for (auto &item : items)
+            {
+                auto index = (*remaining)++;
+                values->_values.emplace_back();
+                auto state = item->_state;
+                state->on_settled([=]()
+                                  {
+                                      if (state->status == Promise<item_t>::state_t::rejected)
+                                      {
+                                          target->reject(state->reason);
+                                          return;
+                                      }
 
-            case anyTypeId::string_type:
-                h2 = std::hash<tstring>{}(static_cast<tstring &>(mutable_(string_ref())));
-                break;
+                                      values->_values[index] = *state->value;
+                                      if (--(*remaining) == 0)
+                                      {
+                                          target->fulfill(values);
+                                      }
+                                  });
+            }
 
-            default:
-                h2 = 0;
+            if (*remaining == 0)
+            {
+                settle_fulfilled(target, values);
             }
 
-            return hash_combine(h1, h2);
+            return result;
         }
 
-        friend tostream &operator<<(tostream &os, any val)
+        // settles as the first settled input does
+        template <typename C>
+        static auto race(C promises)
         {
-            switch (val.get_type())
-            {
-            case anyTypeId::undefined_type:
-                return os << TXT("undefined");
+            auto &items = container_of(promises);
+            typedef typename is_promise<std::decay_t<decltype(*std::begin(items))>>::value_type item_t;
 
-            case anyTypeId::boolean_type:
-                return os << val.boolean_ref();
+            auto result = std::make_shared<Promise<item_t>>();
+            auto target = result->_state;
+            for (auto &item : items)
+            {
+                auto state = item->_state;
+                state->on_settled([=]()
+                                  {
+                                      if (state->status == Promise<item_t>::state_t::rejected)
+                                      {
+                                          target->reject(state->reason);
+                                      }
+                                      else
+                                      {
+                                          target->fulfill(*state->value);
+                                      }
+                                  });
+            }
 
-            case anyTypeId::number_type:
-                return os << val.number_ref();
+            return result;
+        }
 
-            case anyTypeId::pointer_type:
-                return os << TXT("null");
+        // runs f on the executor, the promise settles on the event loop thread
+        template <typename F>
+        static auto run(F f)
+        {
+            typedef decltype(f()) result_t;
+            auto result = std::make_shared<Promise<result_t>>();
+            auto target = result->_state;
+            event_loop().hold();
+            executor().submit([=]() mutable
+                              {
+                                  std::function<void()> complete;
+                                  try
+                                  {
+                                      if constexpr (std::is_void_v<result_t>)
+                                      {
+                                          f();
+                                          complete = [=]()
+                                          { target->fulfill(undefined); };
+                                      }
+                                      else
+                                      {
+                                          auto value = f();
+                                          complete = [=]()
+                                          { target->fulfill(value); };
+                                      }
+                                  }
+                                  catch (...)
+                                  {
+                                      auto reason = std::current_exception();
+                                      complete = [=]()
+                                      { target->reject(reason); };
+                                  }
+
+                                  event_loop().post([=]()
+                                                    {
+                                                        complete();
+                                                        event_loop().release();
+                                                    });
+                              });
+            return result;
+        }
 
-            case anyTypeId::string_type:
-                return os << val.string_ref();
+        template <typename V>
+        friend struct Promise;
 
-            case anyTypeId::function_type:
-                return os << TXT("[function]");
+        template <typename V>
+        friend struct coroutine_promise;
 
-            case anyTypeId::array_type:
-                return os << TXT("[array]");
+        template <typename V>
+        friend struct coroutine_promise_base;
 
-            case anyTypeId::object_type:
-                return os << TXT("[object]");
+    private:
+        template <typename C>
+        static auto &container_of(C &promises)
+        {
+            if constexpr (is_shared_ptr<C>::value)
+            {
+                return promises->_values;
+            }
+            else
+            {
+                return promises._values;
+            }
+        }
 
-            //case anyTypeId::class_type:
-            //    return os << val.class_ref().get()->toString();
+        template <typename S, typename V>
+        static void settle_fulfilled(const std::shared_ptr<S> &state, V value)
+        {
+            if (event_loop_t::on_loop_thread())
+            {
+                state->fulfill(std::move(value));
+            }
+            else
+            {
+                event_loop().post([=]()
+                                  { state->fulfill(value); });
+            }
+        }
 
-            default:
-                return os << TXT("[any]");
+        template <typename S>
+        static void settle_rejected(const std::shared_ptr<S> &state, std::exception_ptr reason)
+        {
+            if (event_loop_t::on_loop_thread())
+            {
+                state->reject(reason);
+            }
+            else
+            {
+                event_loop().post([=]()
+                                  { state->reject(reason); });
             }
         }
-    };
 
+        // resolve(value) / resolve() as passed to the executor function
+        auto resolve_function()
+        {
+            auto state = _state;
+            return [state](auto... args)
+            {
+                if constexpr (sizeof...(args) == 0)
+                {
+                    settle_fulfilled(state, value_t{});
+                }
+                else
+                {
+                    auto adopt_value = [&](auto &&value)
+                    {
+                        typedef std::decay_t<decltype(value)> arg_t;
+                        if constexpr (is_promise<arg_t>::value)
+                        {
+                            adopt(state, value);
+                        }
+                        else
+                        {
+                            settle_fulfilled(state, static_cast<value_t>(value));
+                        }
+                    };
+
+                    adopt_value(args...);
+                }
+            };
+        }
+
+        auto reject_function()
+        {
+            auto state = _state;
+            return [state](auto... args)
+            {
+                settle_rejected(state, std::make_exception_ptr(any(args...)));
+            };
+        }
 
-    template <typename F>
-    any invokeWithInitList(F &_f, std::initializer_list<any> args_)
-    {
-        typedef function_traits<F> traits;
+        template <typename F, typename A>
+        static auto invoke_handler(F &f, A &&arg)
+        {
+            if constexpr (std::is_invocable_v<F &, A &>)
+            {
+                return f(arg);
+            }
+            else
+            {
+                return f();
+            }
+        }
 
-        auto args_vector = std::vector<any>(args_);
-        if constexpr (std::is_void_v<traits::return_type>)
+        // settles target with a handler result, following returned promises
+        template <typename S>
+        static void adopt(const std::shared_ptr<S> &target)
         {
-            invoke_seq<traits::nargs>(_f, args_vector);
-            return any();
+            target->fulfill(undefined);
         }
-        else
+
+        template <typename S, typename V>
+        static void adopt(const std::shared_ptr<S> &target, V value)
         {
-            return invoke_seq<traits::nargs>(_f, args_vector);
+            if constexpr (is_promise<V>::value)
+            {
+                auto source = value->_state;
+                source->on_settled([=]()
+                                   {
+                                       if (source->status == std::decay_t<decltype(*source)>::rejected)
+                                       {
+                                           target->reject(source->reason);
+                                       }
+                                       else
+                                       {
+                                           target->fulfill(*source->value);
+                                       }
+                                   });
+            }
+            else
+            {
+                target->fulfill(std::move(value));
+            }
         }
-    }
-
-    template <typename F>
-    template <typename... Args>
-    auto function_t<F>::operator()(Args... args)
-    {
 
-        if constexpr (std::is_void_v<traits::return_type>)
+        template <typename F, typename R>
+        auto then_internal(F on_fulfilled, R on_rejected)
         {
-            _f(args...);
+            typedef decltype(invoke_handler(on_fulfilled, std::declval<value_t &>())) handler_result_t;
+            typedef std::conditional_t<is_promise<handler_result_t>::value, typename is_promise<handler_result_t>::value_type, handler_result_t> result_t;
+
+            auto result = std::make_shared<Promise<result_t>>();
+            auto state = _state;
+            auto target = result->_state;
+            state->on_settled([=]() mutable
+                              {
+                                  try
+                                  {
+                                      if (state->status == state_t::fulfilled)
+                                      {
+                                          if constexpr (std::is_void_v<handler_result_t>)
+                                          {
+                                              invoke_handler(on_fulfilled, *state->value);
+                                              adopt(target);
+                                          }
+                                          else
+                                          {
+                                              adopt(target, invoke_handler(on_fulfilled, *state->value));
+                                          }
+                                      }
+                                      else if constexpr (!std::is_same_v<R, std::nullptr_t>)
+                                      {
+                                          auto reason = reason_to_any(state->reason);
+                                          if constexpr (std::is_void_v<decltype(invoke_handler(on_rejected, reason))>)
+                                          {
+                                              invoke_handler(on_rejected, reason);
+                                              adopt(target);
+                                          }
+                                          else
+                                          {
+                                              adopt(target, static_cast<typename Promise<result_t>::value_t>(invoke_handler(on_rejected, reason)));
+                                          }
+                                      }
+                                      else
+                                      {
+                                          target->reject(state->reason);
+                                      }
+                                  }
+                                  catch (...)
+                                  {
+                                      target->reject(std::current_exception());
+                                  }
+                              });
+            return result;
         }
-        else 
+    };
+
+    // await on the loop thread keeps the loop turning until the promise settles,
+    // on a worker it helps the executor and otherwise blocks until settle wakes it,
+    // as executor().wait does
+    template <typename T>
+    auto await(const std::shared_ptr<Promise<T>> &promise)
+    {
+        using namespace std::chrono_literals;
+        while (promise->is_pending())
         {
-            return _f(args...);
+            if (event_loop_t::on_loop_thread())
+            {
+                event_loop().run_once(event_loop().alive());
+                if (promise->is_pending() && !event_loop().alive())
+                {
+                    throw js::string(TXT("await: promise can never be settled"));
+                }
+            }
+            else if (!executor().run_one())
+            {
+                // the timeout only lets newly submitted tasks be helped with
+                promise->_state->wait_for(1ms);
+            }
         }
-    }
 
-    template <typename F>
-    any function_t<F>::invoke(std::initializer_list<any> args_)
-    {
-        auto result = invokeWithInitList(*_f, args_);
-        return result;
+        return promise->get();
     }
 
+    // Coroutines ///////////////////////////////////////////////////////////////////////
+    // async functions are emitted as coroutines returning $S<Promise<T>>. The body runs
+    // synchronously up to the first co_await; a suspended frame is resumed by the
+    // promise reaction, i.e. from the event loop's microtask queue.
     template <typename T>
-    struct shared;
-
-    template <class T1, class T2>
-    concept NotShared = !std::is_same_v<T1, shared<T2>>;
+    using Task = std::shared_ptr<Promise<T>>;
 
     template <typename T>
-    struct shared
+    struct promise_awaiter
     {
-        using shared_type = shared<T>;
+        std::shared_ptr<Promise<T>> promise;
 
-        std::shared_ptr<T> _value;
-
-        shared(T t) : _value(std::make_shared<T>(t)) {}
-        shared(std::shared_ptr<T> t) : _value(t) {}
-
-        template <typename V>
-        shared_type &operator=(const V &v)
+        // always suspends, as in JS code after await runs as a microtask even when the
+        // promise has already settled
+        bool await_ready() const
         {
-            *_value = mutable_(v);
-            return *this;
+            return false;
         }
 
-        T &operator*() const
+        void await_suspend(std::coroutine_handle<> handle)
         {
-            return *_value.get();
+            promise->_state->on_settled([handle]()
+                                        { handle.resume(); });
         }
 
-        operator T() { return *_value.get(); }
+        auto await_resume()
+        {
+            return promise->get();
+        }
+    };
 
-        // todo: memory leak here, improve it using any(shared_t<value> s)
-        operator any() { return *_value.get(); }
+    template <typename T>
+    promise_awaiter<T> operator co_await(const std::shared_ptr<Promise<T>> &promise)
+    {
+        return {promise};
+    }
 
-        T &get() const { return *_value.get(); }
+    template <typename T>
+    struct coroutine_promise_base
+    {
+        std::shared_ptr<Promise<T>> result = std::make_shared<Promise<T>>();
 
-        T *operator->() const
+        std::shared_ptr<Promise<T>> get_return_object()
         {
-            return _value.get();
+            return result;
         }
 
-        template <class Tv>
-        auto &operator[](Tv t) const
+        std::suspend_never initial_suspend() noexcept
         {
-            return const_(get())[t];
+            return {};
         }
 
-        template <class Tv>
-        auto &operator[](Tv t)
+        // frame is destroyed as soon as the body completes, the result lives in the promise
+        std::suspend_never final_suspend() noexcept
         {
-            return get()[t];
+            return {};
         }
 
-        auto &operator++()
+        void unhandled_exception()
         {
-            return ++get();
+            Promise<T>::settle_rejected(result->_state, std::current_exception());
         }
+    };
 
-        auto operator++(int)
+    template <typename T>
+    struct coroutine_promise : coroutine_promise_base<T>
+    {
+        template <typename V>
+        void return_value(V value)
         {
-            return get()++;
+            if constexpr (is_promise<V>::value)
+            {
+                Promise<T>::adopt(this->result->_state, value);
+            }
+            else
+            {
+                Promise<T>::settle_fulfilled(this->result->_state, static_cast<typename Promise<T>::value_t>(value));
+            }
         }
+    };
 
-        template <class Tv>
-        auto operator+(Tv other) const
+    template <>
+    struct coroutine_promise<void> : coroutine_promise_base<void>
+    {
+        void return_void()
         {
-            return get() + other;
+            Promise<void>::settle_fulfilled(result->_state, undefined);
         }
+    };
 
-        template <class Tv = void>
-        requires NotShared<Tv, T>
-        friend auto operator+(Tv other, const shared_type &val)
-        {
-            return other + val.get();
-        }
+} // namespace js
 
-        template <class Tv>
-        auto operator+=(Tv other) const
+template <typename T, typename... Args>
+struct std::coroutine_traits<std::shared_ptr<js::Promise<T>>, Args...>
+{
+    using promise_type = js::coroutine_promise<T>;
+};
+
+namespace js
+{
+
+    // File system //////////////////////////////////////////////////////////////////////
+    // sync calls go straight to the OS. Promise variants run metadata calls (open, stat,
+    // readdir) on the executor; file data moves through io_uring on Linux, with
+    // completions reaped on a dedicated thread and posted back to the event loop.
+    // Without io_uring (old kernel, seccomp, other platforms, TSCXX_IO_URING=0) reads
+    // and writes run on the executor as well. Files are read straight into the
+    // returned string or ArrayBuffer storage.
+    namespace fs
+    {
+        struct Stats
         {
-            return get() += other;
-        }
+            js::number size;
+            js::number mode;
+            js::number mtimeMs;
+            bool _file = false;
+            bool _directory = false;
 
-        template <class Tv>
-        requires NotShared<Tv, T>
-        friend auto operator+=(Tv &other, const shared_type &val)
+            bool isFile()
+            {
+                return _file;
+            }
+
+            bool isDirectory()
+            {
+                return _directory;
+            }
+        };
+
+#ifdef _WIN32
+        static int sys_open(const std::filesystem::path &path, int flags, int mode)
         {
-            return other += mutable_(val).get();
+            return _wopen(path.c_str(), flags | _O_BINARY, mode);
         }
 
-        template <class Tv>
-        auto operator-(Tv other) const
+        static int64_t sys_read(int fd, void *buffer, size_t length, int64_t position)
         {
-            return get() - other;
+            if (position >= 0 && _lseeki64(fd, position, SEEK_SET) < 0)
+            {
+                return -1;
+            }
+
+            return _read(fd, buffer, static_cast<unsigned>(length));
         }
 
-        template <class Tv = void>
-        requires NotShared<Tv, T>
-        friend auto operator-(Tv other, const shared_type &val)
+        static int64_t sys_write(int fd, const void *buffer, size_t length, int64_t position)
         {
-            return other - val.get();
+            if (position >= 0 && _lseeki64(fd, position, SEEK_SET) < 0)
+            {
+                return -1;
+            }
+
+            return _write(fd, buffer, static_cast<unsigned>(length));
         }
 
-        template <class Tv>
-        auto operator-=(Tv other) const
+        static int sys_close(int fd)
         {
-            return get() -= other;
+            return _close(fd);
         }
 
-        template <class Tv>
-        requires NotShared<Tv, T>
-        friend auto operator-=(Tv &other, const shared_type &val)
+        static size_t sys_size(int fd)
         {
-            return other -= mutable_(val).get();
+            struct _stat64 st;
+            return _fstat64(fd, &st) == 0 && (st.st_mode & _S_IFREG) ? static_cast<size_t>(st.st_size) : 0;
         }
-
-        template <class Tv>
-        auto operator*(Tv other) const
+#else
+        static int sys_open(const std::filesystem::path &path, int flags, int mode)
         {
-            return get() * other;
+            return ::open(path.c_str(), flags | O_CLOEXEC, mode);
         }
 
-        template <class Tv = void>
-        requires NotShared<Tv, T>
-        friend auto operator*(Tv other, const shared_type &val)
+        static int64_t sys_read(int fd, void *buffer, size_t length, int64_t position)
         {
-            return other * val.get();
+            return position >= 0 ? ::pread(fd, buffer, length, position) : ::read(fd, buffer, length);
         }
 
-        template <class Tv>
-        auto operator*=(Tv other) const
+        static int64_t sys_write(int fd, const void *buffer, size_t length, int64_t position)
         {
-            return get() *= other;
+            return position >= 0 ? ::pwrite(fd, buffer, length, position) : ::write(fd, buffer, length);
         }
 
-        template <class Tv>
-        requires NotShared<Tv, T>
-        friend auto operator*=(Tv &other, const shared_type &val)
+        static int sys_close(int fd)
         {
-            return other *= mutable_(val).get();
+            return ::close(fd);
         }
 
-        template <class Tv>
-        auto operator/(Tv other) const
+        static size_t sys_size(int fd)
         {
-            return get() / other;
+            struct stat st;
+            return ::fstat(fd, &st) == 0 && S_ISREG(st.st_mode) ? static_cast<size_t>(st.st_size) : 0;
         }
+#endif
 
-        template <class Tv = void>
-        requires NotShared<Tv, T>
-        friend auto operator/(Tv other, const shared_type &val)
+        // strings are read and written as UTF-8, node's default encoding; narrow builds
+        // already hold UTF-8 and pass the bytes through
+        static js::string from_bytes(std::string &&bytes)
         {
-            return other / val.get();
+#ifdef UNICODE
+            return js::string(utf::to_text(bytes));
+#else
+            return js::string(std::move(bytes));
+#endif
         }
 
-        template <class Tv>
-        auto operator/=(Tv other) const
+#ifdef UNICODE
+        static std::string to_bytes(const js::string &value)
         {
-            return get() /= other;
+            return utf::from_text(value._value);
         }
-
-        template <class Tv>
-        requires NotShared<Tv, T>
-        friend auto operator/=(Tv &other, const shared_type &val)
+#else
+        static std::string_view to_bytes(const js::string &value)
         {
-            return other /= mutable_(val).get();
+            return value._value;
         }
+#endif
 
-        template <class Tv>
-        friend bool operator==(const Tv &other, const shared_type &val)
+        [[noreturn]] static void throw_error(int error, const char *syscall, const std::filesystem::path &path = {})
         {
-            return val.get() == other;
+            auto message = std::string(std::strerror(error)) + ", " + syscall;
+            if (!path.empty())
+            {
+                message += " '" + path.string() + "'";
+            }
+
+            throw from_bytes(std::move(message));
         }
 
-        template <class Tv>
-        friend bool operator!=(const Tv &other, const shared_type &val)
+        static int open_flags(const js::string &flags)
         {
-            return val.get() != other;
+            auto &value = flags._value;
+            if (value == TXT("r"))
+            {
+                return O_RDONLY;
+            }
+            else if (value == TXT("r+"))
+            {
+                return O_RDWR;
+            }
+            else if (value == TXT("w"))
+            {
+                return O_WRONLY | O_CREAT | O_TRUNC;
+            }
+            else if (value == TXT("w+"))
+            {
+                return O_RDWR | O_CREAT | O_TRUNC;
+            }
+            else if (value == TXT("a"))
+            {
+                return O_WRONLY | O_CREAT | O_APPEND;
+            }
+            else if (value == TXT("a+"))
+            {
+                return O_RDWR | O_CREAT | O_APPEND;
+            }
+
+            throw js::string(TXT("fs: unknown open flags"));
         }
 
-        template <class Tv>
-        bool operator==(const Tv &other) const
+        static int open_file(const js::string &path, int flags)
         {
-            return get() == other;
+            std::filesystem::path native(path._value);
+            auto fd = sys_open(native, flags, 0666);
+            if (fd < 0)
+            {
+                throw_error(errno, "open", native);
+            }
+
+            return fd;
         }
 
-        template <class Tv>
-        bool operator!=(const Tv &other) const
+        // grow(capacity) returns the storage base; reads until EOF, sizing the first
+        // request from the file size so regular files take a single read
+        template <typename G>
+        static size_t read_all(int fd, G grow)
         {
-            return get() != other;
+            auto hint = sys_size(fd);
+            auto capacity = hint > 0 ? hint : size_t(4096);
+            auto base = grow(capacity);
+            size_t done = 0;
+            for (;;)
+            {
+                if (done == capacity)
+                {
+                    // probe for EOF before doubling a buffer that is already exact
+                    char probe;
+                    auto n = sys_read(fd, &probe, 1, -1);
+                    if (n == 0)
+                    {
+                        break;
+                    }
+                    else if (n < 0)
+                    {
+                        throw_error(errno, "read");
+                    }
+
+                    capacity *= 2;
+                    base = grow(capacity);
+                    base[done++] = static_cast<uint8_t>(probe);
+                    continue;
+                }
+
+                auto n = sys_read(fd, base + done, capacity - done, -1);
+                if (n == 0)
+                {
+                    break;
+                }
+                else if (n < 0)
+                {
+                    if (errno == EINTR)
+                    {
+                        continue;
+                    }
+
+                    throw_error(errno, "read");
+                }
+
+                done += static_cast<size_t>(n);
+            }
+
+            return done;
         }
 
-        template <class Tv>
-        friend bool operator==(const shared<Tv> &other, const shared_type &val)
+        static void write_all(int fd, const uint8_t *data, size_t length)
         {
-            return val.get() == other.get();
+            size_t done = 0;
+            while (done < length)
+            {
+                auto n = sys_write(fd, data + done, length - done, -1);
+                if (n < 0)
+                {
+                    if (errno == EINTR)
+                    {
+                        continue;
+                    }
+
+                    throw_error(errno, "write");
+                }
+
+                done += static_cast<size_t>(n);
+            }
         }
 
-        template <class Tv>
-        friend bool operator!=(const shared<Tv> &other, const shared_type &val)
+        // readFileSync(path) -> ArrayBuffer
+        static std::shared_ptr<ArrayBuffer> readFileSync(const js::string &path)
         {
-            return val.get() != other.get();
+            auto fd = open_file(path, O_RDONLY);
+            utils::finally close_fd([=]()
+                                    { sys_close(fd); });
+            auto buffer = std::make_shared<ArrayBuffer>();
+            auto size = read_all(fd, [&](size_t capacity)
+                                 { return buffer->_reserve(capacity); });
+            buffer->_resize(size);
+            return buffer;
         }
 
-        template <class Tv>
-        bool operator==(const shared<Tv> &other) const
+        // readFileSync(path, encoding) -> string
+        template <typename E>
+        static js::string readFileSync(const js::string &path, E)
         {
-            return get() == other.get();
+            auto fd = open_file(path, O_RDONLY);
+            utils::finally close_fd([=]()
+                                    { sys_close(fd); });
+            std::string bytes;
+            auto size = read_all(fd, [&](size_t capacity)
+                                 {
+                                     bytes.resize(capacity);
+                                     return reinterpret_cast<uint8_t *>(bytes.data());
+                                 });
+            bytes.resize(size);
+            return from_bytes(std::move(bytes));
         }
 
-        template <class Tv>
-        bool operator!=(const shared<Tv> &other) const
+        static void writeFileSync(const js::string &path, const js::string &data)
         {
-            return get() != other.get();
+            auto fd = open_file(path, O_WRONLY | O_CREAT | O_TRUNC);
+            utils::finally close_fd([=]()
+                                    { sys_close(fd); });
+            auto bytes = to_bytes(data);
+            write_all(fd, reinterpret_cast<const uint8_t *>(bytes.data()), bytes.size());
         }
 
-        number get_length() const
+        static void writeFileSync(const js::string &path, const std::shared_ptr<ArrayBuffer> &data)
         {
-            return get()->get_length();
+            auto fd = open_file(path, O_WRONLY | O_CREAT | O_TRUNC);
+            utils::finally close_fd([=]()
+                                    { sys_close(fd); });
+            write_all(fd, data->_data.get(), data->_size);
         }
 
-        auto begin()
+        static js::number openSync(const js::string &path, const js::string &flags = js::string(TXT("r")))
         {
-            return get()->begin();
+            return js::number(open_file(path, open_flags(flags)));
         }
 
-        auto end()
+        static void closeSync(js::number fd)
         {
-            return get()->end();
+            if (sys_close(static_cast<int>(fd)) < 0)
+            {
+                throw_error(errno, "close");
+            }
         }
-    };
 
-    template <typename T>
-    shared(T t) -> shared<T>;
+        // the part of buffer a read may fill, checked as node does: 0 <= offset <= size and
+        // offset + length <= size, length -1 (the default) reads up to the end
+        static std::pair<size_t, size_t> read_range(const ArrayBuffer &buffer, js::number offset, js::number length)
+        {
+            auto from = static_cast<double>(offset);
+            if (!(from >= 0 && from <= static_cast<double>(buffer._size)) || from != std::trunc(from))
+            {
+                throw RangeError("The value of \"offset\" is out of range.");
+            }
 
-    // TODO: put into class undefined
-    static js::number operator+(const undefined_t &v)
-    {
-        return number(NAN);
-    }
+            auto start = static_cast<size_t>(from);
+            auto count = static_cast<double>(length);
+            if (count == -1)
+            {
+                return {start, buffer._size - start};
+            }
 
-    // TODO: put into class boolean
-    static js::number operator+(const boolean &v)
-    {
-        return number((mutable_(v)) ? 1 : 0);
-    }
+            if (!(count >= 0 && count <= static_cast<double>(buffer._size - start)) || count != std::trunc(count))
+            {
+                throw RangeError("The value of \"length\" is out of range.");
+            }
 
-    // typedefs
-    typedef std::unordered_map<any, int, any::any_hash, any::any_equal_to> switch_type;
+            return {start, static_cast<size_t>(count)};
+        }
 
-    // Number
-    static js::number Infinity(std::numeric_limits<double>::infinity());
-    static js::number NaN(std::numeric_limits<double>::quiet_NaN());
+        // readSync(fd, buffer, offset, length, position); position -1 reads at the file position
+        static js::number readSync(js::number fd, const std::shared_ptr<ArrayBuffer> &buffer, js::number offset = 0, js::number length = -1, js::number position = -1)
+        {
+            auto [start, count] = read_range(*buffer, offset, length);
+            auto n = sys_read(static_cast<int>(fd), buffer->_data.get() + start, count, static_cast<int64_t>(static_cast<double>(position)));
+            if (n < 0)
+            {
+                throw_error(errno, "read");
+            }
 
-    namespace tmpl
-    {
+            return js::number(static_cast<double>(n));
+        }
 
-        // Number
-        template <typename V>
-        number<V>::operator js::string()
+        static js::number writeSync(js::number fd, const js::string &data, js::number position = -1)
         {
-            return js::string(static_cast<tstring>(*this));
+            auto bytes = to_bytes(data);
+            auto n = sys_write(static_cast<int>(fd), bytes.data(), bytes.size(), static_cast<int64_t>(static_cast<double>(position)));
+            if (n < 0)
+            {
+                throw_error(errno, "write");
+            }
+
+            return js::number(static_cast<double>(n));
         }
 
-        template <typename V>
-        js::string number<V>::toString()
+        static js::number writeSync(js::number fd, const std::shared_ptr<ArrayBuffer> &data, js::number position = -1)
         {
-            tostringstream streamObj2;
-            streamObj2 << _value;
-            return streamObj2.str();
+            auto n = sys_write(static_cast<int>(fd), data->_data.get(), data->_size, static_cast<int64_t>(static_cast<double>(position)));
+            if (n < 0)
+            {
+                throw_error(errno, "write");
+            }
+
+            return js::number(static_cast<double>(n));
         }
 
-        template <typename V>
-        js::string number<V>::toString(number_t radix)
+        static std::shared_ptr<Stats> statSync(const js::string &path)
         {
-            return js::string(to_tstring(_value));
+            std::filesystem::path native(path._value);
+            std::error_code error;
+            auto status = std::filesystem::status(native, error);
+            if (error || !std::filesystem::exists(status))
+            {
+                throw_error(error ? error.value() : ENOENT, "stat", native);
+            }
+
+            auto stats = std::make_shared<Stats>();
+            stats->_file = std::filesystem::is_regular_file(status);
+            stats->_directory = std::filesystem::is_directory(status);
+            stats->size = js::number(stats->_file ? static_cast<double>(std::filesystem::file_size(native, error)) : 0.0);
+            stats->mode = js::number(static_cast<int>(status.permissions()) | (stats->_directory ? S_IFDIR : stats->_file ? S_IFREG : 0));
+            auto modified = std::filesystem::last_write_time(native, error);
+            auto modified_system = std::chrono::system_clock::now() + (modified - std::filesystem::file_time_type::clock::now());
+            stats->mtimeMs = js::number(static_cast<double>(std::chrono::duration_cast<std::chrono::milliseconds>(modified_system.time_since_epoch()).count()));
+            return stats;
         }
 
-        template <typename T>
-        string<T> string<T>::operator+(any value)
+        static std::shared_ptr<array<js::string>> readdirSync(const js::string &path)
         {
-            string tmp(_value);
-            tmp._value.append(value.operator std::string());
-            return tmp;
+            std::filesystem::path native(path._value);
+            std::error_code error;
+            auto names = std::make_shared<array<js::string>>();
+            for (auto it = std::filesystem::directory_iterator(native, error); !error && it != std::filesystem::directory_iterator(); it.increment(error))
+            {
+#ifdef UNICODE
+                names->_values.emplace_back(it->path().filename().wstring());
+#else
+                names->_values.emplace_back(it->path().filename().string());
+#endif
+            }
+
+            if (error)
+            {
+                throw_error(error.value(), "scandir", native);
+            }
+
+            return names;
         }
 
-        template <typename T>
-        string<T> &string<T>::operator+=(any value)
+        enum io_op
         {
-            auto value_string = value.operator std::string();
-            _control = string_defined;
-            _value.append(value_string);
-            return *this;
-        }
+            io_read,
+            io_write
+        };
 
-        // Object
-        template <typename K, typename V>
-        object<K, V>::object() : isUndefined(false)
+#ifdef __linux__
+        // minimal io_uring on raw syscalls; submissions come from the loop thread,
+        // a reaper thread waits for completions and posts them to the event loop
+        struct uring_t
         {
-        }
+            struct request
+            {
+                std::function<void(int)> complete;
+            };
 
-        template <typename K, typename V>
-        object<K, V>::object(const object &value) : _values(value._values), isUndefined(value.isUndefined)
+            int _fd = -1;
+            unsigned _entries = 0;
+            unsigned *_sq_head = nullptr;
+            unsigned *_sq_tail = nullptr;
+            unsigned *_sq_mask = nullptr;
+            unsigned *_sq_array = nullptr;
+            unsigned *_cq_head = nullptr;
+            unsigned *_cq_tail = nullptr;
+            unsigned *_cq_mask = nullptr;
+            io_uring_sqe *_sqes = nullptr;
+            io_uring_cqe *_cqes = nullptr;
+            void *_sq_ring = MAP_FAILED;
+            void *_cq_ring = MAP_FAILED;
+            size_t _sq_ring_size = 0;
+            size_t _cq_ring_size = 0;
+            size_t _sqes_size = 0;
+            std::mutex _lock;
+            std::thread _reaper;
+            std::atomic<unsigned> _in_flight{0};
+
+            uring_t()
+            {
+                // the loop has to outlive the reaper, so make sure it is constructed first
+                event_loop();
+
+                auto env = std::getenv("TSCXX_IO_URING");
+                if (env && std::atoi(env) == 0)
+                {
+                    return;
+                }
+
+                io_uring_params params;
+                std::memset(&params, 0, sizeof(params));
+                _fd = static_cast<int>(syscall(__NR_io_uring_setup, 256, &params));
+                if (_fd < 0)
+                {
+                    return;
+                }
+
+                _entries = params.sq_entries;
+                _sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+                _cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+                auto single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+                if (single)
+                {
+                    _sq_ring_size = _cq_ring_size = std::max(_sq_ring_size, _cq_ring_size);
+                }
+
+                _sq_ring = mmap(nullptr, _sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _fd, IORING_OFF_SQ_RING);
+                _cq_ring = single ? _sq_ring : mmap(nullptr, _cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _fd, IORING_OFF_CQ_RING);
+                _sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+                auto sqes = mmap(nullptr, _sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _fd, IORING_OFF_SQES);
+                if (_sq_ring == MAP_FAILED || _cq_ring == MAP_FAILED || sqes == MAP_FAILED)
+                {
+                    if (sqes != MAP_FAILED)
+                    {
+                        munmap(sqes, _sqes_size);
+                    }
+
+                    unmap();
+                    return;
+                }
+
+                auto sq = static_cast<char *>(_sq_ring);
+                auto cq = static_cast<char *>(_cq_ring);
+                _sq_head = reinterpret_cast<unsigned *>(sq + params.sq_off.head);
+                _sq_tail = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+                _sq_mask = reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+                _sq_array = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+                _cq_head = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+                _cq_tail = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+                _cq_mask = reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+                _cqes = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+                _sqes = static_cast<io_uring_sqe *>(sqes);
+
+                _reaper = std::thread([this]()
+                                      { reap(); });
+            }
+
+            ~uring_t()
+            {
+                if (_fd < 0)
+                {
+                    return;
+                }
+
+                // a nop without a request tells the reaper to stop
+                if (push(IORING_OP_NOP, -1, nullptr, 0, 0, nullptr))
+                {
+                    _reaper.join();
+                }
+                else
+                {
+                    _reaper.detach();
+                }
+
+                munmap(_sqes, _sqes_size);
+                unmap();
+            }
+
+            bool available() const
+            {
+                return _fd >= 0;
+            }
+
+            // false when the ring is unavailable or saturated, the caller falls back
+            bool submit(io_op op, int fd, void *buffer, size_t length, int64_t position, std::function<void(int)> complete)
+            {
+                if (!available() || _in_flight >= _entries)
+                {
+                    return false;
+                }
+
+                auto req = new request{std::move(complete)};
+                event_loop().hold();
+                if (!push(op == io_read ? IORING_OP_READ : IORING_OP_WRITE, fd, buffer, static_cast<unsigned>(length), position, req))
+                {
+                    event_loop().release();
+                    delete req;
+                    return false;
+                }
+
+                return true;
+            }
+
+        private:
+            bool push(uint8_t opcode, int fd, void *buffer, unsigned length, int64_t position, request *req)
+            {
+                std::lock_guard<std::mutex> guard(_lock);
+                auto tail = *_sq_tail;
+                if (tail - __atomic_load_n(_sq_head, __ATOMIC_ACQUIRE) >= _entries)
+                {
+                    return false;
+                }
+
+                auto index = tail & *_sq_mask;
+                auto &sqe = _sqes[index];
+                std::memset(&sqe, 0, sizeof(sqe));
+                sqe.opcode = opcode;
+                sqe.fd = fd;
+                sqe.addr = reinterpret_cast<uint64_t>(buffer);
+                sqe.len = length;
+                sqe.off = static_cast<uint64_t>(position);
+                sqe.user_data = reinterpret_cast<uint64_t>(req);
+                _sq_array[index] = index;
+                __atomic_store_n(_sq_tail, tail + 1, __ATOMIC_RELEASE);
+                _in_flight++;
+
+                for (;;)
+                {
+                    auto submitted = syscall(__NR_io_uring_enter, _fd, 1, 0, 0, nullptr, 0);
+                    if (submitted >= 0)
+                    {
+                        return true;
+                    }
+                    else if (errno != EINTR)
+                    {
+                        break;
+                    }
+                }
+
+                // not consumed by the kernel, take the entry back
+                __atomic_store_n(_sq_tail, tail, __ATOMIC_RELEASE);
+                _in_flight--;
+                return false;
+            }
+
+            void reap()
+            {
+                for (;;)
+                {
+                    auto result = syscall(__NR_io_uring_enter, _fd, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+                    if (result < 0 && errno != EINTR)
+                    {
+                        return;
+                    }
+
+                    auto head = *_cq_head;
+                    auto tail = __atomic_load_n(_cq_tail, __ATOMIC_ACQUIRE);
+                    auto stop = false;
+                    for (; head != tail; head++)
+                    {
+                        auto &cqe = _cqes[head & *_cq_mask];
+                        auto req = reinterpret_cast<request *>(cqe.user_data);
+                        auto res = cqe.res;
+                        _in_flight--;
+                        if (!req)
+                        {
+                            stop = true;
+                            continue;
+                        }
+
+                        event_loop().post([req, res]()
+                                          {
+                                              req->complete(res);
+                                              delete req;
+                                              event_loop().release();
+                                          });
+                    }
+
+                    __atomic_store_n(_cq_head, head, __ATOMIC_RELEASE);
+                    if (stop)
+                    {
+                        return;
+                    }
+                }
+            }
+
+            void unmap()
+            {
+                if (_cq_ring != MAP_FAILED && _cq_ring != _sq_ring)
+                {
+                    munmap(_cq_ring, _cq_ring_size);
+                }
+
+                if (_sq_ring != MAP_FAILED)
+                {
+                    munmap(_sq_ring, _sq_ring_size);
+                }
+
+                ::close(_fd);
+                _fd = -1;
+            }
+        };
+
+        inline uring_t &uring()
         {
+            static uring_t instance;
+            return instance;
         }
+#endif
 
-        template <typename K, typename V>
-        object<K, V>::object(std::initializer_list<pair> values) : _values(values), isUndefined(false)
+        // resolves with the byte count or -errno; buffer must stay alive until then
+        static std::shared_ptr<Promise<int64_t>> transfer(io_op op, int fd, uint8_t *buffer, size_t length, int64_t position)
         {
-            for (auto &item : values)
+#ifdef __linux__
+            auto result = std::make_shared<Promise<int64_t>>();
+            auto state = result->_state;
+            if (event_loop_t::on_loop_thread() && uring().submit(op, fd, buffer, length, position, [state](int res)
+                                                                 { state->fulfill(res); }))
             {
-                _values[item.first] = item.second;
+                return result;
             }
+#endif
+            return Promise<>::run([=]() -> int64_t
+                                  {
+                                      auto n = op == io_read ? sys_read(fd, buffer, length, position) : sys_write(fd, buffer, length, position);
+                                      return n < 0 ? -errno : n;
+                                  });
         }
 
-        template <typename K, typename V>
-        object<K, V>::object(const undefined_t &) : isUndefined(true)
+        namespace promises
         {
-        }
+            static std::shared_ptr<Promise<js::number>> open(js::string path, js::string flags = js::string(TXT("r")))
+            {
+                return Promise<>::run([=]()
+                                      { return openSync(path, flags); });
+            }
 
-        template <typename K, typename V>
-        void object<K, V>::Delete(js::any field)
-        {
-            _values.erase(field.operator std::string /*&*/());
-        }
+            static std::shared_ptr<Promise<void>> close(js::number fd)
+            {
+                return Promise<>::run([=]()
+                                      { closeSync(fd); });
+            }
+
+            static std::shared_ptr<Promise<std::shared_ptr<Stats>>> stat(js::string path)
+            {
+                return Promise<>::run([=]()
+                                      { return statSync(path); });
+            }
 
+            static std::shared_ptr<Promise<std::shared_ptr<array<js::string>>>> readdir(js::string path)
+            {
+                return Promise<>::run([=]()
+                                      { return readdirSync(path); });
+            }
+
+            static std::shared_ptr<Promise<js::number>> read(js::number fd, std::shared_ptr<ArrayBuffer> buffer, js::number offset = 0, js::number length = -1, js::number position = -1)
+            {
+                auto [start, count] = read_range(*buffer, offset, length);
+                auto n = co_await transfer(io_read, static_cast<int>(fd), buffer->_data.get() + start, count, static_cast<int64_t>(static_cast<double>(position)));
+                if (n < 0)
+                {
+                    throw_error(static_cast<int>(-n), "read");
+                }
+
+                co_return js::number(static_cast<double>(n));
+            }
+
+            static std::shared_ptr<Promise<js::number>> write(js::number fd, std::shared_ptr<ArrayBuffer> buffer, js::number position = -1)
+            {
+                auto n = co_await transfer(io_write, static_cast<int>(fd), buffer->_data.get(), buffer->_size, static_cast<int64_t>(static_cast<double>(position)));
+                if (n < 0)
+                {
+                    throw_error(static_cast<int>(-n), "write");
+                }
+
+                co_return js::number(static_cast<double>(n));
+            }
+
+            // reads at explicit offsets, growing storage the way read_all does
+            template <typename G>
+            static std::shared_ptr<Promise<size_t>> read_all(int fd, G grow)
+            {
+                auto hint = co_await Promise<>::run([=]()
+                                                    { return sys_size(fd); });
+                auto capacity = hint > 0 ? hint : size_t(4096);
+                auto base = grow(capacity);
+                size_t done = 0;
+                for (;;)
+                {
+                    if (done == capacity)
+                    {
+                        capacity *= 2;
+                        base = grow(capacity);
+                    }
+
+                    auto n = co_await transfer(io_read, fd, base + done, capacity - done, static_cast<int64_t>(done));
+                    if (n == 0)
+                    {
+                        break;
+                    }
+                    else if (n < 0)
+                    {
+                        if (n == -EINTR)
+                        {
+                            continue;
+                        }
+
+                        throw_error(static_cast<int>(-n), "read");
+                    }
+
+                    done += static_cast<size_t>(n);
+                    if (done == hint)
+                    {
+                        // regular file read whole, skip the EOF round trip
+                        break;
+                    }
+                }
+
+                co_return done;
+            }
+
+            static std::shared_ptr<Promise<void>> write_all(int fd, const uint8_t *data, size_t length)
+            {
+                size_t done = 0;
+                while (done < length)
+                {
+                    auto n = co_await transfer(io_write, fd, const_cast<uint8_t *>(data) + done, length - done, static_cast<int64_t>(done));
+                    if (n < 0)
+                    {
+                        if (n == -EINTR)
+                        {
+                            continue;
+                        }
+
+                        throw_error(static_cast<int>(-n), "write");
+                    }
+
+                    done += static_cast<size_t>(n);
+                }
+            }
+
+            static std::shared_ptr<Promise<std::shared_ptr<ArrayBuffer>>> readFile(js::string path)
+            {
+                auto fd = static_cast<int>(co_await open(path));
+                utils::finally close_fd([=]()
+                                        { sys_close(fd); });
+                auto buffer = std::make_shared<ArrayBuffer>();
+                auto grow = [=](size_t capacity)
+                { return buffer->_reserve(capacity); };
+                auto size = co_await read_all(fd, grow);
+                buffer->_resize(size);
+                co_return buffer;
+            }
+
+            template <typename E>
+            static std::shared_ptr<Promise<js::string>> readFile(js::string path, E)
+            {
+                auto fd = static_cast<int>(co_await open(path));
+                utils::finally close_fd([=]()
+                                        { sys_close(fd); });
+                auto bytes = std::make_shared<std::string>();
+                auto grow = [=](size_t capacity)
+                {
+                    bytes->resize(capacity);
+                    return reinterpret_cast<uint8_t *>(bytes->data());
+                };
+                auto size = co_await read_all(fd, grow);
+                bytes->resize(size);
+                co_return from_bytes(std::move(*bytes));
+            }
+
+            static std::shared_ptr<Promise<void>> writeFile(js::string path, js::string data)
+            {
+                auto fd = static_cast<int>(co_await open(path, js::string(TXT("w"))));
+                utils::finally close_fd([=]()
+                                        { sys_close(fd); });
+                auto bytes = to_bytes(data);
+                co_await write_all(fd, reinterpret_cast<const uint8_t *>(bytes.data()), bytes.size());
+            }
+
+            static std::shared_ptr<Promise<void>> writeFile(js::string path, std::shared_ptr<ArrayBuffer> data)
+            {
+                auto fd = static_cast<int>(co_await open(path, js::string(TXT("w"))));
+                utils::finally close_fd([=]()
+                                        { sys_close(fd); });
+                co_await write_all(fd, data->_data.get(), data->_size);
+            }
+        } // namespace promises
+    } // namespace fs
+
+    static struct math_t
+    {
+        static number E;
+        static number LN10;
+        static number LN2;
+        static number LOG2E;
+        static number LOG10E;
+        static number PI;
+        static number SQRT1_2;
+        static number SQRT2;
 
-        template <typename K, typename V>
-        ObjectKeys<js::string, typename object<K, V>::Cnt> object<K, V>::keys(const object<K, V> &obj)
+        constexpr math_t *operator->()
         {
-            return ObjectKeys<js::string, object<K, V>::Cnt>(obj->_values);
+            return this;
         }
 
-        template <typename K, typename V>
-        ObjectKeys<js::string, typename object<K, V>::Cnt> object<K, V>::keys()
+        static number pow(number op1, number op2)
         {
-            return ObjectKeys<js::string, object<K, V>::Cnt>(_values);
+            return number(std::pow(static_cast<double>(op1), static_cast<double>(op2)));
         }
 
-        template <typename K, typename V>
-        any &object<K, V>::operator[](js::number n) const
+        static number min(number op1, number op2)
         {
-            return mutable_(_values)[static_cast<std::string>(n)];
+            return number(std::min(static_cast<double>(op1), static_cast<double>(op2)));
         }
 
-        template <typename K, typename V>
-        any &object<K, V>::operator[](js::number n)
+        static number max(number op1, number op2)
         {
-            return _values[static_cast<std::string>(n)];
+            return number(std::max(static_cast<double>(op1), static_cast<double>(op2)));
         }
 
-        template <typename K, typename V>
-        any &object<K, V>::operator[](const char_t *s) const
+        static number sin(number op1)
         {
-            return mutable_(_values)[std::string(s)];
+            return number(std::sin(static_cast<double>(op1)));
         }
 
-        template <typename K, typename V>
-        any &object<K, V>::operator[](std::string s) const
+        static number cos(number op1)
         {
-            return mutable_(_values)[s];
+            return number(std::cos(static_cast<double>(op1)));
         }
 
-        template <typename K, typename V>
-        any &object<K, V>::operator[](js::string s) const
+        static number asin(number op1)
         {
-            return mutable_(_values)[(std::string)s];
+            return number(std::asin(static_cast<double>(op1)));
         }
 
-        template <typename K, typename V>
-        any &object<K, V>::operator[](const char_t *s)
+        static number acos(number op1)
         {
-            return _values[std::string(s)];
+            return number(std::acos(static_cast<double>(op1)));
         }
 
-        template <typename K, typename V>
-        any &object<K, V>::operator[](std::string s)
+        static number abs(number op1)
         {
-            return _values[s];
+            return number(std::abs(static_cast<double>(op1)));
         }
 
-        template <typename K, typename V>
-        any &object<K, V>::operator[](js::string s)
+        static number floor(number op1)
         {
-            return _values[(std::string)s];
+            return number(std::floor(static_cast<double>(op1)));
         }
 
-        template <typename K, typename V>
-        any &object<K, V>::operator[](undefined_t)
+        static number round(number op1, int numDecimalPlaces = 0)
         {
-            return _values["undefined"];
+            const auto mult = 10 ^ (numDecimalPlaces);
+            return number(std::floor(static_cast<double>(op1) * mult + 0.5) / mult);
         }
 
-    } // namespace tmpl
-
-    // typeof
-    template <>
-    string type_of(boolean value)
-    {
-        return STR("boolean");
-    }
-
-    template <>
-    string type_of(number value)
-    {
-        return STR("number");
-    }
-
-    template <>
-    string type_of(string value)
-    {
-        return STR("string");
-    }
-
-    template <>
-    string type_of(object value)
-    {
-        return STR("object");
-    }
-
-    template <>
-    string type_of(any value)
-    {
-        return value.type_of();
-    }
-
-    template <class T>
-    static any Void(T value)
-    {
-        return any();
-    }
-
-    template <typename I>
-    inline bool is(js::any t)
-    {
-        return false;
-    }
-
-    template <>
-    inline bool is<js::boolean>(js::any t)
-    {
-        return t && t.get_type() == any::anyTypeId::boolean_type;
-    }
-
-    template <>
-    inline bool is<js::number>(js::any t)
-    {
-        return t && t.get_type() == any::anyTypeId::number_type;
-    }
-
-    template <>
-    inline bool is<js::string>(js::any t)
-    {
-        return t && t.get_type() == any::anyTypeId::string_type;
-    }
-
-    template <>
-    inline bool is<js::array_any>(js::any t)
-    {
-        return t && t.get_type() == any::anyTypeId::array_type;
-    }
-
-    template <>
-    inline bool is<js::object>(js::any t)
-    {
-        return t && t.get_type() == any::anyTypeId::object_type;
-    }
-
-    template <>
-    inline bool is<js::function>(js::any t)
-    {
-        return t && t.get_type() == any::anyTypeId::function_type;
-    }
-
-    namespace utils
-    {
-
-        struct finally
-        {
-        private:
-            std::function<void()> _dtor;
-
-        public:
-            finally(std::function<void()> dtor) : _dtor(dtor){};
-            ~finally() { _dtor(); }
-        };
-
-        template <typename... Args>
-        object *assign(object *dst, const Args &...args)
+        static number sqrt(number op1)
         {
-            for (auto src : {args...})
-            {
-                for (auto &k : keys_(src))
-                {
-                    (*dst)[k] = (*const_(src))[k];
-                }
-            }
-
-            return dst;
+            return number(std::sqrt(static_cast<double>(op1)));
         }
 
-    }; // namespace Utils
-
-    template <typename V, class Ax = void>
-    requires has_exists_member<Ax>
-    constexpr bool in(V v, const Ax &a)
-    {
-        return a.exists(v);
-    }
-
-    template <typename V, class Ax = void>
-    requires has_exists_member<Ax>
-    constexpr bool in(V v, Ax *a)
-    {
-        return a->exists(v);
-    }
-
-    template <typename V, class O>
-    constexpr bool in(V v, O o)
-    {
-        return false;
-    }
-
-} // namespace js
-
-#ifdef UNICODE
-#define MAIN                                                             \
-    int wmain(int argc, char_t **argv)                                   \
-    {                                                                    \
-        try                                                              \
-        {                                                                \
-            Main();                                                      \
-        }                                                                \
-        catch (const js::string &s)                                      \
-        {                                                                \
-            std::wcout << TXT("Exception: ") << s << std::endl;          \
-        }                                                                \
-        catch (const js::any &a)                                         \
-        {                                                                \
-            std::wcout << TXT("Exception: ") << a << std::endl;          \
-        }                                                                \
-        catch (const std::exception &exception)                          \
-        {                                                                \
-            std::cout << "Exception: " << exception.what() << std::endl; \
-        }                                                                \
-        catch (const tstring &s)                                         \
-        {                                                                \
-            std::wcout << TXT("Exception: ") << s << std::endl;          \
-        }                                                                \
-        catch (const char_t *s)                                          \
-        {                                                                \
-            std::wcout << TXT("Exception: ") << s << std::endl;          \
-        }                                                                \
-        catch (...)                                                      \
-        {                                                                \
-            std::wcout << TXT("General failure.") << std::endl;          \
-        }                                                                \
-        return 0;                                                        \
-    }
-#else
-#define MAIN                                                             \
-    int main(int argc, char_t **argv)                                    \
-    {                                                                    \
-        try                                                              \
-        {                                                                \
-            Main();                                                      \
-        }                                                                \
-        catch (const js::string &s)                                      \
-        {                                                                \
-            std::cout << TXT("Exception: ") << s << std::endl;           \
-        }                                                                \
-        catch (const js::any &a)                                         \
-        {                                                                \
-            std::cout << TXT("Exception: ") << a << std::endl;           \
-        }                                                                \
-        catch (const std::exception &exception)                          \
-        {                                                                \
-            std::cout << "Exception: " << exception.what() << std::endl; \
-        }                                                                \
-        catch (const tstring &s)                                         \
-        {                                                                \
-            std::cout << TXT("Exception: ") << s << std::endl;           \
-        }                                                                \
-        catch (const char_t *s)                                          \
-        {                                                                \
-            std::cout << TXT("Exception: ") << s << std::endl;           \
-        }                                                                \
-        catch (...)                                                      \
-        {                                                                \
-            std::cout << TXT("General failure.") << std::endl;           \
-        }                                                                \
-        return 0;                                                        \
-    }
-#endif
+        static number tan(number op1)
+        {
+            return number(std::tan(static_cast<double>(op1)));
+        }
 
-// JS Core classes
-namespace js
-{
+        static number atan(number op1)
+        {
+            return number(std::atan(static_cast<double>(op1)));
+        }
 
-    template <class _Fn, class... _Args>
-    static void thread(_Fn f, _Args... args)
+        static number atan2(number op1, number op2)
+        {
+            return number(std::atan2(static_cast<double>(op1), static_cast<double>(op2)));
+        }
+
+        static number log(number op1)
+        {
+            return number(std::log(static_cast<double>(op1)));
+        }
+
+        static number exp(number op1)
+        {
+            return number(std::exp(static_cast<double>(op1)));
+        }
+
+        static number random()
+        {
+            std::default_random_engine generator;
+            std::uniform_real_distribution<double> distribution(0.0, 1.0);
+            auto rnd = distribution(generator);
+            return number(rnd);
+        }
+
+        static number sign(number op1)
+        {
+            auto d = static_cast<double>(op1);
+            return number(d < 0 ? -1 : d > 0 ? 1
+                                             : 0);
+        }
+    } Math;
+
+    static number E(2.718281828459045);
+    static number LN10(2.302585092994046);
+    static number LN2(0.6931471805599453);
+    static number LOG2E(1.4426950408889634);
+    static number LOG10E(0.4342944819032518);
+    static number PI(3.141592653589793);
+    static number SQRT1_2(0.7071067811865476);
+    static number SQRT2(1.4142135623730951);
+
+    template <typename I, class = std::enable_if_t<!std::is_enum_v<I> && !std::is_floating_point_v<I>>>
+    constexpr inline I pass(I i)
     {
-        new std::thread(f, args...);
+        return i;
     }
 
-    static void sleep(js::number n)
+    // raw doubles print with JS formatting rather than stream precision
+    template <typename I, class = std::enable_if_t<std::is_floating_point_v<I>>, class = void>
+    inline number pass(I i)
     {
-        std::this_thread::sleep_for(std::chrono::milliseconds(static_cast<size_t>(n)));
+        return number(i);
     }
 
-    static number parseInt(const js::string &value, int base = 10)
+    template <typename I, class = std::enable_if_t<std::is_enum_v<I>>>
+    constexpr inline size_t pass(I i)
     {
-        return number(std::stol(value._value, 0, base));
+        return static_cast<size_t>(i);
     }
 
-    static number parseFloat(const js::string &value)
+    // Console sink ///////////////////////////////////////////////////////////////////
+    // console.log formats a whole line and queues it in the calling thread's ring (one
+    // producer; whoever holds _write_lock is the only consumer), a writer thread gathers
+    // the rings into writev calls. Every record carries a number from one global counter
+    // and the rings are merged on it, so lines from different threads come out in the order
+    // they were logged. Policies: immediate writes before returning, line wakes
+    // the writer for every line, buffered wakes it once a ring holds `bytes` or after
+    // `interval`. stderr stays unbuffered and drains stdout first, so 2>&1 keeps order.
+    // Policy: set_policy() or TSCXX_CONSOLE=immediate|line|buffered[:bytes[:ms]]; the
+    // default is line on a terminal and buffered otherwise.
+    struct console_sink_t;
+    inline console_sink_t &console_sink();
+
+    enum class flush_policy
     {
-        auto r = NaN;
-        try
+        immediate,
+        line,
+        buffered
+    };
+
+    struct console_sink_t
+    {
+        struct ring_t
         {
-            r = number(std::stod(value._value, 0));
-        }
-        catch (const std::exception &)
+            static constexpr size_t capacity = 64 * 1024;
+
+            std::unique_ptr<char[]> data{new char[capacity]};
+            std::atomic<size_t> head{0};
+            std::atomic<size_t> tail{0};
+            std::atomic<bool> detached{false};
+        };
+
+        // owned by the producing thread, lets the writer reclaim the ring after it exits
+        struct producer_t
         {
-        }
+            std::shared_ptr<ring_t> ring;
 
-        return r;
-    }
+            ~producer_t()
+            {
+                if (ring)
+                {
+                    ring->detached = true;
+                }
+            }
+        };
 
-    static object Object;
+        struct segment_t
+        {
+            const char *data;
+            size_t size;
+        };
 
-    static string String;
+        // read position of one ring while draining
+        struct cursor_t
+        {
+            ring_t *ring;
+            size_t tail;
+        };
 
-    template <typename T>
-    using ReadonlyArray = tmpl::array<T>;
+        // a record is its sequence number and text size followed by the text
+        static constexpr size_t header_size = sizeof(uint64_t) + sizeof(uint32_t);
 
-    template <typename T>
-    using Array = tmpl::array<T>;
+        inline static std::terminate_handler previous_terminate = nullptr;
 
-    struct Date
-    {
-        number getHours()
+        std::mutex _write_lock;
+        std::mutex _rings_lock;
+        std::vector<std::shared_ptr<ring_t>> _rings;
+        std::vector<segment_t> _segments;
+        std::vector<cursor_t> _cursors;
+        // next number to hand out / next number to write (under _write_lock)
+        std::atomic<uint64_t> _sequence{0};
+        uint64_t _written = 0;
+        std::thread _writer;
+        std::mutex _wake_lock;
+        std::condition_variable _wake;
+        std::atomic<bool> _pending{false};
+        std::atomic<bool> _started{false};
+        std::atomic<bool> _stopping{false};
+        std::atomic<flush_policy> _policy;
+        std::atomic<size_t> _bytes{ring_t::capacity / 2};
+        std::chrono::milliseconds _interval{100};
+
+        console_sink_t() : _policy(is_terminal(1) ? flush_policy::line : flush_policy::buffered)
         {
-            return number(0);
+            if (auto env = std::getenv("TSCXX_CONSOLE"))
+            {
+                configure(env);
+            }
+
+            previous_terminate = std::set_terminate([]() {
+                console_sink().flush(false);
+                if (previous_terminate)
+                {
+                    previous_terminate();
+                }
+
+                std::abort();
+            });
         }
 
-        number getMinutes()
+        ~console_sink_t()
         {
-            return number(0);
+            shutdown();
         }
 
-        number getSeconds()
+        static bool is_terminal(int fd)
         {
-            return number(0);
+#ifdef _WIN32
+            return _isatty(fd) != 0;
+#else
+            return isatty(fd) != 0;
+#endif
         }
-    };
 
-    typedef any Action;
+        // "immediate", "line" or "buffered[:bytes[:ms]]"
+        void configure(std::string_view value)
+        {
+            auto name = value.substr(0, value.find(':'));
+            if (name == "immediate")
+            {
+                set_policy(flush_policy::immediate);
+            }
+            else if (name == "line")
+            {
+                set_policy(flush_policy::line);
+            }
+            else if (name == "buffered")
+            {
+                size_t bytes = _bytes;
+                size_t interval = _interval.count();
+                auto options = std::string(value.substr(name.size()));
+                std::sscanf(options.c_str(), ":%zu:%zu", &bytes, &interval);
+                set_policy(flush_policy::buffered, bytes, std::chrono::milliseconds(interval));
+            }
+        }
 
-    typedef any Function;
+        // the interval takes effect from the writer's next wait
+        void set_policy(flush_policy policy, size_t bytes = ring_t::capacity / 2, std::chrono::milliseconds interval = std::chrono::milliseconds(100))
+        {
+            {
+                std::lock_guard<std::mutex> guard(_wake_lock);
+                _bytes = std::clamp<size_t>(bytes, 1, ring_t::capacity);
+                _interval = std::max(interval, std::chrono::milliseconds(1));
+            }
 
-    struct RegExp
-    {
+            _policy = policy;
+            flush();
+        }
 
-#ifdef UNICODE
-        std::wregex re;
-#else
-        std::regex re;
-#endif
+        flush_policy policy() const
+        {
+            return _policy;
+        }
+
+        // text is one or more complete lines
+        void write(int fd, std::string_view text)
+        {
+            if (fd != 1)
+            {
+                std::lock_guard<std::mutex> guard(_write_lock);
+                drain();
+                write_all(fd, {{text.data(), text.size()}});
+                return;
+            }
+
+            auto &ring = local_ring();
+            if (!push(ring, text))
+            {
+                // full: drain in place, lines larger than the ring bypass it
+                std::lock_guard<std::mutex> guard(_write_lock);
+                drain();
+                if (!push(ring, text))
+                {
+                    write_all(fd, {{text.data(), text.size()}});
+                    return;
+                }
+            }
+
+            switch (_policy.load(std::memory_order_relaxed))
+            {
+            case flush_policy::immediate:
+                flush();
+                break;
+            case flush_policy::line:
+                wake();
+                break;
+            case flush_policy::buffered:
+                if (ring.head.load(std::memory_order_relaxed) - ring.tail.load(std::memory_order_relaxed) >= _bytes.load(std::memory_order_relaxed))
+                {
+                    wake();
+                }
 
-        RegExp(js::string pattern) : re((const char_t *)pattern)
+                break;
+            }
+        }
+
+        // writes everything queued so far; wait = false gives up if another thread is writing
+        void flush(bool wait = true)
         {
+            std::unique_lock<std::mutex> guard(_write_lock, std::defer_lock);
+            if (wait)
+            {
+                guard.lock();
+            }
+            else if (!guard.try_lock())
+            {
+                return;
+            }
+
+            drain();
         }
 
-        js::boolean test(js::string val)
+        void shutdown()
         {
-            try
+            if (!_stopping.exchange(true))
             {
-                if (std::regex_search((const char_t *)val, re))
                 {
-                    return true;
+                    std::lock_guard<std::mutex> guard(_wake_lock);
+                }
+
+                _wake.notify_one();
+                if (_writer.joinable())
+                {
+                    _writer.join();
                 }
             }
-            catch (std::regex_error &)
+
+            flush();
+        }
+
+    private:
+        ring_t &local_ring()
+        {
+            thread_local producer_t producer;
+            if (!producer.ring)
             {
+                producer.ring = std::make_shared<ring_t>();
+                std::lock_guard<std::mutex> guard(_rings_lock);
+                _rings.push_back(producer.ring);
             }
 
-            return false;
+            return *producer.ring;
         }
-    };
 
-    template <typename T>
-    struct TypedArray : public Array<T>
-    {
-        typedef Array<T> super__;
-        js::number _length;
+        bool push(ring_t &ring, std::string_view text)
+        {
+            auto head = ring.head.load(std::memory_order_relaxed);
+            auto tail = ring.tail.load(std::memory_order_acquire);
+            if (ring_t::capacity - (head - tail) < header_size + text.size())
+            {
+                return false;
+            }
 
-        TypedArray(js::number length_) : super__()
+            // taken only once the record fits, so every number drain() waits for gets published
+            uint64_t sequence = _sequence.fetch_add(1, std::memory_order_relaxed);
+            uint32_t size = static_cast<uint32_t>(text.size());
+            copy_in(ring, head, &sequence, sizeof(sequence));
+            copy_in(ring, head + sizeof(sequence), &size, sizeof(size));
+            copy_in(ring, head + header_size, text.data(), text.size());
+            ring.head.store(head + header_size + text.size(), std::memory_order_release);
+            return true;
+        }
+
+        static void copy_in(ring_t &ring, size_t position, const void *source, size_t size)
         {
-            _length = length_;
+            auto offset = position % ring_t::capacity;
+            auto first = std::min(size, ring_t::capacity - offset);
+            std::memcpy(ring.data.get() + offset, source, first);
+            std::memcpy(ring.data.get(), static_cast<const char *>(source) + first, size - first);
         }
-    };
 
-    struct Int16Array : TypedArray<short>
-    {
-        Int16Array(js::number length_) : TypedArray(length_)
+        static void copy_out(const ring_t &ring, size_t position, void *target, size_t size)
         {
+            auto offset = position % ring_t::capacity;
+            auto first = std::min(size, ring_t::capacity - offset);
+            std::memcpy(target, ring.data.get() + offset, first);
+            std::memcpy(static_cast<char *>(target) + first, ring.data.get(), size - first);
         }
-    };
 
-    struct Uint16Array : TypedArray<unsigned short>
-    {
-        Uint16Array(js::number length_) : TypedArray(length_)
+        void add_segment(const char *data, size_t size)
         {
+            if (size > 0)
+            {
+                _segments.push_back({data, size});
+            }
         }
-    };
 
-    struct Float32Array : TypedArray<float>
-    {
-        Float32Array(js::number length_) : TypedArray(length_)
+        void wake()
         {
+            start();
+            if (!_pending.exchange(true))
+            {
+                {
+                    std::lock_guard<std::mutex> guard(_wake_lock);
+                }
+
+                _wake.notify_one();
+            }
         }
-    };
 
-    struct Float64Array : TypedArray<double>
-    {
-        Float64Array(js::number length_) : TypedArray(length_)
+        void start()
         {
+            if (_started.load(std::memory_order_relaxed) || _stopping)
+            {
+                return;
+            }
+
+            std::lock_guard<std::mutex> guard(_wake_lock);
+            if (!_started.exchange(true))
+            {
+                _writer = std::thread([this]() {
+                    std::unique_lock<std::mutex> lock(_wake_lock);
+                    while (!_stopping)
+                    {
+                        _wake.wait_for(lock, _interval, [this]() { return _pending || _stopping; });
+                        _pending = false;
+                        lock.unlock();
+                        flush();
+                        lock.lock();
+                    }
+                });
+            }
         }
-    };
 
-    struct Int32Array : TypedArray<int>
-    {
-        Int32Array(js::number length_) : TypedArray(length_)
+        // caller holds _write_lock. Writes every record numbered before the counter's value on
+        // entry, in number order; a number can be taken but its record not yet published, then
+        // the producer is between fetch_add and its head store and the wait is short
+        void drain()
         {
+            std::lock_guard<std::mutex> guard(_rings_lock);
+            // read under _rings_lock: the ring of every number below it is registered
+            auto issued = _sequence.load(std::memory_order_acquire);
+            _segments.clear();
+            _cursors.clear();
+            for (auto &ring : _rings)
+            {
+                _cursors.push_back({ring.get(), ring->tail.load(std::memory_order_relaxed)});
+            }
+
+            while (_written != issued)
+            {
+                auto found = false;
+                for (auto &cursor : _cursors)
+                {
+                    if (cursor.tail == cursor.ring->head.load(std::memory_order_acquire))
+                    {
+                        continue;
+                    }
+
+                    uint64_t sequence;
+                    copy_out(*cursor.ring, cursor.tail, &sequence, sizeof(sequence));
+                    if (sequence != _written)
+                    {
+                        continue;
+                    }
+
+                    uint32_t size;
+                    copy_out(*cursor.ring, cursor.tail + sizeof(sequence), &size, sizeof(size));
+                    auto offset = (cursor.tail + header_size) % ring_t::capacity;
+                    auto first = std::min<size_t>(size, ring_t::capacity - offset);
+                    add_segment(cursor.ring->data.get() + offset, first);
+                    add_segment(cursor.ring->data.get(), size - first);
+                    cursor.tail += header_size + size;
+                    _written++;
+                    found = true;
+                    break;
+                }
+
+                if (!found)
+                {
+                    std::this_thread::yield();
+                }
+            }
+
+            write_all(1, _segments);
+
+            for (auto &cursor : _cursors)
+            {
+                cursor.ring->tail.store(cursor.tail, std::memory_order_release);
+            }
+
+            _rings.erase(std::remove_if(_rings.begin(), _rings.end(), [](auto &ring) {
+                             return ring->detached && ring->head.load(std::memory_order_acquire) == ring->tail.load(std::memory_order_relaxed);
+                         }),
+                         _rings.end());
         }
-    };
 
-    struct Uint32Array : TypedArray<unsigned int>
-    {
-        Uint32Array(js::number length_) : TypedArray(length_)
+        static void write_all(int fd, const std::vector<segment_t> &segments)
         {
+#ifdef _WIN32
+            for (auto &segment : segments)
+            {
+                for (size_t written = 0; written < segment.size;)
+                {
+                    auto result = _write(fd, segment.data + written, static_cast<unsigned>(segment.size - written));
+                    if (result <= 0)
+                    {
+                        return;
+                    }
+
+                    written += result;
+                }
+            }
+#else
+            std::vector<iovec> vectors;
+            vectors.reserve(segments.size());
+            for (auto &segment : segments)
+            {
+                vectors.push_back({const_cast<char *>(segment.data), segment.size});
+            }
+
+            for (size_t index = 0; index < vectors.size();)
+            {
+                auto count = static_cast<int>(std::min<size_t>(vectors.size() - index, IOV_MAX));
+                auto result = ::writev(fd, vectors.data() + index, count);
+                if (result < 0)
+                {
+                    if (errno == EINTR)
+                    {
+                        continue;
+                    }
+
+                    return;
+                }
+
+                if (result == 0)
+                {
+                    return;
+                }
+
+                // partial writes resume mid-vector
+                auto written = static_cast<size_t>(result);
+                for (; written > 0 && written >= vectors[index].iov_len; index++)
+                {
+                    written -= vectors[index].iov_len;
+                }
+
+                if (written > 0)
+                {
+                    vectors[index].iov_base = static_cast<char *>(vectors[index].iov_base) + written;
+                    vectors[index].iov_len -= written;
+                }
+            }
+#endif
         }
     };
 
-    struct Int64Array : TypedArray<long long>
+    inline console_sink_t &console_sink()
     {
-        Int64Array(js::number length_) : TypedArray(length_)
-        {
-        }
-    };
+        static console_sink_t instance;
+        return instance;
+    }
 
-    struct Uint64Array : TypedArray<unsigned long long>
+    static struct Console
     {
-        Uint64Array(js::number length_) : TypedArray(length_)
+#ifndef UNICODE
+        // appends to a reused string, so formatting a line does not allocate once warm
+        struct line_buffer : std::streambuf
         {
-        }
-    };
+            std::string text;
 
-    struct ArrayBuffer
-    {
-    };
+            int_type overflow(int_type c) override
+            {
+                if (c != traits_type::eof())
+                {
+                    text.push_back(static_cast<char>(c));
+                }
 
-    struct ArrayBufferView
-    {
-    };
+                return c;
+            }
 
-    template <typename T>
-    struct Promise
-    {
-        static void all()
+            std::streamsize xsputn(const char *s, std::streamsize n) override
+            {
+                text.append(s, static_cast<size_t>(n));
+                return n;
+            }
+        };
+
+        template <class... Args>
+        static void write(int fd, Args &&...args)
         {
+            thread_local line_buffer buffer;
+            thread_local std::ostream stream(&buffer);
+            stream << std::boolalpha;
+            buffer.text.clear();
+            auto dummy = {(stream << pass(args), 0)...};
+            buffer.text.push_back('\n');
+            console_sink().write(fd, buffer.text);
         }
+#endif
 
-        void _catch()
+        Console()
         {
+#ifdef UNICODE
+            std::wcout << std::boolalpha;
+#else
+            std::cout << std::boolalpha;
+#endif
         }
 
-        void finally()
+        constexpr Console *operator->()
         {
+            return this;
         }
 
-        void then()
+        template <class... Args>
+        void log(Args &&...args)
         {
+#ifdef UNICODE
+            auto dummy = {(std::wcout << pass(args), 0)...};
+            std::wcout << std::endl;
+#else
+            write(1, args...);
+#endif
         }
 
-        static void race()
+        template <class... Args>
+        void warn(Args &&...args)
         {
+#ifdef UNICODE
+            auto dummy = {(std::wclog << pass(args), 0)...};
+            std::wclog << std::endl;
+#else
+            write(2, args...);
+#endif
         }
 
-        static void reject()
+        template <class... Args>
+        void error(Args &&...args)
         {
+#ifdef UNICODE
+            auto dummy = {(std::wcerr << pass(args), 0)...};
+            std::wcerr << std::endl;
+#else
+            write(2, args...);
+#endif
         }
 
-        static void resolve()
+        template <class... Args>
+        void debug(Args &&...args)
         {
+#ifdef UNICODE
+            auto dummy = {(std::wclog << pass(args), 0)...};
+            std::wclog << std::endl;
+#else
+            write(2, args...);
+#endif
         }
-    };
 
-    static struct math_t
+    } console;
+
+    // Binary log ///////////////////////////////////////////////////////////////////////
+    // tsc-cxx -binary_log turns console.* calls into binlog::write(site, level, args...):
+    // string and number literals live in the emitted <file>.binlog.json site table, only
+    // the remaining values are written. A record is
+    //   magic 1e 62 6c 01, u32 size, u32 ~size, then size bytes of payload:
+    //     u32 site, u8 level, u64 unix time in ns, then per argument a tag and its
+    //     payload (f64 numbers, u32 size + UTF-8 for strings and text)
+    //   and a closing 0x1f
+    // little endian, queued on the console sink next to text output. tsc-cxx-logdecode
+    // prints it back as console text; bytes outside records, and anything that looks
+    // like a record but fails the size checks, pass through unchanged.
+    namespace binlog
     {
-        static number E;
-        static number LN10;
-        static number LN2;
-        static number LOG2E;
-        static number LOG10E;
-        static number PI;
-        static number SQRT1_2;
-        static number SQRT2;
+        constexpr char record_magic[] = {0x1e, 0x62, 0x6c, 0x01};
+        constexpr char record_end = 0x1f;
 
-        constexpr math_t *operator->()
+        enum class level : uint8_t
         {
-            return this;
-        }
+            log,
+            warn,
+            error,
+            debug
+        };
 
-        static number pow(number op1, number op2)
+        enum tag : uint8_t
         {
-            return number(std::pow(static_cast<double>(op1), static_cast<double>(op2)));
-        }
+            tag_undefined,
+            tag_null,
+            tag_false,
+            tag_true,
+            tag_number,
+            tag_string,
+            // anything else, formatted as console.log would
+            tag_text
+        };
 
-        static number min(number op1, number op2)
+        template <typename V>
+        inline void put(std::string &out, V value)
         {
-            return number(std::min(static_cast<double>(op1), static_cast<double>(op2)));
+            static_assert(std::endian::native == std::endian::little, "binary log records are little endian");
+            out.append(reinterpret_cast<const char *>(&value), sizeof(value));
         }
 
-        static number max(number op1, number op2)
+        inline void put_text(std::string &out, tag type, std::basic_string_view<char_t> text)
         {
-            return number(std::max(static_cast<double>(op1), static_cast<double>(op2)));
-        }
+            out.push_back(type);
+#ifdef UNICODE
+            std::string utf8;
+            if constexpr (sizeof(char_t) == sizeof(char16_t))
+            {
+                utf8 = utf::to_utf8(std::u16string_view(reinterpret_cast<const char16_t *>(text.data()), text.size()));
+            }
+            else
+            {
+                // UTF-32 wchar_t: characters outside the BMP do not fit a char16_t
+                for (auto c : text)
+                {
+                    utf::append_code_point(utf8, static_cast<uint32_t>(c));
+                }
+            }
 
-        static number sin(number op1)
-        {
-            return number(std::sin(static_cast<double>(op1)));
+            put(out, static_cast<uint32_t>(utf8.size()));
+            out.append(utf8);
+#else
+            put(out, static_cast<uint32_t>(text.size()));
+            out.append(text);
+#endif
         }
 
-        static number cos(number op1)
+        inline void encode(std::string &out, const undefined_t &)
         {
-            return number(std::cos(static_cast<double>(op1)));
+            out.push_back(tag_undefined);
         }
 
-        static number asin(number op1)
+        inline void encode(std::string &out, const boolean &value)
         {
-            return number(std::asin(static_cast<double>(op1)));
+            out.push_back(value._control == boolean::boolean_undefined ? tag_undefined : value._control == boolean::boolean_true ? tag_true : tag_false);
         }
 
-        static number acos(number op1)
+        inline void encode(std::string &out, bool value)
         {
-            return number(std::acos(static_cast<double>(op1)));
+            out.push_back(value ? tag_true : tag_false);
         }
 
-        static number abs(number op1)
+        template <typename V>
+        requires std::is_arithmetic_v<V> || std::is_enum_v<V>
+        inline void encode(std::string &out, V value)
         {
-            return number(std::abs(static_cast<double>(op1)));
+            out.push_back(tag_number);
+            put(out, static_cast<double>(value));
         }
 
-        static number floor(number op1)
+        template <typename V>
+        inline void encode(std::string &out, tmpl::number<V> value)
         {
-            return number(std::floor(static_cast<double>(op1)));
-        }
+            if (value.is_undefined())
+            {
+                out.push_back(tag_undefined);
+                return;
+            }
 
-        static number round(number op1, int numDecimalPlaces = 0)
-        {
-            const auto mult = 10 ^ (numDecimalPlaces);
-            return number(std::floor(static_cast<double>(op1) * mult + 0.5) / mult);
+            out.push_back(tag_number);
+            put(out, static_cast<double>(value._value));
         }
 
-        static number sqrt(number op1)
+        template <typename T>
+        inline void encode(std::string &out, const tmpl::string<T> &value)
         {
-            return number(std::sqrt(static_cast<double>(op1)));
-        }
+            if (value.is_undefined() || value.is_null())
+            {
+                out.push_back(value.is_null() ? tag_null : tag_undefined);
+                return;
+            }
 
-        static number tan(number op1)
-        {
-            return number(std::tan(static_cast<double>(op1)));
+            put_text(out, tag_string, value._value);
         }
 
-        static number atan(number op1)
+        inline void encode(std::string &out, const char_t *value)
         {
-            return number(std::atan(static_cast<double>(op1)));
+            put_text(out, tag_string, value);
         }
 
-        static number atan2(number op1, number op2)
+        template <typename V>
+        requires(!std::is_arithmetic_v<V> && !std::is_enum_v<V>)
+        inline void encode(std::string &out, const V &value)
         {
-            return number(std::atan2(static_cast<double>(op1), static_cast<double>(op2)));
+            thread_local tostringstream text;
+            text.str(tstring());
+            text << std::boolalpha << pass(value);
+            put_text(out, tag_text, text.str());
         }
 
-        static number log(number op1)
+        template <class... Args>
+        inline void write(uint32_t site, level severity, Args &&...args)
+        {
+            thread_local std::string record;
+            record.clear();
+            record.append(record_magic, sizeof(record_magic));
+            put(record, uint32_t(0));
+            put(record, uint32_t(0));
+            put(record, site);
+            put(record, static_cast<uint8_t>(severity));
+            put(record, static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count()));
+            (encode(record, args), ...);
+            constexpr auto header = sizeof(record_magic) + 2 * sizeof(uint32_t);
+            auto size = static_cast<uint32_t>(record.size() - header);
+            auto check = ~size;
+            std::memcpy(record.data() + sizeof(record_magic), &size, sizeof(size));
+            std::memcpy(record.data() + sizeof(record_magic) + sizeof(size), &check, sizeof(check));
+            record.push_back(record_end);
+            console_sink().write(1, record);
+        }
+    } // namespace binlog
+
+    // Profiler /////////////////////////////////////////////////////////////////////////
+    // tsc-cxx -instrument opens a profile::scope at the top of every function body. Each
+    // thread records into its own call tree: entering a function looks its site up among
+    // the children of the current node, no locks or atomics are involved. MAIN writes the
+    // trees of all threads as collapsed stacks ("Main;f (a.ts:3);g (a.ts:9) <self ticks>")
+    // to profile.folded, or to the file TSCXX_PROFILE names, for flamegraph.pl or
+    // speedscope. Ticks are TSC cycles on x86 and steady_clock nanoseconds elsewhere, only
+    // their ratios matter for a flame graph.
+    namespace profile
+    {
+        struct site
         {
-            return number(std::log(static_cast<double>(op1)));
-        }
+            const char *name;
+        };
 
-        static number exp(number op1)
+        inline uint64_t ticks()
         {
-            return number(std::exp(static_cast<double>(op1)));
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+            return __rdtsc();
+#else
+            return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
         }
 
-        static number random()
+        struct node
         {
-            std::default_random_engine generator;
-            std::uniform_real_distribution<double> distribution(0.0, 1.0);
-            auto rnd = distribution(generator);
-            return number(rnd);
-        }
+            const site *_site;
+            uint32_t _parent;
+            // 0 ends the list, node 0 is the root and never anybody's child
+            uint32_t _first_child;
+            uint32_t _next_sibling;
+            uint64_t _calls;
+            uint64_t _ticks;
+        };
 
-        static number sign(number op1)
+        struct call_tree
         {
-            auto d = static_cast<double>(op1);
-            return number(d < 0 ? -1 : d > 0 ? 1
-                                             : 0);
-        }
-    } Math;
+            std::vector<node> _nodes{node{nullptr, 0, 0, 0, 0, 0}};
+            uint32_t _current = 0;
 
-    static number E(2.718281828459045);
-    static number LN10(2.302585092994046);
-    static number LN2(0.6931471805599453);
-    static number LOG2E(1.4426950408889634);
-    static number LOG10E(0.4342944819032518);
-    static number PI(3.141592653589793);
-    static number SQRT1_2(0.7071067811865476);
-    static number SQRT2(1.4142135623730951);
+            uint32_t enter(const site &at)
+            {
+                auto index = _nodes[_current]._first_child;
+                while (index && _nodes[index]._site != &at)
+                {
+                    index = _nodes[index]._next_sibling;
+                }
 
-    template <typename I, class = std::enable_if_t<!std::is_enum_v<I>>>
-    constexpr inline I pass(I i)
-    {
-        return i;
-    }
+                if (!index)
+                {
+                    index = static_cast<uint32_t>(_nodes.size());
+                    _nodes.push_back(node{&at, _current, 0, _nodes[_current]._first_child, 0, 0});
+                    _nodes[_current]._first_child = index;
+                }
 
-    template <typename I, class = std::enable_if_t<std::is_enum_v<I>>>
-    constexpr inline size_t pass(I i)
-    {
-        return static_cast<size_t>(i);
-    }
+                _current = index;
+                return index;
+            }
 
-    static struct Console
-    {
-        Console()
-        {
-#ifdef UNICODE
-            std::wcout << std::boolalpha;
-#else
-            std::cout << std::boolalpha;
-#endif
-        }
+            void leave(uint32_t index, uint64_t elapsed)
+            {
+                auto &left = _nodes[index];
+                left._calls++;
+                left._ticks += elapsed;
+                _current = left._parent;
+            }
+        };
 
-        constexpr Console *operator->()
+        struct registry_t
         {
-            return this;
-        }
+            std::mutex _lock;
+            std::vector<std::unique_ptr<call_tree>> _trees;
+        };
 
-        template <class... Args>
-        void log(Args &&...args)
+        inline registry_t &registry()
         {
-#ifdef UNICODE
-            auto dummy = {(std::wcout << pass(args), 0)...};
-            std::wcout << std::endl;
-#else
-            auto dummy = {(std::cout << pass(args), 0)...};
-            std::cout << std::endl;
-#endif
+            static registry_t registry;
+            return registry;
         }
 
-        template <class... Args>
-        void warn(Args &&...args)
+        // trees belong to the registry, so they outlive the threads that recorded them
+        inline call_tree &this_thread()
         {
-#ifdef UNICODE
-            auto dummy = {(std::wclog << pass(args), 0)...};
-            std::wclog << std::endl;
-#else
-            auto dummy = {(std::clog << pass(args), 0)...};
-            std::clog << std::endl;
-#endif
+            thread_local call_tree *tree = []()
+            {
+                auto &all = registry();
+                std::lock_guard<std::mutex> guard(all._lock);
+                all._trees.push_back(std::make_unique<call_tree>());
+                return all._trees.back().get();
+            }();
+            return *tree;
         }
 
-        template <class... Args>
-        void error(Args &&...args)
+        struct scope
         {
-#ifdef UNICODE
-            auto dummy = {(std::wcerr << pass(args), 0)...};
-            std::wcerr << std::endl;
-#else
-            auto dummy = {(std::cerr << pass(args), 0)...};
-            std::cerr << std::endl;
-#endif
-        }
+            call_tree &_tree;
+            uint32_t _index;
+            uint64_t _start;
 
-        template <class... Args>
-        void debug(Args &&...args)
+            explicit scope(const site &at) : _tree(this_thread()), _index(_tree.enter(at)), _start(ticks())
+            {
+            }
+
+            ~scope()
+            {
+                _tree.leave(_index, ticks() - _start);
+            }
+
+            scope(const scope &) = delete;
+            scope &operator=(const scope &) = delete;
+        };
+
+        // called by MAIN once the executor has stopped; stacks recorded by several threads
+        // are added up, a program built without -instrument has no trees and writes nothing
+        inline void dump()
         {
-#ifdef UNICODE
-            auto dummy = {(std::wclog << pass(args), 0)...};
-            std::wclog << std::endl;
-#else
-            auto dummy = {(std::clog << pass(args), 0)...};
-            std::clog << std::endl;
-#endif
-        }
+            auto &all = registry();
+            std::lock_guard<std::mutex> guard(all._lock);
+            std::map<std::string, uint64_t> stacks;
+            for (auto &tree : all._trees)
+            {
+                auto &nodes = tree->_nodes;
+                // children are always added after their parent
+                std::vector<std::string> paths(nodes.size());
+                std::vector<uint64_t> children(nodes.size());
+                for (size_t index = 1; index < nodes.size(); index++)
+                {
+                    children[nodes[index]._parent] += nodes[index]._ticks;
+                }
 
-    } console;
+                for (size_t index = 1; index < nodes.size(); index++)
+                {
+                    auto &parent = paths[nodes[index]._parent];
+                    paths[index] = parent.empty() ? nodes[index]._site->name : parent + ';' + nodes[index]._site->name;
+                    // a scope still open has no ticks yet, its callees may have
+                    if (nodes[index]._ticks > children[index])
+                    {
+                        stacks[paths[index]] += nodes[index]._ticks - children[index];
+                    }
+                }
+            }
+
+            if (stacks.empty())
+            {
+                return;
+            }
+
+            auto env = std::getenv("TSCXX_PROFILE");
+            std::ofstream out(env ? env : "profile.folded");
+            for (auto &[stack, self] : stacks)
+            {
+                out << stack << ' ' << self << '\n';
+            }
+        }
+    } // namespace profile
 
     struct XMLHttpRequest
     {
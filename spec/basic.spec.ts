@@ -90,4 +90,12 @@ describe('Test 1', () => {
             x = "Hello World!";                 \
             console.log(x);                     \
         '])));
+
+    it('buffered console output precedes uncaught exception', () => expect(new Run().test([
+        '                                       \
+            for (let i = 0; i < 3; i++) {       \
+                console.log(i);                 \
+            }                                   \
+            throw "stop";                       \
+        '])).to.equals('0\r\n1\r\n2\r\nException: stop\r\n'));
 });
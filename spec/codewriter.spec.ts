@@ -0,0 +1,33 @@
+import { CodeWriter } from '../src/codewriter';
+import { expect } from 'chai';
+import { describe, it } from 'mocha';
+
+describe('CodeWriter', () => {
+
+    it('rolls back an empty section across a sealed chunk', () => {
+        const writer = new CodeWriter();
+        writer.mapSource(0, 0);
+        writer.writeStringNewLine('int a;');
+        const text = writer.getText();
+        const mappings = writer.getMappings().length;
+
+        const rollbackPosition = writer.newSection();
+        writer.mapSource(1, 0);
+        writer.newSection();
+        for (let i = 0; i < 5000; i++) {
+            writer.writeString('x');
+        }
+
+        const point = writer.newSection();
+        expect(writer.hasAnyContent(point, rollbackPosition)).to.equals(false);
+        expect(writer.getText()).to.equals(text);
+        expect(writer.getMappings().length).to.equals(mappings);
+        expect([...writer['marks'].keys()].filter(position => position > rollbackPosition)).to.be.empty;
+
+        writer.mapSource(2, 0);
+        writer.writeStringNewLine('int b;');
+        expect(writer.getText()).to.equals('int a;\nint b;\n');
+        expect(writer.getMappings().map(mapping => mapping.offset)).to.deep.equal([0, 7]);
+    });
+
+});
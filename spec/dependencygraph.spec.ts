@@ -0,0 +1,28 @@
+import { DependencyGraph } from '../src/dependencygraph';
+import { expect } from 'chai';
+import { describe, it } from 'mocha';
+import * as ts from 'typescript';
+import * as fs from 'fs-extra';
+import * as os from 'os';
+import * as path from 'path';
+
+describe('DependencyGraph', () => {
+
+    it('finds importers', () => {
+        const folder = fs.mkdtempSync(path.join(os.tmpdir(), 'tsc-cxx-')).replace(/\\/g, '/');
+        fs.writeFileSync(folder + '/shape.ts', 'export class Shape { }');
+        fs.writeFileSync(folder + '/circle.ts', 'import { Shape } from "./shape"; export class Circle extends Shape { }');
+        fs.writeFileSync(folder + '/main.ts', 'export * from "./circle"; console.log(1);');
+        const program = ts.createProgram([folder + '/main.ts'], {});
+        const sourceFiles = program.getSourceFiles().filter(s => s.fileName.startsWith(folder));
+
+        const graph = new DependencyGraph();
+        graph.update(program, sourceFiles);
+        expect(graph.importersOf(folder + '/shape.ts')).to.deep.equals([folder + '/circle.ts']);
+        expect(graph.importersOf(folder + '/circle.ts')).to.deep.equals([folder + '/main.ts']);
+        expect(graph.importersOf(folder + '/main.ts')).to.deep.equals([]);
+
+        fs.removeSync(folder);
+    });
+
+});
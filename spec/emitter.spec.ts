@@ -0,0 +1,61 @@
+import { Emitter } from '../src/emitter';
+import { expect } from 'chai';
+import { describe, it } from 'mocha';
+import * as ts from 'typescript';
+import * as fs from 'fs-extra';
+import * as os from 'os';
+import * as path from 'path';
+
+describe('Emitter', () => {
+
+    it('header and source passes of one emitter match two fresh emitters', () => {
+        const folder = fs.mkdtempSync(path.join(os.tmpdir(), 'tsc-cxx-'));
+        const fileName = path.join(folder, 'a.ts');
+        fs.writeFileSync(fileName, [
+            'namespace Shapes {',
+            '    export class Point {',
+            '        constructor(public x: number, public y: number) {}',
+            '        length(): number { return Math.sqrt(this.x * this.x + this.y * this.y); }',
+            '    }',
+            '    export const origin = new Point(0, 0);',
+            '}',
+            'class Counter {',
+            '    private count = 0;',
+            '    static created = 0;',
+            '    next(): number { return ++this.count; }',
+            '}',
+            'async function delayed(value: string): Promise<string> {',
+            '    await Promise.resolve();',
+            '    return value;',
+            '}',
+            'const counter = new Counter();',
+            'console.log(counter.next(), new Shapes.Point(3, 4).length());',
+            'delayed("done").then(text => console.log(text));',
+        ].join('\n'));
+
+        const program = ts.createProgram([fileName], {});
+        const sourceFile = program.getSourceFile(fileName);
+        const emitFiles = { rootFolder: folder, fileNameHeader: 'a.h', fileNameHeader_pre: 'a_pre.h', fileNameCpp: 'a.cpp' };
+        const create = () => new Emitter(program.getTypeChecker(), {}, {}, false, emitFiles);
+
+        const one = create();
+        one.processHeaderAndSource(sourceFile);
+
+        const header = create();
+        header.HeaderMode = true;
+        header.processNode(sourceFile);
+        const source = create();
+        source.SourceMode = true;
+        source.processNode(sourceFile);
+
+        expect(one.writer.getText()).to.equals(header.writer.getText());
+        expect(one.writer_predecl.getText()).to.equals(header.writer_predecl.getText());
+        expect(one.writer_source.getText()).to.equals(source.writer.getText());
+        expect(one.writer.getMappings()).to.deep.equals(header.writer.getMappings());
+        expect(one.writer_source.getMappings()).to.deep.equals(source.writer.getMappings());
+        expect(one.writer_source.getText()).to.contain('Counter');
+
+        fs.removeSync(folder);
+    });
+
+});
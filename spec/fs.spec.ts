@@ -0,0 +1,53 @@
+import { Run } from '../src/compiler';
+import { expect } from 'chai';
+import { describe, it } from 'mocha';
+
+describe('fs', () => {
+
+    it('writeFileSync and readFileSync', () => expect('hello\r\n').to.equals(new Run().test([
+        'import * as fs from "fs";                                          \
+        fs.writeFileSync("fs_sync.txt", "hello");                           \
+        console.log(fs.readFileSync("fs_sync.txt", "utf8"));                \
+    '])));
+
+    it('promises writeFile and readFile', () => expect('sync\r\nworld\r\n').to.equals(new Run().test([
+        'import * as fs from "fs";                                          \
+        async function roundTrip() {                                        \
+            await fs.promises.writeFile("fs_async.txt", "world");           \
+            const text = await fs.promises.readFile("fs_async.txt", "utf8"); \
+            console.log(text);                                              \
+        }                                                                   \
+        roundTrip();                                                        \
+        console.log("sync");                                                \
+    '])));
+
+    it('non-ASCII text round trips as UTF-8', () => expect('h\u00e9llo \u20ac\r\n7\r\n10\r\n').to.equals(new Run().test([
+        'import * as fs from "fs";                                          \
+        fs.writeFileSync("fs_utf8.txt", "h\u00e9llo \u20ac");               \
+        const text = fs.readFileSync("fs_utf8.txt", "utf8");                \
+        console.log(text);                                                  \
+        console.log(text.length);                                           \
+        console.log(fs.readFileSync("fs_utf8.txt").byteLength);             \
+    '])));
+
+    it('import with a local name', () => expect('alias\r\n').to.equals(new Run().test([
+        'import { readFileSync as rfs, writeFileSync as wfs } from "fs";   \
+        wfs("fs_alias.txt", "alias");                                       \
+        console.log(rfs("fs_alias.txt", "utf8"));                           \
+    '])));
+
+    it('readSync rejects an offset past the buffer', () => expect(new Run().test([
+        'import * as fs from "fs";                                          \
+        fs.writeFileSync("fs_range.txt", "0123456789");                     \
+        const fd = fs.openSync("fs_range.txt", "r");                        \
+        fs.readSync(fd, new ArrayBuffer(4), 8);                             \
+    '])).to.equals('Exception: RangeError: The value of "offset" is out of range.\r\n'));
+
+    it('promises.read rejects a length past the buffer', () => expect(
+        'RangeError: The value of "length" is out of range.\r\n').to.equals(new Run().test([
+        'import * as fs from "fs";                                          \
+        fs.writeFileSync("fs_range.txt", "0123456789");                     \
+        const fd = fs.openSync("fs_range.txt", "r");                        \
+        fs.promises.read(fd, new ArrayBuffer(4), 2, 3).catch(e => console.log(e)); \
+    '])));
+});
@@ -0,0 +1,35 @@
+import { Helpers } from '../src/helpers';
+import { expect } from 'chai';
+import { describe, it } from 'mocha';
+
+describe('Helpers', () => {
+
+    function check(keys: string[]) {
+        const hash = Helpers.findPerfectHash(keys);
+        keys.forEach((key, index) => {
+            const value = Helpers.switchHash(hash.seed, key);
+            const slot = Helpers.switchPlace(value, hash.displacements[value & (hash.displacements.length - 1)]) & (hash.size - 1);
+            expect(slot).to.equals(hash.slots[index]);
+        });
+
+        expect(new Set(hash.slots).size).to.equals(keys.length);
+        return hash;
+    }
+
+    it('perfect hash for a few keys', () => {
+        expect(check(['GET', 'HEAD', 'POST']).size).to.equals(4);
+        expect(check(['']).size).to.equals(1);
+    });
+
+    it('perfect hash table stays linear in the key count', () => {
+        const keys = new Array<string>();
+        for (let i = 0; i < 1000; i++) {
+            keys.push('key' + i);
+        }
+
+        const hash = check(keys);
+        expect(hash.size).to.equals(2048);
+        expect(hash.displacements.length).to.equals(256);
+    });
+
+});
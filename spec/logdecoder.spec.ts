@@ -0,0 +1,58 @@
+import { LogDecoder } from '../src/logdecoder';
+import { expect } from 'chai';
+import { describe, it } from 'mocha';
+
+describe('LogDecoder', () => {
+
+    // magic, size, ~size, site 7, level log, time 0, a number and a string argument, 0x1f
+    function record(): Buffer {
+        const text = Buffer.from('ok');
+        const payload = Buffer.alloc(13 + 9 + 5 + text.length);
+        payload.writeUInt32LE(7, 0);
+        payload.writeDoubleLE(1.5, 14);
+        payload[13] = 4;
+        payload[22] = 5;
+        payload.writeUInt32LE(text.length, 23);
+        text.copy(payload, 27);
+        const header = Buffer.alloc(12);
+        Buffer.from([0x1e, 0x62, 0x6c, 0x01]).copy(header);
+        header.writeUInt32LE(payload.length, 4);
+        header.writeUInt32LE(~payload.length >>> 0, 8);
+        return Buffer.concat([header, payload, Buffer.from([0x1f])]);
+    }
+
+    function decode(data: Buffer): string {
+        const decoder = new LogDecoder();
+        (<any>decoder).sites.set(7, { id: 7, file: 'a.ts', line: 1, column: 1, level: 'log', parts: ['x=', null, ' ', null] });
+
+        let output = '';
+        decoder.decode(data, (level, text) => output += text);
+        return output;
+    }
+
+    it('decodes records and passes text through', () => {
+        expect(decode(Buffer.concat([Buffer.from('start\n'), record(), Buffer.from('Exception: stop\n')])))
+            .to.equals('start\nx=1.5 ok\nException: stop\n');
+    });
+
+    it('passes through a record separator in plain text', () => {
+        expect(decode(Buffer.concat([Buffer.from('a\x1eb\x1e\n'), record(), Buffer.from('\x1e')])))
+            .to.equals('a\x1eb\x1e\nx=1.5 ok\n\x1e');
+    });
+
+    it('passes through records that do not validate', () => {
+        const damaged = record();
+        damaged.writeUInt32LE(damaged.readUInt32LE(4) + 1, 4);
+        const truncated = record().slice(0, 20);
+        expect(decode(Buffer.concat([damaged, record(), truncated])).indexOf('x=1.5 ok\n')).to.equals(damaged.length);
+    });
+
+    it('emits a record with an unknown value tag and goes on', () => {
+        const unknown = record();
+        unknown[12 + 13] = 9;
+        const payload = unknown.slice(12, unknown.length - 1).toString('hex');
+        expect(decode(Buffer.concat([unknown, record()])))
+            .to.equals(`<undecodable record of site 0x7 ${payload}>\nx=1.5 ok\n`);
+    });
+
+});
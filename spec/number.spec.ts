@@ -56,4 +56,15 @@ describe('Numbers', () => {
          a += 1;                                \
          console.log(a);                        \
     '])).to.equals('false\r\nNaN\r\nNaN\r\n'));
+
+    it('parseInt parseFloat Number', () => expect(new Run().test([
+        'console.log(parseInt("  42px"));      \
+         console.log(parseInt("0x1F"));         \
+         console.log(parseInt("z", 36));        \
+         console.log(parseInt("abc"));          \
+         console.log(parseFloat("-.5e1 m"));    \
+         console.log(parseFloat("Infinity!"));  \
+         console.log(Number(" 0b101 "));        \
+         console.log(Number("12px"));           \
+    '])).to.equals('42\r\n31\r\n35\r\nNaN\r\n-5\r\nInfinity\r\n5\r\nNaN\r\n'));
 });
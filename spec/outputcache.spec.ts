@@ -0,0 +1,34 @@
+import { OutputCache } from '../src/outputcache';
+import { expect } from 'chai';
+import { describe, it } from 'mocha';
+import * as fs from 'fs-extra';
+import * as os from 'os';
+import * as path from 'path';
+
+describe('OutputCache', () => {
+
+    it('writes only changed files', () => {
+        const outDir = fs.mkdtempSync(path.join(os.tmpdir(), 'tsc-cxx-')) + '/';
+        const header = outDir + 'a.h';
+        const source = outDir + 'a.cpp';
+
+        const first = new OutputCache(outDir);
+        expect(first.write(header, 'struct A;')).to.equals(true);
+        expect(first.write(source, 'int a = 1;')).to.equals(true);
+        first.save();
+
+        const second = new OutputCache(outDir);
+        expect(second.write(header, 'struct A;')).to.equals(false);
+        expect(second.write(source, 'int a = 2;')).to.equals(true);
+        second.save();
+
+        fs.unlinkSync(header);
+        const third = new OutputCache(outDir);
+        expect(third.write(header, 'struct A;')).to.equals(true);
+        expect(third.write(source, 'int a = 2;')).to.equals(false);
+        expect(fs.readFileSync(source).toString()).to.equals('int a = 2;');
+
+        fs.removeSync(outDir);
+    });
+
+});
@@ -0,0 +1,67 @@
+import { Run } from '../src/compiler';
+import { expect } from 'chai';
+import { describe, it } from 'mocha';
+
+describe('Promise', () => {
+
+    it('then chain runs after synchronous code', () => expect('sync\r\n1\r\n2\r\n').to.equals(new Run().test([
+        'const p = new Promise<number>((resolve, reject) => resolve(1));    \
+        p.then(v => { console.log(v); return v + 1; })                      \
+            .then(v => console.log(v));                                     \
+        console.log("sync");                                                \
+    '])));
+
+    it('catch and finally', () => expect('caught\r\nfinally\r\n').to.equals(new Run().test([
+        'Promise.reject("no")                                               \
+            .catch(e => console.log("caught"))                              \
+            .finally(() => console.log("finally"));                         \
+    '])));
+
+    it('Promise.all', () => expect('3\r\n').to.equals(new Run().test([
+        'Promise.all([Promise.resolve(1), Promise.resolve(2)])              \
+            .then(values => console.log(values[0] + values[1]));            \
+    '])));
+
+    it('async function suspends on await', () => expect('before\r\nsync\r\nafter\r\n3\r\n').to.equals(new Run().test([
+        'async function add(a: number, b: number): Promise<number> {       \
+            console.log("before");                                          \
+            const x = await Promise.resolve(a);                             \
+            console.log("after");                                           \
+            return x + b;                                                   \
+        }                                                                   \
+        add(1, 2).then(v => console.log(v));                                \
+        console.log("sync");                                                \
+    '])));
+
+    it('await of a settled value still yields', () => expect('1\r\n2\r\n3\r\n').to.equals(new Run().test([
+        'async function f() {                                               \
+            console.log(1);                                                 \
+            await null;                                                     \
+            console.log(3);                                                 \
+        }                                                                   \
+        f();                                                                \
+        console.log(2);                                                     \
+    '])));
+
+    it('runtime TypeError rejects with its name', () => expect('TypeError: wrong type\r\n').to.equals(new Run().test([
+        'async function f() {                                               \
+            const a: any = 5;                                               \
+            return a["x"];                                                  \
+        }                                                                   \
+        f().catch(e => console.log(e));                                     \
+    '])));
+
+    it('setTimeout and clearTimeout', () => expect('sync\r\n2\r\n').to.equals(new Run().test([
+        'const id = setTimeout(() => console.log(1), 10);                   \
+        setTimeout(() => console.log(2), 20);                               \
+        clearTimeout(id);                                                   \
+        console.log("sync");                                                \
+    '])));
+
+    it('setTimeout with a negative or NaN delay runs at once', () => expect('2\r\n').to.equals(new Run().test([
+        'let fired = 0;                                                     \
+        setTimeout(() => fired++, -5);                                      \
+        setTimeout(() => fired++, NaN);                                     \
+        setTimeout(() => console.log(fired), 20);                           \
+    '])));
+});
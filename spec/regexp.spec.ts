@@ -46,4 +46,32 @@ describe('RegExp', () => {
         console.log(b);                                     \
     '])));
 
+    it('RegExp exec captures lastIndex', () => expect(new Run().test([
+        'const re = /(\\d+)-(\\d+)/g;                        \
+        let m = re.exec("10-20 x 3-4");                     \
+        console.log(m[0] + " " + m[1] + " " + m[2]);        \
+        console.log(re.lastIndex);                          \
+        m = re.exec("10-20 x 3-4");                         \
+        console.log(m.index);                               \
+        console.log(!re.exec("10-20 x 3-4"));               \
+        console.log(/^b/m.test("a\\nb"));                   \
+    '])).to.equals('10-20 10 20\r\n5\r\n8\r\ntrue\r\ntrue\r\n'));
+
+    it('RegExp open-ended {n,} quantifier', () => expect(new Run().test([
+        'console.log(/a{2,}/.exec("baaab")[0]);             \
+        console.log(/\\d{3,}/.exec("ab12345")[0]);          \
+        console.log(/x{1,}y/.exec("zxxxy")[0]);             \
+        console.log(/a{2,}/.test("ab"));                    \
+    '])).to.equals('aaa\r\n12345\r\nxxxy\r\nfalse\r\n'));
+
+    it('RegExp non-ASCII escapes and classes', () => expect(new Run().test([
+        'console.log(/\\u{1F600}/u.exec("x\u{1F600}y")[0]);   \
+        console.log(/\\u00e9/.exec("caf\u00e9")[0]);          \
+        console.log(/\\xe9+/.exec("\u00e9\u00e9!")[0]);       \
+        console.log(/[\u00e9]/.exec("caf\u00e9")[0]);          \
+        console.log(/[\u00e0-\u00ff]+/.exec("x\u00e0\u00e9z")[0]); \
+        console.log(/[^\u00e9]/.exec("\u00e9\u20ac")[0]);     \
+        console.log(/[\\u{1F600}-\\u{1F602}]/u.test("\u{1F603}")); \
+    '])).to.equals('\u{1F600}\r\n\u00e9\r\n\u00e9\u00e9\r\n\u00e9\r\n\u00e0\u00e9\r\n\u20ac\r\nfalse\r\n'));
+
 });
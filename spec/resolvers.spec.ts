@@ -0,0 +1,31 @@
+import { IdentifierResolver } from '../src/resolvers';
+import { expect } from 'chai';
+import { describe, it } from 'mocha';
+import * as ts from 'typescript';
+import * as fs from 'fs-extra';
+import * as os from 'os';
+import * as path from 'path';
+
+describe('IdentifierResolver', () => {
+
+    it('shares memoized types per program', () => {
+        const fileName = path.join(fs.mkdtempSync(path.join(os.tmpdir(), 'tsc-cxx-')), 'a.ts');
+        fs.writeFileSync(fileName, 'var n = 1; var s = "a";');
+        const program = ts.createProgram([fileName], {});
+        const statements = program.getSourceFile(fileName).statements;
+        const [n, s] = statements.map(v => (<ts.VariableStatement>v).declarationList.declarations[0].name);
+
+        const header = new IdentifierResolver(program.getTypeChecker());
+        const source = new IdentifierResolver(program.getTypeChecker());
+        expect(header.isNumberType(header.getOrResolveTypeOf(n))).to.equals(true);
+        expect(source.isNumberType(source.getOrResolveTypeOf(n))).to.equals(true);
+        expect(source.isStringType(source.getOrResolveTypeOf(s))).to.equals(true);
+
+        const stats = IdentifierResolver.getStats(program.getTypeChecker());
+        expect(stats.getOrResolveTypeOf).to.deep.equals({ hits: 1, misses: 2 });
+        expect(stats.isNumberType).to.deep.equals({ hits: 1, misses: 1 });
+
+        fs.removeSync(path.dirname(fileName));
+    });
+
+});
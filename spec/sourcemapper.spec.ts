@@ -0,0 +1,72 @@
+import { CodeWriter } from '../src/codewriter';
+import { SourceMapper } from '../src/sourcemapper';
+import { expect } from 'chai';
+import { describe, it } from 'mocha';
+
+describe('SourceMapper', () => {
+
+    function writeFunction(): CodeWriter {
+        const writer = new CodeWriter();
+        writer.writeStringNewLine('#include "a.h"');
+        writer.writeStringNewLine('');
+        writer.mapSource(0, 0);
+        writer.writeString('void f() ');
+        writer.BeginBlock();
+        writer.mapSource(1, 4);
+        writer.writeString('g()');
+        writer.EndOfStatement();
+        writer.mapSource(0, 0);
+        writer.EndBlock();
+        writer.mapSource(-1, 0);
+        writer.writeStringNewLine('MAIN');
+        return writer;
+    }
+
+    it('puts #line directives where the .ts line changes', () => {
+        const writer = writeFunction();
+        const mapped = new SourceMapper('/src/a.ts', '/out/a.cpp').apply(writer.getText(), writer.getMappings(), true, false);
+        expect(mapped.text).to.equals([
+            '#include "a.h"',
+            '',
+            '#line 1 "/src/a.ts"',
+            'void f() {',
+            '    g();',
+            '#line 1 "/src/a.ts"',
+            '}',
+            '#line 9 "/out/a.cpp"',
+            'MAIN',
+            ''].join('\n'));
+        expect(mapped.map).to.equals(undefined);
+    });
+
+    it('writes a source map relative to the generated file', () => {
+        const writer = writeFunction();
+        const mapped = new SourceMapper('/src/a.ts', '/out/a.cpp').apply(writer.getText(), writer.getMappings(), false, true);
+        const map = JSON.parse(mapped.map);
+        expect(mapped.text).to.equals(writer.getText());
+        expect(map.file).to.equals('a.cpp');
+        expect(map.sources).to.deep.equals(['../src/a.ts']);
+        expect(map.mappings).to.not.equals('');
+    });
+
+    it('leaves statements that start inside a line to the source map', () => {
+        const writer = new CodeWriter();
+        writer.mapSource(0, 0);
+        writer.writeString('if (c) ');
+        writer.mapSource(0, 7);
+        writer.writeStringNewLine('return AND(a, [&]() {');
+        writer.writeStringNewLine('    return b;');
+        writer.writeStringNewLine('});');
+        const mapped = new SourceMapper('/src/a.ts', '/out/a.cpp').apply(writer.getText(), writer.getMappings(), true, false);
+        expect(mapped.text.split('\n').filter(l => l.startsWith('#line'))).to.deep.equals(['#line 1 "/src/a.ts"']);
+    });
+
+    it('drops the locations of rolled back code', () => {
+        const writer = new CodeWriter();
+        writer.writeStringNewLine('int a;');
+        const position = writer.newSection();
+        writer.mapSource(4, 0);
+        expect(writer.hasAnyContent(position, position)).to.equals(false);
+        expect(writer.getMappings()).to.deep.equals([]);
+    });
+});
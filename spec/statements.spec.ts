@@ -250,6 +250,55 @@ describe('Statements', () => {
         }                                                       \
     '])).to.equals('Excellent\r\n'));
 
+    it('switch (string) - miss, fall-through, dynamic cases', () => expect(new Run().test([
+        'function kind(method: string) {                        \
+            switch (method) {                                   \
+                case "GET":                                     \
+                case "HEAD":                                    \
+                    return "read";                              \
+                case "POST":                                    \
+                    return "write";                             \
+                default:                                        \
+                    return "other";                             \
+            }                                                   \
+        }                                                       \
+        console.log(kind("HEAD"));                              \
+        console.log(kind("POST"));                              \
+        console.log(kind("GETS"));                              \
+        let limit = 2;                                          \
+        switch (3) {                                            \
+            case limit:                                         \
+                console.log("limit");                           \
+                break;                                          \
+            case limit + 1:                                     \
+                console.log("next");                            \
+                break;                                          \
+        }                                                       \
+    '])).to.equals('read\r\nwrite\r\nother\r\nnext\r\n'));
+
+    it('switch (number) - negative, sparse and fractional cases', () => expect(new Run().test([
+        'function f(v: number) {                                \
+            switch (v) {                                        \
+                case -1: return "neg";                          \
+                case 1: return "one";                           \
+                case 4096: return "big";                        \
+                default: return "other";                        \
+            }                                                   \
+        }                                                       \
+        function g(v: any) {                                    \
+            switch (v) {                                        \
+                case 0.5: return "half";                        \
+                case 1: return "one";                           \
+                default: return "other";                        \
+            }                                                   \
+        }                                                       \
+        console.log(f(-1));                                     \
+        console.log(f(1.5));                                    \
+        console.log(f(4096));                                   \
+        console.log(g(0.5));                                    \
+        console.log(g(-0.5));                                   \
+    '])).to.equals('neg\r\nother\r\nbig\r\nhalf\r\nother\r\n'));
+
     it('switch - with for statement', () => expect(new Run().test([
         'const grade = 0;                                       \
         var i = 0;                                              \
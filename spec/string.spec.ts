@@ -9,4 +9,25 @@ describe('Strings', () => {
         console.log(s[1]);                                     \
     '])).to.equals('B\r\n'));
 
+    it('search split replace', () => expect(new Run().test([
+        'var s = "GET /a/b HTTP/1.0";                          \
+        console.log(s.indexOf("HTTP"));                        \
+        console.log(s.indexOf("x"));                           \
+        console.log(s.includes("/b "));                        \
+        console.log(s.startsWith("GET"));                      \
+        console.log(s.endsWith("1.1"));                        \
+        console.log(s.split(" ").length);                      \
+        console.log(s.replace("/", "[$&]"));                   \
+        console.log(s.replaceAll("/", "-"));                   \
+    '])).to.equals('9\r\n-1\r\ntrue\r\ntrue\r\nfalse\r\n3\r\nGET [/]a/b HTTP/1.0\r\nGET -a-b HTTP-1.0\r\n'));
+
+    it('utf-16 length', () => expect(new Run().test([
+        'var s = "hęłłó 💃";                                  \
+        console.log(s.length);                                 \
+        console.log(s.charCodeAt(6));                          \
+        console.log(s.indexOf("💃"));                          \
+        console.log(s.slice(1, 5));                            \
+        console.log(s.toUpperCase());                          \
+    '])).to.equals('8\r\n55357\r\n6\r\nęłłó\r\nHĘŁŁÓ 💃\r\n'));
+
 });
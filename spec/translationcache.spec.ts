@@ -0,0 +1,57 @@
+import { TranslationCache } from '../src/translationcache';
+import { DependencyGraph } from '../src/dependencygraph';
+import { expect } from 'chai';
+import { describe, it } from 'mocha';
+import * as ts from 'typescript';
+import * as fs from 'fs-extra';
+import * as os from 'os';
+import * as path from 'path';
+
+describe('TranslationCache', () => {
+
+    const folder = fs.mkdtempSync(path.join(os.tmpdir(), 'tsc-cxx-')).replace(/\\/g, '/');
+
+    function key(shape: string, cmdLineOptions: any = {}, globals?: string): string {
+        fs.writeFileSync(folder + '/shape.ts', shape);
+        fs.writeFileSync(folder + '/main.ts', 'import { area } from "./shape"; console.log(area(2));');
+        const rootNames = [folder + '/main.ts'];
+        if (globals !== undefined) {
+            fs.writeFileSync(folder + '/globals.d.ts', globals);
+            rootNames.push(folder + '/globals.d.ts');
+        }
+
+        const program = ts.createProgram(rootNames, {});
+        const sourceFiles = program.getSourceFiles().filter(s => s.fileName.startsWith(folder));
+        const graph = new DependencyGraph();
+        graph.update(program, sourceFiles);
+        return new TranslationCache(folder + '/cache', 1024).key(
+            program, program.getSourceFile(folder + '/main.ts'), graph, {}, cmdLineOptions, folder + '/');
+    }
+
+    it('keys by import signatures and options', () => {
+        const first = key('export function area(r: number): number { return r * r; }');
+        expect(key('export function area(r: number): number { return 3 * r * r; }', { jobs: 4 })).to.equals(first);
+        expect(key('export function area(r: number): string { return "" + r; }')).to.not.equals(first);
+        expect(key('export function area(r: number): number { return r * r; }', { binary_log: true })).to.not.equals(first);
+    });
+
+    it('keys by global declarations', () => {
+        const shape = 'export function area(r: number): number { return scale * r * r; }';
+        const first = key(shape, {}, 'declare const scale: number;');
+        expect(key(shape, {}, 'declare const scale: number;')).to.equals(first);
+        expect(key(shape, {}, 'declare const scale: string;')).to.not.equals(first);
+    });
+
+    it('evicts least recently used entries', () => {
+        const cache = new TranslationCache(folder + '/lru', 300);
+        cache.set('old', <any>{ source: 'x'.repeat(200) });
+        cache.set('new', <any>{ source: 'y'.repeat(200) });
+        fs.utimesSync(folder + '/lru/old.json', new Date(1000), new Date(1000));
+        cache.evict();
+        expect(cache.get('old')).to.equals(undefined);
+        expect(cache.get('new').source.length).to.equals(200);
+        expect([cache.hits, cache.misses, cache.evicted]).to.deep.equals([1, 1, 1]);
+        fs.removeSync(folder);
+    });
+
+});
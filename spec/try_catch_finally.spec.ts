@@ -34,4 +34,13 @@ describe('Try/Finally', () => {
         console.log(i);                         \
     '])));
 
+    it('finally runs when the runtime throws a TypeError', () => expect(new Run().test([
+        'const a: any = 5;                      \
+        try {                                   \
+            console.log(a["x"]);                \
+        } finally {                             \
+            console.log("cleanup");             \
+        }                                       \
+    '])).to.equals('cleanup\r\nException: TypeError: wrong type\r\n'));
+
 });
@@ -1,18 +1,56 @@
+// Written parts are joined into a chunk every 4096 parts, so a module of several MB is held
+// as a few hundred flat strings rather than one array entry per token, and getText()
+// joins the chunks once. Positions from newSection() count written parts, as before; the
+// character offset of each one is kept so the writer can roll back to it.
+
+// start of the C++ written for a TypeScript location, line and column are 0-based;
+// a negative line marks code that has no TypeScript counterpart
+export interface SourceMapping {
+    offset: number;
+    line: number;
+    column: number;
+}
+
 export class CodeWriter {
+    private static readonly partsPerChunk = 4096;
+    // left open when sealing, cancelNewLine() removes whole parts
+    private static readonly openParts = 8;
+
+    private chunks = new Array<string>();
+    private sealedLength = 0;
     private parts = new Array<string>();
+    private partsLength = 0;
+    private partCount = 0;
+    private marks = new Map<number, { offset: number, mappings: number }>();
+    private mappings = new Array<SourceMapping>();
     private intent = 0;
     private pendingIntent = false;
     private newLine = false;
     private endOfStatement = false;
 
     public newSection(): number {
-        return this.parts.length;
+        // a section nested at the same position must not move the outer one's start
+        if (this.marks.has(this.partCount)) {
+            return this.partCount;
+        }
+
+        this.marks.set(this.partCount, { offset: this.sealedLength + this.partsLength, mappings: this.mappings.length });
+        return this.partCount;
     }
 
     public hasAnyContent(point: number, rollbackPosition?: number): boolean {
-        if (point >= this.parts.length) {
+        if (point >= this.partCount) {
             if (rollbackPosition) {
-                this.parts.length = rollbackPosition;
+                const mark = this.marks.get(rollbackPosition);
+                this.truncate(mark.offset);
+                this.mappings.length = mark.mappings;
+                this.partCount = rollbackPosition;
+                // sections opened after the rollback point no longer exist
+                for (const position of this.marks.keys()) {
+                    if (position > rollbackPosition) {
+                        this.marks.delete(position);
+                    }
+                }
             }
 
             return false;
@@ -88,11 +126,11 @@ export class CodeWriter {
     public writeString(data: string): void {
         this.endOfStatement = false;
         if (this.pendingIntent) {
-            this.parts.push(' '.repeat(this.intent));
+            this.append(' '.repeat(this.intent));
             this.pendingIntent = false;
         }
 
-        this.parts.push(data);
+        this.append(data);
         if (data) {
             this.newLine = false;
         }
@@ -103,7 +141,7 @@ export class CodeWriter {
             this.writeString(data);
         }
 
-        this.parts.push('\n');
+        this.append('\n');
         this.newLine = true;
         if (this.intent > 0) {
             this.pendingIntent = true;
@@ -114,13 +152,60 @@ export class CodeWriter {
         if (this.newLine) {
             this.pendingIntent = false;
             this.newLine = false;
-            this.parts.pop();
+            this.removeLastPart();
         } else if (this.parts.length > 0 && this.parts[this.parts.length - 1] === '\n') {
-            this.parts.pop();
+            this.removeLastPart();
         }
     }
 
+    public mapSource(line: number, column: number) {
+        this.mappings.push({ offset: this.sealedLength + this.partsLength, line, column });
+    }
+
     public getText(): string {
-        return this.parts.join('');
+        return this.chunks.join('') + this.parts.join('');
     }
-}
+
+    public getMappings(): SourceMapping[] {
+        return this.mappings;
+    }
+
+    private append(data: string) {
+        this.parts.push(data);
+        this.partsLength += data.length;
+        this.partCount++;
+        if (this.parts.length >= CodeWriter.partsPerChunk) {
+            const chunk = this.parts.splice(0, this.parts.length - CodeWriter.openParts).join('');
+            this.chunks.push(chunk);
+            this.sealedLength += chunk.length;
+            this.partsLength -= chunk.length;
+        }
+    }
+
+    private removeLastPart() {
+        if (this.parts.length > 0) {
+            this.marks.delete(this.partCount);
+            this.partsLength -= this.parts.pop().length;
+            this.partCount--;
+        }
+    }
+
+    private truncate(position: number) {
+        while (position < this.sealedLength) {
+            const chunk = this.chunks.pop();
+            this.sealedLength -= chunk.length;
+            this.parts.unshift(chunk);
+            this.partsLength += chunk.length;
+        }
+
+        while (this.parts.length > 0 && this.sealedLength + this.partsLength > position) {
+            const last = this.parts.pop();
+            this.partsLength -= last.length;
+            if (this.sealedLength + this.partsLength < position) {
+                const kept = last.substring(0, position - this.sealedLength - this.partsLength);
+                this.parts.push(kept);
+                this.partsLength += kept.length;
+            }
+        }
+    }
+}
\ No newline at end of file
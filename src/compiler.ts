@@ -1,8 +1,13 @@
 import * as ts from 'typescript';
 import * as fs from 'fs-extra';
 import { spawn } from 'cross-spawn';
-import { Emitter } from './emitter';
+import { BinaryLogSite } from './emitter';
 import { Helpers } from './helpers';
+import { OutputCache } from './outputcache';
+import { emitFile, emitParallel, EmittedFile } from './emitpool';
+import { IdentifierResolver, ResolverStats } from './resolvers';
+import { DependencyGraph } from './dependencygraph';
+import { TranslationCache } from './translationcache';
 
 export enum ForegroundColorEscapeSequences {
     Grey = '\u001b[90m',
@@ -50,8 +55,17 @@ const resetEscapeSequence = '\u001b[0m';
 
 export class Run {
 
+    // options followed by a value
+    private static readonly valueOptions = ['run_on_compile', 'jobs', 'cache_limit', 'unity'];
+    public static readonly changeListName = '.tsc-cxx-changes.json';
+
     private formatHost: ts.FormatDiagnosticsHost;
     private versions: Map<string, number> = new Map<string, number>();
+    private dependencies = new DependencyGraph();
+    // hash of the last emitted .h and _pre.h of every file, the API importers see
+    private headerHashes = new Map<string, string>();
+    // what -unity needs of every file, kept for the files watch mode does not re-emit
+    private unityUnits = new Map<string, { fileNameCpp: string, fileScopeNames: string[] }>();
 
     public constructor() {
         this.formatHost = <ts.FormatDiagnosticsHost>{
@@ -71,7 +85,7 @@ export class Run {
 
             const option = item.substring(1);
             options[option] = true;
-            if (option  === 'run_on_compile') {
+            if (Run.valueOptions.indexOf(option) !== -1) {
                 options[option] = cmdLineArgs[++i];
             }
         }
@@ -84,7 +98,7 @@ export class Run {
         for (let i = 2; i < cmdLineArgs.length; i++) {
             const item = cmdLineArgs[i];
             if (!item || item[0] === '-') {
-                if (item === '-run_on_compile') {
+                if (item && Run.valueOptions.indexOf(item.substring(1)) !== -1) {
                     ++i;
                 }
 
@@ -230,13 +244,22 @@ export class Run {
             }
         }
 
+        const outputCache = new OutputCache(outDir);
+        const translationCache = cmdLineOptions.no_cache
+            ? undefined
+            : new TranslationCache(TranslationCache.folderName, (Number(cmdLineOptions.cache_limit) || 256) * 1024 * 1024);
+
         let rootFolder = process.cwd().replace(/\\/g, '/');
         const lastChar2  = rootFolder[rootFolder.length - 1];
         if (lastChar2 !== '/' && lastChar2 !== '\\') {
             rootFolder += '/';
         }
 
-        sourceFiles.filter(s => !s.fileName.endsWith('.d.ts') && sources.some(sf => s.fileName.endsWith(sf))).forEach(s => {
+        const candidates = sourceFiles.filter(s => !s.fileName.endsWith('.d.ts') && sources.some(sf => s.fileName.endsWith(sf)));
+        this.dependencies.update(program, candidates);
+
+        let pending: ts.SourceFile[] = [];
+        candidates.forEach(s => {
             // track version
             const paths = sources.filter(sf => s.fileName.endsWith(sf));
             (<any>s).__path = paths[0];
@@ -275,39 +298,135 @@ export class Run {
                     + resetEscapeSequence);
             }
 
-            let fileNameNoExt = s.fileName.endsWith('.ts') ? s.fileName.substr(0, s.fileName.length - 3) : s.fileName;
-            if (fileNameNoExt.startsWith(rootFolder)) {
-                fileNameNoExt = fileNameNoExt.substring(rootFolder.length);
-            }
+            pending.push(s);
+        });
 
-            const fileNameHeader = Helpers.correctFileNameForCxx(fileNameNoExt.concat('.', 'h'));
-            const fileNameHeader_pre = Helpers.correctFileNameForCxx(fileNameNoExt.concat('_pre.', 'h'));
-            const fileNameCpp = Helpers.correctFileNameForCxx(fileNameNoExt.concat('.', 'cpp'));
+        // changed files first, then importers of every file whose header text changed, until
+        // no header changes any more
+        const stats: ResolverStats = {};
+        const emittedFiles = new Set<string>();
+        let sequential = false;
+        while (pending.length) {
+            pending.forEach(s => emittedFiles.add(s.fileName));
+
+            const keys = translationCache
+                ? pending.map(s => translationCache.key(program, s, this.dependencies, options, cmdLineOptions, rootFolder))
+                : [];
+            const emitted: EmittedFile[] = pending.map((s, index) => translationCache && translationCache.get(keys[index]));
+            const misses = pending.filter((s, index) => !emitted[index]);
+
+            const jobs = Math.min(Number(cmdLineOptions.jobs) || 1, misses.length);
+            const translated: EmittedFile[] = jobs > 1
+                ? emitParallel(jobs, sources, options, cmdLineOptions, rootFolder, misses.map(s => s.fileName), stats)
+                : misses.map(s => emitFile(program, s, options, cmdLineOptions, rootFolder));
+            sequential = sequential || jobs <= 1;
+
+            translated.forEach((file, missIndex) => {
+                const index = pending.indexOf(misses[missIndex]);
+                emitted[index] = file;
+                if (translationCache) {
+                    translationCache.set(keys[index], file);
+                }
+            });
 
+            const importers = new Set<string>();
+            emitted.forEach(file => {
+                if (!cmdLineOptions.suppressOutput) {
+                    console.log(
+                        ForegroundColorEscapeSequences.Cyan
+                        + 'Writing to file: '
+                        + resetEscapeSequence
+                        + ForegroundColorEscapeSequences.White
+                        + outDir + file.fileNameCpp
+                        + resetEscapeSequence);
+                }
+
+                // each file is compared on its own, a change inside a function body only touches the .cpp
+                outputCache.write(outDir + file.fileNameHeader, file.header);
+                outputCache.write(outDir + file.fileNameHeader_pre, file.headerPre);
+                outputCache.write(outDir + file.fileNameCpp, file.source);
+                if (file.sourceMap) {
+                    outputCache.write(outDir + file.fileNameHeader + '.map', file.headerMap);
+                    outputCache.write(outDir + file.fileNameCpp + '.map', file.sourceMap);
+                }
+
+                if (cmdLineOptions.binary_log) {
+                    this.writeBinaryLogSites(
+                        outputCache,
+                        outDir + Helpers.correctFileNameForCxx(file.fileNameNoExt.concat('.binlog.json')),
+                        file.binaryLogSites);
+                }
+
+                this.unityUnits.set(file.fileName, { fileNameCpp: file.fileNameCpp, fileScopeNames: file.fileScopeNames });
+
+                const headerHash = OutputCache.hash(file.headerPre + file.header);
+                const previousHash = this.headerHashes.get(file.fileName);
+                if (previousHash !== headerHash) {
+                    if (previousHash) {
+                        this.dependencies.importersOf(file.fileName).forEach(importer => importers.add(importer));
+                    }
+
+                    this.headerHashes.set(file.fileName, headerHash);
+                }
+            });
+
+            pending = candidates.filter(s => importers.has(s.fileName) && !emittedFiles.has(s.fileName));
             if (!cmdLineOptions.suppressOutput) {
-                console.log(
+                pending.forEach(s => console.log(
                     ForegroundColorEscapeSequences.Cyan
-                    + 'Writing to file: '
+                    + 'Processing Importer: '
                     + resetEscapeSequence
                     + ForegroundColorEscapeSequences.White
-                    + outDir + fileNameCpp
-                    + resetEscapeSequence);
+                    + s.fileName
+                    + resetEscapeSequence));
             }
+        }
 
-            const emitterHeader = new Emitter(program.getTypeChecker(), options, cmdLineOptions, false, {rootFolder:program.getCurrentDirectory(), fileNameHeader,fileNameHeader_pre,fileNameCpp});
-            emitterHeader.HeaderMode = true;
-            emitterHeader.processNode(s);
-            const emitterSource = new Emitter(program.getTypeChecker(), options, cmdLineOptions, false, {rootFolder:program.getCurrentDirectory(), fileNameHeader,fileNameHeader_pre,fileNameCpp});
-            emitterSource.SourceMode = true;
-            emitterSource.processNode(s);
+        if (sequential) {
+            IdentifierResolver.getStats(program.getTypeChecker(), stats);
+        }
 
-            fs.writeFileSync(outDir + fileNameHeader, emitterHeader.writer.getText());
-            fs.writeFileSync(outDir + fileNameHeader_pre, emitterHeader.writer_predecl.getText());
-            fs.writeFileSync(outDir + fileNameCpp, emitterSource.writer.getText());
-        });
+        if (cmdLineOptions.unity) {
+            this.writeUnityFiles(outputCache, outDir, candidates, Number(cmdLineOptions.unity) || 16);
+        }
+
+        outputCache.save();
+        if (translationCache) {
+            translationCache.evict();
+        }
+
+        this.writeChangeList(outDir, Array.from(emittedFiles), outputCache.writtenFiles);
 
         if (!cmdLineOptions.suppressOutput) {
             console.log(ForegroundColorEscapeSequences.Pink + 'Binary files have been generated...' + resetEscapeSequence);
+            console.log(
+                ForegroundColorEscapeSequences.Cyan
+                + 'Files written: '
+                + resetEscapeSequence
+                + outputCache.written
+                + ForegroundColorEscapeSequences.Cyan
+                + ', unchanged: '
+                + resetEscapeSequence
+                + outputCache.unchanged);
+            if (translationCache) {
+                console.log(
+                    ForegroundColorEscapeSequences.Cyan
+                    + 'Translation cache hits: '
+                    + resetEscapeSequence
+                    + translationCache.hits
+                    + ForegroundColorEscapeSequences.Cyan
+                    + ', misses: '
+                    + resetEscapeSequence
+                    + translationCache.misses
+                    + ForegroundColorEscapeSequences.Cyan
+                    + ', evicted: '
+                    + resetEscapeSequence
+                    + translationCache.evicted);
+            }
+        }
+
+        if (cmdLineOptions.stats) {
+            this.reportStats(stats);
         }
 
         if (cmdLineOptions.run_on_compile) {
@@ -333,6 +452,77 @@ export class Run {
         }
     }
 
+    private reportStats(stats: ResolverStats) {
+        console.log(ForegroundColorEscapeSequences.Cyan + 'Resolver cache:' + resetEscapeSequence);
+        Object.keys(stats).forEach(name => {
+            const { hits, misses } = stats[name];
+            const rate = hits + misses ? (100 * hits / (hits + misses)).toFixed(1) : '0.0';
+            console.log(`    ${name.padEnd(20)} hits ${String(hits).padStart(9)}  misses ${String(misses).padStart(9)}  ${rate.padStart(5)}%`);
+        });
+    }
+
+    // unity_<n>.cpp, each including up to `size` generated sources so core.h and the templates
+    // it instantiates are compiled once per group. A file joins the first group with room
+    // where none of its headers, own or imported, aliases a name differently than a header
+    // already in the group; otherwise it starts a new group.
+    private writeUnityFiles(outputCache: OutputCache, outDir: string, candidates: ts.SourceFile[], size: number) {
+        const groups: { sources: string[], names: Map<string, string> }[] = [];
+        candidates.forEach(s => {
+            const unit = this.unityUnits.get(s.fileName);
+            if (!unit) {
+                return;
+            }
+
+            const names = [s.fileName].concat(this.dependencies.transitiveImportsOf(s.fileName))
+                .map(fileName => this.unityUnits.get(fileName))
+                .filter(imported => imported)
+                .reduce((all, imported) => all.concat(imported.fileScopeNames), <string[]>[])
+                .map(name => [name.substr(0, name.indexOf('=')), name.substr(name.indexOf('=') + 1)]);
+
+            let group = groups.find(g => g.sources.length < size
+                && names.every(([name, definition]) => !g.names.has(name) || g.names.get(name) === definition));
+            if (!group) {
+                group = { sources: [], names: new Map<string, string>() };
+                groups.push(group);
+            }
+
+            group.sources.push(unit.fileNameCpp);
+            names.forEach(([name, definition]) => group.names.set(name, definition));
+        });
+
+        groups.forEach((group, index) => outputCache.write(
+            outDir + `unity_${index}.cpp`,
+            '// generated by tsc-cxx -unity, compile instead of the sources it includes\n'
+            + group.sources.map(source => `#include "${source}"\n`).join('')));
+
+        // groups left over from a run with more files
+        fs.readdirSync(outDir || '.')
+            .filter(name => /^unity_\d+\.cpp$/.test(name) && Number(name.slice(6, -4)) >= groups.length)
+            .forEach(name => fs.unlinkSync(outDir + name));
+    }
+
+    // for the C++ build: the sources translated in this run and the outputs actually written,
+    // replaced on every run
+    private writeChangeList(outDir: string, sources: string[], written: string[]) {
+        fs.writeFileSync(outDir + Run.changeListName, JSON.stringify({ version: 1, sources, written }, null, 1));
+    }
+
+    // site table for tsc-cxx-logdecode, keyed by the id the emitted binlog::write passes
+    private writeBinaryLogSites(outputCache: OutputCache, fileName: string, binaryLogSites: BinaryLogSite[]) {
+        const sites = {};
+        binaryLogSites.forEach(site => {
+            const existing = sites[site.id];
+            if (existing && (existing.file !== site.file || existing.line !== site.line || existing.column !== site.column)) {
+                throw new Error(`Binary log site id collision: ${site.file}:${site.line}:${site.column} and `
+                    + `${existing.file}:${existing.line}:${existing.column}`);
+            }
+
+            sites[site.id] = site;
+        });
+
+        outputCache.write(fileName, JSON.stringify({ version: 1, sites }, null, 2));
+    }
+
     public test(sources: string[], cmdLineOptions?: any, header?: string, footer?: string): string {
         let actualOutput = '';
 
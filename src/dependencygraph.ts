@@ -0,0 +1,62 @@
+import * as ts from 'typescript';
+import * as path from 'path';
+
+// Which translated files include which: the import/export declarations and /// references
+// that processHeaderFileIncludes turns into #include lines. Watch mode uses the reverse
+// edges to re-emit importers whose imported header changed.
+export class DependencyGraph {
+    private importers = new Map<string, Set<string>>();
+    private imports = new Map<string, string[]>();
+
+    public update(program: ts.Program, sourceFiles: ts.SourceFile[]) {
+        this.importers.clear();
+        this.imports.clear();
+        sourceFiles.forEach(s => this.resolveImports(program, s).forEach(imported => {
+            let importers = this.importers.get(imported);
+            if (!importers) {
+                importers = new Set<string>();
+                this.importers.set(imported, importers);
+            }
+
+            importers.add(s.fileName);
+        }));
+    }
+
+    public importersOf(fileName: string): string[] {
+        const importers = this.importers.get(fileName);
+        return importers ? Array.from(importers) : [];
+    }
+
+    // everything fileName includes directly or indirectly, sorted
+    public transitiveImportsOf(fileName: string): string[] {
+        const found = new Set<string>();
+        const visit = (name: string) => (this.imports.get(name) || []).forEach(imported => {
+            if (!found.has(imported)) {
+                found.add(imported);
+                visit(imported);
+            }
+        });
+
+        visit(fileName);
+        found.delete(fileName);
+        return Array.from(found).sort();
+    }
+
+    private resolveImports(program: ts.Program, s: ts.SourceFile): string[] {
+        const imports: string[] = [];
+        s.statements.forEach(statement => {
+            if ((ts.isImportDeclaration(statement) || ts.isExportDeclaration(statement))
+                && statement.moduleSpecifier && ts.isStringLiteral(statement.moduleSpecifier)) {
+                const resolved = ts.resolveModuleName(
+                    statement.moduleSpecifier.text, s.fileName, program.getCompilerOptions(), ts.sys).resolvedModule;
+                if (resolved) {
+                    imports.push(resolved.resolvedFileName);
+                }
+            }
+        });
+
+        s.referencedFiles.forEach(f => imports.push(path.resolve(path.dirname(s.fileName), f.fileName).replace(/\\/g, '/')));
+        this.imports.set(s.fileName, imports);
+        return imports;
+    }
+}
@@ -0,0 +1,204 @@
+import * as ts from 'typescript';
+import * as path from 'path';
+import { Worker, MessageChannel, MessagePort, receiveMessageOnPort } from 'worker_threads';
+import { Emitter, BinaryLogSite } from './emitter';
+import { Helpers } from './helpers';
+import { IdentifierResolver, ResolverStats } from './resolvers';
+import { SourceMapper, MappedText } from './sourcemapper';
+
+export interface EmittedFile {
+    fileName: string;
+    fileNameNoExt: string;
+    fileNameHeader: string;
+    fileNameHeader_pre: string;
+    fileNameCpp: string;
+    header: string;
+    headerPre: string;
+    source: string;
+    // JSON source maps of header and source, with -source_map
+    headerMap?: string;
+    sourceMap?: string;
+    binaryLogSites: BinaryLogSite[];
+    fileScopeNames: string[];
+}
+
+interface EmitTask {
+    rootNames: string[];
+    options: ts.CompilerOptions;
+    cmdLineOptions: any;
+    rootFolder: string;
+    fileNames: string[];
+    port: MessagePort;
+    signal: Int32Array;
+    job: number;
+}
+
+// layout of EmitTask.signal: workers that stopped, files emitted by all workers, then the
+// state of each worker
+const signalStopped = 0;
+const signalProgress = 1;
+const signalStates = 2;
+const workerRunning = 0;
+const workerFinished = 1;
+const workerDied = 2;
+
+// emitParallel gives up when no worker finished a file for this long
+const stallTimeout = 5 * 60 * 1000;
+const pollInterval = 1000;
+
+// header and source text of one .ts file, the unit of work for both the sequential path
+// and the workers
+export function emitFile(
+    program: ts.Program, s: ts.SourceFile, options: ts.CompilerOptions, cmdLineOptions: any, rootFolder: string): EmittedFile {
+
+    let fileNameNoExt = s.fileName.endsWith('.ts') ? s.fileName.substr(0, s.fileName.length - 3) : s.fileName;
+    if (fileNameNoExt.startsWith(rootFolder)) {
+        fileNameNoExt = fileNameNoExt.substring(rootFolder.length);
+    }
+
+    const fileNameHeader = Helpers.correctFileNameForCxx(fileNameNoExt.concat('.', 'h'));
+    const fileNameHeader_pre = Helpers.correctFileNameForCxx(fileNameNoExt.concat('_pre.', 'h'));
+    const fileNameCpp = Helpers.correctFileNameForCxx(fileNameNoExt.concat('.', 'cpp'));
+
+    const emitter = new Emitter(program.getTypeChecker(), options, cmdLineOptions, false, {rootFolder:program.getCurrentDirectory(), fileNameHeader,fileNameHeader_pre,fileNameCpp});
+    emitter.processHeaderAndSource(s);
+
+    let header: MappedText = { text: emitter.writer.getText() };
+    let source: MappedText = { text: emitter.writer_source.getText() };
+    if (cmdLineOptions && (cmdLineOptions.line_directives || cmdLineOptions.source_map)) {
+        const lineDirectives = !!cmdLineOptions.line_directives;
+        const sourceMap = !!cmdLineOptions.source_map;
+        const outDir = path.resolve(cmdLineOptions.outDir || '');
+        header = new SourceMapper(s.fileName, path.join(outDir, fileNameHeader).replace(/\\/g, '/'))
+            .apply(header.text, emitter.writer.getMappings(), lineDirectives, sourceMap);
+        source = new SourceMapper(s.fileName, path.join(outDir, fileNameCpp).replace(/\\/g, '/'))
+            .apply(source.text, emitter.writer_source.getMappings(), lineDirectives, sourceMap);
+    }
+
+    return {
+        fileName: s.fileName,
+        fileNameNoExt,
+        fileNameHeader,
+        fileNameHeader_pre,
+        fileNameCpp,
+        header: header.text,
+        headerPre: emitter.writer_predecl.getText(),
+        source: source.text,
+        headerMap: header.map,
+        sourceMap: source.map,
+        binaryLogSites: emitter.binaryLogSites,
+        fileScopeNames: emitter.fileScopeNames
+    };
+}
+
+// Emits fileNames on `jobs` worker threads. Every worker builds its own ts.Program from
+// the same root names and options, a checker cannot be shared between threads. The call
+// blocks until all workers are done and returns the files in the order of fileNames, so
+// the output does not depend on scheduling. Resolver cache counters of the workers are
+// added to stats. A worker that exits without reporting (process.exit, a fatal error) or
+// stops making progress fails the call instead of hanging it.
+export function emitParallel(
+    jobs: number, rootNames: string[], options: ts.CompilerOptions, cmdLineOptions: any, rootFolder: string,
+    fileNames: string[], stats: ResolverStats): EmittedFile[] {
+
+    // running under ts-node (spec, tsc-cxx via npm run exec) the worker has to register it too
+    const register = __filename.endsWith('.ts') ? `require('ts-node/register');` : '';
+    // the first of finally and the 'exit' handler to run sets the worker's state; 'exit'
+    // also runs when the worker calls process.exit or dies of an uncaught error
+    const bootstrap = `
+        const { workerData } = require('worker_threads');
+        const leave = state => {
+            if (Atomics.compareExchange(workerData.signal, ${signalStates} + workerData.job, ${workerRunning}, state) === ${workerRunning}) {
+                Atomics.add(workerData.signal, ${signalStopped}, 1);
+                Atomics.notify(workerData.signal, ${signalStopped});
+            }
+        };
+        process.on('exit', () => leave(${workerDied}));
+        try {
+            ${register}
+            require(${JSON.stringify(__filename)}).runWorker(workerData);
+        } catch (e) {
+            workerData.port.postMessage({ error: e.stack || String(e) });
+        } finally {
+            leave(${workerFinished});
+        }`;
+
+    const signal = new Int32Array(new SharedArrayBuffer(4 * (signalStates + jobs)));
+    const ports: MessagePort[] = [];
+    const workers: Worker[] = [];
+    for (let job = 0; job < jobs; job++) {
+        const channel = new MessageChannel();
+        const task: EmitTask = {
+            rootNames,
+            options: options && JSON.parse(JSON.stringify(options)),
+            cmdLineOptions: JSON.parse(JSON.stringify(cmdLineOptions)),
+            rootFolder,
+            fileNames: fileNames.filter((f, index) => index % jobs === job),
+            port: channel.port2,
+            signal,
+            job
+        };
+
+        ports.push(channel.port1);
+        workers.push(new Worker(bootstrap, { eval: true, workerData: task, transferList: [<any>channel.port2] }));
+    }
+
+    let progress = 0;
+    let idle = 0;
+    for (let stopped = Atomics.load(signal, signalStopped); stopped < jobs && idle < stallTimeout; stopped = Atomics.load(signal, signalStopped)) {
+        if (Atomics.wait(signal, signalStopped, stopped, pollInterval) === 'timed-out') {
+            const current = Atomics.load(signal, signalProgress);
+            idle = current === progress ? idle + pollInterval : 0;
+            progress = current;
+        }
+    }
+
+    const emitted = new Map<string, EmittedFile>();
+    const errors: string[] = [];
+    workers.forEach((worker, job) => {
+        switch (Atomics.load(signal, signalStates + job)) {
+            case workerRunning:
+                errors.push(`Emit worker ${job} did not finish a file in ${stallTimeout / 1000} s`);
+                break;
+            case workerDied:
+                errors.push(`Emit worker ${job} exited before reporting its files`);
+                break;
+        }
+    });
+
+    ports.forEach(port => {
+        for (let message = receiveMessageOnPort(port); message; message = receiveMessageOnPort(port)) {
+            if (message.message.error) {
+                errors.push(message.message.error);
+            } else {
+                (<EmittedFile[]>message.message.files).forEach(file => emitted.set(file.fileName, file));
+                const workerStats: ResolverStats = message.message.stats;
+                Object.keys(workerStats).forEach(name => {
+                    const total = stats[name] || (stats[name] = { hits: 0, misses: 0 });
+                    total.hits += workerStats[name].hits;
+                    total.misses += workerStats[name].misses;
+                });
+            }
+        }
+
+        port.close();
+    });
+
+    workers.forEach(worker => worker.terminate());
+
+    if (errors.length) {
+        throw new Error(errors.join('\n'));
+    }
+
+    return fileNames.map(fileName => emitted.get(fileName));
+}
+
+export function runWorker(task: EmitTask) {
+    const program = ts.createProgram({ rootNames: task.rootNames, options: task.options || {} });
+    const files = task.fileNames.map(fileName => {
+        const file = emitFile(program, program.getSourceFile(fileName), task.options, task.cmdLineOptions, task.rootFolder);
+        Atomics.add(task.signal, signalProgress, 1);
+        return file;
+    });
+    task.port.postMessage({ files, stats: IdentifierResolver.getStats(program.getTypeChecker()) });
+}
@@ -23,6 +23,17 @@ interface EmitFiles {
     fileNameCpp:string;
 }
 
+// console.* call site compiled for -binary_log; parts holds the literal arguments,
+// null where a value is written at runtime
+export interface BinaryLogSite {
+    id: number;
+    file: string;
+    line: number;
+    column: number;
+    level: string;
+    parts: string[];
+}
+
 type HasTemplate0 = ts.MethodDeclaration | ts.ConstructorDeclaration | ts.FunctionDeclaration;
 type HasTemplate1 = HasTemplate0 | ts.ClassDeclaration | ts.FunctionExpression;
 type HasTemplate = HasTemplate0 | ts.FunctionExpression | ts.GetAccessorDeclaration | ts.SetAccessorDeclaration | 
@@ -34,6 +45,7 @@ type FuncExpr = ts.FunctionExpression | ts.ArrowFunction | ts.FunctionDeclaratio
 export class Emitter {
     public writer: CodeWriter;
     public writer_predecl: CodeWriter;
+    public writer_source: CodeWriter;
     private resolver: IdentifierResolver;
     private preprocessor: Preprocessor;
     private typeChecker: ts.TypeChecker;
@@ -43,6 +55,14 @@ export class Emitter {
     private opsMap: Map<number, string> = new Map<number, string>();
     private embeddedCPPTypes: Array<string>;
     private isWritingMain = false;
+    public binaryLogSites: BinaryLogSite[] = [];
+    // aliases the header declares at file scope as "name=definition", two headers with the
+    // same name and different definitions cannot share a unity translation unit
+    public fileScopeNames: string[] = [];
+    // statements being written, innermost last, for -line_directives and -source_map
+    private mappedNodes: ts.Node[] = [];
+    // a #line inside the arguments of a function-like macro is undefined behaviour
+    private macroArgumentDepth = 0;
 
     public constructor(
         typeChecker: ts.TypeChecker, private options: ts.CompilerOptions,
@@ -51,6 +71,7 @@ export class Emitter {
 
         this.writer = new CodeWriter();
         this.writer_predecl = new CodeWriter();
+        this.writer_source = new CodeWriter();
         this.typeChecker = typeChecker;
         this.resolver = new IdentifierResolver(typeChecker);
         this.preprocessor = new Preprocessor(this.resolver, this);
@@ -202,6 +223,30 @@ export class Emitter {
         return result;
     }
 
+    // .h and _pre.h go to writer and writer_predecl, the .cpp to writer_source; one emitter
+    // serves both modes so the resolver and preprocessor work is shared
+    public processHeaderAndSource(sourceFile: ts.SourceFile): void {
+        const headerWriter = this.writer;
+
+        this.HeaderMode = true;
+        this.SourceMode = false;
+        this.processNode(sourceFile);
+
+        // the source pass starts from the same state a fresh emitter would
+        this.HeaderMode = false;
+        this.SourceMode = true;
+        this.isWritingMain = false;
+        this.wasCurClassConstructorInStack = false;
+        this.isNewExpressionInStack = false;
+        this.isInvokableClassRefInStack = false;
+        this.writer = this.writer_source;
+        try {
+            this.processNode(sourceFile);
+        } finally {
+            this.writer = headerWriter;
+        }
+    }
+
     public processNode(node: ts.Node): void {
         switch (node.kind) {
             case ts.SyntaxKind.SourceFile:
@@ -532,6 +577,9 @@ export class Emitter {
             this.writer.writeStringNewLine('');
             this.writer.writeStringNewLine('void Main(void)');
             this.writer.BeginBlock();
+            if (this.cmdLineOptions && this.cmdLineOptions.instrument) {
+                this.writeProfileProbe('Main', sourceFile);
+            }
 
             this.isWritingMain = true;
 
@@ -663,8 +711,40 @@ export class Emitter {
         throw new Error('Method not implemented.');
     }
 
-    private processStatement(node: ts.Statement | ts.Declaration): void {
-        this.processStatementInternal(node);
+    private processStatement(node: ts.Statement | ts.Declaration, enableTypeAliases = false): void {
+        const mapped = this.beginSourceMapping(node);
+        this.processStatementInternal(node, enableTypeAliases);
+        if (mapped) {
+            this.endSourceMapping();
+        }
+    }
+
+    // records where the C++ of a statement starts; once it is written the enclosing statement
+    // is recorded again, so closing braces and the code after them are not charged to the
+    // last statement of a block
+    private beginSourceMapping(node: ts.Node): boolean {
+        if (!this.cmdLineOptions || !(this.cmdLineOptions.line_directives || this.cmdLineOptions.source_map)
+            || this.macroArgumentDepth > 0 || node.pos < 0 || node.getSourceFile() !== this.sourceFile) {
+            return false;
+        }
+
+        this.mappedNodes.push(node);
+        this.mapSource(node);
+        return true;
+    }
+
+    private endSourceMapping() {
+        this.mappedNodes.pop();
+        if (this.mappedNodes.length > 0) {
+            this.mapSource(this.mappedNodes[this.mappedNodes.length - 1]);
+        } else {
+            this.writer.mapSource(-1, 0);
+        }
+    }
+
+    private mapSource(node: ts.Node) {
+        const location = this.sourceFile.getLineAndCharacterOfPosition(node.getStart(this.sourceFile));
+        this.writer.mapSource(location.line, location.character);
     }
 
     private processStatementInternal(nodeIn: ts.Statement | ts.Declaration, enableTypeAliases = false): void {
@@ -774,6 +854,14 @@ export class Emitter {
     }
 
     private processDeclaration(node: ts.Declaration): void {
+        const mapped = this.beginSourceMapping(node);
+        this.processDeclarationInternal(node);
+        if (mapped) {
+            this.endSourceMapping();
+        }
+    }
+
+    private processDeclarationInternal(node: ts.Declaration): void {
         switch (node.kind) {
             case ts.SyntaxKind.PropertySignature: this.processPropertyDeclaration(<ts.PropertySignature>node); return;
             case ts.SyntaxKind.PropertyDeclaration: this.processPropertyDeclaration(<ts.PropertyDeclaration>node); return;
@@ -1922,6 +2010,11 @@ export class Emitter {
             return;
         }
 
+        if ((<ts.StringLiteral>node.moduleSpecifier).text === 'fs') {
+            this.processRuntimeModuleImport(node, 'js::fs', predecl);
+            return;
+        }
+
         this.writer.writeString('#include \"');
         if (node.moduleSpecifier.kind === ts.SyntaxKind.StringLiteral) {
             const ident = <ts.StringLiteral>node.moduleSpecifier;
@@ -1942,6 +2035,7 @@ export class Emitter {
                 this.writer.writeString('using ');
                 this.processExpression(node.importClause.name);
                 this.writer.writeStringNewLine(' = _default;');
+                this.addFileScopeName(node.importClause.name.text, '_default', predecl);
             }
 
             if (node.importClause.namedBindings
@@ -1952,11 +2046,58 @@ export class Emitter {
                     this.writer.writeString(' = ');
                     this.processExpression(binding.propertyName);
                     this.writer.writeStringNewLine(';');
+                    this.addFileScopeName(binding.name.text, binding.propertyName.text, predecl);
                 }
             }
         }
     }
 
+    // modules implemented by cpplib/core.h, nothing to include
+    private processRuntimeModuleImport(node: ts.ImportDeclaration, runtimeNamespace: string, predecl: boolean): void {
+        if (predecl || !node.importClause || !node.importClause.namedBindings) {
+            return;
+        }
+
+        const namedBindings = node.importClause.namedBindings;
+        if (namedBindings.kind === ts.SyntaxKind.NamespaceImport) {
+            if (namedBindings.name.text !== runtimeNamespace.substr(runtimeNamespace.lastIndexOf(':') + 1)) {
+                this.writer.writeString('namespace ');
+                this.processExpression(namedBindings.name);
+                this.writer.writeStringNewLine(' = ' + runtimeNamespace + ';');
+                this.addFileScopeName(namedBindings.name.text, runtimeNamespace, predecl);
+            }
+
+            return;
+        }
+
+        for (const binding of (<ts.NamedImports>namedBindings).elements) {
+            const imported = (binding.propertyName || binding.name).text;
+            const local = binding.name.text;
+            const member = runtimeNamespace + '::' + imported;
+            if (imported === local) {
+                this.writer.writeStringNewLine('using ' + member + ';');
+            } else if (imported === 'promises') {
+                this.writer.writeStringNewLine('namespace ' + local + ' = ' + member + ';');
+            } else if (imported[0] >= 'A' && imported[0] <= 'Z') {
+                // types such as Stats
+                this.writer.writeStringNewLine('using ' + local + ' = ' + member + ';');
+            } else {
+                // functions are overloaded and have default arguments, a reference would
+                // pick one overload and lose the defaults
+                this.writer.writeStringNewLine('const auto ' + local + ' = [](auto &&...args) -> decltype(auto) { return '
+                    + member + '(std::forward<decltype(args)>(args)...); };');
+            }
+
+            this.addFileScopeName(local, member, predecl);
+        }
+    }
+
+    private addFileScopeName(name: string, definition: string, predecl: boolean) {
+        if (this.isHeader() && !predecl) {
+            this.fileScopeNames.push(name + '=' + definition);
+        }
+    }
+
     private processVariableDeclarationList(declarationList: ts.VariableDeclarationList, forwardDeclaration?: boolean): boolean {
 
         if (this.isDeclare(declarationList.parent) && !forwardDeclaration) {
@@ -2804,9 +2945,17 @@ export class Emitter {
         /*if (things.isArrowFunction || things.isFunctionExpression) {
             this.writer.writeStringNewLine(') mutable');
         } else {*/
-            this.writer.writeStringNewLine(')');
+            this.writer.writeString(')');
         //}
 
+        // coroutine lambdas can't deduce their return type
+        if (this.isAsync(node) && !things.isFunctionOrMethodDeclaration) {
+            this.writer.writeString(' -> ');
+            this.writer.writeString(things.inferredReturnType);
+        }
+
+        this.writer.writeStringNewLine();
+
         if (obsoleteConstructor) {
             this.writer.writeStringNewLine();
             return true;
@@ -2826,6 +2975,11 @@ export class Emitter {
         if (!noBody && (things.isArrowFunction || things.isFunctionExpression || implementationMode)) {
             this.writer.BeginBlock();
 
+            // a coroutine can resume on another thread, its scope would leave the wrong call tree
+            if (this.cmdLineOptions && this.cmdLineOptions.instrument && !this.isAsync(node)) {
+                this.writeProfileProbe(this.getProfileName(node), node);
+            }
+
             node.parameters
                 .filter(e => e.dotDotDotToken)
                 .forEach(element => {
@@ -2847,11 +3001,15 @@ export class Emitter {
 
             this.markRequiredCapture(node);
             (<any>node.body).statements.filter((item, index) => index >= skipped).forEach(element => {
-                this.processStatementInternal(element, true);
+                this.processStatement(element, true);
             });
 
-            // add default return if no body
-            if (node.kind !== ts.SyntaxKind.Constructor && things.noReturnStatement && things.inferredReturnType != 'void') {
+            // async body without a value return still has to be a coroutine
+            if (this.isAsync(node) && things.noReturn) {
+                this.writer.writeString('co_return');
+                this.writer.EndOfStatement();
+            } else if (node.kind !== ts.SyntaxKind.Constructor && things.noReturnStatement && things.inferredReturnType != 'void') {
+                // add default return if no body
                 this.writer.writeString('return ');
                 this.writer.writeString(things.inferredReturnType);
                 this.writer.writeString('()');
@@ -2879,6 +3037,47 @@ export class Emitter {
 
     }
 
+    // -instrument: times the enclosing body into the per-thread call tree of js::profile,
+    // the frame is named "name (file.ts:line)"
+    private writeProfileProbe(name: string, node: ts.Node) {
+        if (node.pos >= 0 && node.getSourceFile() === this.sourceFile) {
+            const file = Helpers.getSubPath(Helpers.cleanUpPath(this.sourceFileName), Helpers.cleanUpPath(this.emitFiles.rootFolder));
+            const position = this.sourceFile.getLineAndCharacterOfPosition(node.getStart(this.sourceFile));
+            name += node.kind === ts.SyntaxKind.SourceFile ? ` (${file})` : ` (${file}:${position.line + 1})`;
+        }
+
+        this.writer.writeString(`static js::profile::site __profile_site{${JSON.stringify(name)}}`);
+        this.writer.EndOfStatement();
+        this.writer.writeString('js::profile::scope __profile_scope(__profile_site)');
+        this.writer.EndOfStatement();
+    }
+
+    private getProfileName(node: FuncExpr): string {
+        const name = (n: ts.Node) => n && (n.kind === ts.SyntaxKind.Identifier || n.kind === ts.SyntaxKind.StringLiteral)
+            ? (<ts.Identifier | ts.StringLiteral>n).text
+            : undefined;
+
+        if (node.kind === ts.SyntaxKind.Constructor || name(node.name)) {
+            const member = node.kind === ts.SyntaxKind.Constructor ? 'constructor' : name(node.name);
+            const parent = node.parent;
+            if (parent && (parent.kind === ts.SyntaxKind.ClassDeclaration || parent.kind === ts.SyntaxKind.ClassExpression)
+                && (<ts.ClassLikeDeclaration>parent).name) {
+                return (<ts.ClassLikeDeclaration>parent).name.text + '.' + member;
+            }
+
+            return member;
+        }
+
+        // const f = () => ..., { f: function () ... }
+        const parent = node.parent;
+        if (parent && (parent.kind === ts.SyntaxKind.VariableDeclaration || parent.kind === ts.SyntaxKind.PropertyAssignment)
+            && name((<ts.VariableDeclaration | ts.PropertyAssignment>parent).name)) {
+            return name((<ts.VariableDeclaration | ts.PropertyAssignment>parent).name);
+        }
+
+        return 'anonymous';
+    }
+
     private processFunctionExpressionLambda(
         node: FuncExpr, things: FuncDefThings,
         implementationMode?: boolean) {
@@ -3238,6 +3437,14 @@ export class Emitter {
         return node.modifiers && node.modifiers.some(m => m.kind === ts.SyntaxKind.DeclareKeyword);
     }
 
+    private isAsync(node: ts.Node) {
+        return node && node.modifiers && node.modifiers.some(m => m.kind === ts.SyntaxKind.AsyncKeyword);
+    }
+
+    private isInAsyncFunction() {
+        return this.isAsync(this.scope[this.scope.length - 1]);
+    }
+
     private processFunctionDeclaration(node: ts.FunctionDeclaration | ts.MethodDeclaration, implementationMode?: boolean): boolean {
 
         if (!implementationMode) {
@@ -3272,7 +3479,8 @@ export class Emitter {
             functionReturn = null;
         }
 
-        this.writer.writeString('return');
+        const isAsync = this.isAsync(functionDeclaration);
+        this.writer.writeString(isAsync ? 'co_return' : 'return');
         if (node.expression) {
             this.writer.writeString(' ');
 
@@ -3307,7 +3515,7 @@ export class Emitter {
             }
             */
         } else {
-            if (functionReturn && functionReturn.kind !== ts.SyntaxKind.VoidKeyword) {
+            if (!isAsync && functionReturn && functionReturn.kind !== ts.SyntaxKind.VoidKeyword) {
                 this.writer.writeString(' ');
                 this.processType(functionReturn);
                 this.writer.writeString('()');
@@ -3441,11 +3649,30 @@ export class Emitter {
         const isTheSameTypes = caseExpressions.every(
             ce => this.resolver.typesAreTheSame(this.resolver.getOrResolveTypeOfAsTypeNode(ce), firstTypeNode));
 
+        const discriminantType = this.resolver.getOrResolveTypeOf(node.expression);
+        const numericValues = caseExpressions.map(expression => this.getNumericCaseValue(expression));
+        if (numericValues.every(value => value !== undefined)
+            && (this.resolver.isNumberType(discriminantType) || this.resolver.isAnyLikeType(discriminantType))) {
+            this.processSwitchStatementForNumbersInternal(node, numericValues);
+            return;
+        }
+
         if (isTheSameTypes && isAllStatic && !this.resolver.isStringType(firstType)) {
             this.processSwitchStatementForBasicTypesInternal(node);
             return;
         }
 
+        // printable ASCII keys hash the same in UTF-8 and wide builds
+        const isAsciiStrings = caseExpressions
+            .every(expression => (expression.kind === ts.SyntaxKind.StringLiteral
+                || expression.kind === ts.SyntaxKind.NoSubstitutionTemplateLiteral)
+                && /^[\x20-\x7e]*$/.test((<ts.LiteralExpression>expression).text));
+
+        if (isAsciiStrings && this.resolver.isStringType(this.resolver.getOrResolveTypeOf(node.expression))) {
+            this.processSwitchStatementForStringsInternal(node);
+            return;
+        }
+
         this.processSwitchStatementForAnyInternal(node);
     }
 
@@ -3495,33 +3722,197 @@ export class Emitter {
         this.writer.EndBlock();
     }
 
+    // value of a numeric literal, a signed one or a numeric enum member; undefined otherwise
+    private getNumericCaseValue(expression: ts.Expression): number {
+        switch (expression.kind) {
+            case ts.SyntaxKind.NumericLiteral:
+                return Number((<ts.NumericLiteral>expression).text);
+            case ts.SyntaxKind.PrefixUnaryExpression:
+                const prefixUnary = <ts.PrefixUnaryExpression>expression;
+                const operand = prefixUnary.operand.kind === ts.SyntaxKind.NumericLiteral
+                    ? Number((<ts.NumericLiteral>prefixUnary.operand).text)
+                    : undefined;
+                if (operand === undefined) {
+                    return undefined;
+                }
+
+                return prefixUnary.operator === ts.SyntaxKind.MinusToken
+                    ? -operand
+                    : prefixUnary.operator === ts.SyntaxKind.PlusToken ? operand : undefined;
+            case ts.SyntaxKind.PropertyAccessExpression:
+            case ts.SyntaxKind.ElementAccessExpression:
+                const value = this.typeChecker.getConstantValue(<ts.PropertyAccessExpression | ts.ElementAccessExpression>expression);
+                return typeof value === 'number' ? value : undefined;
+            default:
+                return undefined;
+        }
+    }
+
+    // number or any discriminant over constant numeric cases, unboxed once: integers
+    // become a native switch (the C++ compiler picks a jump table or a binary search),
+    // other values a binary search over a sorted number_switch table
+    private processSwitchStatementForNumbersInternal(node: ts.SwitchStatement, values: number[]) {
+        const isInteger = values.every(value => Number.isSafeInteger(value));
+        if (isInteger) {
+            this.writer.writeString('switch (switch_int(');
+            this.processExpression(node.expression);
+            this.writer.writeStringNewLine('))');
+
+            this.writer.BeginBlock();
+
+            let caseNumber = 0;
+            const seen = new Set<number>();
+            node.caseBlock.clauses.forEach(element => {
+                this.writer.DecreaseIntent();
+                if (element.kind === ts.SyntaxKind.CaseClause) {
+                    const value = values[caseNumber++];
+                    // a repeated value belongs to the first clause, this one is reached by fall-through only
+                    if (seen.has(value)) {
+                        this.writer.IncreaseIntent();
+                        element.statements.forEach(elementCase => {
+                            this.processStatement(elementCase);
+                        });
+                        return;
+                    }
+
+                    seen.add(value);
+                    const isLong = value > 0x7fffffff || value < -0x80000000;
+                    this.writer.writeString(`case ${value}${isLong ? 'LL' : ''}`);
+                } else {
+                    this.writer.writeString('default');
+                }
+
+                this.writer.IncreaseIntent();
+
+                this.writer.writeStringNewLine(':');
+                element.statements.forEach(elementCase => {
+                    this.processStatement(elementCase);
+                });
+            });
+
+            this.writer.EndBlock();
+            return;
+        }
+
+        const cases: Array<{ value: number, label: number }> = [];
+        values.forEach((value, index) => {
+            if (!cases.some(c => c.value === value)) {
+                cases.push({ value, label: index + 1 });
+            }
+        });
+
+        cases.sort((left, right) => left.value - right.value);
+
+        const switchName = `__switch${node.getFullStart()}_${node.getEnd()}`;
+        this.writer.writeString(`static const js::number_switch<${cases.length}> ${switchName} = `);
+        this.writer.BeginBlock();
+        this.writer.BeginBlock();
+        cases.forEach((c, index) => {
+            this.writer.writeString(`{ ${String(c.value)}, ${c.label} }${index + 1 < cases.length ? ',' : ''}`);
+            this.writer.writeStringNewLine();
+        });
+        this.writer.EndBlock();
+        this.writer.EndBlock();
+        this.writer.EndOfStatement();
+
+        this.writer.writeString(`switch (${switchName}(`);
+        this.processExpression(node.expression);
+        this.writer.writeStringNewLine('))');
+
+        this.processSwitchCaseClauses(node);
+    }
+
+    // string literal cases: perfect hash found at compile time, see string_switch in core.h
+    private processSwitchStatementForStringsInternal(node: ts.SwitchStatement) {
+        const switchName = `__switch${node.getFullStart()}_${node.getEnd()}`;
+        const keys: string[] = [];
+        const labels: number[] = [];
+        node.caseBlock.clauses.filter(c => c.kind === ts.SyntaxKind.CaseClause).forEach((element, index) => {
+            const key = (<ts.LiteralExpression>(<ts.CaseClause>element).expression).text;
+            // a repeated key can never be reached
+            if (keys.indexOf(key) === -1) {
+                keys.push(key);
+                labels.push(index + 1);
+            }
+        });
+
+        const perfectHash = Helpers.findPerfectHash(keys);
+        const slots = new Array<string>(perfectHash.size).fill('{ nullptr, 0, 0 }');
+        keys.forEach((key, index) => {
+            slots[perfectHash.slots[index]] = `{ TXT(${JSON.stringify(key)}), ${key.length}, ${labels[index]} }`;
+        });
+
+        this.writer.writeString(`static const js::string_switch<${perfectHash.size}, ${perfectHash.displacements.length}> ${switchName} = `);
+        this.writer.BeginBlock();
+        this.writer.writeString(`0x${perfectHash.seed.toString(16)}u,`);
+        this.writer.writeStringNewLine();
+        this.writer.writeString(`{ ${perfectHash.displacements.map(d => `0x${d.toString(16)}u`).join(', ')} },`);
+        this.writer.writeStringNewLine();
+        this.writer.BeginBlock();
+        slots.forEach((slot, index) => {
+            this.writer.writeString(slot + (index + 1 < slots.length ? ',' : ''));
+            this.writer.writeStringNewLine();
+        });
+        this.writer.EndBlock();
+        this.writer.EndBlock();
+        this.writer.EndOfStatement();
+
+        this.writer.writeString(`switch (${switchName}(`);
+        this.processExpression(node.expression);
+        this.writer.writeStringNewLine('))');
+
+        this.processSwitchCaseClauses(node);
+    }
+
     private processSwitchStatementForAnyInternal(node: ts.SwitchStatement) {
 
         const switchName = `__switch${node.getFullStart()}_${node.getEnd()}`;
-        const isAllStatic = node.caseBlock.clauses
+        const caseExpressions = node.caseBlock.clauses
             .filter(c => c.kind === ts.SyntaxKind.CaseClause)
-            .map(element => (<ts.CaseClause>element).expression)
+            .map(element => (<ts.CaseClause>element).expression);
+        const isAllStatic = caseExpressions
             .every(expression => expression.kind === ts.SyntaxKind.NumericLiteral
                 || expression.kind === ts.SyntaxKind.StringLiteral
                 || expression.kind === ts.SyntaxKind.TrueKeyword
                 || expression.kind === ts.SyntaxKind.FalseKeyword);
 
-        if (isAllStatic) {
-            this.writer.writeString('static ');
+        if (!isAllStatic) {
+            // cases are evaluated in order until one equals the discriminant, as in JS
+            this.writer.writeString('switch ([&]() ');
+            this.writer.BeginBlock();
+            this.writer.writeString(`auto &&${switchName} = `);
+            this.processExpression(node.expression);
+            this.writer.EndOfStatement();
+            caseExpressions.forEach((expression, index) => {
+                const isEnum = this.resolver.isTypeFromSymbol(this.resolver.getOrResolveTypeOf(expression), ts.SyntaxKind.EnumDeclaration);
+                this.writer.writeString(`if (${switchName} == `);
+                this.writer.writeString(isEnum ? 'static_cast<long>(' : '(');
+                this.processExpression(expression);
+                this.writer.writeString(`)) return ${index + 1}`);
+                this.writer.EndOfStatement();
+            });
+
+            this.writer.writeString('return 0');
+            this.writer.EndOfStatement();
+            this.writer.EndBlock(true);
+            this.writer.writeStringNewLine('())');
+
+            this.processSwitchCaseClauses(node);
+            return;
         }
 
-        this.writer.writeString(`switch_type ${switchName} = `);
+        this.writer.writeString(`static const switch_type ${switchName} = `);
         this.writer.BeginBlock();
 
         let caseNumber = 0;
-        node.caseBlock.clauses.filter(c => c.kind === ts.SyntaxKind.CaseClause).forEach(element => {
+        caseExpressions.forEach(expression => {
             if (caseNumber > 0) {
                 this.writer.writeStringNewLine(',');
             }
 
             this.writer.BeginBlockNoIntent();
             this.writer.writeString('any(');
-            this.processExpression((<ts.CaseClause>element).expression);
+            this.processExpression(expression);
             this.writer.writeString('), ');
             this.writer.writeString((++caseNumber).toString());
             this.writer.EndBlockNoIntent();
@@ -3530,14 +3921,18 @@ export class Emitter {
         this.writer.EndBlock();
         this.writer.EndOfStatement();
 
-
-        this.writer.writeString(`switch (${switchName}[`);
+        this.writer.writeString(`switch (switch_case(${switchName}, `);
         this.processExpression(node.expression);
-        this.writer.writeStringNewLine('])');
+        this.writer.writeStringNewLine('))');
+
+        this.processSwitchCaseClauses(node);
+    }
 
+    // case clauses numbered from 1 in source order, 0 selects default
+    private processSwitchCaseClauses(node: ts.SwitchStatement) {
         this.writer.BeginBlock();
 
-        caseNumber = 0;
+        let caseNumber = 0;
         node.caseBlock.clauses.forEach(element => {
             this.writer.DecreaseIntent();
             if (element.kind === ts.SyntaxKind.CaseClause) {
@@ -3653,9 +4048,11 @@ export class Emitter {
     }
 
     private processRegularExpressionLiteral(node: ts.RegularExpressionLiteral): void {
-        this.writer.writeString('(new RegExp(');
-        this.processStringLiteral(<ts.LiteralLikeNode>{ text: node.text.substring(1, node.text.length - 2) });
-        this.writer.writeString('))');
+        // compiled once into static storage by the REGEXP macro
+        const end = node.text.lastIndexOf('/');
+        const pattern = JSON.stringify(node.text.substring(1, end)).slice(1, -1);
+        const flags = node.text.substring(end + 1);
+        this.writer.writeString(`REGEXP("${pattern}", "${flags}")`);
     }
 
     private processObjectLiteralExpression(node: ts.ObjectLiteralExpression): void {
@@ -4047,10 +4444,16 @@ export class Emitter {
             || opCode === ts.SyntaxKind.BarBarToken;
         const op = this.opsMap[node.operatorToken.kind];
         const isFunction = op.substr(0, 2) === '__';
+        // AND() and OR() are macros in core.h
+        const isMacro = wrapIntoRoundBrackets;
         if (isFunction) {
             this.writer.writeString(op.substr(2) + '(');
         }
 
+        if (isMacro) {
+            this.macroArgumentDepth++;
+        }
+
         const leftType = this.resolver.getOrResolveTypeOf(node.left);
         const rightType = this.resolver.getOrResolveTypeOf(node.right);
 
@@ -4110,6 +4513,10 @@ export class Emitter {
             this.writer.writeString(')');
         }
 
+        if (isMacro) {
+            this.macroArgumentDepth--;
+        }
+
         if (isFunction) {
             this.writer.writeString(')');
         }
@@ -4148,8 +4555,13 @@ export class Emitter {
     private processCallExpression(node: ts.CallExpression | ts.NewExpression): void {
 
         const isNew = node.kind === ts.SyntaxKind.NewExpression;
+        if (!isNew && this.cmdLineOptions && this.cmdLineOptions.binary_log && this.processBinaryLogCall(<ts.CallExpression>node)) {
+            return;
+        }
+
         const typeOfExpression = isNew && this.resolver.getOrResolveTypeOf(node.expression);
         const isArray = isNew && typeOfExpression && typeOfExpression.symbol && typeOfExpression.symbol.name === 'ArrayConstructor';
+        const isPromise = isNew && typeOfExpression && typeOfExpression.symbol && typeOfExpression.symbol.name === 'PromiseConstructor';
 
         this.isInvokableClassRefInStack = false;
         let invclassref = false;
@@ -4181,6 +4593,9 @@ export class Emitter {
 
 
             this.processTemplateArguments(node);
+            if (isPromise && !node.typeArguments) {
+                this.writer.writeString('<>');
+            }
         }
 
         if (isArray || (isNew && !invclassref)) {
@@ -4205,6 +4620,71 @@ export class Emitter {
         this.writer.writeString(')');
     }
 
+    private processBinaryLogCall(node: ts.CallExpression): boolean {
+        if (node.expression.kind !== ts.SyntaxKind.PropertyAccessExpression) {
+            return false;
+        }
+
+        const propertyAccess = <ts.PropertyAccessExpression>node.expression;
+        const level = propertyAccess.name.text;
+        if (!this.isConsoleReference(propertyAccess.expression)
+            || ['log', 'warn', 'error', 'debug'].indexOf(level) === -1
+            || node.arguments.some(a => a.kind === ts.SyntaxKind.SpreadElement)) {
+            return false;
+        }
+
+        const file = Helpers.getSubPath(Helpers.cleanUpPath(this.sourceFileName), Helpers.cleanUpPath(this.emitFiles.rootFolder));
+        const position = node.getSourceFile().getLineAndCharacterOfPosition(node.getStart());
+        const site: BinaryLogSite = {
+            id: Helpers.fnv1a(`${file}:${position.line + 1}:${position.character + 1}`),
+            file,
+            line: position.line + 1,
+            column: position.character + 1,
+            level,
+            parts: node.arguments.map(a => {
+                switch (a.kind) {
+                    case ts.SyntaxKind.StringLiteral:
+                    case ts.SyntaxKind.NoSubstitutionTemplateLiteral:
+                        return (<ts.LiteralExpression>a).text;
+                    case ts.SyntaxKind.NumericLiteral:
+                        return String(Number((<ts.NumericLiteral>a).text));
+                    default:
+                        return null;
+                }
+            })
+        };
+
+        this.binaryLogSites.push(site);
+
+        this.writer.writeString(`js::binlog::write(0x${site.id.toString(16)}u, js::binlog::level::${level}`);
+        node.arguments.forEach((element, index) => {
+            if (site.parts[index] === null) {
+                this.writer.writeString(', ');
+                this.processExpression(element);
+            }
+        });
+
+        this.writer.writeString(')');
+        return true;
+    }
+
+    // console or a variable holding it (const c = console), i.e. an identifier typed as the
+    // default library's Console; other expressions are not matched, a record is written
+    // without evaluating the receiver
+    private isConsoleReference(node: ts.Expression): boolean {
+        if (node.kind !== ts.SyntaxKind.Identifier) {
+            return false;
+        }
+
+        if ((<ts.Identifier>node).text === 'console') {
+            return true;
+        }
+
+        const type = this.resolver.getOrResolveTypeOf(node);
+        const declaration = type && type.symbol && type.symbol.name === 'Console' && this.resolver.getFirstDeclaration(type.symbol);
+        return !!declaration && declaration.getSourceFile().hasNoDefaultLib;
+    }
+
     private processThisExpression(node: ts.ThisExpression): void {
 
         const method = this.scope[this.scope.length - 1];
@@ -4290,10 +4770,35 @@ export class Emitter {
     }
 
     private processAwaitExpression(node: ts.AwaitExpression): void {
-        //this.writer.writeString('std::async([=]() { ');
-        this.writer.writeString('std::async([&]() { ');
+        const typeInfo = this.resolver.getOrResolveTypeOf(node.expression);
+        const isPromise = typeInfo && typeInfo.symbol && typeInfo.symbol.name === 'Promise';
+        if (this.isInAsyncFunction()) {
+            // async functions are coroutines, the frame is resumed from the event loop
+            this.writer.writeString('co_await ');
+            // runtime awaitables such as sleep() are not known to the type checker
+            if (isPromise || this.resolver.isNotDetected(typeInfo)) {
+                this.processExpression(node.expression);
+            } else {
+                this.writer.writeString('Promise<>::resolve(');
+                this.processExpression(node.expression);
+                this.writer.writeString(')');
+            }
+
+            return;
+        }
+
+        if (isPromise) {
+            // promises settle on the event loop, await keeps it turning meanwhile
+            this.writer.writeString('js::await(');
+            this.processExpression(node.expression);
+            this.writer.writeString(')');
+            return;
+        }
+
+        // runs on the runtime executor, caller helps with queued work until the result is ready
+        this.writer.writeString('js::await(js::async([&]() { return ');
         this.processExpression(node.expression);
-        this.writer.writeString('; })');
+        this.writer.writeString('; }))');
     }
 
     private resolveIdentifierNamespace(node: ts.Identifier): ts.TypeNode {
@@ -4477,7 +4982,13 @@ export class Emitter {
             }
 
             // field access
-            this.processExpression(node.expression);
+            const isPromiseStatic = typeInfo && typeInfo.symbol && typeInfo.symbol.name === 'PromiseConstructor';
+            if (isPromiseStatic) {
+                // Promise.all/race/resolve/reject are statics of the runtime template
+                this.writer.writeString('Promise<>');
+            } else {
+                this.processExpression(node.expression);
+            }
 
             if (node.expression.kind === ts.SyntaxKind.NewExpression
                 || node.expression.kind === ts.SyntaxKind.ArrayLiteralExpression) {
@@ -4490,6 +5001,7 @@ export class Emitter {
                 this.writer.writeString('"]');
                 return;
             } else */if (this.resolver.isStaticAccess(typeInfo)
+                || isPromiseStatic
                 || node.expression.kind === ts.SyntaxKind.SuperKeyword
                 || typeInfo && typeInfo.symbol && typeInfo.symbol.valueDeclaration
                 && typeInfo.symbol.valueDeclaration.kind === ts.SyntaxKind.ModuleDeclaration) {
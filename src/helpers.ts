@@ -34,6 +34,93 @@ export class Helpers {
         return beginPath + fileNameFixed + endExt;
     }
 
+    // 32-bit FNV-1a over UTF-16 code units
+    public static fnv1a(text: string): number {
+        let hash = 0x811c9dc5;
+        for (let i = 0; i < text.length; i++) {
+            hash ^= text.charCodeAt(i);
+            hash = Math.imul(hash, 0x01000193);
+        }
+
+        return hash >>> 0;
+    }
+
+    // seeded FNV-1a over code units, the same function as js::string_switch::hash
+    public static switchHash(seed: number, key: string): number {
+        let hash = (0x811c9dc5 ^ seed) >>> 0;
+        for (let i = 0; i < key.length; i++) {
+            hash ^= key.charCodeAt(i);
+            hash = Math.imul(hash, 0x01000193);
+        }
+
+        return (hash ^ (hash >>> 16)) >>> 0;
+    }
+
+    // slot of a key hash under its bucket's displacement, js::string_switch::place
+    public static switchPlace(hash: number, displacement: number): number {
+        let value = (hash ^ displacement) >>> 0;
+        value = Math.imul(value ^ (value >>> 16), 0x85ebca6b);
+        value = Math.imul(value ^ (value >>> 13), 0xc2b2ae35);
+        return (value ^ (value >>> 16)) >>> 0;
+    }
+
+    // CHD (hash, displace): the seeded hash picks one of ~n/4 buckets, each bucket gets the
+    // displacement that moves all its keys into free slots of a power-of-two table with at
+    // least n * 5/4 slots. Buckets are placed largest first; the table stays linear in the
+    // number of (distinct) keys.
+    public static findPerfectHash(keys: string[]): { seed: number, size: number, displacements: number[], slots: number[] } {
+        let size = 1;
+        while (size < keys.length + (keys.length >> 2)) {
+            size <<= 1;
+        }
+
+        let bucketCount = 1;
+        while (bucketCount * 4 < keys.length) {
+            bucketCount <<= 1;
+        }
+
+        for (let seed = 0; seed < 4096; seed++) {
+            const hashes = keys.map(key => Helpers.switchHash(seed, key));
+            if (new Set(hashes).size !== hashes.length) {
+                continue;
+            }
+
+            const buckets = new Array<number[]>(bucketCount);
+            for (let index = 0; index < bucketCount; index++) {
+                buckets[index] = [];
+            }
+
+            hashes.forEach((hash, index) => buckets[hash & (bucketCount - 1)].push(index));
+            const order = buckets.map((_, index) => index).sort((left, right) => buckets[right].length - buckets[left].length);
+
+            const taken = new Uint8Array(size);
+            const displacements = new Array<number>(bucketCount).fill(0);
+            const slots = new Array<number>(keys.length);
+            const placed = order.every(bucket => {
+                const members = buckets[bucket];
+                for (let displacement = 0; displacement < 0x10000; displacement++) {
+                    const candidate = members.map(index => Helpers.switchPlace(hashes[index], displacement) & (size - 1));
+                    if (candidate.every((slot, index) => !taken[slot] && candidate.indexOf(slot) === index)) {
+                        candidate.forEach((slot, index) => {
+                            taken[slot] = 1;
+                            slots[members[index]] = slot;
+                        });
+                        displacements[bucket] = displacement;
+                        return true;
+                    }
+                }
+
+                return false;
+            });
+
+            if (placed) {
+                return { seed, size, displacements, slots };
+            }
+        }
+
+        throw new Error('No perfect hash for switch cases: ' + keys.join(', '));
+    }
+
     public static cleanUpPath(path: string) {
         if (!path) {
             return;
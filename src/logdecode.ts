@@ -0,0 +1,43 @@
+import * as fs from 'fs-extra';
+import { LogDecoder } from './logdecoder';
+
+declare var process: any;
+
+const args: string[] = process.argv.slice(2);
+const inputs: Array<string | number> = [];
+const decoder = new LogDecoder(args.indexOf('-timestamps') !== -1);
+args.filter(a => a[0] !== '-').forEach(a => {
+    if (a.endsWith('.json')) {
+        decoder.addSites(a);
+    } else {
+        inputs.push(a);
+    }
+});
+
+if (args.length === 0 || args.indexOf('-help') !== -1) {
+    console.log(`Syntax:   tsc-cxx-logdecode [-timestamps] <file.binlog.json...> [log...]
+
+    Decodes the output of a program compiled with tsc-cxx -binary_log, reads stdin
+    when no log file is given.
+
+    Examples: ./app | tsc-cxx-logdecode app.binlog.json
+              tsc-cxx-logdecode -timestamps app.binlog.json lib.binlog.json app.log
+    `);
+} else {
+    if (inputs.length === 0) {
+        inputs.push(0);
+    }
+
+    try {
+        inputs.forEach(input => decoder.decode(fs.readFileSync(<any>input), (level, text) => {
+            if (level === 'log') {
+                process.stdout.write(text);
+            } else {
+                process.stderr.write(text);
+            }
+        }));
+    } catch (e) {
+        console.error(e.message);
+        process.exitCode = 1;
+    }
+}
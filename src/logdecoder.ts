@@ -0,0 +1,126 @@
+import * as fs from 'fs-extra';
+import { BinaryLogSite } from './emitter';
+
+// Decodes console output written by programs compiled with -binary_log (see binlog in
+// cpplib/core.h) back into the text console.* would have printed. Bytes outside
+// records, e.g. uncaught exception messages, are copied through unchanged, so is a
+// magic whose size, size complement or closing byte do not check out. A record holding
+// a value it cannot read is printed as <undecodable record ...> with its payload in hex.
+export class LogDecoder {
+    private static readonly recordMagic = Buffer.from([0x1e, 0x62, 0x6c, 0x01]);
+    private static readonly recordEnd = 0x1f;
+    private static readonly headerSize = 12;
+    // site, level and time
+    private static readonly minimumSize = 13;
+    private static readonly levels = ['log', 'warn', 'error', 'debug'];
+
+    private sites = new Map<number, BinaryLogSite>();
+
+    public constructor(private timestamps = false) {
+    }
+
+    public addSites(fileName: string) {
+        const table = JSON.parse(fs.readFileSync(fileName).toString());
+        Object.keys(table.sites).forEach(id => this.sites.set(Number(id), table.sites[id]));
+    }
+
+    public decode(data: Buffer, out: (level: string, text: string) => void) {
+        // start of the text not yet passed through
+        let text = 0;
+        for (let offset = data.indexOf(LogDecoder.recordMagic); offset !== -1; offset = data.indexOf(LogDecoder.recordMagic, offset)) {
+            const size = this.recordSize(data, offset);
+            if (size === -1) {
+                offset++;
+                continue;
+            }
+
+            if (offset > text) {
+                out('log', data.toString('utf8', text, offset));
+            }
+
+            const start = offset + LogDecoder.headerSize;
+            const [level, line] = this.decodeRecord(data.slice(start, start + size));
+            out(level, line);
+            offset = text = start + size + 1;
+        }
+
+        if (text < data.length) {
+            out('log', data.toString('utf8', text));
+        }
+    }
+
+    // payload size of the record at offset, -1 when the header does not validate
+    private recordSize(data: Buffer, offset: number): number {
+        if (offset + LogDecoder.headerSize > data.length) {
+            return -1;
+        }
+
+        const size = data.readUInt32LE(offset + 4);
+        const check = data.readUInt32LE(offset + 8);
+        const end = offset + LogDecoder.headerSize + size;
+        if (((size ^ check) >>> 0) !== 0xffffffff || size < LogDecoder.minimumSize || end >= data.length || data[end] !== LogDecoder.recordEnd) {
+            return -1;
+        }
+
+        return size;
+    }
+
+    private decodeRecord(record: Buffer): [string, string] {
+        const id = record.readUInt32LE(0);
+        const level = LogDecoder.levels[record[4]] || 'log';
+        const milliseconds = (record.readUInt32LE(9) * 0x100000000 + record.readUInt32LE(5)) / 1e6;
+
+        // a value this decoder does not know ends only its own record
+        const values = this.decodeValues(record);
+        const site = this.sites.get(id);
+        let text = !values
+            ? `<undecodable record of site 0x${id.toString(16)} ${record.toString('hex')}>`
+            : site
+                ? site.parts.map(part => part === null ? values.shift() : part).join('')
+                : `<unknown site 0x${id.toString(16)}> ${values.join(' ')}`;
+        if (this.timestamps) {
+            const location = site ? `${site.file}:${site.line}:${site.column}` : '?';
+            text = `${new Date(Math.floor(milliseconds)).toISOString()} ${level} ${location} ${text}`;
+        }
+
+        return [level, text + '\n'];
+    }
+
+    // the arguments of a record as text, undefined for an unknown tag or a value that
+    // runs past the end of the record
+    private decodeValues(record: Buffer): string[] {
+        const values: string[] = [];
+        for (let offset = LogDecoder.minimumSize; offset < record.length;) {
+            const tag = record[offset++];
+            switch (tag) {
+                case 0: values.push('undefined'); break;
+                case 1: values.push('null'); break;
+                case 2: values.push('false'); break;
+                case 3: values.push('true'); break;
+                case 4:
+                    if (offset + 8 > record.length) {
+                        return undefined;
+                    }
+
+                    values.push(String(record.readDoubleLE(offset)));
+                    offset += 8;
+                    break;
+                case 5:
+                case 6: {
+                    if (offset + 4 > record.length || offset + 4 + record.readUInt32LE(offset) > record.length) {
+                        return undefined;
+                    }
+
+                    const size = record.readUInt32LE(offset);
+                    values.push(record.toString('utf8', offset + 4, offset + 4 + size));
+                    offset += 4 + size;
+                    break;
+                }
+                default:
+                    return undefined;
+            }
+        }
+
+        return values;
+    }
+}
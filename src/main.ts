@@ -24,5 +24,14 @@ function print() {
     Options:
      -watch                                          Watch mode
      -run_after_compile <app.bat|exe>                Run extra application or batch file after compilation
+     -binary_log                                     Emit console.* as binary records, decode with tsc-cxx-logdecode
+     -line_directives                                Emit #line directives so debuggers and profilers show .ts lines
+     -source_map                                     Write a .map source map next to every .h and .cpp
+     -instrument                                     Time every function, the program writes profile.folded for flame graphs
+     -jobs <n>                                       Emit files on <n> worker threads
+     -unity <n>                                      Also emit unity_*.cpp files including <n> sources each
+     -stats                                          Print resolver cache hit rates
+     -no_cache                                       Do not use the translation cache in .tsc-cxx-cache
+     -cache_limit <MB>                               Size of the translation cache, 256 by default
      `);
 }
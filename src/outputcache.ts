@@ -0,0 +1,78 @@
+import * as fs from 'fs-extra';
+import { createHash } from 'crypto';
+
+interface OutputEntry {
+    hash: string;
+    size: number;
+    mtime: number;
+}
+
+// Keeps generated C++ files untouched when their text did not change, so make/ninja only
+// rebuild what a translation really altered. The manifest in outDir maps each written
+// file to the hash of its text plus the size and mtime it had after writing; a file
+// edited or deleted by hand no longer matches and is written again.
+export class OutputCache {
+    public static readonly manifestName = '.tsc-cxx-manifest.json';
+    private static readonly version = 1;
+
+    private entries: { [fileName: string]: OutputEntry } = {};
+    private dirty = false;
+
+    public written = 0;
+    public unchanged = 0;
+    public writtenFiles: string[] = [];
+
+    public constructor(private outDir: string) {
+        const manifest = this.outDir + OutputCache.manifestName;
+        try {
+            if (fs.existsSync(manifest)) {
+                const content = JSON.parse(fs.readFileSync(manifest).toString());
+                if (content.version === OutputCache.version) {
+                    this.entries = content.files;
+                }
+            }
+        } catch (e) {
+            // a damaged manifest only costs one full write
+        }
+    }
+
+    public static hash(text: string): string {
+        return createHash('sha1').update(text).digest('hex');
+    }
+
+    // returns true when the file had to be written
+    public write(fileName: string, text: string): boolean {
+        const hash = OutputCache.hash(text);
+        const stat = fs.existsSync(fileName) ? fs.statSync(fileName) : undefined;
+        const entry = this.entries[fileName];
+        if (stat && entry && entry.hash === hash && entry.size === stat.size && entry.mtime === stat.mtimeMs
+            || stat && !entry && stat.size === Buffer.byteLength(text) && fs.readFileSync(fileName).toString() === text) {
+            if (!entry) {
+                this.remember(fileName, hash, stat);
+            }
+
+            this.unchanged++;
+            return false;
+        }
+
+        fs.writeFileSync(fileName, text);
+        this.remember(fileName, hash, fs.statSync(fileName));
+        this.written++;
+        this.writtenFiles.push(fileName);
+        return true;
+    }
+
+    public save() {
+        if (this.dirty) {
+            fs.writeFileSync(
+                this.outDir + OutputCache.manifestName,
+                JSON.stringify({ version: OutputCache.version, files: this.entries }, null, 1));
+            this.dirty = false;
+        }
+    }
+
+    private remember(fileName: string, hash: string, stat: fs.Stats) {
+        this.entries[fileName] = { hash, size: stat.size, mtime: stat.mtimeMs };
+        this.dirty = true;
+    }
+}
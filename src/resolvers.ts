@@ -1,8 +1,62 @@
 import * as ts from 'typescript';
 
+export interface ResolverStats {
+    [name: string]: { hits: number, misses: number };
+}
+
+// one memoized question about nodes or types, with hit/miss counters for -stats
+class ResolverCache<K extends object, V> {
+    private values = new WeakMap<K, V>();
+    public hits = 0;
+    public misses = 0;
+
+    public get(key: K, compute: () => V): V {
+        if (this.values.has(key)) {
+            this.hits++;
+            return this.values.get(key);
+        }
+
+        this.misses++;
+        const value = compute();
+        this.values.set(key, value);
+        return value;
+    }
+}
+
+class ResolverCaches {
+    public getOrResolveTypeOf = new ResolverCache<ts.Node, ts.Type>();
+    public typeToTypeNode = new ResolverCache<ts.Type, ts.TypeNode>();
+    public isAnyLikeType = new ResolverCache<ts.Type, boolean>();
+    public isNumberType = new ResolverCache<ts.Type, boolean>();
+    public isStringType = new ResolverCache<ts.Type, boolean>();
+}
+
 export class IdentifierResolver {
 
+    // answers depend only on the program, so every emitter of one program shares them
+    private static programCaches = new WeakMap<ts.TypeChecker, ResolverCaches>();
+
+    private caches: ResolverCaches;
+
     public constructor(private typeChecker: ts.TypeChecker) {
+        this.caches = IdentifierResolver.programCaches.get(typeChecker);
+        if (!this.caches) {
+            this.caches = new ResolverCaches();
+            IdentifierResolver.programCaches.set(typeChecker, this.caches);
+        }
+    }
+
+    public static getStats(typeChecker: ts.TypeChecker, stats: ResolverStats = {}): ResolverStats {
+        const caches = IdentifierResolver.programCaches.get(typeChecker);
+        if (caches) {
+            Object.keys(caches).forEach(name => {
+                const total = stats[name] || (stats[name] = { hits: 0, misses: 0 });
+                total.hits += caches[name].hits;
+                total.misses += caches[name].misses;
+            });
+        }
+
+        return stats;
     }
 
     public getFirstDeclaration(symbol: ts.Symbol): ts.Declaration {
@@ -85,10 +139,12 @@ export class IdentifierResolver {
             return false;
         }
 
-        const isAnonymousObject = ((<ts.ObjectType>typeInfo).objectFlags & ts.ObjectFlags.Anonymous) === ts.ObjectFlags.Anonymous;
-        return (isAnonymousObject
-            && (!typeInfo.symbol.name || typeInfo.symbol.name === '__type' || typeInfo.symbol.name === '__object'))
-            || (<any>typeInfo).intrinsicName === 'any';
+        return this.caches.isAnyLikeType.get(typeInfo, () => {
+            const isAnonymousObject = ((<ts.ObjectType>typeInfo).objectFlags & ts.ObjectFlags.Anonymous) === ts.ObjectFlags.Anonymous;
+            return (isAnonymousObject
+                && (!typeInfo.symbol.name || typeInfo.symbol.name === '__type' || typeInfo.symbol.name === '__object'))
+                || (<any>typeInfo).intrinsicName === 'any';
+        });
     }
 
     public isTypeFromSymbol(node: ts.Node | ts.Type, kind: ts.SyntaxKind) {
@@ -153,15 +209,17 @@ export class IdentifierResolver {
             return false;
         }
 
-        if ((<any>typeInfo).intrinsicName === 'number') {
-            return true;
-        }
+        return this.caches.isNumberType.get(typeInfo, () => {
+            if ((<any>typeInfo).intrinsicName === 'number') {
+                return true;
+            }
 
-        if (!typeInfo.symbol && (<any>typeInfo).value !== undefined && typeof((<any>typeInfo).value) === 'number') {
-            return true;
-        }
+            if (!typeInfo.symbol && (<any>typeInfo).value !== undefined && typeof((<any>typeInfo).value) === 'number') {
+                return true;
+            }
 
-        return this.isNumberTypeFromSymbol(typeInfo.symbol);
+            return this.isNumberTypeFromSymbol(typeInfo.symbol);
+        });
     }
 
     public isNumberTypeFromSymbol(symbol: ts.Symbol) {
@@ -180,15 +238,17 @@ export class IdentifierResolver {
             return false;
         }
 
-        if ((<any>typeInfo).intrinsicName === 'string') {
-            return true;
-        }
+        return this.caches.isStringType.get(typeInfo, () => {
+            if ((<any>typeInfo).intrinsicName === 'string') {
+                return true;
+            }
 
-        if (!typeInfo.symbol && (<any>typeInfo).value && typeof((<any>typeInfo).value) === 'string') {
-            return true;
-        }
+            if (!typeInfo.symbol && (<any>typeInfo).value && typeof((<any>typeInfo).value) === 'string') {
+                return true;
+            }
 
-        return this.isStringTypeFromSymbol(typeInfo.symbol);
+            return this.isStringTypeFromSymbol(typeInfo.symbol);
+        });
     }
 
     public isStringTypeFromSymbol(symbol: ts.Symbol) {
@@ -251,12 +311,18 @@ export class IdentifierResolver {
     }
 
     public getOrResolveTypeOf(location: ts.Node): ts.Type {
-        const type = this.getTypeAtLocation(location);
-        if (!type || this.isNotDetected(type)) {
-            return this.resolveTypeOf(location);
+        if (!location) {
+            return this.getTypeAtLocation(location);
         }
 
-        return type;
+        return this.caches.getOrResolveTypeOf.get(location, () => {
+            const type = this.getTypeAtLocation(location);
+            if (!type || this.isNotDetected(type)) {
+                return this.resolveTypeOf(location);
+            }
+
+            return type;
+        });
     }
 
     public getTypeOf(location: ts.Node): ts.Type {
@@ -277,7 +343,11 @@ export class IdentifierResolver {
     }
 
     public typeToTypeNode(type: ts.Type): ts.TypeNode {
-        return this.typeChecker.typeToTypeNode(type);
+        if (!type) {
+            return this.typeChecker.typeToTypeNode(type);
+        }
+
+        return this.caches.typeToTypeNode.get(type, () => this.typeChecker.typeToTypeNode(type));
     }
 
     public checkTypeAlias(symbol: ts.Symbol): boolean {
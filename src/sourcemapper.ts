@@ -0,0 +1,80 @@
+import * as path from 'path';
+import { SourceMapGenerator } from 'source-map';
+import { SourceMapping } from './codewriter';
+
+export interface MappedText {
+    text: string;
+    map?: string;
+}
+
+// Turns the locations CodeWriter recorded for one generated file into #line directives
+// (-line_directives), so DWARF line tables and with them perf and gdb point at the .ts
+// lines, and/or a JSON source map (-source_map). A directive is only placed in front of a
+// line whose statement started at the beginning of that line; statements written in the
+// middle of a line, e.g. inside an AND()/OR() macro argument, only go to the source map.
+export class SourceMapper {
+    public constructor(private sourceFileName: string, private generatedFileName: string) {
+    }
+
+    public apply(text: string, mappings: SourceMapping[], lineDirectives: boolean, sourceMap: boolean): MappedText {
+        const ordered = mappings.slice().sort((a, b) => a.offset - b.offset);
+        const sourceName = path.relative(path.dirname(this.generatedFileName), this.sourceFileName).replace(/\\/g, '/');
+        const generator = sourceMap ? new SourceMapGenerator({ file: path.basename(this.generatedFileName) }) : undefined;
+
+        const output = new Array<string>();
+        let next = 0;
+        let lineStart = 0;
+        let previousLine = '';
+        // recorded on blank lines, they take effect on the next line with code
+        let gap = new Array<SourceMapping>();
+        // line number the compiler gives to the next output line while a #line of the .ts is in effect
+        let sourceLine = 0;
+
+        text.split('\n').forEach(line => {
+            const onLine = new Array<SourceMapping>();
+            while (next < ordered.length && ordered[next].offset <= lineStart + line.length) {
+                onLine.push(ordered[next++]);
+            }
+
+            const code = line.trim().length > 0;
+            if (lineDirectives && code && !previousLine.endsWith('\\')) {
+                const indent = lineStart + line.length - line.trimLeft().length;
+                const atStart = gap.concat(onLine.filter(m => m.offset <= indent));
+                const mapping = atStart[atStart.length - 1];
+                if (mapping && mapping.line >= 0 && sourceLine !== mapping.line + 1) {
+                    output.push(`#line ${mapping.line + 1} "${this.sourceFileName}"`);
+                    sourceLine = mapping.line + 1;
+                } else if (mapping && mapping.line < 0 && sourceLine) {
+                    output.push(`#line ${output.length + 2} "${this.generatedFileName}"`);
+                    sourceLine = 0;
+                }
+            }
+
+            if (generator) {
+                onLine.forEach(m => generator.addMapping(m.line >= 0
+                    ? {
+                        generated: { line: output.length + 1, column: m.offset - lineStart },
+                        original: { line: m.line + 1, column: m.column },
+                        source: sourceName
+                    }
+                    : <any>{ generated: { line: output.length + 1, column: m.offset - lineStart } }));
+            }
+
+            if (code) {
+                gap = [];
+                previousLine = line;
+            } else {
+                gap = gap.concat(onLine);
+            }
+
+            if (sourceLine) {
+                sourceLine++;
+            }
+
+            output.push(line);
+            lineStart += line.length + 1;
+        });
+
+        return { text: output.join('\n'), map: generator ? generator.toString() : undefined };
+    }
+}
@@ -0,0 +1,162 @@
+import * as ts from 'typescript';
+import * as fs from 'fs-extra';
+import * as path from 'path';
+import { EmittedFile } from './emitpool';
+import { DependencyGraph } from './dependencygraph';
+import { OutputCache } from './outputcache';
+
+// Translations kept across runs, so a cold run (CI, a fresh checkout of the output) skips
+// the emitter for every file whose inputs are unchanged. An entry is keyed by
+//  - the compiler itself: its own scripts and the typescript version,
+//  - the compiler and command line options that reach the emitter,
+//  - the file name and text,
+//  - the signatures of everything the file imports, directly or not,
+//  - the signatures of the program's scripts and declaration files (ambient declarations,
+//    @types packages), whose globals any file can use without an import; the default
+//    library follows from the typescript version and the options.
+// A signature is the file text with the bodies of functions that declare their return
+// type left out, an edit inside such a body cannot change how importers are translated.
+// Entries are single JSON files, the least recently used ones are removed once the
+// folder grows past the limit.
+export class TranslationCache {
+    public static readonly folderName = '.tsc-cxx-cache';
+
+    // command line options that do not change the generated text
+    private static readonly neutralOptions = [
+        'jobs', 'stats', 'watch', 'suppressOutput', 'outDir', 'run_on_compile', 'no_cache', 'cache_limit', 'unity'];
+
+    private static compilerHash: string;
+
+    private signatures = new Map<string, string>();
+    private globals: string;
+    private globalsOf: ts.Program;
+
+    public hits = 0;
+    public misses = 0;
+    public evicted = 0;
+
+    public constructor(private folder: string, private limit: number) {
+        if (!fs.pathExistsSync(this.folder)) {
+            fs.mkdirSync(this.folder, {recursive: true});
+        }
+    }
+
+    public key(
+        program: ts.Program, s: ts.SourceFile, dependencies: DependencyGraph, options: ts.CompilerOptions,
+        cmdLineOptions: any, rootFolder: string): string {
+
+        const emitOptions = {};
+        Object.keys(cmdLineOptions).sort()
+            .filter(name => TranslationCache.neutralOptions.indexOf(name) === -1)
+            .forEach(name => emitOptions[name] = cmdLineOptions[name]);
+
+        const imports = dependencies.transitiveImportsOf(s.fileName)
+            .map(fileName => fileName + ':' + this.signature(program, fileName));
+
+        return OutputCache.hash([
+            TranslationCache.getCompilerHash(),
+            JSON.stringify(options || {}),
+            JSON.stringify(emitOptions),
+            rootFolder,
+            this.globalSignature(program),
+            s.fileName,
+            OutputCache.hash(s.text)
+        ].concat(imports).join('\n'));
+    }
+
+    public get(key: string): EmittedFile {
+        const fileName = path.join(this.folder, key + '.json');
+        try {
+            const file = JSON.parse(fs.readFileSync(fileName).toString());
+            const now = new Date();
+            fs.utimesSync(fileName, now, now);
+            this.hits++;
+            return file;
+        } catch (e) {
+            this.misses++;
+            return undefined;
+        }
+    }
+
+    public set(key: string, file: EmittedFile) {
+        fs.writeFileSync(path.join(this.folder, key + '.json'), JSON.stringify(file));
+    }
+
+    public evict() {
+        const entries = fs.readdirSync(this.folder)
+            .filter(name => name.endsWith('.json'))
+            .map(name => {
+                const fileName = path.join(this.folder, name);
+                const stat = fs.statSync(fileName);
+                return { fileName, size: stat.size, used: stat.mtimeMs };
+            })
+            .sort((a, b) => a.used - b.used);
+
+        let total = entries.reduce((sum, entry) => sum + entry.size, 0);
+        for (const entry of entries) {
+            if (total <= this.limit) {
+                break;
+            }
+
+            fs.unlinkSync(entry.fileName);
+            total -= entry.size;
+            this.evicted++;
+        }
+    }
+
+    private globalSignature(program: ts.Program): string {
+        if (this.globalsOf !== program) {
+            this.globals = OutputCache.hash(program.getSourceFiles()
+                .filter(s => !program.isSourceFileDefaultLibrary(s) && (s.isDeclarationFile || !ts.isExternalModule(s)))
+                .map(s => s.fileName + ':' + this.signature(program, s.fileName))
+                .join('\n'));
+            this.globalsOf = program;
+        }
+
+        return this.globals;
+    }
+
+    private signature(program: ts.Program, fileName: string): string {
+        let signature = this.signatures.get(fileName);
+        if (signature) {
+            return signature;
+        }
+
+        const s = program.getSourceFile(fileName);
+        if (!s) {
+            signature = fs.existsSync(fileName) ? OutputCache.hash(fs.readFileSync(fileName).toString()) : 'missing';
+        } else {
+            const parts: string[] = [];
+            let position = 0;
+            const visit = (node: ts.Node) => {
+                if (ts.isFunctionLike(node) && node.type && (<ts.FunctionLikeDeclaration>node).body) {
+                    const body = (<ts.FunctionLikeDeclaration>node).body;
+                    parts.push(s.text.substring(position, body.pos));
+                    position = body.end;
+                    return;
+                }
+
+                ts.forEachChild(node, visit);
+            };
+
+            ts.forEachChild(s, visit);
+            parts.push(s.text.substring(position));
+            signature = OutputCache.hash(parts.join(';'));
+        }
+
+        this.signatures.set(fileName, signature);
+        return signature;
+    }
+
+    private static getCompilerHash(): string {
+        if (!TranslationCache.compilerHash) {
+            const scripts = fs.readdirSync(__dirname)
+                .filter(name => /\.(js|ts)$/.test(name))
+                .sort()
+                .map(name => fs.readFileSync(path.join(__dirname, name)).toString());
+            TranslationCache.compilerHash = OutputCache.hash([ts.version].concat(scripts).join('\n'));
+        }
+
+        return TranslationCache.compilerHash;
+    }
+}
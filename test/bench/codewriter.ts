@@ -0,0 +1,85 @@
+// CodeWriter benchmark: memory held while emitting a large module, the previous writer
+// (one array entry per token, joined in getText) against the chunked one.
+//
+//   npx ts-node test/bench/codewriter.ts          (node --expose-gc for stable numbers)
+//
+import { CodeWriter } from '../../src/codewriter';
+
+declare var process: any;
+declare var global: any;
+
+// the previous CodeWriter, reduced to what the benchmark calls
+class PartsWriter {
+    private parts = new Array<string>();
+    private intent = 0;
+    private pendingIntent = false;
+
+    public BeginBlock() { this.writeStringNewLine('{'); this.intent += 4; this.pendingIntent = true; }
+    public EndBlock() { this.intent -= 4; this.writeStringNewLine('}'); }
+    public EndOfStatement() { this.writeStringNewLine(';'); }
+    public writeString(data: string) {
+        if (this.pendingIntent) {
+            this.parts.push(' '.repeat(this.intent));
+            this.pendingIntent = false;
+        }
+
+        this.parts.push(data);
+    }
+
+    public writeStringNewLine(data?: string) {
+        if (data) {
+            this.writeString(data);
+        }
+
+        this.parts.push('\n');
+        if (this.intent > 0) {
+            this.pendingIntent = true;
+        }
+    }
+
+    public getText() { return this.parts.join(''); }
+}
+
+function emit(writer: PartsWriter | CodeWriter, functions: number) {
+    for (let f = 0; f < functions; f++) {
+        writer.writeString('any ');
+        writer.writeString('function' + f);
+        writer.writeStringNewLine('(any a, any b)');
+        writer.BeginBlock();
+        for (let s = 0; s < 10; s++) {
+            writer.writeString('auto v' + s);
+            writer.writeString(' = ');
+            writer.writeString('a');
+            writer.writeString(' + ');
+            writer.writeString('b');
+            writer.writeString(' * ');
+            writer.writeString(String(s));
+            writer.EndOfStatement();
+        }
+
+        writer.writeString('return v9');
+        writer.EndOfStatement();
+        writer.EndBlock();
+    }
+}
+
+function measure(name: string, create: () => PartsWriter | CodeWriter) {
+    if (global.gc) {
+        global.gc();
+    }
+
+    const before = process.memoryUsage().heapUsed;
+    const start = Date.now();
+    const writer = create();
+    emit(writer, 40000);
+    const written = process.memoryUsage().heapUsed;
+    const text = writer.getText();
+    const elapsed = Date.now() - start;
+    const joined = process.memoryUsage().heapUsed;
+    console.log(`${name}: ${(text.length / 1048576).toFixed(1)} MB of text, ${elapsed} ms, `
+        + `heap +${((written - before) / 1048576).toFixed(1)} MB after writing, `
+        + `+${((joined - before) / 1048576).toFixed(1)} MB after getText`);
+}
+
+measure('parts array', () => new PartsWriter());
+measure('chunked    ', () => new CodeWriter());
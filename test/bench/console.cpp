@@ -0,0 +1,71 @@
+// Console benchmark: console.log through the buffered sink against the previous
+// std::cout << ... << std::endl, which flushed every line. Redirect stdout to a file
+// or pipe, timings go to stderr.
+//
+//   g++ -std=c++20 -O2 -I../.. console.cpp -o console && ./console > /dev/null
+//   TSCXX_CONSOLE=line ./console > log.txt
+//
+#include "cpplib/core.h"
+
+#include <chrono>
+
+template <typename F>
+static double measure(const char *name, F f)
+{
+    auto start = std::chrono::steady_clock::now();
+    f();
+    auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cerr << name << ": " << elapsed << " ms" << std::endl;
+    return elapsed;
+}
+
+int main(int argc, char **argv)
+{
+    const auto lines = 1000000;
+
+    auto flushed = measure("std::cout << std::endl", [&]()
+                           {
+                               for (auto i = 0; i < lines; i++)
+                               {
+                                   std::cout << "request " << i << " served in " << js::number(i % 97 * 0.25) << " ms" << std::endl;
+                               }
+                           });
+
+    auto buffered = measure("console.log", [&]()
+                            {
+                                for (auto i = 0; i < lines; i++)
+                                {
+                                    js::console->log("request ", i, " served in ", js::number(i % 97 * 0.25), " ms");
+                                }
+
+                                js::console_sink().flush();
+                            });
+
+    std::cerr << "speedup: " << flushed / buffered << "x" << std::endl;
+
+    // four producers share the writer thread
+    measure("console.log x4 threads", [&]()
+            {
+                std::vector<std::thread> threads;
+                for (auto t = 0; t < 4; t++)
+                {
+                    threads.emplace_back([&, t]()
+                                         {
+                                             for (auto i = 0; i < lines / 4; i++)
+                                             {
+                                                 js::console->log("thread ", t, " request ", i);
+                                             }
+                                         });
+                }
+
+                for (auto &thread : threads)
+                {
+                    thread.join();
+                }
+
+                js::console_sink().flush();
+            });
+
+    js::console_sink().shutdown();
+    return 0;
+}
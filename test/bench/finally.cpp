@@ -0,0 +1,64 @@
+// try...finally benchmark: the scope guard emitted for every entry to a try block with a
+// finally clause, the old std::function based guard against utils::finally<F>.
+//
+//   g++ -std=c++20 -O2 -I../.. finally.cpp -o finally
+//
+#include "cpplib/core.h"
+
+#include <chrono>
+
+using namespace js;
+
+template <typename F>
+static double measure(const char *name, F f)
+{
+    auto start = std::chrono::steady_clock::now();
+    auto total = f();
+    auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << name << ": " << elapsed << " ms (" << total << ")" << std::endl;
+    return elapsed;
+}
+
+struct function_finally
+{
+private:
+    std::function<void()> _dtor;
+
+public:
+    function_finally(std::function<void()> dtor) : _dtor(dtor){};
+    ~function_finally() { _dtor(); }
+};
+
+int main(int argc, char **argv)
+{
+    const auto iterations = 10000000;
+
+    // captures more than fit the small buffer of std::function
+    auto previous = measure("std::function guard", [&]()
+                            {
+                                size_t total = 0, opened = 0, closed = 0, failed = 0;
+                                for (auto i = 0; i < iterations; i++)
+                                {
+                                    function_finally __finally([&]() { closed++; total += opened - closed + failed + i; });
+                                    opened++;
+                                }
+
+                                return total;
+                            });
+
+    auto guard = measure("utils::finally<F>", [&]()
+                         {
+                             size_t total = 0, opened = 0, closed = 0, failed = 0;
+                             for (auto i = 0; i < iterations; i++)
+                             {
+                                 utils::finally __finally([&]() { closed++; total += opened - closed + failed + i; });
+                                 opened++;
+                             }
+
+                             return total;
+                         });
+
+    std::cout << "speedup: " << previous / guard << "x" << std::endl;
+
+    return 0;
+}
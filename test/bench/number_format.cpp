@@ -0,0 +1,85 @@
+// Number formatting benchmark: JS ToString(Number) via js::numfmt against the
+// std::ostringstream path the runtime used before.
+//
+//   g++ -std=c++20 -O2 -I../.. number_format.cpp -o number_format
+//
+#include "cpplib/core.h"
+
+#include <chrono>
+#include <random>
+
+template <typename F>
+static double measure(const char *name, F f)
+{
+    auto start = std::chrono::steady_clock::now();
+    auto total = f();
+    auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << name << ": " << elapsed << " ms (" << total << " chars)" << std::endl;
+    return elapsed;
+}
+
+int main(int argc, char **argv)
+{
+    std::mt19937_64 random(42);
+    std::uniform_real_distribution<double> distribution(-1e6, 1e6);
+    std::vector<double> values(1000000);
+    for (auto &value : values)
+    {
+        value = distribution(random);
+    }
+
+    auto streams = measure("ostringstream", [&]()
+                           {
+                               size_t total = 0;
+                               for (auto value : values)
+                               {
+                                   js::tostringstream stream;
+                                   stream << value;
+                                   total += stream.str().size();
+                               }
+
+                               return total;
+                           });
+
+    auto streams_exact = measure("ostringstream precision(17)", [&]()
+                                 {
+                                     size_t total = 0;
+                                     for (auto value : values)
+                                     {
+                                         js::tostringstream stream;
+                                         stream.precision(17);
+                                         stream << value;
+                                         total += stream.str().size();
+                                     }
+
+                                     return total;
+                                 });
+
+    auto to_chars = measure("numfmt::append_number", [&]()
+                            {
+                                size_t total = 0;
+                                js::tstring out;
+                                for (auto value : values)
+                                {
+                                    out.clear();
+                                    js::numfmt::append_number(out, value);
+                                    total += out.size();
+                                }
+
+                                return total;
+                            });
+
+    measure("number::toFixed(2)", [&]()
+            {
+                size_t total = 0;
+                for (auto value : values)
+                {
+                    total += js::number(value).toFixed(2)._value.size();
+                }
+
+                return total;
+            });
+
+    std::cout << "speedup vs ostringstream: " << streams / to_chars << "x, vs precision(17): " << streams_exact / to_chars << "x" << std::endl;
+    return 0;
+}
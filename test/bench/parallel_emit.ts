@@ -0,0 +1,59 @@
+// Emission benchmark: translates a synthetic project of 600 files with -jobs 1, 2, 4 and 8
+// and checks that every job count produces the same output.
+//
+//   npx ts-node test/bench/parallel_emit.ts [files]
+//
+import { Run } from '../../src/compiler';
+import * as fs from 'fs-extra';
+import * as os from 'os';
+import * as path from 'path';
+
+declare var process: any;
+
+const fileCount = Number(process.argv[2]) || 600;
+const projectDir = fs.mkdtempSync(path.join(os.tmpdir(), 'tsc-cxx-bench-'));
+
+for (let i = 0; i < fileCount; i++) {
+    const previous = i > 0 ? `import { Shape${i - 1} } from './shape${i - 1}';\n` : '';
+    fs.writeFileSync(path.join(projectDir, `shape${i}.ts`), `${previous}
+export class Shape${i} {
+    private points: number[] = [];
+    constructor(private name: string) {}
+    add(x: number, y: number) { this.points.push(x, y); return this; }
+    area(): number {
+        let sum = 0;
+        for (let p = 0; p + 3 < this.points.length; p += 2) {
+            sum += this.points[p] * this.points[p + 3] - this.points[p + 2] * this.points[p + 1];
+        }
+        return Math.abs(sum) / 2;
+    }
+    describe(): string {
+        switch (this.points.length) {
+            case 0: return this.name + ' is empty';
+            case 2: return this.name + ' is a point';
+            default: return this.name + ' has area ' + this.area();
+        }
+    }
+}
+`);
+}
+
+// output names are relative to the working folder
+process.chdir(projectDir);
+const sources = fs.readdirSync(projectDir);
+let baseline: string;
+let sequential: number;
+[1, 2, 4, 8].forEach(jobs => {
+    const outDir = `out${jobs}`;
+    const start = Date.now();
+    new Run().compileSources(sources, { suppressOutput: true, outDir, jobs });
+    const elapsed = Date.now() - start;
+
+    const output = fs.readdirSync(outDir).filter(f => f[0] !== '.').sort().map(f => fs.readFileSync(path.join(outDir, f)).toString()).join('\n');
+    baseline = baseline || output;
+    sequential = sequential || elapsed;
+    console.log(`-jobs ${jobs}: ${elapsed} ms, speedup ${(sequential / elapsed).toFixed(2)}x${output === baseline ? '' : ', OUTPUT DIFFERS'}`);
+});
+
+process.chdir(os.tmpdir());
+fs.removeSync(projectDir);
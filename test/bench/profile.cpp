@@ -0,0 +1,47 @@
+// -instrument benchmark: cost of the profile::scope probe emitted at the top of every
+// function body, on a call-heavy recursion with and without probes.
+//
+//   g++ -std=c++20 -O2 -I../.. profile.cpp -o profile
+//
+#include "cpplib/core.h"
+
+#include <chrono>
+
+using namespace js;
+
+template <typename F>
+static double measure(const char *name, F f)
+{
+    auto start = std::chrono::steady_clock::now();
+    auto total = f();
+    auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << name << ": " << elapsed << " ms (" << total << ")" << std::endl;
+    return elapsed;
+}
+
+static int fib(int n)
+{
+    return n < 2 ? n : fib(n - 1) + fib(n - 2);
+}
+
+static int fib_probed(int n)
+{
+    static js::profile::site __profile_site{"fib_probed (profile.ts:1)"};
+    js::profile::scope __profile_scope(__profile_site);
+    return n < 2 ? n : fib_probed(n - 1) + fib_probed(n - 2);
+}
+
+int main(int argc, char **argv)
+{
+    const auto n = 32;
+    // fib(32) makes 7049155 calls
+    const auto calls = 7049155.0;
+
+    auto plain = measure("without probes", [&]() { return fib(n); });
+    auto probed = measure("with probes", [&]() { return fib_probed(n); });
+    std::cout << "per probed call: " << probed * 1e6 / calls << " ns, plain " << plain * 1e6 / calls << " ns" << std::endl;
+
+    // the recorded tree goes to TSCXX_PROFILE, profile.folded by default
+    js::profile::dump();
+    return 0;
+}
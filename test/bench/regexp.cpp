@@ -0,0 +1,114 @@
+// RegExp benchmark: js::regexp against std::regex, which js::RegExp wrapped before,
+// on access log lines in the Apache combined format.
+//
+//   g++ -std=c++20 -O2 -I../.. regexp.cpp -o regexp
+//
+#include "cpplib/core.h"
+
+#include <chrono>
+#include <regex>
+
+template <typename F>
+static double measure(const char *name, F f)
+{
+    auto start = std::chrono::steady_clock::now();
+    auto total = f();
+    auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << name << ": " << elapsed << " ms (" << total << " chars matched)" << std::endl;
+    return elapsed;
+}
+
+int main(int argc, char **argv)
+{
+    std::vector<js::tstring> lines;
+    for (auto i = 0; i < 200000; i++)
+    {
+        js::tostringstream line;
+        line << TXT("10.0.") << i % 256 << TXT(".") << i % 199 << TXT(" - frank [10/Oct/2000:13:55:") << 10 + i % 50
+             << TXT(" -0700] \"GET /apache_pb") << i << TXT(".gif HTTP/1.0\" ") << (i % 7 ? 200 : 404) << TXT(" ") << i * 7 % 5000;
+        lines.push_back(line.str());
+    }
+
+    const js::char_t *patterns[] = {
+        TXT("\\[(\\d+)/(\\w+)/(\\d+):(\\d+):(\\d+):(\\d+) ([-+]\\d+)\\]"),
+        TXT("\"(GET|POST|PUT) (\\S+) HTTP/(\\d\\.\\d)\" (\\d{3})"),
+        TXT("^(\\S+) \\S+ (\\S+)"),
+        TXT("\" 404 "),
+        TXT("(\\d+)$"),
+    };
+
+    for (auto pattern : patterns)
+    {
+        std::cout << js::string(pattern) << std::endl;
+
+#ifdef UNICODE
+        std::wregex re(pattern);
+        std::wsmatch match;
+#else
+        std::regex re(pattern);
+        std::smatch match;
+#endif
+        auto std_regex = measure("  std::regex", [&]()
+                                 {
+                                     size_t total = 0;
+                                     for (auto &line : lines)
+                                     {
+                                         if (std::regex_search(line, match, re))
+                                         {
+                                             total += match[0].length();
+                                         }
+                                     }
+
+                                     return total;
+                                 });
+
+        auto program = js::regexp::compile(pattern, TXT(""));
+        auto engine = measure("  js::regexp", [&]()
+                              {
+                                  size_t total = 0;
+                                  std::vector<size_t> captures;
+                                  for (auto &line : lines)
+                                  {
+                                      if (js::regexp::search(*program, line, 0, captures))
+                                      {
+                                          total += captures[1] - captures[0];
+                                      }
+                                  }
+
+                                  return total;
+                              });
+
+        std::cout << "  speedup: " << std_regex / engine << "x" << std::endl;
+    }
+
+    // construction cost: new RegExp(...) per evaluation hits the program cache
+    measure("std::regex construction x10000", [&]()
+            {
+                size_t total = 0;
+                for (auto i = 0; i < 10000; i++)
+                {
+#ifdef UNICODE
+                    std::wregex re(patterns[0]);
+#else
+                    std::regex re(patterns[0]);
+#endif
+                    total += re.mark_count();
+                }
+
+                return total;
+            });
+
+    measure("js::RegExp construction x10000", [&]()
+            {
+                size_t total = 0;
+                for (auto i = 0; i < 10000; i++)
+                {
+                    js::RegExp re(js::string(patterns[0]));
+                    total += re._program->groups;
+                }
+
+                return total;
+            });
+
+    return 0;
+}
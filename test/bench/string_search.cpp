@@ -0,0 +1,109 @@
+// String search benchmark: js::strsearch against std::basic_string::find on access log
+// lines, for indexOf, includes, split and replaceAll.
+//
+//   g++ -std=c++20 -O2 -I../.. string_search.cpp -o string_search
+//
+#include "cpplib/core.h"
+
+#include <chrono>
+
+template <typename F>
+static double measure(const char *name, F f)
+{
+    auto start = std::chrono::steady_clock::now();
+    auto total = f();
+    auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << name << ": " << elapsed << " ms (" << total << ")" << std::endl;
+    return elapsed;
+}
+
+int main(int argc, char **argv)
+{
+    std::vector<js::tstring> lines;
+    for (auto i = 0; i < 200000; i++)
+    {
+        js::tostringstream line;
+        line << TXT("10.0.") << i % 256 << TXT(".") << i % 199 << TXT(" - frank [10/Oct/2000:13:55:") << 10 + i % 50
+             << TXT(" -0700] \"GET /static/assets/images/apache_pb") << i << TXT(".gif HTTP/1.0\" ") << (i % 7 ? 200 : 404) << TXT(" ") << i * 7 % 5000
+             << TXT(" \"http://www.example.com/start.html\" \"Mozilla/4.08 [en] (Win98; I ;Nav)\"");
+        lines.push_back(line.str());
+    }
+
+    const js::char_t *needles[] = {TXT("HTTP/1.0"), TXT("\" 404 "), TXT("Mozilla/5.0"), TXT("(Win98; I ;Nav)")};
+    for (auto needle : needles)
+    {
+        std::cout << js::string(needle) << std::endl;
+
+        auto naive = measure("  std::string::find", [&]()
+                             {
+                                 size_t total = 0;
+                                 for (auto &line : lines)
+                                 {
+                                     total += line.find(needle) + 1;
+                                 }
+
+                                 return total;
+                             });
+
+        auto vectorized = measure("  strsearch::find", [&]()
+                                  {
+                                      size_t total = 0;
+                                      for (auto &line : lines)
+                                      {
+                                          total += js::strsearch::find(line, needle) + 1;
+                                      }
+
+                                      return total;
+                                  });
+
+        std::cout << "  speedup: " << naive / vectorized << "x" << std::endl;
+    }
+
+    measure("std::string::find split on ' '", [&]()
+            {
+                size_t total = 0;
+                std::vector<js::tstring> pieces;
+                for (auto &line : lines)
+                {
+                    pieces.clear();
+                    size_t start = 0;
+                    for (auto found = line.find(' '); found != js::tstring::npos; found = line.find(' ', start))
+                    {
+                        pieces.push_back(line.substr(start, found - start));
+                        start = found + 1;
+                    }
+
+                    pieces.push_back(line.substr(start));
+                    total += pieces.size();
+                }
+
+                return total;
+            });
+
+    measure("string::split(\" \")", [&]()
+            {
+                size_t total = 0;
+                js::string separator(TXT(" "));
+                for (auto &line : lines)
+                {
+                    total += js::string(line).split(separator).size();
+                }
+
+                return total;
+            });
+
+    measure("string::replaceAll(\"/\", \"\\\\\")", [&]()
+            {
+                size_t total = 0;
+                js::string pattern(TXT("/"));
+                js::string replacement(TXT("\\"));
+                for (auto &line : lines)
+                {
+                    total += js::string(line).replaceAll(pattern, replacement)._value.size();
+                }
+
+                return total;
+            });
+
+    return 0;
+}
@@ -0,0 +1,170 @@
+// Switch benchmark: the dispatch loops of lang-test0/34switch.ts, lowered the old way
+// (switch_type keyed by any, indexed with operator[]) and the way the emitter lowers
+// them now: switch_int for integer cases, number_switch for fractional ones and an
+// ordered compare chain when a case is not constant.
+//
+//   g++ -std=c++20 -O2 -I../.. switch.cpp -o switch
+//
+#include "cpplib/core.h"
+
+#include <chrono>
+
+using namespace js;
+
+template <typename F>
+static double measure(const char *name, F f)
+{
+    auto start = std::chrono::steady_clock::now();
+    auto total = f();
+    auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << name << ": " << elapsed << " ms (" << total << ")" << std::endl;
+    return elapsed;
+}
+
+static number bar(number x)
+{
+    return x;
+}
+
+int main(int argc, char **argv)
+{
+    const auto iterations = 2000000;
+
+    std::cout << "testQuick, dense integer cases" << std::endl;
+    auto map = measure("  switch_type[]", [&]()
+                       {
+                           size_t total = 0;
+                           for (auto i = 0; i < iterations; i++)
+                           {
+                               static switch_type cases = {{any(0), 1}, {any(1), 2}, {any(3), 3}, {any(4), 4}, {any(5), 5}};
+                               switch (cases[any(number(i % 7))])
+                               {
+                               case 1: total += 1; break;
+                               case 2: total += 2; break;
+                               case 3: total += 4; break;
+                               case 4: total += 5; break;
+                               case 5: total += 6; break;
+                               default: total += 7; break;
+                               }
+                           }
+
+                           return total;
+                       });
+
+    auto native = measure("  switch_int", [&]()
+                          {
+                              size_t total = 0;
+                              for (auto i = 0; i < iterations; i++)
+                              {
+                                  switch (switch_int(number(i % 7)))
+                                  {
+                                  case 0: total += 1; break;
+                                  case 1: total += 2; break;
+                                  case 3: total += 4; break;
+                                  case 4: total += 5; break;
+                                  case 5: total += 6; break;
+                                  default: total += 7; break;
+                                  }
+                              }
+
+                              return total;
+                          });
+
+    std::cout << "  speedup: " << map / native << "x" << std::endl;
+
+    std::cout << "sparse integer cases, any discriminant" << std::endl;
+    map = measure("  switch_type[]", [&]()
+                  {
+                      size_t total = 0;
+                      for (auto i = 0; i < iterations; i++)
+                      {
+                          static switch_type cases = {{any(-100), 1}, {any(7), 2}, {any(4096), 3}, {any(1000000), 4}};
+                          any value(number((i % 5) * 1000000 - 100));
+                          total += cases[value];
+                      }
+
+                      return total;
+                  });
+
+    native = measure("  switch_int", [&]()
+                     {
+                         size_t total = 0;
+                         for (auto i = 0; i < iterations; i++)
+                         {
+                             any value(number((i % 5) * 1000000 - 100));
+                             switch (switch_int(value))
+                             {
+                             case -100: total += 1; break;
+                             case 7: total += 2; break;
+                             case 4096: total += 3; break;
+                             case 1000000: total += 4; break;
+                             }
+                         }
+
+                         return total;
+                     });
+
+    std::cout << "  speedup: " << map / native << "x" << std::endl;
+
+    std::cout << "fractional cases" << std::endl;
+    map = measure("  switch_type[]", [&]()
+                  {
+                      size_t total = 0;
+                      for (auto i = 0; i < iterations; i++)
+                      {
+                          static switch_type cases = {{any(0.25), 1}, {any(0.5), 2}, {any(1.5), 3}, {any(2.75), 4}};
+                          total += cases[any(number((i % 12) * 0.25))];
+                      }
+
+                      return total;
+                  });
+
+    native = measure("  number_switch", [&]()
+                     {
+                         size_t total = 0;
+                         static const number_switch<4> cases = {{{0.25, 1}, {0.5, 2}, {1.5, 3}, {2.75, 4}}};
+                         for (auto i = 0; i < iterations; i++)
+                         {
+                             total += cases(number((i % 12) * 0.25));
+                         }
+
+                         return total;
+                     });
+
+    std::cout << "  speedup: " << map / native << "x" << std::endl;
+
+    std::cout << "testIt, non-constant cases" << std::endl;
+    map = measure("  switch_type rebuilt", [&]()
+                  {
+                      size_t total = 0;
+                      for (auto i = 0; i < iterations; i++)
+                      {
+                          switch_type cases = {{any(bar(0)), 1}, {any(bar(1)), 2}, {any(bar(2)), 3}};
+                          total += cases[any(number(i % 4))];
+                      }
+
+                      return total;
+                  });
+
+    native = measure("  compare chain", [&]()
+                     {
+                         size_t total = 0;
+                         for (auto i = 0; i < iterations; i++)
+                         {
+                             total += [&]()
+                             {
+                                 auto &&value = number(i % 4);
+                                 if (value == (bar(0))) return 1;
+                                 if (value == (bar(1))) return 2;
+                                 if (value == (bar(2))) return 3;
+                                 return 0;
+                             }();
+                         }
+
+                         return total;
+                     });
+
+    std::cout << "  speedup: " << map / native << "x" << std::endl;
+
+    return 0;
+}